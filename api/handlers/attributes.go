@@ -7,6 +7,7 @@ import (
 
 	"github.com/equinor/oneseismic-api/internal/cache"
 	"github.com/equinor/oneseismic-api/internal/core"
+	"github.com/equinor/oneseismic-api/internal/scheduler"
 )
 
 // AttributesAlongSurfacePost godoc
@@ -26,6 +27,7 @@ func (e *Endpoint) AttributesAlongSurfacePost(ctx *gin.Context) {
 	if abortOnError(ctx, err) {
 		return
 	}
+	prepareSurfaceLogging(ctx, request.Surface)
 
 	e.makeDataRequest(ctx, request)
 }
@@ -47,10 +49,24 @@ func (e *Endpoint) AttributesBetweenSurfacesPost(ctx *gin.Context) {
 	if abortOnError(ctx, err) {
 		return
 	}
+	prepareSurfaceLogging(ctx, request.PrimarySurface)
 
 	e.makeDataRequest(ctx, request)
 }
 
+/** Size of the surface, and the number of chunks the core computes it in,
+ *  for the slow request recorder
+ */
+func prepareSurfaceLogging(ctx *gin.Context, surface core.RegularSurface) {
+	nrows := len(surface.Values)
+	ncols := 0
+	if nrows > 0 {
+		ncols = len(surface.Values[0])
+	}
+	ctx.Set("surface-size", nrows*ncols)
+	ctx.Set("attribute-chunks", core.AttributeChunks(nrows, ncols))
+}
+
 // Query for Attribute endpoints
 // @Description Query payload for attribute endpoint.
 type AttributeRequest struct {
@@ -88,6 +104,30 @@ type AttributeRequest struct {
 	Attributes []string `json:"attributes" binding:"required" swaggertype:"array,string" example:"min,max"`
 } //@name AttributeRequest
 
+func (r AttributeRequest) writeHash(hasher *cache.Hasher) {
+	r.RequestedResource.writeHash(hasher)
+	hasher.WriteString(r.Interpolation)
+	hasher.WriteFloat32(r.Stepsize)
+	hasher.WriteStrings(r.Attributes)
+}
+
+func writeSurfaceHash(hasher *cache.Hasher, surface core.RegularSurface) {
+	hasher.WriteFloat32Matrix(surface.Values)
+	hasher.WriteOptionalFloat32(surface.Rotation)
+	hasher.WriteOptionalFloat32(surface.Xori)
+	hasher.WriteOptionalFloat32(surface.Yori)
+	hasher.WriteFloat32(surface.Xinc)
+	hasher.WriteFloat32(surface.Yinc)
+	hasher.WriteOptionalFloat32(surface.FillValue)
+}
+
+/** Attribute calculations read large parts of the cube and can run for
+ *  minutes, so they are scheduled separately from slices and fences
+ */
+func (r AttributeRequest) schedulingClass() scheduler.Class {
+	return scheduler.Batch
+}
+
 // Query for Attribute along the surface endpoints
 // @Description Query payload for attribute "along" endpoint.
 type AttributeAlongSurfaceRequest struct {
@@ -159,9 +199,13 @@ func (request AttributeAlongSurfaceRequest) execute(
  * I.e. every field except the sas token.
  */
 func (h AttributeAlongSurfaceRequest) hash() (string, error) {
-	// Strip the sas tokens before computing hash
-	h.Sas = nil
-	return cache.Hash(h)
+	hasher := cache.NewHasher()
+	hasher.WriteString("attributes/along")
+	h.AttributeRequest.writeHash(hasher)
+	writeSurfaceHash(hasher, h.Surface)
+	hasher.WriteFloat32(h.Above)
+	hasher.WriteFloat32(h.Below)
+	return hasher.Sum(), nil
 }
 
 func (h AttributeAlongSurfaceRequest) toString() (string, error) {
@@ -240,9 +284,12 @@ func (request AttributeBetweenSurfacesRequest) execute(
  * I.e. every field except the sas token.
  */
 func (h AttributeBetweenSurfacesRequest) hash() (string, error) {
-	// Strip the sas tokens before computing hash
-	h.Sas = nil
-	return cache.Hash(h)
+	hasher := cache.NewHasher()
+	hasher.WriteString("attributes/between")
+	h.AttributeRequest.writeHash(hasher)
+	writeSurfaceHash(hasher, h.PrimarySurface)
+	writeSurfaceHash(hasher, h.SecondarySurface)
+	return hasher.Sum(), nil
 }
 
 func (h AttributeBetweenSurfacesRequest) toString() (string, error) {
@@ -1,15 +1,23 @@
 package handlers
 
 import (
+	"context"
 	"encoding/json"
+	"errors"
 	"fmt"
 	"net/http"
+	"net/url"
+	"sort"
+	"strings"
 
 	"github.com/gin-gonic/gin"
 	"github.com/gin-gonic/gin/binding"
 
 	"github.com/equinor/oneseismic-api/internal/cache"
 	"github.com/equinor/oneseismic-api/internal/core"
+	"github.com/equinor/oneseismic-api/internal/readahead"
+	"github.com/equinor/oneseismic-api/internal/scheduler"
+	"github.com/equinor/oneseismic-api/internal/warmup"
 )
 
 func httpStatusCode(err error) int {
@@ -18,6 +26,8 @@ func httpStatusCode(err error) int {
 		return http.StatusBadRequest
 	case *core.InternalError:
 		return http.StatusInternalServerError
+	case *core.ResourceExhausted:
+		return http.StatusServiceUnavailable
 	default:
 		return http.StatusInternalServerError
 	}
@@ -54,6 +64,17 @@ func abortOnError(ctx *gin.Context, err error) bool {
 type Endpoint struct {
 	MakeVdsConnection core.ConnectionMaker
 	Cache             cache.Cache
+	// Pool of opened handles. Handles are opened per request if nil
+	Handles *core.HandlePool
+	// Memory budget for data requests. Memory is not limited if nil
+	Admission core.MemoryBudget
+	// Scheduler of data requests. Requests are not queued if nil
+	Scheduler *scheduler.Scheduler
+	// Reads ahead of sequential requests. Nothing is read ahead if nil
+	ReadAhead *readahead.ReadAhead
+	// Warm-up jobs started through the prefetch endpoint. Prefetching is
+	// disabled if nil
+	Warmups *warmup.Jobs
 }
 
 func prepareRequestLogging(ctx *gin.Context, request Stringable) {
@@ -69,12 +90,52 @@ func prepareMetricsLogging(ctx *gin.Context, request interface {
 	ctx.Set("vds", vds)
 }
 
+/** Stages of the request, created on first use
+ *
+ * The stages are stored on the gin context such that middleware can report
+ * them once the request is done.
+ */
+func requestStages(ctx *gin.Context) *core.Stages {
+	if stages, exists := ctx.Get("stages"); exists {
+		return stages.(*core.Stages)
+	}
+	stages := core.NewStages()
+	ctx.Set("stages", stages)
+	return stages
+}
+
+/** Storage reads of the request, created on first use */
+func requestIO(ctx *gin.Context) *core.IOStats {
+	if io, exists := ctx.Get("io"); exists {
+		return io.(*core.IOStats)
+	}
+	io := core.NewIOStats()
+	ctx.Set("io", io)
+	return io
+}
+
+/** Memory and CPU used by the C++ core for the request, created on first use */
+func requestResources(ctx *gin.Context) *core.ResourceStats {
+	if resources, exists := ctx.Get("resources"); exists {
+		return resources.(*core.ResourceStats)
+	}
+	resources := core.NewResourceStats()
+	ctx.Set("resources", resources)
+	return resources
+}
+
 func (e *Endpoint) makeDataRequest(
 	ctx *gin.Context,
 	request DataRequest,
 ) {
 	prepareRequestLogging(ctx, request)
 	prepareMetricsLogging(ctx, request)
+	stages := requestStages(ctx)
+
+	explain := request.getRequestedResource().Explain
+	if abortOnError(ctx, validateExplain(explain)) {
+		return
+	}
 
 	connections, binaryOperator, err := e.readConnectionParameters(ctx, request.getRequestedResource())
 	if err != nil {
@@ -86,8 +147,27 @@ func (e *Endpoint) makeDataRequest(
 		return
 	}
 
-	cacheEntry, hit := e.Cache.Get(cacheKey)
-	if hit {
+	if explain != explainEstimate {
+		defer e.readAhead(ctx, request)
+	}
+
+	respond := func(metadata []byte, data [][]byte) {
+		if explain == explainProfile {
+			metadata, err = withExplanation(metadata, explainRequest(ctx))
+			if abortOnError(ctx, err) {
+				return
+			}
+		}
+		defer stages.Start("write")()
+		writeResponse(ctx, metadata, data)
+	}
+
+	vdsUrls, _, _ := request.credentials()
+
+	stopCache := stages.Start("cache")
+	cacheEntry, tier, hit := cache.Lookup(e.Cache, cacheKey)
+	stopCache()
+	if hit && cacheEntry.ReadFrom(vdsUrls) {
 		var isAuthorizedToRead = true
 		for i := 0; i < len(connections); i++ {
 			if !connections[i].IsAuthorizedToRead() {
@@ -96,25 +176,220 @@ func (e *Endpoint) makeDataRequest(
 		}
 		if isAuthorizedToRead {
 			ctx.Set("cache-hit", true)
-			writeResponse(ctx, cacheEntry.Metadata(), cacheEntry.Data())
+			ctx.Set("cache", "hit")
+			ctx.Set("cache-tier", tier)
+			if explain == explainEstimate {
+				writeEstimate(ctx, 0)
+				return
+			}
+			respond(cacheEntry.Metadata(), cacheEntry.Data())
 			return
 		}
 	}
 
-	handle, err := core.CreateDSHandle(connections, binaryOperator)
+	if derivable, ok := request.(DerivableRequest); ok {
+		open := func() (core.DSHandle, error) {
+			handle, err := core.OpenDSHandle(e.Handles, connections, binaryOperator)
+			if err != nil {
+				return handle, err
+			}
+			return handle.WithStages(stages).WithIOStats(requestIO(ctx)), nil
+		}
+		stopDerive := stages.Start("derive")
+		data, metadata, hit, err := derivable.fromCache(e.Cache, open)
+		stopDerive()
+		if abortOnError(ctx, err) {
+			return
+		}
+		if hit {
+			e.Cache.Set(cacheKey, cache.NewCacheEntry(data, metadata, vdsUrls))
+			ctx.Set("cache-hit", true)
+			ctx.Set("cache", "derived")
+			if explain == explainEstimate {
+				writeEstimate(ctx, 0)
+				return
+			}
+			respond(metadata, data)
+			return
+		}
+	}
+
+	ctx.Set("cache", "miss")
+
+	if explain == explainEstimate {
+		e.estimate(ctx, request, connections, binaryOperator)
+		return
+	}
+
+	if e.Scheduler != nil {
+		stopSchedule := stages.Start("schedule")
+		release, err := e.Scheduler.Acquire(
+			ctx.Request.Context(),
+			request.schedulingClass(),
+			schedulingClient(connections),
+		)
+		stopSchedule()
+		if abortOnError(ctx, err) {
+			return
+		}
+		defer release()
+	}
+
+	handle, err := core.OpenDSHandle(e.Handles, connections, binaryOperator)
 	if abortOnError(ctx, err) {
 		return
 	}
 	defer handle.Close()
+	handle = handle.WithStages(stages).
+		WithIOStats(requestIO(ctx)).
+		WithResourceStats(requestResources(ctx))
+	if e.Admission != nil {
+		handle = handle.WithBudget(ctx.Request.Context(), e.Admission)
+	}
+
+	data, metadata, err := request.execute(handle)
+	if abortOnError(ctx, err) {
+		return
+	}
+
+	e.Cache.Set(cacheKey, cache.NewCacheEntry(data, metadata, vdsUrls))
+
+	respond(metadata, data)
+}
+
+/** Read the requests following a sequential request into the cache
+ *
+ * Sequences are followed per client, and only requests that succeeded move
+ * them along.
+ */
+func (e *Endpoint) readAhead(ctx *gin.Context, request DataRequest) {
+	if e.ReadAhead == nil || ctx.IsAborted() {
+		return
+	}
+	sequential, ok := request.(SequentialRequest)
+	if !ok {
+		return
+	}
+	key, position, err := sequential.sequence()
+	if err != nil {
+		return
+	}
+
+	for _, next := range e.ReadAhead.Next(ctx.ClientIP()+"/"+key, position) {
+		ahead := sequential.at(next)
+		cacheKey, err := ahead.hash()
+		if err != nil {
+			continue
+		}
+		e.ReadAhead.Schedule(cacheKey, func() { e.prefetch(ahead, cacheKey) })
+	}
+}
+
+/** Read the response to a request into the cache, at low priority
+ *
+ * Prefetches are scheduled as batch requests and only use spare memory.
+ * Failures, e.g. reading past the last line, are of no concern to anyone and
+ * are dropped.
+ */
+func (e *Endpoint) prefetch(request DataRequest, cacheKey string) {
+	if cache.Contains(e.Cache, cacheKey) {
+		return
+	}
+
+	vdsUrls, sasTokens, binaryOperatorString := request.credentials()
+	binaryOperator, err := core.GetBinaryOperator(binaryOperatorString)
+	if err != nil {
+		return
+	}
+	var connections []core.Connection
+	for i := range vdsUrls {
+		connection, err := e.MakeVdsConnection(vdsUrls[i], sasTokens[i])
+		if err != nil {
+			return
+		}
+		connections = append(connections, connection)
+	}
+
+	if e.Scheduler != nil {
+		release, err := e.Scheduler.Acquire(
+			context.Background(),
+			scheduler.Batch,
+			schedulingClient(connections),
+		)
+		if err != nil {
+			return
+		}
+		defer release()
+	}
+
+	handle, err := core.OpenDSHandle(e.Handles, connections, binaryOperator)
+	if err != nil {
+		return
+	}
+	defer handle.Close()
+	if budget := e.ReadAhead.Budget(); budget != nil {
+		handle = handle.WithBudget(context.Background(), budget)
+	}
 
 	data, metadata, err := request.execute(handle)
+	if err != nil {
+		return
+	}
+	e.Cache.Set(cacheKey, cache.NewCacheEntry(data, metadata, vdsUrls))
+}
+
+/** Answer a dry run of a request that is not cached
+ *
+ * The request is run against a budget that stops it as soon as it reserves
+ * memory, which is before any data is read. Dry runs read no data, so they
+ * are neither scheduled nor admitted.
+ */
+func (e *Endpoint) estimate(
+	ctx *gin.Context,
+	request DataRequest,
+	connections []core.Connection,
+	binaryOperator uint32,
+) {
+	handle, err := core.OpenDSHandle(e.Handles, connections, binaryOperator)
 	if abortOnError(ctx, err) {
 		return
 	}
+	defer handle.Close()
+
+	budget := &estimator{}
+	handle = handle.WithStages(requestStages(ctx)).
+		WithIOStats(requestIO(ctx)).
+		WithResourceStats(requestResources(ctx)).
+		WithBudget(ctx.Request.Context(), budget)
+
+	_, _, err = request.execute(handle)
+	if err != nil && !errors.Is(err, errEstimated) {
+		abortOnError(ctx, err)
+		return
+	}
 
-	e.Cache.Set(cacheKey, cache.NewCacheEntry(data, metadata))
+	writeEstimate(ctx, budget.bytes)
+}
 
-	writeResponse(ctx, metadata, data)
+func writeEstimate(ctx *gin.Context, memoryBytes uint64) {
+	explanation := explainRequest(ctx)
+	explanation.DryRun = true
+	explanation.MemoryBytes = memoryBytes
+	ctx.JSON(http.StatusOK, explanation)
+}
+
+/** Requests share the scheduler fairly per storage account they read from */
+func schedulingClient(connections []core.Connection) string {
+	var accounts []string
+	for _, connection := range connections {
+		account := connection.Url()
+		if parsed, err := url.Parse(account); err == nil {
+			account = parsed.Hostname()
+		}
+		accounts = append(accounts, account)
+	}
+	sort.Strings(accounts)
+	return strings.Join(accounts, ",")
 }
 
 func (e *Endpoint) readConnectionParameters(
@@ -160,6 +435,8 @@ func (e *Endpoint) readConnectionParameters(
 }
 
 func parseGetRequest(ctx *gin.Context, v Normalizable) error {
+	defer requestStages(ctx).Start("decode")()
+
 	query, status := ctx.GetQuery("query")
 	if !status {
 		return core.NewInvalidArgument(
@@ -181,6 +458,8 @@ func parseGetRequest(ctx *gin.Context, v Normalizable) error {
 }
 
 func parsePostRequest(ctx *gin.Context, v Normalizable) error {
+	defer requestStages(ctx).Start("decode")()
+
 	if err := ctx.ShouldBind(v); err != nil {
 		return core.NewInvalidArgument(err.Error())
 	}
@@ -0,0 +1,176 @@
+package handlers
+
+import (
+	"bytes"
+	"context"
+	"encoding/json"
+	"errors"
+	"fmt"
+
+	"github.com/gin-gonic/gin"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+const (
+	explainProfile  = "profile"
+	explainEstimate = "estimate"
+)
+
+func validateExplain(mode string) error {
+	switch mode {
+	case "", explainProfile, explainEstimate:
+		return nil
+	default:
+		return core.NewInvalidArgument(fmt.Sprintf(
+			"Invalid explain: %s. Valid options are: \"profile\", \"estimate\" "+
+				"and empty string (\"\")",
+			mode,
+		))
+	}
+}
+
+// How a request was, or would be, answered
+type ExplainPlan struct {
+	// Level of detail the data is read at. 0 is full resolution
+	LOD int `json:"lod"`
+
+	// Number of storage reads per fetch method: "subcube" (slabs of the
+	// volume), "traces" (whole traces) and "samples" (individual samples)
+	Fetch map[string]uint64 `json:"fetch,omitempty"`
+
+	// Whether the response was found in the cache ("hit"), cut out of a
+	// larger cached response ("derived") or read from storage ("miss")
+	Cache string `json:"cache"`
+
+	// Cache tier the response was found in, "memory" or "disk"
+	CacheTier string `json:"cacheTier,omitempty"`
+} //@name ExplainPlan
+
+// Storage reads of a request
+type ExplainIO struct {
+	Requests   uint64  `json:"requests"`
+	Chunks     uint64  `json:"chunks"`
+	ChunkBytes uint64  `json:"chunkBytes"`
+	ReadTimeMs float64 `json:"readTimeMs"`
+} //@name ExplainIO
+
+// Cost breakdown of a request
+type Explanation struct {
+	Plan ExplainPlan `json:"plan"`
+
+	// True if the request was only estimated and no data was read
+	DryRun bool `json:"dryRun"`
+
+	IO *ExplainIO `json:"io,omitempty"`
+
+	// Time spent per stage of the request, up until the response is written
+	StagesMs map[string]float64 `json:"stagesMs"`
+
+	// Most memory held in data buffers by the core at any time
+	PeakBufferBytes uint64 `json:"peakBufferBytes,omitempty"`
+
+	// CPU time spent in the core, excluding OpenVDS' own threads
+	CoreCPUMs float64 `json:"coreCpuMs,omitempty"`
+
+	// Memory the request reserves before reading data, an estimate of its
+	// peak memory. Only given for dry runs
+	MemoryBytes uint64 `json:"memoryBytes,omitempty"`
+} //@name Explanation
+
+/** Cost breakdown of the request so far, as recorded on the gin context */
+func explainRequest(ctx *gin.Context) Explanation {
+	explanation := Explanation{
+		Plan: ExplainPlan{
+			LOD:       core.LevelOfDetail,
+			Cache:     ctx.GetString("cache"),
+			CacheTier: ctx.GetString("cache-tier"),
+		},
+		StagesMs: map[string]float64{},
+	}
+
+	for _, stage := range requestStages(ctx).Durations() {
+		explanation.StagesMs[stage.Name] = milliseconds(stage.Duration.Seconds())
+	}
+
+	totals := requestIO(ctx).Totals()
+	if totals.Requests > 0 {
+		explanation.IO = &ExplainIO{
+			Requests:   totals.Requests,
+			Chunks:     totals.Chunks,
+			ChunkBytes: totals.ChunkBytes,
+			ReadTimeMs: milliseconds(totals.ReadTime.Seconds()),
+		}
+		explanation.Plan.Fetch = map[string]uint64{}
+		fetches := map[string]uint64{
+			"subcube": totals.SubcubeRequests,
+			"traces":  totals.TraceRequests,
+			"samples": totals.SampleRequests,
+		}
+		for method, count := range fetches {
+			if count > 0 {
+				explanation.Plan.Fetch[method] = count
+			}
+		}
+	}
+
+	resources := requestResources(ctx)
+	explanation.PeakBufferBytes = resources.PeakBytes()
+	explanation.CoreCPUMs = milliseconds(resources.CPUTime().Seconds())
+
+	return explanation
+}
+
+func milliseconds(seconds float64) float64 {
+	return seconds * 1000
+}
+
+/** Add the explanation to the json object of the response metadata
+ *
+ * The explanation is appended as the "explain" key, leaving the rest of the
+ * metadata untouched.
+ */
+func withExplanation(metadata []byte, explanation Explanation) ([]byte, error) {
+	encoded, err := json.Marshal(explanation)
+	if err != nil {
+		return nil, core.NewInternalError(err.Error())
+	}
+
+	object := bytes.TrimSpace(metadata)
+	if len(object) < 2 || object[0] != '{' || object[len(object)-1] != '}' {
+		return nil, core.NewInternalError(
+			"Unable to explain request, metadata is not a json object",
+		)
+	}
+	body := bytes.TrimSpace(object[:len(object)-1])
+
+	out := make([]byte, 0, len(body)+len(encoded)+len(`,"explain":}`))
+	out = append(out, body...)
+	if len(body) > 1 {
+		out = append(out, ',')
+	}
+	out = append(out, `"explain":`...)
+	out = append(out, encoded...)
+	out = append(out, '}')
+	return out, nil
+}
+
+var errEstimated = errors.New("request estimated, no data read")
+
+/** Memory budget that records what a request would reserve, and stops the
+ *  request there
+ *
+ * Requests reserve memory once, before they read any data, so failing the
+ * reservation leaves them as dry runs.
+ */
+type estimator struct {
+	bytes uint64
+}
+
+func (e *estimator) Acquire(
+	ctx context.Context,
+	bytes uint64,
+) (release func(), err error) {
+	e.bytes += bytes
+	return nil, errEstimated
+}
@@ -0,0 +1,67 @@
+package handlers
+
+import (
+	"context"
+	"encoding/json"
+	"testing"
+
+	"github.com/stretchr/testify/require"
+)
+
+func TestWithExplanation(t *testing.T) {
+	explanation := Explanation{
+		Plan:     ExplainPlan{Cache: "miss", Fetch: map[string]uint64{"subcube": 2}},
+		StagesMs: map[string]float64{"fetch": 12.5},
+	}
+
+	testCases := []struct {
+		name     string
+		metadata string
+		expected string
+	}{
+		{
+			name:     "Keys are kept in order",
+			metadata: `{"format": "<f4", "shape": [2, 3]}`,
+			expected: `{"format": "<f4", "shape": [2, 3],"explain":`,
+		},
+		{
+			name:     "Empty object",
+			metadata: "{ }\n",
+			expected: `{"explain":`,
+		},
+	}
+
+	for _, testCase := range testCases {
+		out, err := withExplanation([]byte(testCase.metadata), explanation)
+		require.NoErrorf(t, err, "[%s] Failed to add explanation", testCase.name)
+		require.Truef(t, json.Valid(out), "[%s] Invalid json: %s", testCase.name, out)
+		require.Containsf(t, string(out), testCase.expected, "[%s]", testCase.name)
+
+		var decoded struct {
+			Explain Explanation `json:"explain"`
+		}
+		require.NoError(t, json.Unmarshal(out, &decoded))
+		require.Equalf(t, explanation, decoded.Explain, "[%s]", testCase.name)
+	}
+}
+
+func TestWithExplanationRejectsNonObjects(t *testing.T) {
+	for _, metadata := range []string{"", "[1, 2]", "{"} {
+		_, err := withExplanation([]byte(metadata), Explanation{})
+		require.Errorf(t, err, "Expected error for metadata %q", metadata)
+	}
+}
+
+func TestValidateExplain(t *testing.T) {
+	for _, mode := range []string{"", "profile", "estimate"} {
+		require.NoError(t, validateExplain(mode))
+	}
+	require.Error(t, validateExplain("plan"))
+}
+
+func TestEstimatorStopsRequest(t *testing.T) {
+	budget := &estimator{}
+	_, err := budget.Acquire(context.Background(), 1024)
+	require.ErrorIs(t, err, errEstimated)
+	require.Equal(t, uint64(1024), budget.bytes)
+}
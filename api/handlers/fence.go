@@ -116,28 +116,21 @@ func (f FenceRequest) toString() (string, error) {
 	), nil
 }
 
-// gob library is used to serialize data
-// however, library does not distinguish between FillValue pointing to 0 or to nil
-// so additional wrapper type is created to avoid same hash for different requests
-type HashableFenceRequest struct {
-	FenceRequest
-	IsFillValueSupplied bool
-}
-
 /** Compute a hash of the request that uniquely identifies the requested fence
  *
  * The hash is computed based on all fields that contribute toward a unique response.
- * I.e. every field except the sas token and with additional fill value information
+ * I.e. every field except the sas token. A missing fill value hashes
+ * differently from any supplied fill value.
  */
 func (f FenceRequest) hash() (string, error) {
-	// Strip the sas tokens before computing hash
-	f.Sas = nil
-
-	r := HashableFenceRequest{FenceRequest: f}
-	if r.FillValue != nil {
-		r.IsFillValueSupplied = true
-	}
-	return cache.Hash(r)
+	hasher := cache.NewHasher()
+	hasher.WriteString("fence")
+	f.RequestedResource.writeHash(hasher)
+	hasher.WriteString(f.CoordinateSystem)
+	hasher.WriteFloat32Matrix(f.Coordinates)
+	hasher.WriteString(f.Interpolation)
+	hasher.WriteOptionalFloat32(f.FillValue)
+	return hasher.Sum(), nil
 }
 
 func (request FenceRequest) execute(
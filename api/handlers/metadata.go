@@ -59,7 +59,7 @@ func (e *Endpoint) metadata(ctx *gin.Context, request MetadataRequest) {
 		return
 	}
 
-	handle, err := core.CreateDSHandle(connections, binaryOperator)
+	handle, err := core.OpenDSHandle(e.Handles, connections, binaryOperator)
 	if abortOnError(ctx, err) {
 		return
 	}
@@ -0,0 +1,235 @@
+package handlers
+
+import (
+	"context"
+	"fmt"
+	"net/http"
+	"strings"
+
+	"github.com/gin-gonic/gin"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+	"github.com/equinor/oneseismic-api/internal/scheduler"
+)
+
+// PrefetchPost godoc
+// @Summary  Warm the caches with a region of a VDS, in the background
+// @description.markdown prefetch
+// @Tags     prefetch
+// @Param    body  body  PrefetchRequest  True  "Request parameters"
+// @Accept   application/json
+// @Produce  json
+// @Success  200 {object} warmup.Progress
+// @Failure  400 {object} ErrorResponse "Request is invalid"
+// @Failure  500 {object} ErrorResponse "openvds failed to process the request"
+// @Failure  503 {object} ErrorResponse "Too many warm-up jobs in progress"
+// @Router   /prefetch  [post]
+func (e *Endpoint) PrefetchPost(ctx *gin.Context) {
+	var request PrefetchRequest
+	err := parsePostRequest(ctx, &request)
+	if abortOnError(ctx, err) {
+		return
+	}
+
+	e.prefetchRegion(ctx, request)
+}
+
+// PrefetchGet godoc
+// @Summary  Progress of a warm-up job
+// @description.markdown prefetch
+// @Tags     prefetch
+// @Param    id  path  string  True  "Id of the warm-up job"
+// @Produce  json
+// @Success  200 {object} warmup.Progress
+// @Failure  404 {object} ErrorResponse "No such job"
+// @Router   /prefetch/{id}  [get]
+func (e *Endpoint) PrefetchGet(ctx *gin.Context) {
+	if e.Warmups == nil {
+		abortOnError(ctx, errPrefetchDisabled)
+		return
+	}
+
+	progress, exists := e.Warmups.Get(ctx.Param("id"))
+	if !exists {
+		abortWithJobNotFound(ctx)
+		return
+	}
+	ctx.JSON(http.StatusOK, progress)
+}
+
+// PrefetchDelete godoc
+// @Summary  Cancel a warm-up job
+// @description.markdown prefetch
+// @Tags     prefetch
+// @Param    id  path  string  True  "Id of the warm-up job"
+// @Produce  json
+// @Success  200 {object} warmup.Progress
+// @Failure  404 {object} ErrorResponse "No such job"
+// @Router   /prefetch/{id}  [delete]
+func (e *Endpoint) PrefetchDelete(ctx *gin.Context) {
+	if e.Warmups == nil {
+		abortOnError(ctx, errPrefetchDisabled)
+		return
+	}
+
+	progress, exists := e.Warmups.Cancel(ctx.Param("id"))
+	if !exists {
+		abortWithJobNotFound(ctx)
+		return
+	}
+	ctx.JSON(http.StatusOK, progress)
+}
+
+// Query for the prefetch endpoint
+// @Description Query payload for prefetch endpoint /prefetch.
+type PrefetchRequest struct {
+	RequestedResource
+
+	// Restrict the region to warm up. Not specifying any bounds warms up the
+	// entire volume, which for large volumes takes a long time and is likely
+	// to outgrow the caches.
+	//
+	// Bounds follow the same rules as the bounds of slices. To warm up the
+	// footprint of a surface, give the inline and crossline range it covers.
+	Bounds []core.Bound `json:"bounds" binding:"dive"`
+} //@name PrefetchRequest
+
+func (p PrefetchRequest) toString() (string, error) {
+	var bounds []string
+	for _, bound := range p.Bounds {
+		bounds = append(bounds,
+			fmt.Sprintf("%s: [%d, %d]", *bound.Direction, *bound.Lower, *bound.Upper))
+	}
+
+	return fmt.Sprintf("{%s, bounds: %s}",
+		p.RequestedResource.toString(),
+		strings.Join(bounds, ", ")), nil
+}
+
+var errPrefetchDisabled = core.NewInvalidArgument(
+	"Prefetching is not enabled on this server",
+)
+
+func abortWithJobNotFound(ctx *gin.Context) {
+	ctx.AbortWithError(
+		http.StatusNotFound,
+		fmt.Errorf("No warm-up job with id %s", ctx.Param("id")),
+	)
+}
+
+/** Start a job that reads the region slab by slab through pooled handles
+ *
+ * The region is validated up front, such that bad requests fail right away
+ * rather than in the background. Every slab is scheduled as a batch request
+ * and admitted on its own, so a job never holds a scheduler slot, memory or
+ * handle for longer than it takes to read one slab, and stops between slabs
+ * when cancelled.
+ */
+func (e *Endpoint) prefetchRegion(ctx *gin.Context, request PrefetchRequest) {
+	prepareRequestLogging(ctx, request)
+	prepareMetricsLogging(ctx, request.RequestedResource)
+
+	if e.Handles == nil || e.Warmups == nil {
+		abortOnError(ctx, errPrefetchDisabled)
+		return
+	}
+
+	connections, binaryOperator, err := e.readConnectionParameters(
+		ctx,
+		request.RequestedResource,
+	)
+	if err != nil {
+		return
+	}
+
+	handle, err := core.OpenDSHandle(e.Handles, connections, binaryOperator)
+	if abortOnError(ctx, err) {
+		return
+	}
+	region, err := handle.GetPrefetchRegion(request.Bounds)
+	handle.Close()
+	if abortOnError(ctx, err) {
+		return
+	}
+
+	run := func(jobCtx context.Context, stepDone func()) error {
+		for i := 0; i < region.Slabs; i++ {
+			if err := jobCtx.Err(); err != nil {
+				return err
+			}
+			err := e.prefetchSlab(jobCtx, connections, binaryOperator, region, i)
+			if err != nil {
+				return err
+			}
+			stepDone()
+		}
+		return nil
+	}
+
+	progress, err := e.Warmups.Start(request.Vds, region.Slabs, run)
+	if err != nil {
+		abortOnError(ctx, core.NewResourceExhausted(err.Error()))
+		return
+	}
+	ctx.JSON(http.StatusOK, progress)
+}
+
+func (e *Endpoint) prefetchSlab(
+	ctx context.Context,
+	connections []core.Connection,
+	binaryOperator uint32,
+	region core.PrefetchRegion,
+	index int,
+) error {
+	if e.Scheduler != nil {
+		release, err := e.Scheduler.Acquire(
+			ctx,
+			scheduler.Batch,
+			schedulingClient(connections),
+		)
+		if err != nil {
+			return err
+		}
+		defer release()
+	}
+
+	handle, err := core.OpenDSHandle(e.Handles, connections, binaryOperator)
+	if err != nil {
+		return err
+	}
+	defer handle.Close()
+	if e.Admission != nil {
+		handle = handle.WithBudget(ctx, e.Admission)
+	}
+
+	return handle.Prefetch(region, index)
+}
+
+/** Open the VDS of a signed url into the handle pool, such that the first
+ *  requests to it do not pay for reading its layout from storage
+ */
+func (e *Endpoint) PreOpen(signedUrl string) error {
+	if e.Handles == nil {
+		return errPrefetchDisabled
+	}
+
+	resource := RequestedResource{Vds: []string{signedUrl}}
+	if err := resource.NormalizeConnection(); err != nil {
+		return err
+	}
+	connection, err := e.MakeVdsConnection(resource.Vds[0], resource.Sas[0])
+	if err != nil {
+		return err
+	}
+
+	handle, err := core.OpenDSHandle(
+		e.Handles,
+		[]core.Connection{connection},
+		core.BinaryOperatorNoOperator,
+	)
+	if err != nil {
+		return err
+	}
+	handle.Close()
+	return nil
+}
@@ -6,7 +6,9 @@ import (
 	"net/url"
 	"strings"
 
+	"github.com/equinor/oneseismic-api/internal/cache"
 	"github.com/equinor/oneseismic-api/internal/core"
+	"github.com/equinor/oneseismic-api/internal/scheduler"
 )
 
 type stringOrSlice []string
@@ -71,6 +73,22 @@ type RequestedResource struct {
 	// Inside the intersection both cubes should have data at the same lines and
 	// there should be at least two samples in each dimension.
 	BinaryOperator string `json:"binary_operator,omitempty" example:"subtraction"`
+
+	// Opt-in cost breakdown of data requests. Ignored by the metadata endpoint.
+	//
+	// With "profile" the request is answered as usual, and an "explain" object
+	// is added to the metadata part of the response. It holds the execution
+	// plan (level of detail, how data was fetched and whether the cache was
+	// hit, and in which tier), the bytes and chunks read from storage and the
+	// time spent per stage.
+	//
+	// With "estimate" no data is read. The response is only the json
+	// explanation, with the memory the request would reserve, the cache
+	// outcome and the time spent so far, e.g. opening the VDS.
+	//
+	// Valid options are: "profile", "estimate" and empty string ("").
+	// Explaining a request does not change which response is cached for it.
+	Explain string `json:"explain,omitempty" example:"profile"`
 }
 
 func (r RequestedResource) credentials() ([]string, []string, string) {
@@ -82,16 +100,55 @@ func (f RequestedResource) toString() string {
 	return fmt.Sprintf("vds: %s, binary_operator: %s", allVds, f.BinaryOperator)
 }
 
+/** Feed the fields that identify the requested data to the hasher
+ *
+ * The sas tokens only grant access to the data and are therefore left out.
+ */
+func (r RequestedResource) writeHash(hasher *cache.Hasher) {
+	hasher.WriteStrings(r.Vds)
+	hasher.WriteString(r.BinaryOperator)
+}
+
 func (r RequestedResource) getRequestedResource() RequestedResource {
 	return r
 }
 
+func (r RequestedResource) schedulingClass() scheduler.Class {
+	return scheduler.Interactive
+}
+
 type DataRequest interface {
 	toString() (string, error)
 	hash() (string, error)
 	credentials() ([]string, []string, string)
 	execute(handle core.DSHandle) (data [][]byte, metadata []byte, err error)
 	getRequestedResource() RequestedResource
+	schedulingClass() scheduler.Class
+}
+
+/** Requests that can be answered from other cached responses
+ *
+ * fromCache is consulted right after a cache miss, before the request is
+ * scheduled, and reports whether the response could be derived from an entry
+ * that is already in the cache. Deriving reads no data. A handle, for
+ * metadata only, is opened with open and only once a parent entry is found.
+ */
+type DerivableRequest interface {
+	fromCache(
+		responseCache cache.Cache,
+		open func() (core.DSHandle, error),
+	) (data [][]byte, metadata []byte, hit bool, err error)
+}
+
+/** Requests that step through a sequence, like the lines of a volume
+ *
+ * sequence identifies everything about the request but its position in the
+ * sequence, and at returns the same request at another position. Following
+ * requests of steadily moving sequences are read ahead into the cache.
+ */
+type SequentialRequest interface {
+	sequence() (key string, position int, err error)
+	at(position int) DataRequest
 }
 
 type Stringable interface {
@@ -1,7 +1,9 @@
 package handlers
 
 import (
+	"encoding/json"
 	"fmt"
+	"math"
 	"strings"
 
 	"github.com/gin-gonic/gin"
@@ -103,9 +105,40 @@ type SliceRequest struct {
  * I.e. every field except the sas token.
  */
 func (s SliceRequest) hash() (string, error) {
-	// Strip the sas tokens before computing hash
-	s.Sas = nil
-	return cache.Hash(s)
+	hasher := cache.NewHasher()
+	hasher.WriteString("slice")
+	s.RequestedResource.writeHash(hasher)
+	hasher.WriteString(s.Direction)
+	hasher.WriteOptionalInt(s.Lineno)
+	hasher.WriteInt(len(s.Bounds))
+	for _, bound := range s.Bounds {
+		hasher.WriteBool(bound.Direction != nil)
+		if bound.Direction != nil {
+			hasher.WriteString(*bound.Direction)
+		}
+		hasher.WriteOptionalInt(bound.Lower)
+		hasher.WriteOptionalInt(bound.Upper)
+	}
+	return hasher.Sum(), nil
+}
+
+/** The slice is a position in the sequence of parallel slices */
+func (s SliceRequest) sequence() (string, int, error) {
+	if s.Lineno == nil {
+		return "", 0, core.NewInvalidArgument("Slice has no line number")
+	}
+	parallel := s
+	parallel.Lineno = nil
+	key, err := parallel.hash()
+	return key, *s.Lineno, err
+}
+
+/** The parallel slice at lineno, without explaining its cost */
+func (s SliceRequest) at(lineno int) DataRequest {
+	parallel := s
+	parallel.Lineno = &lineno
+	parallel.Explain = ""
+	return parallel
 }
 
 func (s SliceRequest) toString() (string, error) {
@@ -151,3 +184,114 @@ func (request SliceRequest) execute(
 
 	return data, metadata, nil
 }
+
+/** Answer a bounded slice request by cropping the cached full slice
+ *
+ * A slice with bounds hashes differently from the same slice without bounds,
+ * so zooming into a line would always miss the cache. If the full line is
+ * cached the requested sub-slice is cut out of it instead. Metadata is always
+ * computed for the requested bounds, which also resolves the bounds to the
+ * exact lines that would have been read from the VDS.
+ */
+func (request SliceRequest) fromCache(
+	responseCache cache.Cache,
+	open func() (core.DSHandle, error),
+) (data [][]byte, metadata []byte, hit bool, err error) {
+	if len(request.Bounds) == 0 {
+		return nil, nil, false, nil
+	}
+
+	full := request
+	full.Bounds = nil
+	fullKey, err := full.hash()
+	if err != nil {
+		return nil, nil, false, err
+	}
+
+	entry, hit := responseCache.Get(fullKey)
+	if !hit || !entry.ReadFrom(request.Vds) {
+		return nil, nil, false, nil
+	}
+
+	axis, err := core.GetAxis(strings.ToLower(request.Direction))
+	if err != nil {
+		return nil, nil, false, err
+	}
+
+	handle, err := open()
+	if err != nil {
+		return nil, nil, false, err
+	}
+	defer handle.Close()
+
+	metadata, err = handle.GetSliceMetadata(
+		*request.Lineno,
+		axis,
+		request.Bounds,
+	)
+	if err != nil {
+		return nil, nil, false, err
+	}
+
+	var fullMetadata core.SliceMetadata
+	if err := json.Unmarshal(entry.Metadata(), &fullMetadata); err != nil {
+		return nil, nil, false, nil
+	}
+	var croppedMetadata core.SliceMetadata
+	if err := json.Unmarshal(metadata, &croppedMetadata); err != nil {
+		return nil, nil, false, nil
+	}
+
+	cropped, ok := cropSlice(entry.Data()[0], fullMetadata, croppedMetadata)
+	if !ok {
+		return nil, nil, false, nil
+	}
+	return [][]byte{cropped}, metadata, true, nil
+}
+
+/** Cut the slice described by cropped out of the slice described by full
+ *
+ * Slices are stored row-major with shape [Y.Samples, X.Samples] and 4-byte
+ * samples. Returns false if cropped is not contained in full.
+ */
+func cropSlice(
+	data []byte,
+	full core.SliceMetadata,
+	cropped core.SliceMetadata,
+) ([]byte, bool) {
+	const sampleSize = 4
+
+	offset := func(full, cropped core.Axis) (int, bool) {
+		if full.Annotation != cropped.Annotation || full.StepSize != cropped.StepSize {
+			return 0, false
+		}
+		if full.StepSize == 0 {
+			return 0, full.Min == cropped.Min
+		}
+		offset := int(math.Round((cropped.Min - full.Min) / full.StepSize))
+		if offset < 0 || offset+cropped.Samples > full.Samples {
+			return 0, false
+		}
+		return offset, true
+	}
+
+	xoffset, ok := offset(full.X, cropped.X)
+	if !ok {
+		return nil, false
+	}
+	yoffset, ok := offset(full.Y, cropped.Y)
+	if !ok {
+		return nil, false
+	}
+	if len(data) != full.X.Samples*full.Y.Samples*sampleSize {
+		return nil, false
+	}
+
+	rowSize := cropped.X.Samples * sampleSize
+	out := make([]byte, cropped.Y.Samples*rowSize)
+	for row := 0; row < cropped.Y.Samples; row++ {
+		from := ((yoffset+row)*full.X.Samples + xoffset) * sampleSize
+		copy(out[row*rowSize:(row+1)*rowSize], data[from:from+rowSize])
+	}
+	return out, true
+}
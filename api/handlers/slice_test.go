@@ -1,9 +1,13 @@
 package handlers
 
 import (
+	"encoding/binary"
+	"math"
 	"testing"
 
 	"github.com/stretchr/testify/require"
+
+	"github.com/equinor/oneseismic-api/internal/core"
 )
 
 func newSliceRequest(
@@ -69,6 +73,21 @@ func TestSasIsOmmitedFromSliceHash(t *testing.T) {
 				Lineno:            &lineNr,
 			},
 		},
+		{
+			name: "Explain specified",
+			request1: newSliceRequest(
+				[]string{"some-path"},
+				[]string{"some-sas"}, "", "inline", lineNr),
+			request2: SliceRequest{
+				RequestedResource: RequestedResource{
+					Vds:     []string{"some-path"},
+					Sas:     []string{"some-sas"},
+					Explain: "profile",
+				},
+				Direction: "inline",
+				Lineno:    &lineNr,
+			},
+		},
 	}
 
 	for _, testCase := range testCases {
@@ -174,3 +193,119 @@ func TestSliceGivesUniqueHash(t *testing.T) {
 		)
 	}
 }
+
+func toSliceBytes(values []float32) []byte {
+	out := make([]byte, len(values)*4)
+	for i, value := range values {
+		binary.LittleEndian.PutUint32(out[i*4:], math.Float32bits(value))
+	}
+	return out
+}
+
+func TestCropSlice(t *testing.T) {
+	full := core.SliceMetadata{
+		X: core.Axis{Annotation: "Crossline", Min: 10, Max: 13, Samples: 4, StepSize: 1},
+		Y: core.Axis{Annotation: "Sample", Min: 4, Max: 12, Samples: 3, StepSize: 4},
+	}
+	data := toSliceBytes([]float32{
+		0, 1, 2, 3,
+		4, 5, 6, 7,
+		8, 9, 10, 11,
+	})
+
+	testCases := []struct {
+		name     string
+		x        core.Axis
+		y        core.Axis
+		expected []float32
+	}{
+		{
+			name:     "Full slice",
+			x:        full.X,
+			y:        full.Y,
+			expected: []float32{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11},
+		},
+		{
+			name:     "Inner rectangle",
+			x:        core.Axis{Annotation: "Crossline", Min: 11, Max: 12, Samples: 2, StepSize: 1},
+			y:        core.Axis{Annotation: "Sample", Min: 8, Max: 12, Samples: 2, StepSize: 4},
+			expected: []float32{5, 6, 9, 10},
+		},
+		{
+			name:     "Single sample",
+			x:        core.Axis{Annotation: "Crossline", Min: 13, Max: 13, Samples: 1, StepSize: 1},
+			y:        core.Axis{Annotation: "Sample", Min: 4, Max: 4, Samples: 1, StepSize: 4},
+			expected: []float32{3},
+		},
+	}
+
+	for _, testCase := range testCases {
+		cropped := core.SliceMetadata{X: testCase.x, Y: testCase.y}
+		out, ok := cropSlice(data, full, cropped)
+		require.Truef(t, ok, "[%s] Expected slice to be cropped", testCase.name)
+		require.Equalf(t, toSliceBytes(testCase.expected), out,
+			"[%s] Unexpected cropped data", testCase.name)
+	}
+}
+
+func TestCropSliceRejectsUncontainedBounds(t *testing.T) {
+	full := core.SliceMetadata{
+		X: core.Axis{Annotation: "Crossline", Min: 10, Max: 13, Samples: 4, StepSize: 1},
+		Y: core.Axis{Annotation: "Sample", Min: 4, Max: 12, Samples: 3, StepSize: 4},
+	}
+	data := make([]byte, 4*3*4)
+
+	testCases := []struct {
+		name string
+		x    core.Axis
+	}{
+		{
+			name: "Outside full slice",
+			x:    core.Axis{Annotation: "Crossline", Min: 12, Max: 14, Samples: 3, StepSize: 1},
+		},
+		{
+			name: "Different stepsize",
+			x:    core.Axis{Annotation: "Crossline", Min: 10, Max: 12, Samples: 2, StepSize: 2},
+		},
+		{
+			name: "Different axis",
+			x:    core.Axis{Annotation: "Inline", Min: 10, Max: 11, Samples: 2, StepSize: 1},
+		},
+	}
+
+	for _, testCase := range testCases {
+		cropped := core.SliceMetadata{X: testCase.x, Y: full.Y}
+		_, ok := cropSlice(data, full, cropped)
+		require.Falsef(t, ok, "[%s] Expected cropping to be rejected", testCase.name)
+	}
+}
+
+func TestParallelSlicesShareSequence(t *testing.T) {
+	request := newSliceRequest([]string{"some-path"}, []string{"some-sas"}, "", "inline", 10)
+	request.Explain = "profile"
+
+	key, position, err := request.sequence()
+	require.NoError(t, err)
+	require.Equal(t, 10, position)
+
+	next := request.at(11).(SliceRequest)
+	require.Equal(t, 11, *next.Lineno)
+	require.Equal(t, 10, *request.Lineno)
+	require.Equal(t, "", next.Explain)
+
+	nextKey, position, err := next.sequence()
+	require.NoError(t, err)
+	require.Equal(t, 11, position)
+	require.Equal(t, key, nextKey)
+
+	crossline := newSliceRequest([]string{"some-path"}, []string{"some-sas"}, "", "crossline", 10)
+	crosslineKey, _, err := crossline.sequence()
+	require.NoError(t, err)
+	require.NotEqual(t, key, crosslineKey)
+
+	nextHash, err := next.hash()
+	require.NoError(t, err)
+	expected, err := newSliceRequest([]string{"some-path"}, []string{"some-sas"}, "", "inline", 11).hash()
+	require.NoError(t, err)
+	require.Equal(t, expected, nextHash)
+}
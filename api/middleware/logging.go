@@ -34,6 +34,16 @@ func FormattedLogger() gin.HandlerFunc {
 			request = fmt.Sprintf("%s\n", request)
 		}
 
+		/* Storage reads of data requests that were not served from cache */
+		if io, ok := param.Keys["io"].(fmt.Stringer); ok {
+			request = fmt.Sprintf("%sIO: %s\n", request, io)
+		}
+
+		/* Memory and CPU used by the C++ core for the same requests */
+		if resources, ok := param.Keys["resources"].(fmt.Stringer); ok {
+			request = fmt.Sprintf("%sResources: %s\n", request, resources)
+		}
+
 		return fmt.Sprintf("[GIN] %v |%s %3d %s| %13v | %15s |%s %-7s %s %#v\nUser-Agent: %s\n%s%s",
 			param.TimeStamp.Format(time.RFC1123),
 			statusColor, param.StatusCode, resetColor,
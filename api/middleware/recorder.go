@@ -0,0 +1,143 @@
+package middleware
+
+import (
+	"bytes"
+	"encoding/json"
+	"io"
+	"net/http"
+	"net/url"
+	"sync"
+	"time"
+
+	"github.com/gin-gonic/gin"
+)
+
+/** One line of the request log written by RequestRecorder
+ *
+ * Body is the request as sent by the client, i.e. the json body of POST
+ * requests and the query parameter of GET requests, with the sas tokens
+ * removed. It is left out if the request could not be parsed.
+ *
+ * PeakBufferBytes and CoreCPUMs are the memory and CPU used by the C++ core,
+ * and are left out for requests that never reached it.
+ */
+type RecordedRequest struct {
+	Time            time.Time       `json:"time"`
+	Method          string          `json:"method"`
+	Path            string          `json:"path"`
+	Body            json.RawMessage `json:"body,omitempty"`
+	Status          int             `json:"status"`
+	ResponseSize    int             `json:"responseSize"`
+	LatencyMs       float64         `json:"latencyMs"`
+	PeakBufferBytes uint64          `json:"peakBufferBytes,omitempty"`
+	CoreCPUMs       float64         `json:"coreCpuMs,omitempty"`
+}
+
+/** Memory and CPU used by the C++ core for a request, as set on the gin
+ *  context by the handlers (see core.ResourceStats)
+ */
+type resourceUsage interface {
+	PeakBytes() uint64
+	CPUTime() time.Duration
+}
+
+/** Remove everything that grants access to the data from a request
+ *
+ * Sas tokens are given either in the sas field or appended to the vds urls.
+ * Returns nil if the request is not a json object, as it then cannot be
+ * cleaned with any confidence.
+ */
+func StripCredentials(request []byte) json.RawMessage {
+	var fields map[string]json.RawMessage
+	if err := json.Unmarshal(request, &fields); err != nil {
+		return nil
+	}
+	delete(fields, "sas")
+
+	if raw, ok := fields["vds"]; ok {
+		var vds any
+		if err := json.Unmarshal(raw, &vds); err != nil {
+			return nil
+		}
+		switch v := vds.(type) {
+		case string:
+			vds = stripQuery(v)
+		case []any:
+			for i, item := range v {
+				s, ok := item.(string)
+				if !ok {
+					return nil
+				}
+				v[i] = stripQuery(s)
+			}
+		default:
+			return nil
+		}
+		fields["vds"], _ = json.Marshal(vds)
+	}
+
+	out, err := json.Marshal(fields)
+	if err != nil {
+		return nil
+	}
+	return out
+}
+
+func stripQuery(vds string) string {
+	u, err := url.Parse(vds)
+	if err != nil {
+		return ""
+	}
+	u.RawQuery = ""
+	u.ForceQuery = false
+	return u.String()
+}
+
+/** Write one RecordedRequest per line to out for every request
+ *
+ * The request body is read up front and handed on to the handlers
+ * unchanged. Lines are written once the response is done, so they are
+ * ordered by completion, not arrival.
+ */
+func RequestRecorder(out io.Writer) gin.HandlerFunc {
+	var lock sync.Mutex
+	encoder := json.NewEncoder(out)
+
+	return func(ctx *gin.Context) {
+		start := time.Now()
+
+		var request []byte
+		if ctx.Request.Method == http.MethodGet {
+			request = []byte(ctx.Query("query"))
+		} else if ctx.Request.Body != nil {
+			body, err := io.ReadAll(ctx.Request.Body)
+			ctx.Request.Body.Close()
+			ctx.Request.Body = io.NopCloser(bytes.NewReader(body))
+			if err == nil {
+				request = body
+			}
+		}
+
+		ctx.Next()
+
+		record := RecordedRequest{
+			Time:         start.UTC(),
+			Method:       ctx.Request.Method,
+			Path:         ctx.Request.URL.Path,
+			Body:         StripCredentials(request),
+			Status:       ctx.Writer.Status(),
+			ResponseSize: max(ctx.Writer.Size(), 0),
+			LatencyMs:    float64(time.Since(start)) / float64(time.Millisecond),
+		}
+		resources, _ := ctx.Get("resources")
+		if resources, ok := resources.(resourceUsage); ok {
+			record.PeakBufferBytes = resources.PeakBytes()
+			record.CoreCPUMs = float64(resources.CPUTime()) / float64(time.Millisecond)
+		}
+
+		lock.Lock()
+		defer lock.Unlock()
+		// ignore possible errors as they should not change outcome for the user
+		encoder.Encode(record)
+	}
+}
@@ -0,0 +1,135 @@
+package middleware
+
+import (
+	"bytes"
+	"encoding/json"
+	"net/http"
+	"net/http/httptest"
+	"net/url"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/gin-gonic/gin"
+	"github.com/stretchr/testify/require"
+)
+
+func TestStripCredentials(t *testing.T) {
+	testcases := []struct {
+		name     string
+		request  string
+		expected string
+	}{
+		{
+			name:     "Sas field",
+			request:  `{"vds": "https://account/container/blob", "sas": "sig=secret", "lineno": 1}`,
+			expected: `{"lineno": 1, "vds": "https://account/container/blob"}`,
+		},
+		{
+			name:     "Signed url",
+			request:  `{"vds": "https://account/container/blob?sv=1&sig=secret"}`,
+			expected: `{"vds": "https://account/container/blob"}`,
+		},
+		{
+			name:     "Signed urls",
+			request:  `{"vds": ["https://account/a?sig=secret", "https://account/b?sig=secret"], "sas": ["", ""]}`,
+			expected: `{"vds": ["https://account/a", "https://account/b"]}`,
+		},
+	}
+
+	for _, testcase := range testcases {
+		stripped := StripCredentials([]byte(testcase.request))
+		require.JSONEq(t, testcase.expected, string(stripped), testcase.name)
+		require.NotContains(t, string(stripped), "secret", testcase.name)
+	}
+}
+
+func TestStripCredentialsRejectsUnknownShapes(t *testing.T) {
+	requests := []string{
+		``,
+		`not json`,
+		`["https://account/container/blob?sig=secret"]`,
+		`{"vds": 1, "sas": "sig=secret"}`,
+		`{"vds": [{"url": "https://account/container/blob?sig=secret"}]}`,
+	}
+	for _, request := range requests {
+		require.Nil(t, StripCredentials([]byte(request)), request)
+	}
+}
+
+func TestRequestRecorder(t *testing.T) {
+	var log bytes.Buffer
+	app := gin.New()
+	app.Use(RequestRecorder(&log))
+	app.POST("slice", func(ctx *gin.Context) {
+		var body map[string]any
+		require.NoError(t, ctx.BindJSON(&body))
+		require.Equal(t, "sig=secret", body["sas"])
+		ctx.String(http.StatusOK, "data")
+	})
+	app.GET("slice", func(ctx *gin.Context) {
+		ctx.Status(http.StatusBadRequest)
+	})
+
+	body := `{"vds": "https://account/container/blob", "sas": "sig=secret"}`
+	w := httptest.NewRecorder()
+	app.ServeHTTP(w, httptest.NewRequest(http.MethodPost, "/slice", strings.NewReader(body)))
+
+	query := "/slice?query=" + url.QueryEscape(body)
+	w = httptest.NewRecorder()
+	app.ServeHTTP(w, httptest.NewRequest(http.MethodGet, query, nil))
+
+	require.NotContains(t, log.String(), "secret")
+
+	decoder := json.NewDecoder(&log)
+	expected := []struct {
+		method string
+		status int
+		size   int
+	}{
+		{http.MethodPost, http.StatusOK, 4},
+		{http.MethodGet, http.StatusBadRequest, 0},
+	}
+	for _, e := range expected {
+		var record RecordedRequest
+		require.NoError(t, decoder.Decode(&record))
+		require.Equal(t, e.method, record.Method)
+		require.Equal(t, "/slice", record.Path)
+		require.Equal(t, e.status, record.Status)
+		require.Equal(t, e.size, record.ResponseSize)
+		require.JSONEq(t, `{"vds": "https://account/container/blob"}`, string(record.Body))
+	}
+}
+
+type fakeResources struct{}
+
+func (fakeResources) PeakBytes() uint64      { return 1024 }
+func (fakeResources) CPUTime() time.Duration { return 5 * time.Millisecond }
+
+func TestRequestRecorderResources(t *testing.T) {
+	var log bytes.Buffer
+	app := gin.New()
+	app.Use(RequestRecorder(&log))
+	app.POST("slice", func(ctx *gin.Context) {
+		ctx.Set("resources", fakeResources{})
+		ctx.Status(http.StatusOK)
+	})
+	app.POST("metadata", func(ctx *gin.Context) {
+		ctx.Status(http.StatusOK)
+	})
+
+	for _, path := range []string{"/slice", "/metadata"} {
+		request := httptest.NewRequest(http.MethodPost, path, strings.NewReader(`{}`))
+		app.ServeHTTP(httptest.NewRecorder(), request)
+	}
+
+	decoder := json.NewDecoder(&log)
+	var record RecordedRequest
+	require.NoError(t, decoder.Decode(&record))
+	require.Equal(t, uint64(1024), record.PeakBufferBytes)
+	require.Equal(t, 5.0, record.CoreCPUMs)
+
+	var untouched RecordedRequest
+	require.NoError(t, decoder.Decode(&untouched))
+	require.Equal(t, uint64(0), untouched.PeakBufferBytes)
+}
@@ -0,0 +1,85 @@
+package main
+
+import (
+	"fmt"
+	"net/http"
+	"os"
+	"time"
+
+	"github.com/pborman/getopt/v2"
+
+	"github.com/equinor/oneseismic-api/internal/fakeblob"
+)
+
+type opts struct {
+	root      string
+	port      uint32
+	latency   uint32
+	jitter    uint32
+	bandwidth float64
+	errorRate float64
+	seed      int64
+}
+
+func parseopts() opts {
+	help := getopt.BoolLong("help", 0, "print this help text")
+
+	opts := opts{
+		port: 10000,
+		seed: 1,
+	}
+
+	getopt.FlagLong(&opts.root, "root", 0,
+		"Directory the blobs are stored in, as <root>/<container>/<blob>.", "dir")
+	getopt.FlagLong(&opts.port, "port", 0,
+		"Port to serve on. Defaults to 10000.", "int")
+	getopt.FlagLong(&opts.latency, "latency", 0,
+		"Latency, in milliseconds, added to every request. Defaults to 0.", "int")
+	getopt.FlagLong(&opts.jitter, "jitter", 0,
+		"Max random extra latency, in milliseconds. Defaults to 0.", "int")
+	getopt.FlagLong(&opts.bandwidth, "bandwidth", 0,
+		"Max speed, in megabytes per second, of every download. A value of\n"+
+			"zero means unlimited. Defaults to 0.", "float")
+	getopt.FlagLong(&opts.errorRate, "error-rate", 0,
+		"Fraction, between 0 and 1, of reads that fail with 503 Server Busy.\n"+
+			"Defaults to 0.", "float")
+	getopt.FlagLong(&opts.seed, "seed", 0,
+		"Seed for jitter and errors. Defaults to 1.", "int")
+
+	getopt.Parse()
+	if *help {
+		getopt.Usage()
+		os.Exit(0)
+	}
+
+	if opts.root == "" || opts.errorRate < 0 || opts.errorRate > 1 {
+		getopt.Usage()
+		os.Exit(1)
+	}
+
+	return opts
+}
+
+func main() {
+	opts := parseopts()
+
+	server := fakeblob.NewServer(
+		opts.root,
+		fakeblob.Faults{
+			Latency:   time.Duration(opts.latency) * time.Millisecond,
+			Jitter:    time.Duration(opts.jitter) * time.Millisecond,
+			Bandwidth: int64(opts.bandwidth * 1024 * 1024),
+			ErrorRate: opts.errorRate,
+		},
+		opts.seed,
+	)
+
+	account := fmt.Sprintf("http://127.0.0.1:%d", opts.port)
+	fmt.Printf("Serving %s as storage account %s\n", opts.root, account)
+	fmt.Printf("Connection string: BlobEndpoint=%s;SharedAccessSignature=?sv=fake\n", account)
+
+	err := http.ListenAndServe(fmt.Sprintf("127.0.0.1:%d", opts.port), server)
+	if err != nil {
+		panic(err)
+	}
+}
@@ -0,0 +1,216 @@
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"math/rand"
+	"net/http"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/pborman/getopt/v2"
+
+	"github.com/equinor/oneseismic-api/internal/localserver"
+)
+
+type opts struct {
+	duration       uint32
+	concurrency    uint32
+	mix            string
+	fencePoints    uint32
+	surfaceRows    uint32
+	surfaceCols    uint32
+	window         uint32
+	attributes     []string
+	seed           int64
+	cacheSize      uint64
+	handleCacheTTL uint32
+	memoryBudget   uint64
+	schedulerSlots uint32
+	jsonReport     string
+	files          []string
+}
+
+func parseopts() opts {
+	help := getopt.BoolLong("help", 0, "print this help text")
+
+	opts := opts{
+		duration:    60,
+		concurrency: 8,
+		mix:         "slice=6,fence=2,metadata=1,attribute=1",
+		fencePoints: 1000,
+		surfaceRows: 500,
+		surfaceCols: 500,
+		window:      50,
+		attributes:  []string{"mean", "rms", "max"},
+		seed:        1,
+	}
+
+	getopt.FlagLong(&opts.duration, "duration", 0,
+		"Time, in seconds, to generate load for. Defaults to 60.", "int")
+	getopt.FlagLong(&opts.concurrency, "concurrency", 0,
+		"Number of requests in flight at any time. Defaults to 8.", "int")
+	getopt.FlagLong(&opts.mix, "mix", 0,
+		"Comma-separated relative weights of the kinds of requests, out of\n"+
+			"slice, fence, metadata and attribute.\n"+
+			"Defaults to 'slice=6,fence=2,metadata=1,attribute=1'.", "string")
+	getopt.FlagLong(&opts.fencePoints, "fence-points", 0,
+		"Number of points in every fence. Defaults to 1000.", "int")
+	getopt.FlagLong(&opts.surfaceRows, "surface-rows", 0,
+		"Number of rows of the horizons in attribute requests. Defaults to 500.", "int")
+	getopt.FlagLong(&opts.surfaceCols, "surface-cols", 0,
+		"Number of columns of the horizons in attribute requests. Defaults to 500.", "int")
+	getopt.FlagLong(&opts.window, "window", 0,
+		"Number of samples in the vertical window of attribute requests. The\n"+
+			"window is shrunk to fit cubes with fewer samples. Defaults to 50.", "int")
+	getopt.FlagLong(&opts.attributes, "attributes", 0,
+		"Comma-separated list of attributes to calculate in attribute requests.\n"+
+			"Defaults to 'mean,rms,max'.", "string")
+	getopt.FlagLong(&opts.seed, "seed", 0,
+		"Seed for the generated requests. Defaults to 1.", "int")
+	getopt.FlagLong(&opts.cacheSize, "cache-size", 0,
+		"Max size of the response cache of the server. In megabytes. Defaults to 0.", "int")
+	getopt.FlagLong(&opts.handleCacheTTL, "handle-cache-ttl", 0,
+		"Time, in seconds, the server keeps opened VDS handles around for reuse.\n"+
+			"Defaults to 0.", "int")
+	getopt.FlagLong(&opts.memoryBudget, "memory-budget", 0,
+		"Max memory, in megabytes, for data being read by requests in flight.\n"+
+			"Defaults to 0, which disables the limit.", "int")
+	getopt.FlagLong(&opts.schedulerSlots, "scheduler-slots", 0,
+		"Max number of data requests reading data at the same time.\n"+
+			"Defaults to 0, which disables scheduling.", "int")
+	getopt.FlagLong(&opts.jsonReport, "json", 0,
+		"Write the report as json to this file, in addition to stdout.", "string")
+
+	getopt.SetParameters("vds...")
+	getopt.Parse()
+	if *help {
+		getopt.Usage()
+		os.Exit(0)
+	}
+
+	opts.files = getopt.Args()
+	if len(opts.files) == 0 {
+		fmt.Fprintln(os.Stderr, "No VDS given")
+		getopt.Usage()
+		os.Exit(1)
+	}
+
+	return opts
+}
+
+/** Generate load from concurrency workers until the deadline */
+func run(
+	client *http.Client,
+	server string,
+	cubes []*cube,
+	requests mix,
+	s shape,
+	opts *opts,
+	r *recorder,
+) {
+	deadline := time.Now().Add(time.Duration(opts.duration) * time.Second)
+
+	var wg sync.WaitGroup
+	for worker := 0; worker < int(opts.concurrency); worker++ {
+		wg.Add(1)
+		go func(seed int64) {
+			defer wg.Done()
+			rng := rand.New(rand.NewSource(seed))
+			for time.Now().Before(deadline) {
+				k := requests.pick(rng)
+				c := cubes[rng.Intn(len(cubes))]
+
+				start := time.Now()
+				err := c.send(client, server, k, rng, s)
+				r.record(k, time.Since(start), err)
+			}
+		}(opts.seed + int64(worker))
+	}
+	wg.Wait()
+}
+
+func main() {
+	opts := parseopts()
+
+	requests, err := parseMix(opts.mix)
+	if err != nil {
+		fmt.Fprintln(os.Stderr, err)
+		os.Exit(1)
+	}
+
+	hits := newCacheHits()
+	app := localserver.New(
+		localserver.Options{
+			CacheSize:       opts.cacheSize,
+			HandleCacheTTL:  time.Duration(opts.handleCacheTTL) * time.Second,
+			MemoryBudget:    opts.memoryBudget,
+			SchedulerSlots:  int(opts.schedulerSlots),
+			StorageAccounts: localserver.StorageAccountsOf(opts.files),
+		},
+		hits.middleware(),
+	)
+	server, err := localserver.Start(app)
+	if err != nil {
+		panic(err)
+	}
+
+	client := &http.Client{
+		Transport: &http.Transport{MaxIdleConnsPerHost: int(opts.concurrency)},
+	}
+
+	s := shape{
+		fencePoints:    int(opts.fencePoints),
+		surfaceRows:    int(opts.surfaceRows),
+		surfaceCols:    int(opts.surfaceCols),
+		windowSamples:  int(opts.window),
+		attributeNames: opts.attributes,
+	}
+	var cubes []*cube
+	for _, file := range opts.files {
+		path := file
+		if !strings.Contains(file, "://") {
+			path, err = filepath.Abs(file)
+			if err != nil {
+				panic(err)
+			}
+		}
+		c, err := newCube(client, server, path, s)
+		if err != nil {
+			fmt.Fprintln(os.Stderr, err)
+			os.Exit(1)
+		}
+		cubes = append(cubes, c)
+	}
+	hits.reset()
+
+	fmt.Printf(
+		"Running %s against %s for %ds\n",
+		opts.mix,
+		strings.Join(opts.files, ", "),
+		opts.duration,
+	)
+
+	r := newRecorder()
+	rss := startRSSSampler(100 * time.Millisecond)
+	start := time.Now()
+	run(client, server, cubes, requests, s, &opts, r)
+	elapsed := time.Since(start)
+	rss.stop()
+
+	result := makeReport(r, hits, rss, requests.kinds(), elapsed, int(opts.concurrency))
+	result.print(os.Stdout)
+
+	if opts.jsonReport != "" {
+		data, err := json.MarshalIndent(result, "", "  ")
+		if err != nil {
+			panic(err)
+		}
+		if err := os.WriteFile(opts.jsonReport, data, 0644); err != nil {
+			panic(err)
+		}
+	}
+}
@@ -0,0 +1,262 @@
+package main
+
+import (
+	"bufio"
+	"fmt"
+	"io"
+	"net/http"
+	"os"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"text/tabwriter"
+	"time"
+
+	"github.com/gin-gonic/gin"
+)
+
+/** Latencies and errors of the requests sent by the load generator */
+type recorder struct {
+	lock      sync.Mutex
+	latencies map[kind][]time.Duration
+	errors    map[kind]int
+	lastError map[kind]string
+}
+
+func newRecorder() *recorder {
+	return &recorder{
+		latencies: make(map[kind][]time.Duration),
+		errors:    make(map[kind]int),
+		lastError: make(map[kind]string),
+	}
+}
+
+func (r *recorder) record(k kind, latency time.Duration, err error) {
+	r.lock.Lock()
+	defer r.lock.Unlock()
+	if err != nil {
+		r.errors[k]++
+		r.lastError[k] = err.Error()
+		return
+	}
+	r.latencies[k] = append(r.latencies[k], latency)
+}
+
+/** Cache hits as seen by the server, counted per route */
+type cacheHits struct {
+	lock     sync.Mutex
+	requests map[string]int
+	hits     map[string]int
+}
+
+func newCacheHits() *cacheHits {
+	return &cacheHits{
+		requests: make(map[string]int),
+		hits:     make(map[string]int),
+	}
+}
+
+/** Middleware that counts the requests answered from the response cache */
+func (c *cacheHits) middleware() gin.HandlerFunc {
+	return func(ctx *gin.Context) {
+		ctx.Next()
+		if ctx.Writer.Status() != http.StatusOK {
+			return
+		}
+		c.lock.Lock()
+		defer c.lock.Unlock()
+		c.requests[ctx.FullPath()]++
+		if ctx.GetBool("cache-hit") {
+			c.hits[ctx.FullPath()]++
+		}
+	}
+}
+
+/** Forget what was counted so far, e.g. requests made during setup */
+func (c *cacheHits) reset() {
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	c.requests = make(map[string]int)
+	c.hits = make(map[string]int)
+}
+
+func (c *cacheHits) ratio(path string) float64 {
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	if c.requests[path] == 0 {
+		return 0
+	}
+	return float64(c.hits[path]) / float64(c.requests[path])
+}
+
+/** Resident set size of this process, which also hosts the server */
+func readRSS() (uint64, error) {
+	file, err := os.Open("/proc/self/status")
+	if err != nil {
+		return 0, err
+	}
+	defer file.Close()
+
+	scanner := bufio.NewScanner(file)
+	for scanner.Scan() {
+		fields := strings.Fields(scanner.Text())
+		if len(fields) == 3 && fields[0] == "VmRSS:" && fields[2] == "kB" {
+			kb, err := strconv.ParseUint(fields[1], 10, 64)
+			return kb * 1024, err
+		}
+	}
+	return 0, fmt.Errorf("no VmRSS in /proc/self/status")
+}
+
+/** Samples RSS until stopped, remembering the peak */
+type rssSampler struct {
+	peak atomic.Uint64
+	last atomic.Uint64
+	done chan struct{}
+	wg   sync.WaitGroup
+}
+
+func startRSSSampler(interval time.Duration) *rssSampler {
+	s := &rssSampler{done: make(chan struct{})}
+	s.sample()
+	s.wg.Add(1)
+	go func() {
+		defer s.wg.Done()
+		ticker := time.NewTicker(interval)
+		defer ticker.Stop()
+		for {
+			select {
+			case <-s.done:
+				return
+			case <-ticker.C:
+				s.sample()
+			}
+		}
+	}()
+	return s
+}
+
+func (s *rssSampler) sample() {
+	rss, err := readRSS()
+	if err != nil {
+		return
+	}
+	s.last.Store(rss)
+	for {
+		peak := s.peak.Load()
+		if rss <= peak || s.peak.CompareAndSwap(peak, rss) {
+			return
+		}
+	}
+}
+
+func (s *rssSampler) stop() {
+	close(s.done)
+	s.wg.Wait()
+	s.sample()
+}
+
+/** Summary of one kind of traffic */
+type endpointReport struct {
+	Kind          string  `json:"kind"`
+	Requests      int     `json:"requests"`
+	Errors        int     `json:"errors"`
+	LastError     string  `json:"lastError,omitempty"`
+	Throughput    float64 `json:"throughput"`
+	P50           float64 `json:"p50Ms"`
+	P95           float64 `json:"p95Ms"`
+	P99           float64 `json:"p99Ms"`
+	CacheHitRatio float64 `json:"cacheHitRatio"`
+}
+
+type report struct {
+	Duration    float64          `json:"durationSeconds"`
+	Concurrency int              `json:"concurrency"`
+	PeakRSS     uint64           `json:"peakRssBytes"`
+	FinalRSS    uint64           `json:"finalRssBytes"`
+	Endpoints   []endpointReport `json:"endpoints"`
+}
+
+/** Nearest-rank percentile of sorted latencies, in milliseconds */
+func percentile(sorted []time.Duration, p float64) float64 {
+	if len(sorted) == 0 {
+		return 0
+	}
+	rank := int(p/100*float64(len(sorted))+0.5) - 1
+	rank = max(0, min(rank, len(sorted)-1))
+	return float64(sorted[rank]) / float64(time.Millisecond)
+}
+
+func makeReport(
+	r *recorder,
+	hits *cacheHits,
+	rss *rssSampler,
+	kinds []kind,
+	elapsed time.Duration,
+	concurrency int,
+) report {
+	r.lock.Lock()
+	defer r.lock.Unlock()
+
+	out := report{
+		Duration:    elapsed.Seconds(),
+		Concurrency: concurrency,
+		PeakRSS:     rss.peak.Load(),
+		FinalRSS:    rss.last.Load(),
+	}
+	for _, k := range kinds {
+		latencies := r.latencies[k]
+		sort.Slice(latencies, func(i, j int) bool {
+			return latencies[i] < latencies[j]
+		})
+		out.Endpoints = append(out.Endpoints, endpointReport{
+			Kind:          string(k),
+			Requests:      len(latencies),
+			Errors:        r.errors[k],
+			LastError:     r.lastError[k],
+			Throughput:    float64(len(latencies)) / elapsed.Seconds(),
+			P50:           percentile(latencies, 50),
+			P95:           percentile(latencies, 95),
+			P99:           percentile(latencies, 99),
+			CacheHitRatio: hits.ratio(k.path()),
+		})
+	}
+	return out
+}
+
+func (r report) print(w io.Writer) {
+	fmt.Fprintf(
+		w,
+		"duration: %.1fs, concurrency: %d, peak RSS: %.1f MB, final RSS: %.1f MB\n\n",
+		r.Duration,
+		r.Concurrency,
+		float64(r.PeakRSS)/(1024*1024),
+		float64(r.FinalRSS)/(1024*1024),
+	)
+
+	table := tabwriter.NewWriter(w, 0, 0, 2, ' ', tabwriter.AlignRight)
+	fmt.Fprintln(table, "kind\trequests\terrors\treq/s\tp50 ms\tp95 ms\tp99 ms\tcache hits\t")
+	for _, e := range r.Endpoints {
+		fmt.Fprintf(
+			table,
+			"%s\t%d\t%d\t%.1f\t%.1f\t%.1f\t%.1f\t%.0f%%\t\n",
+			e.Kind,
+			e.Requests,
+			e.Errors,
+			e.Throughput,
+			e.P50,
+			e.P95,
+			e.P99,
+			e.CacheHitRatio*100,
+		)
+	}
+	table.Flush()
+
+	for _, e := range r.Endpoints {
+		if e.LastError != "" {
+			fmt.Fprintf(w, "\nlast %s error: %s\n", e.Kind, e.LastError)
+		}
+	}
+}
@@ -0,0 +1,334 @@
+package main
+
+import (
+	"bytes"
+	"encoding/json"
+	"fmt"
+	"io"
+	"math"
+	"math/rand"
+	"net/http"
+	"sort"
+	"strconv"
+	"strings"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+/** Kinds of traffic the load test can generate */
+type kind string
+
+const (
+	sliceKind     kind = "slice"
+	fenceKind     kind = "fence"
+	metadataKind  kind = "metadata"
+	attributeKind kind = "attribute"
+)
+
+var kinds = []kind{sliceKind, fenceKind, metadataKind, attributeKind}
+
+func (k kind) path() string {
+	switch k {
+	case sliceKind:
+		return "/slice"
+	case fenceKind:
+		return "/fence"
+	case metadataKind:
+		return "/metadata"
+	case attributeKind:
+		return "/attributes/surface/along"
+	default:
+		panic(fmt.Sprintf("unknown request kind %s", k))
+	}
+}
+
+/** Relative weights of the kinds of requests in the generated traffic */
+type mix []weightedKind
+
+type weightedKind struct {
+	kind   kind
+	weight int
+}
+
+/** Parse a mix on the form slice=6,fence=2,metadata=1,attribute=1
+ *
+ * Kinds that are left out are not generated.
+ */
+func parseMix(value string) (mix, error) {
+	var out mix
+	seen := map[kind]bool{}
+	for _, item := range strings.Split(value, ",") {
+		name, weight, found := strings.Cut(strings.TrimSpace(item), "=")
+		if !found {
+			return nil, fmt.Errorf("expected kind=weight, got '%s'", item)
+		}
+
+		k := kind(strings.ToLower(strings.TrimSpace(name)))
+		valid := false
+		for _, known := range kinds {
+			valid = valid || k == known
+		}
+		if !valid {
+			return nil, fmt.Errorf("unknown request kind '%s'", name)
+		}
+		if seen[k] {
+			return nil, fmt.Errorf("request kind '%s' is given more than once", name)
+		}
+		seen[k] = true
+
+		w, err := strconv.Atoi(strings.TrimSpace(weight))
+		if err != nil || w < 0 {
+			return nil, fmt.Errorf("invalid weight '%s' for '%s'", weight, name)
+		}
+		if w > 0 {
+			out = append(out, weightedKind{kind: k, weight: w})
+		}
+	}
+	if len(out) == 0 {
+		return nil, fmt.Errorf("mix '%s' does not generate any requests", value)
+	}
+	return out, nil
+}
+
+func (m mix) pick(rng *rand.Rand) kind {
+	total := 0
+	for _, w := range m {
+		total += w.weight
+	}
+	n := rng.Intn(total)
+	for _, w := range m {
+		if n < w.weight {
+			return w.kind
+		}
+		n -= w.weight
+	}
+	panic("unreachable")
+}
+
+func (m mix) kinds() []kind {
+	out := make([]kind, len(m))
+	for i, w := range m {
+		out[i] = w.kind
+	}
+	sort.Slice(out, func(i, j int) bool { return out[i] < out[j] })
+	return out
+}
+
+/** Shapes of the generated requests */
+type shape struct {
+	fencePoints    int
+	surfaceRows    int
+	surfaceCols    int
+	windowSamples  int
+	attributeNames []string
+}
+
+/** Request bodies, mirroring the swagger specification of the server */
+type resource struct {
+	Vds []string `json:"vds"`
+	Sas []string `json:"sas"`
+}
+
+type sliceBody struct {
+	resource
+	Direction string `json:"direction"`
+	Lineno    int    `json:"lineno"`
+}
+
+type fenceBody struct {
+	resource
+	CoordinateSystem string      `json:"coordinateSystem"`
+	Coordinates      [][]float32 `json:"coordinates"`
+	Interpolation    string      `json:"interpolation"`
+}
+
+type surface struct {
+	Values    [][]float32 `json:"values"`
+	Rotation  float32     `json:"rotation"`
+	Xori      float32     `json:"xori"`
+	Yori      float32     `json:"yori"`
+	Xinc      float32     `json:"xinc"`
+	Yinc      float32     `json:"yinc"`
+	FillValue float32     `json:"fillValue"`
+}
+
+type attributeBody struct {
+	resource
+	Surface    surface  `json:"surface"`
+	Above      float32  `json:"above"`
+	Below      float32  `json:"below"`
+	Attributes []string `json:"attributes"`
+}
+
+/** A VDS under test, and what is needed to generate valid requests to it */
+type cube struct {
+	path     string
+	metadata core.Metadata
+	// Pre-made attribute requests, as surfaces are expensive to encode
+	attributes [][]byte
+}
+
+/** Number of distinct horizons per cube in attribute traffic */
+const attributeVariants = 8
+
+func (c *cube) resource() resource {
+	/* File connections ignore the sas, but the server expects one per vds */
+	return resource{Vds: []string{c.path}, Sas: []string{"unused"}}
+}
+
+func post(client *http.Client, server string, k kind, body any) ([]byte, error) {
+	payload, err := json.Marshal(body)
+	if err != nil {
+		return nil, err
+	}
+	return postRaw(client, server, k, payload)
+}
+
+func postRaw(client *http.Client, server string, k kind, payload []byte) ([]byte, error) {
+	response, err := client.Post(
+		server+k.path(),
+		"application/json",
+		bytes.NewReader(payload),
+	)
+	if err != nil {
+		return nil, err
+	}
+	defer response.Body.Close()
+
+	data, err := io.ReadAll(response.Body)
+	if err != nil {
+		return nil, err
+	}
+	if response.StatusCode != http.StatusOK {
+		return nil, fmt.Errorf("%s: %s: %s", k.path(), response.Status, data)
+	}
+	return data, nil
+}
+
+/** Read the metadata of the VDS through the server itself */
+func newCube(client *http.Client, server string, path string, s shape) (*cube, error) {
+	c := &cube{path: path}
+	data, err := post(client, server, metadataKind, c.resource())
+	if err != nil {
+		return nil, err
+	}
+	if err := json.Unmarshal(data, &c.metadata); err != nil {
+		return nil, err
+	}
+	if len(c.metadata.Axis) != 3 || len(c.metadata.BoundingBox.Cdp) != 4 {
+		return nil, fmt.Errorf("%s: unexpected metadata: %s", path, data)
+	}
+
+	for variant := 0; variant < attributeVariants; variant++ {
+		attribute, err := json.Marshal(c.attributeRequest(s, float64(variant)))
+		if err != nil {
+			return nil, err
+		}
+		c.attributes = append(c.attributes, attribute)
+	}
+	return c, nil
+}
+
+/** Slice through a random line in a random direction */
+func (c *cube) sliceRequest(rng *rand.Rand) sliceBody {
+	directions := []string{"i", "j", "k"}
+	dim := rng.Intn(len(directions))
+	return sliceBody{
+		resource:  c.resource(),
+		Direction: directions[dim],
+		Lineno:    rng.Intn(c.metadata.Axis[dim].Samples),
+	}
+}
+
+/** Straight fence of npoints between two random points in the cube */
+func (c *cube) fenceRequest(rng *rand.Rand, npoints int) fenceBody {
+	maxi := float32(c.metadata.Axis[0].Samples - 1)
+	maxj := float32(c.metadata.Axis[1].Samples - 1)
+	i0, j0 := rng.Float32()*maxi, rng.Float32()*maxj
+	i1, j1 := rng.Float32()*maxi, rng.Float32()*maxj
+
+	coordinates := make([][]float32, npoints)
+	for n := range coordinates {
+		t := float32(n) / float32(max(npoints-1, 1))
+		coordinates[n] = []float32{i0 + t*(i1-i0), j0 + t*(j1-j0)}
+	}
+	return fenceBody{
+		resource:         c.resource(),
+		CoordinateSystem: "ij",
+		Coordinates:      coordinates,
+		Interpolation:    "linear",
+	}
+}
+
+/** Horizon covering the whole cube, undulating around the middle sample
+ *
+ * The window is shrunk to fit the cube, such that every request is valid
+ * also against small cubes. Horizons with different phases are different
+ * requests to the server.
+ */
+func (c *cube) attributeRequest(s shape, phase float64) attributeBody {
+	box := c.metadata.BoundingBox.Cdp
+	ix, iy := box[1][0]-box[0][0], box[1][1]-box[0][1]
+	jx, jy := box[3][0]-box[0][0], box[3][1]-box[0][1]
+
+	handedness := 1.0
+	if ix*jy-iy*jx < 0 {
+		handedness = -1
+	}
+
+	sample := c.metadata.Axis[2]
+	middle := (sample.Min + sample.Max) / 2
+	jitter := 2 * sample.StepSize
+	room := math.Max((sample.Max-sample.Min)/2-jitter, 0)
+	half := math.Min(
+		float64(s.windowSamples/2)*sample.StepSize,
+		math.Floor(room/sample.StepSize)*sample.StepSize,
+	)
+
+	values := make([][]float32, s.surfaceRows)
+	for row := range values {
+		values[row] = make([]float32, s.surfaceCols)
+		for col := range values[row] {
+			wave := math.Sin(float64(row)*0.05+phase) * math.Cos(float64(col)*0.07)
+			values[row][col] = float32(middle + jitter*wave)
+		}
+	}
+
+	return attributeBody{
+		resource: c.resource(),
+		Surface: surface{
+			Values:    values,
+			Rotation:  float32(math.Atan2(iy, ix) * 180 / math.Pi),
+			Xori:      float32(box[0][0]),
+			Yori:      float32(box[0][1]),
+			Xinc:      float32(math.Hypot(ix, iy) / float64(max(s.surfaceRows-1, 1))),
+			Yinc:      float32(handedness * math.Hypot(jx, jy) / float64(max(s.surfaceCols-1, 1))),
+			FillValue: -999.25,
+		},
+		Above:      float32(half),
+		Below:      float32(half),
+		Attributes: s.attributeNames,
+	}
+}
+
+/** Send one request of the given kind */
+func (c *cube) send(
+	client *http.Client,
+	server string,
+	k kind,
+	rng *rand.Rand,
+	s shape,
+) error {
+	var err error
+	switch k {
+	case sliceKind:
+		_, err = post(client, server, k, c.sliceRequest(rng))
+	case fenceKind:
+		_, err = post(client, server, k, c.fenceRequest(rng, s.fencePoints))
+	case metadataKind:
+		_, err = post(client, server, k, c.resource())
+	case attributeKind:
+		_, err = postRaw(client, server, k, c.attributes[rng.Intn(len(c.attributes))])
+	}
+	return err
+}
@@ -0,0 +1,84 @@
+package main
+
+import (
+	"math/rand"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+func TestParseMix(t *testing.T) {
+	m, err := parseMix("slice=6, Fence=2,metadata=0")
+	require.NoError(t, err)
+	require.Equal(t, mix{{sliceKind, 6}, {fenceKind, 2}}, m)
+	require.Equal(t, []kind{fenceKind, sliceKind}, m.kinds())
+
+	invalid := []string{
+		"",
+		"slice",
+		"slice=-1",
+		"slice=a",
+		"horizon=1",
+		"slice=1,slice=2",
+		"slice=0,fence=0",
+	}
+	for _, value := range invalid {
+		_, err := parseMix(value)
+		require.Error(t, err, value)
+	}
+}
+
+func TestMixPicksByWeight(t *testing.T) {
+	m, err := parseMix("slice=3,fence=1")
+	require.NoError(t, err)
+
+	rng := rand.New(rand.NewSource(1))
+	picked := map[kind]int{}
+	for i := 0; i < 4000; i++ {
+		picked[m.pick(rng)]++
+	}
+	require.InDelta(t, 3000, picked[sliceKind], 150)
+	require.InDelta(t, 1000, picked[fenceKind], 150)
+}
+
+func TestPercentile(t *testing.T) {
+	var latencies []time.Duration
+	for i := 1; i <= 100; i++ {
+		latencies = append(latencies, time.Duration(i)*time.Millisecond)
+	}
+	require.Equal(t, 50.0, percentile(latencies, 50))
+	require.Equal(t, 95.0, percentile(latencies, 95))
+	require.Equal(t, 99.0, percentile(latencies, 99))
+	require.Equal(t, 0.0, percentile(nil, 50))
+}
+
+func TestAttributeWindowFitsCube(t *testing.T) {
+	c := cube{
+		path: "cube.vds",
+		metadata: core.Metadata{
+			BoundingBox: core.BoundingBox{
+				Cdp: [][]float64{{0, 0}, {100, 0}, {100, 50}, {0, 50}},
+			},
+			Axis: []*core.Axis{
+				{Samples: 11},
+				{Samples: 6},
+				{Min: 4, Max: 40, Samples: 10, StepSize: 4},
+			},
+		},
+	}
+	request := c.attributeRequest(shape{surfaceRows: 3, surfaceCols: 2, windowSamples: 50}, 0)
+
+	require.Equal(t, float32(8), request.Above)
+	require.Equal(t, float32(8), request.Below)
+	require.Equal(t, float32(50), request.Surface.Xinc)
+	require.Equal(t, float32(50), request.Surface.Yinc)
+	for _, row := range request.Surface.Values {
+		for _, value := range row {
+			require.GreaterOrEqual(t, value-request.Above, float32(4))
+			require.LessOrEqual(t, value+request.Below, float32(40))
+		}
+	}
+}
@@ -2,9 +2,11 @@ package main
 
 import (
 	"fmt"
+	"log"
 	"os"
 	"strconv"
 	"strings"
+	"time"
 
 	"github.com/gin-contrib/gzip"
 	"github.com/gin-gonic/gin"
@@ -14,18 +16,64 @@ import (
 
 	"github.com/equinor/oneseismic-api/api/handlers"
 	"github.com/equinor/oneseismic-api/api/middleware"
+	"github.com/equinor/oneseismic-api/internal/admission"
 	"github.com/equinor/oneseismic-api/internal/cache"
 	"github.com/equinor/oneseismic-api/internal/core"
+	"github.com/equinor/oneseismic-api/internal/flightrecorder"
 	"github.com/equinor/oneseismic-api/internal/metrics"
+	"github.com/equinor/oneseismic-api/internal/readahead"
+	"github.com/equinor/oneseismic-api/internal/scheduler"
+	"github.com/equinor/oneseismic-api/internal/warmup"
 	_ "github.com/equinor/oneseismic-api/docs"
 )
 
+/** Max number of opened VDS handles kept for reuse. Every handle holds the
+ *  layout of its VDS and a small cache of recently read chunks.
+ */
+const maxPooledHandles = 64
+
+/** Warm-up jobs of the prefetch endpoint. At most maxRunningWarmups jobs read
+ *  at the same time, and the progress of the last maxWarmups jobs is kept.
+ */
+const (
+	maxRunningWarmups = 2
+	maxWarmups        = 100
+)
+
+/** Max number of remembered authorization checks */
+const maxCachedAuthorizations = 10000
+
+/** Scheduling of interactive requests (slices, fences) against batch requests
+ *  (attributes). Interactive requests get 4 of every 5 free slots when both
+ *  are waiting, and are expected to give up sooner.
+ */
+const (
+	interactiveWeight  = 4
+	interactiveMaxWait = 30 * time.Second
+	batchWeight        = 1
+	batchMaxWait       = 5 * time.Minute
+)
+
 type opts struct {
 	storageAccounts   string
 	port              uint32
 	cacheSize         uint64
+	diskCacheDir      string
+	diskCacheSize     uint64
+	handleCacheTTL    uint32
+	authCacheTTL      uint32
+	memoryBudget      uint64
+	admissionTimeout  uint32
+	schedulerSlots    uint32
+	batchSlots        uint32
+	readAhead         uint32
+	alignThreads      uint32
+	preOpen           []string
 	metrics           bool
 	metricsPort       uint32
+	requestLog        string
+	slowRequests      uint32
+	slowRequestCount  uint32
 	trustedProxies    []string
 	blockedIPs        []string
 	blockedUserAgents []string
@@ -91,8 +139,22 @@ func parseopts() opts {
 		storageAccounts:   parseAsString("", os.Getenv("ONESEISMIC_API_STORAGE_ACCOUNTS")),
 		port:              parseAsUint32(8080, os.Getenv("ONESEISMIC_API_PORT")),
 		cacheSize:         parseAsUint64(0, os.Getenv("ONESEISMIC_API_CACHE_SIZE")),
+		diskCacheDir:      parseAsString("", os.Getenv("ONESEISMIC_API_DISK_CACHE_DIR")),
+		diskCacheSize:     parseAsUint64(0, os.Getenv("ONESEISMIC_API_DISK_CACHE_SIZE")),
+		handleCacheTTL:    parseAsUint32(0, os.Getenv("ONESEISMIC_API_HANDLE_CACHE_TTL")),
+		authCacheTTL:      parseAsUint32(0, os.Getenv("ONESEISMIC_API_AUTH_CACHE_TTL")),
+		memoryBudget:      parseAsUint64(0, os.Getenv("ONESEISMIC_API_MEMORY_BUDGET")),
+		admissionTimeout:  parseAsUint32(30, os.Getenv("ONESEISMIC_API_ADMISSION_TIMEOUT")),
+		schedulerSlots:    parseAsUint32(0, os.Getenv("ONESEISMIC_API_SCHEDULER_SLOTS")),
+		batchSlots:        parseAsUint32(0, os.Getenv("ONESEISMIC_API_BATCH_SLOTS")),
+		readAhead:         parseAsUint32(0, os.Getenv("ONESEISMIC_API_READ_AHEAD")),
+		alignThreads:      parseAsUint32(0, os.Getenv("ONESEISMIC_API_ALIGN_THREADS")),
+		preOpen:           parseAsListOfStrings(nil, os.Getenv("ONESEISMIC_API_PRE_OPEN")),
 		metrics:           parseAsBool(false, os.Getenv("ONESEISMIC_API_METRICS")),
 		metricsPort:       parseAsUint32(8081, os.Getenv("ONESEISMIC_API_METRICS_PORT")),
+		requestLog:        parseAsString("", os.Getenv("ONESEISMIC_API_REQUEST_LOG")),
+		slowRequests:      parseAsUint32(0, os.Getenv("ONESEISMIC_API_SLOW_REQUESTS")),
+		slowRequestCount:  parseAsUint32(100, os.Getenv("ONESEISMIC_API_SLOW_REQUEST_COUNT")),
 		trustedProxies:    parseAsListOfStrings(nil, os.Getenv("ONESEISMIC_API_TRUSTED_PROXIES")),
 		blockedIPs:        parseAsListOfStrings(nil, os.Getenv("ONESEISMIC_API_BLOCKED_IPS")),
 		blockedUserAgents: parseAsListOfStrings(nil, os.Getenv("ONESEISMIC_API_BLOCKED_USER_AGENTS")),
@@ -127,6 +189,140 @@ func parseopts() opts {
 		"int",
 	)
 
+	getopt.FlagLong(
+		&opts.diskCacheDir,
+		"disk-cache-dir",
+		0,
+		"Directory for the disk tier of the response cache. Entries evicted from\n"+
+			"memory are moved to disk, and the disk tier survives restarts. The disk\n"+
+			"tier is off when no directory is given. (see --disk-cache-size)\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_DISK_CACHE_DIR'",
+		"string",
+	)
+
+	getopt.FlagLong(
+		&opts.diskCacheSize,
+		"disk-cache-size",
+		0,
+		"Max size of the disk tier of the response cache. In megabytes.\n"+
+			"Ignored if no disk cache directory is given. (see --disk-cache-dir)\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_DISK_CACHE_SIZE'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.handleCacheTTL,
+		"handle-cache-ttl",
+		0,
+		"Time, in seconds, to keep opened VDS handles around for reuse. Reused\n"+
+			"handles serve metadata, and the metadata part of data requests,\n"+
+			"without reading the VDS layout from storage again. Handles are never\n"+
+			"kept beyond the expiry of the sas-token they were opened with.\n"+
+			"A value of zero disables reuse. Defaults to 0.\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_HANDLE_CACHE_TTL'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.authCacheTTL,
+		"auth-cache-ttl",
+		0,
+		"Time, in seconds, to remember that a sas-token grants read access to a\n"+
+			"VDS. Cached responses are only served after such a check, which\n"+
+			"otherwise costs a round-trip to blob storage. Access is never\n"+
+			"remembered beyond the expiry of the sas-token, and denied access is\n"+
+			"never remembered. The value is how long a revoked sas-token, or a\n"+
+			"revoked stored access policy, may still be served cached responses.\n"+
+			"A value of zero disables the cache. Defaults to 0.\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_AUTH_CACHE_TTL'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.memoryBudget,
+		"memory-budget",
+		0,
+		"Max memory, in megabytes, for data being read by requests in flight.\n"+
+			"The memory needed by a request is estimated before any data is read.\n"+
+			"Requests that do not fit wait for memory to be released, while\n"+
+			"requests larger than the whole budget are rejected. A value of zero\n"+
+			"disables the limit. Defaults to 0. (see --admission-timeout)\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_MEMORY_BUDGET'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.admissionTimeout,
+		"admission-timeout",
+		0,
+		"Time, in seconds, a request waits for memory before it is rejected with\n"+
+			"503 Service Unavailable. Defaults to 30.\n"+
+			"Ignored if there is no memory budget. (see --memory-budget)\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_ADMISSION_TIMEOUT'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.schedulerSlots,
+		"scheduler-slots",
+		0,
+		"Max number of data requests reading data at the same time.\n"+
+			"Other requests are queued, and slices and fences are scheduled ahead\n"+
+			"of attribute calculations. A value of zero disables scheduling.\n"+
+			"Defaults to 0. (see --batch-slots)\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_SCHEDULER_SLOTS'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.batchSlots,
+		"batch-slots",
+		0,
+		"Max number of scheduler slots used by attribute calculations, such that\n"+
+			"the remaining slots are always available to slices and fences.\n"+
+			"Defaults to half of the scheduler slots. (see --scheduler-slots)\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_BATCH_SLOTS'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.readAhead,
+		"read-ahead",
+		0,
+		"Number of slices to read ahead of clients that step through a volume\n"+
+			"line by line. The slices are read into the response cache in the\n"+
+			"background, as batch requests that only use spare memory. A value of\n"+
+			"zero disables reading ahead. Defaults to 0.\n"+
+			"Ignored if there is no response cache. (see --cache-size)\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_READ_AHEAD'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.alignThreads,
+		"align-threads",
+		0,
+		"Number of threads, shared by all requests, that help align large\n"+
+			"surfaces in attribute calculations between surfaces. Requests that\n"+
+			"find no thread spare align their surfaces by themselves. A value of\n"+
+			"zero aligns every pair of surfaces in the thread of its request.\n"+
+			"Defaults to 0.\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_ALIGN_THREADS'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.preOpen,
+		"pre-open",
+		0,
+		"Comma-separated list of signed VDS urls to open when the server starts,\n"+
+			"such that the first requests to hot VDS do not pay for reading their\n"+
+			"layout from storage. The handles are kept like any other reused\n"+
+			"handle. Ignored if handles are not reused. (see --handle-cache-ttl)\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_PRE_OPEN'",
+		"string",
+	)
+
 	getopt.FlagLong(
 		&opts.metrics,
 		"metrics",
@@ -148,6 +344,39 @@ func parseopts() opts {
 		"int",
 	)
 
+	getopt.FlagLong(
+		&opts.requestLog,
+		"request-log",
+		0,
+		"File to append a structured log of all data and metadata requests to,\n"+
+			"one json object per line, for replay with cmd/replay. Requests are\n"+
+			"logged in full, except for sas-tokens. Off by default.\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_REQUEST_LOG'",
+		"string",
+	)
+
+	getopt.FlagLong(
+		&opts.slowRequests,
+		"slow-requests",
+		0,
+		"Latency threshold, in milliseconds, for recording requests in the slow\n"+
+			"request flight recorder. A detailed breakdown of the most recent slow\n"+
+			"requests is served as json on /debug/slow-requests on the metrics port.\n"+
+			"A value of zero turns the recorder off. Defaults to 0.\n"+
+			"Ignored if metrics are not turned on. (see --metrics)\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_SLOW_REQUESTS'",
+		"int",
+	)
+
+	getopt.FlagLong(
+		&opts.slowRequestCount,
+		"slow-request-count",
+		0,
+		"Number of slow requests the flight recorder keeps. Defaults to 100.\n"+
+			"Can also be set by environment variable 'ONESEISMIC_API_SLOW_REQUEST_COUNT'",
+		"int",
+	)
+
 	getopt.FlagLong(
 		&opts.trustedProxies,
 		"trusted-proxies",
@@ -187,13 +416,34 @@ func parseopts() opts {
 	return opts
 }
 
-func setupApp(app *gin.Engine, endpoint *handlers.Endpoint, metric *metrics.Metrics, opts *opts) {
+func setupApp(
+	app *gin.Engine,
+	endpoint *handlers.Endpoint,
+	metric *metrics.Metrics,
+	slowRequests *flightrecorder.Recorder,
+	opts *opts,
+) {
 	app.Use(middleware.FormattedLogger())
 	app.Use(gin.Recovery())
 	app.Use(gzip.Gzip(gzip.BestSpeed))
 	app.Use(middleware.RequestBlocker(opts.blockedIPs, opts.blockedUserAgents))
 
 	seismic := app.Group("/")
+	if opts.requestLog != "" {
+		requestLog, err := os.OpenFile(
+			opts.requestLog,
+			os.O_APPEND|os.O_CREATE|os.O_WRONLY,
+			0644,
+		)
+		if err != nil {
+			panic(err)
+		}
+		/* Registered first to see the final status set by the error handler */
+		seismic.Use(middleware.RequestRecorder(requestLog))
+	}
+	if slowRequests != nil {
+		seismic.Use(slowRequests.Middleware())
+	}
 	seismic.Use(middleware.ErrorHandler)
 
 	if metric != nil {
@@ -211,6 +461,10 @@ func setupApp(app *gin.Engine, endpoint *handlers.Endpoint, metric *metrics.Metr
 	seismic.GET("fence", endpoint.FenceGet)
 	seismic.POST("fence", endpoint.FencePost)
 
+	seismic.POST("prefetch", endpoint.PrefetchPost)
+	seismic.GET("prefetch/:id", endpoint.PrefetchGet)
+	seismic.DELETE("prefetch/:id", endpoint.PrefetchDelete)
+
 	attributes := seismic.Group("attributes")
 	attributesSurface := attributes.Group("surface")
 
@@ -234,9 +488,84 @@ func main() {
 
 	storageAccounts := strings.Split(opts.storageAccounts, ",")
 
+	core.SetAlignmentThreads(int(opts.alignThreads))
+
+	responseCache := cache.NewCache(opts.cacheSize)
+	if opts.diskCacheDir != "" && opts.diskCacheSize > 0 {
+		tieredCache, err := cache.NewTieredCache(
+			opts.cacheSize,
+			opts.diskCacheDir,
+			opts.diskCacheSize,
+		)
+		if err != nil {
+			panic(err)
+		}
+		responseCache = tieredCache
+	}
+
+	makeConnection := core.MakeAzureConnection(storageAccounts)
+	if opts.authCacheTTL > 0 {
+		makeConnection = core.WithAuthorizationCache(
+			makeConnection,
+			core.NewAuthorizationCache(
+				time.Duration(opts.authCacheTTL)*time.Second,
+				maxCachedAuthorizations,
+			),
+		)
+	}
+
 	endpoint := handlers.Endpoint{
-		MakeVdsConnection: core.MakeAzureConnection(storageAccounts),
-		Cache:             cache.NewCache(opts.cacheSize),
+		MakeVdsConnection: makeConnection,
+		Cache:             responseCache,
+	}
+	if opts.memoryBudget > 0 {
+		endpoint.Admission = admission.NewController(
+			opts.memoryBudget*1024*1024,
+			time.Duration(opts.admissionTimeout)*time.Second,
+		)
+	}
+	if opts.schedulerSlots > 0 {
+		batchSlots := opts.batchSlots
+		if batchSlots == 0 {
+			batchSlots = (opts.schedulerSlots + 1) / 2
+		}
+		endpoint.Scheduler = scheduler.NewScheduler(
+			int(opts.schedulerSlots),
+			scheduler.ClassConfig{
+				Weight:  interactiveWeight,
+				MaxWait: interactiveMaxWait,
+			},
+			scheduler.ClassConfig{
+				Weight:   batchWeight,
+				MaxSlots: int(batchSlots),
+				MaxWait:  batchMaxWait,
+			},
+		)
+	}
+	/* Memory for work that must never make requests wait */
+	var spareBudget core.MemoryBudget
+	if controller, ok := endpoint.Admission.(*admission.Controller); ok {
+		spareBudget = controller.Spare()
+	}
+	_, noCache := responseCache.(*cache.NoCache)
+	if opts.readAhead > 0 && !noCache {
+		endpoint.ReadAhead = readahead.New(int(opts.readAhead), spareBudget)
+	}
+	if opts.handleCacheTTL > 0 {
+		endpoint.Handles = core.NewHandlePool(
+			time.Duration(opts.handleCacheTTL)*time.Second,
+			maxPooledHandles,
+			spareBudget,
+		)
+		endpoint.Warmups = warmup.NewJobs(maxRunningWarmups, maxWarmups)
+
+		go func() {
+			for _, vds := range opts.preOpen {
+				if err := endpoint.PreOpen(vds); err != nil {
+					log.Printf("Unable to pre-open vds: %v", err)
+				}
+			}
+		}()
 	}
 
 	app := gin.New()
@@ -248,8 +577,15 @@ func main() {
 	}
 
 	var metric *metrics.Metrics
+	var slowRequests *flightrecorder.Recorder
 	if opts.metrics {
 		metric = metrics.NewMetrics()
+		if reporter, ok := responseCache.(cache.StatsReporter); ok {
+			metric.RegisterCacheStats(reporter)
+		}
+		if endpoint.Scheduler != nil {
+			metric.RegisterScheduler(endpoint.Scheduler)
+		}
 		/*
 		 * Host the /metrics endpoint on a different app instance. This is needed
 		 * in order to serve it on a different port, while also giving some benefits
@@ -266,12 +602,19 @@ func main() {
 
 		metricsApp.Use(gin.Recovery())
 		metricsApp.GET("metrics", metrics.NewGinHandler(metric))
+		if opts.slowRequests > 0 {
+			slowRequests = flightrecorder.NewRecorder(
+				time.Duration(opts.slowRequests)*time.Millisecond,
+				int(opts.slowRequestCount),
+			)
+			metricsApp.GET("debug/slow-requests", slowRequests.Handler())
+		}
 
 		go func() {
 			metricsApp.Run(fmt.Sprintf(":%d", opts.metricsPort))
 		}()
 	}
 
-	setupApp(app, &endpoint, metric, &opts)
+	setupApp(app, &endpoint, metric, slowRequests, &opts)
 	app.Run(fmt.Sprintf(":%d", opts.port))
 }
@@ -315,7 +315,7 @@ func setupTest(t *testing.T, testcase endpointTest) *httptest.ResponseRecorder {
 		Cache:             cache.NewNoCache(),
 	}
 
-	setupApp(r, &endpoint, nil, &opts)
+	setupApp(r, &endpoint, nil, nil, &opts)
 	// setup test server to trust correctness of X-Forwarded-For header
 	r.TrustedPlatform = "X-Forwarded-For"
 
@@ -0,0 +1,215 @@
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"io"
+	"net/http"
+	"os"
+	"sort"
+	"text/tabwriter"
+	"time"
+
+	"github.com/pborman/getopt/v2"
+
+	"github.com/equinor/oneseismic-api/internal/localserver"
+)
+
+type opts struct {
+	target         string
+	redirects      []string
+	sas            string
+	speed          float64
+	out            string
+	cacheSize      uint64
+	handleCacheTTL uint32
+	memoryBudget   uint64
+	schedulerSlots uint32
+	log            string
+}
+
+func parseopts() opts {
+	help := getopt.BoolLong("help", 0, "print this help text")
+
+	opts := opts{
+		sas:   "replay",
+		speed: 1,
+	}
+
+	getopt.FlagLong(&opts.target, "target", 0,
+		"Url of the server to replay against. If not given, the requests are\n"+
+			"replayed against a server started in this process, which reads\n"+
+			"local files, or a local stand-in for blob storage. (see --redirect)", "url")
+	getopt.FlagLong(&opts.redirects, "redirect", 0,
+		"Comma-separated list of from=to prefixes to rewrite in the vds urls,\n"+
+			"e.g. to point requests to local copies of the files:\n"+
+			"'https://<account>.blob.core.windows.net/<container>=/data/copies'", "string")
+	getopt.FlagLong(&opts.sas, "sas", 0,
+		"Sas-token to send for every vds, as the log holds none. Defaults to\n"+
+			"a dummy token, which is enough for local files.", "string")
+	getopt.FlagLong(&opts.speed, "speed", 0,
+		"Replay speed relative to the recorded timing, e.g. 2 sends requests\n"+
+			"twice as fast as they arrived. Defaults to 1.", "float")
+	getopt.FlagLong(&opts.out, "out", 0,
+		"Write the outcome of every request as json lines to this file.", "string")
+	getopt.FlagLong(&opts.cacheSize, "cache-size", 0,
+		"Response cache size of the local server. In megabytes. Defaults to 0.", "int")
+	getopt.FlagLong(&opts.handleCacheTTL, "handle-cache-ttl", 0,
+		"Time, in seconds, the local server keeps opened VDS handles around for\n"+
+			"reuse. Defaults to 0.", "int")
+	getopt.FlagLong(&opts.memoryBudget, "memory-budget", 0,
+		"Memory budget of the local server. In megabytes. Defaults to 0.", "int")
+	getopt.FlagLong(&opts.schedulerSlots, "scheduler-slots", 0,
+		"Scheduler slots of the local server. Defaults to 0.", "int")
+
+	getopt.SetParameters("request-log")
+	getopt.Parse()
+	if *help {
+		getopt.Usage()
+		os.Exit(0)
+	}
+
+	if getopt.NArgs() != 1 || opts.speed <= 0 {
+		getopt.Usage()
+		os.Exit(1)
+	}
+	opts.log = getopt.Arg(0)
+
+	return opts
+}
+
+/** Nearest-rank percentile of sorted latencies */
+func percentile(sorted []float64, p float64) float64 {
+	if len(sorted) == 0 {
+		return 0
+	}
+	rank := int(p/100*float64(len(sorted))+0.5) - 1
+	return sorted[max(0, min(rank, len(sorted)-1))]
+}
+
+type pathSummary struct {
+	path       string
+	requests   int
+	errors     int
+	mismatches int
+	recorded   []float64
+	replayed   []float64
+	deltas     []float64
+}
+
+/** Summarize the results per path, ordered by path */
+func summarize(results []result) []*pathSummary {
+	byPath := map[string]*pathSummary{}
+	for _, r := range results {
+		s, ok := byPath[r.Path]
+		if !ok {
+			s = &pathSummary{path: r.Path}
+			byPath[r.Path] = s
+		}
+		s.requests++
+		if r.Error != "" {
+			s.errors++
+			continue
+		}
+		if r.ReplayStatus != r.Status {
+			s.mismatches++
+		}
+		s.recorded = append(s.recorded, r.LatencyMs)
+		s.replayed = append(s.replayed, r.ReplayLatencyMs)
+		s.deltas = append(s.deltas, r.LatencyDeltaMs)
+	}
+
+	var out []*pathSummary
+	for _, s := range byPath {
+		sort.Float64s(s.recorded)
+		sort.Float64s(s.replayed)
+		sort.Float64s(s.deltas)
+		out = append(out, s)
+	}
+	sort.Slice(out, func(i, j int) bool { return out[i].path < out[j].path })
+	return out
+}
+
+func printSummary(w io.Writer, summaries []*pathSummary) {
+	table := tabwriter.NewWriter(w, 0, 0, 2, ' ', tabwriter.AlignRight)
+	fmt.Fprintln(table, "path\trequests\terrors\tstatus changed\t"+
+		"p50 ms\treplay p50 ms\tp95 ms\treplay p95 ms\tp50 delta ms\t")
+	for _, s := range summaries {
+		fmt.Fprintf(
+			table,
+			"%s\t%d\t%d\t%d\t%.1f\t%.1f\t%.1f\t%.1f\t%+.1f\t\n",
+			s.path,
+			s.requests,
+			s.errors,
+			s.mismatches,
+			percentile(s.recorded, 50),
+			percentile(s.replayed, 50),
+			percentile(s.recorded, 95),
+			percentile(s.replayed, 95),
+			percentile(s.deltas, 50),
+		)
+	}
+	table.Flush()
+}
+
+func main() {
+	opts := parseopts()
+
+	redirects, err := parseRedirects(opts.redirects)
+	if err != nil {
+		fmt.Fprintln(os.Stderr, err)
+		os.Exit(1)
+	}
+
+	requests, skipped, err := readLog(opts.log)
+	if err != nil {
+		fmt.Fprintln(os.Stderr, err)
+		os.Exit(1)
+	}
+
+	target := opts.target
+	if target == "" {
+		var locations []string
+		for _, r := range redirects {
+			locations = append(locations, r.to)
+		}
+		app := localserver.New(localserver.Options{
+			CacheSize:       opts.cacheSize,
+			HandleCacheTTL:  time.Duration(opts.handleCacheTTL) * time.Second,
+			MemoryBudget:    opts.memoryBudget,
+			SchedulerSlots:  int(opts.schedulerSlots),
+			StorageAccounts: localserver.StorageAccountsOf(locations),
+		})
+		target, err = localserver.Start(app)
+		if err != nil {
+			panic(err)
+		}
+	}
+
+	fmt.Printf(
+		"Replaying %d requests (%d skipped) against %s at %gx speed\n\n",
+		len(requests),
+		skipped,
+		target,
+		opts.speed,
+	)
+
+	client := &http.Client{Transport: &http.Transport{MaxIdleConnsPerHost: 64}}
+	results := replay(client, target, requests, redirects, opts.sas, opts.speed)
+	printSummary(os.Stdout, summarize(results))
+
+	if opts.out != "" {
+		file, err := os.Create(opts.out)
+		if err != nil {
+			panic(err)
+		}
+		defer file.Close()
+
+		encoder := json.NewEncoder(file)
+		for _, r := range results {
+			if err := encoder.Encode(r); err != nil {
+				panic(err)
+			}
+		}
+	}
+}
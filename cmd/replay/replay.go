@@ -0,0 +1,215 @@
+package main
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/json"
+	"fmt"
+	"io"
+	"net/http"
+	"net/url"
+	"os"
+	"sort"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/equinor/oneseismic-api/api/middleware"
+)
+
+/** Read a request log written by middleware.RequestRecorder, ordered by
+ *  arrival. Requests that were logged without a body cannot be replayed and
+ *  are counted as skipped.
+ */
+func readLog(path string) (requests []middleware.RecordedRequest, skipped int, err error) {
+	file, err := os.Open(path)
+	if err != nil {
+		return nil, 0, err
+	}
+	defer file.Close()
+
+	reader := bufio.NewReader(file)
+	decoder := json.NewDecoder(reader)
+	for {
+		var record middleware.RecordedRequest
+		err := decoder.Decode(&record)
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return nil, 0, fmt.Errorf("%s: %v", path, err)
+		}
+		if record.Body == nil {
+			skipped++
+			continue
+		}
+		requests = append(requests, record)
+	}
+
+	sort.SliceStable(requests, func(i, j int) bool {
+		return requests[i].Time.Before(requests[j].Time)
+	})
+	return requests, skipped, nil
+}
+
+/** Redirection of vds urls with a given prefix to another location */
+type redirect struct {
+	from string
+	to   string
+}
+
+func parseRedirects(values []string) ([]redirect, error) {
+	var out []redirect
+	for _, value := range values {
+		from, to, found := strings.Cut(value, "=")
+		if !found || from == "" {
+			return nil, fmt.Errorf("expected from=to, got '%s'", value)
+		}
+		out = append(out, redirect{from: from, to: to})
+	}
+	return out, nil
+}
+
+func applyRedirects(vds string, redirects []redirect) string {
+	for _, r := range redirects {
+		if strings.HasPrefix(vds, r.from) {
+			return r.to + strings.TrimPrefix(vds, r.from)
+		}
+	}
+	return vds
+}
+
+/** Prepare a recorded request for the target
+ *
+ * The vds urls are redirected and every vds is given the sas, as the log
+ * holds no credentials.
+ */
+func rewrite(body json.RawMessage, redirects []redirect, sas string) ([]byte, error) {
+	var fields map[string]json.RawMessage
+	if err := json.Unmarshal(body, &fields); err != nil {
+		return nil, err
+	}
+
+	var vds []string
+	var single string
+	if err := json.Unmarshal(fields["vds"], &single); err == nil {
+		vds = []string{single}
+	} else if err := json.Unmarshal(fields["vds"], &vds); err != nil {
+		return nil, fmt.Errorf("unexpected vds in request: %s", fields["vds"])
+	}
+
+	sasTokens := make([]string, len(vds))
+	for i := range vds {
+		vds[i] = applyRedirects(vds[i], redirects)
+		sasTokens[i] = sas
+	}
+	fields["vds"], _ = json.Marshal(vds)
+	fields["sas"], _ = json.Marshal(sasTokens)
+
+	return json.Marshal(fields)
+}
+
+/** Outcome of replaying one request, next to the recorded one */
+type result struct {
+	Time            time.Time `json:"time"`
+	Method          string    `json:"method"`
+	Path            string    `json:"path"`
+	Status          int       `json:"status"`
+	ReplayStatus    int       `json:"replayStatus"`
+	LatencyMs       float64   `json:"latencyMs"`
+	ReplayLatencyMs float64   `json:"replayLatencyMs"`
+	LatencyDeltaMs  float64   `json:"latencyDeltaMs"`
+	Error           string    `json:"error,omitempty"`
+}
+
+func send(
+	client *http.Client,
+	target string,
+	record middleware.RecordedRequest,
+	body []byte,
+) (int, error) {
+	var request *http.Request
+	var err error
+	if record.Method == http.MethodGet {
+		query := url.Values{"query": {string(body)}}
+		request, err = http.NewRequest(
+			http.MethodGet,
+			target+record.Path+"?"+query.Encode(),
+			nil,
+		)
+	} else {
+		request, err = http.NewRequest(
+			record.Method,
+			target+record.Path,
+			bytes.NewReader(body),
+		)
+	}
+	if err != nil {
+		return 0, err
+	}
+	if record.Method != http.MethodGet {
+		request.Header.Set("Content-Type", "application/json")
+	}
+
+	response, err := client.Do(request)
+	if err != nil {
+		return 0, err
+	}
+	defer response.Body.Close()
+	_, err = io.Copy(io.Discard, response.Body)
+	return response.StatusCode, err
+}
+
+/** Re-issue the requests at their recorded offsets, divided by speed
+ *
+ * Requests are sent on time regardless of how many are still in flight,
+ * such that the target sees the same arrival pattern as production.
+ */
+func replay(
+	client *http.Client,
+	target string,
+	requests []middleware.RecordedRequest,
+	redirects []redirect,
+	sas string,
+	speed float64,
+) []result {
+	results := make([]result, len(requests))
+	if len(requests) == 0 {
+		return results
+	}
+
+	origin := requests[0].Time
+	start := time.Now()
+
+	var wg sync.WaitGroup
+	for i, record := range requests {
+		offset := time.Duration(float64(record.Time.Sub(origin)) / speed)
+		time.Sleep(time.Until(start.Add(offset)))
+
+		wg.Add(1)
+		go func(i int, record middleware.RecordedRequest) {
+			defer wg.Done()
+			r := result{
+				Time:      record.Time,
+				Method:    record.Method,
+				Path:      record.Path,
+				Status:    record.Status,
+				LatencyMs: record.LatencyMs,
+			}
+
+			body, err := rewrite(record.Body, redirects, sas)
+			if err == nil {
+				sent := time.Now()
+				r.ReplayStatus, err = send(client, target, record, body)
+				r.ReplayLatencyMs = float64(time.Since(sent)) / float64(time.Millisecond)
+				r.LatencyDeltaMs = r.ReplayLatencyMs - r.LatencyMs
+			}
+			if err != nil {
+				r.Error = err.Error()
+			}
+			results[i] = r
+		}(i, record)
+	}
+	wg.Wait()
+	return results
+}
@@ -0,0 +1,86 @@
+package main
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/require"
+)
+
+func TestRewrite(t *testing.T) {
+	redirects, err := parseRedirects([]string{
+		"https://account.blob.core.windows.net/container=/data/copies",
+	})
+	require.NoError(t, err)
+
+	testcases := []struct {
+		name     string
+		body     string
+		expected string
+	}{
+		{
+			name: "Single vds",
+			body: `{"vds": "https://account.blob.core.windows.net/container/cube", "lineno": 1}`,
+			expected: `{
+				"vds": ["/data/copies/cube"],
+				"sas": ["token"],
+				"lineno": 1
+			}`,
+		},
+		{
+			name: "Two vds, one not redirected",
+			body: `{"vds": ["https://account.blob.core.windows.net/container/a", "https://other/b"]}`,
+			expected: `{
+				"vds": ["/data/copies/a", "https://other/b"],
+				"sas": ["token", "token"]
+			}`,
+		},
+	}
+	for _, testcase := range testcases {
+		rewritten, err := rewrite([]byte(testcase.body), redirects, "token")
+		require.NoError(t, err, testcase.name)
+		require.JSONEq(t, testcase.expected, string(rewritten), testcase.name)
+	}
+
+	_, err = rewrite([]byte(`{"vds": 1}`), redirects, "token")
+	require.Error(t, err)
+
+	_, err = parseRedirects([]string{"no-separator"})
+	require.Error(t, err)
+}
+
+func TestReadLogOrdersByArrival(t *testing.T) {
+	log := `{"time":"2024-01-01T00:00:02Z","method":"POST","path":"/slice","body":{"vds":"a"},"status":200,"responseSize":1,"latencyMs":1}
+{"time":"2024-01-01T00:00:03Z","method":"POST","path":"/slice","status":400,"responseSize":1,"latencyMs":1}
+{"time":"2024-01-01T00:00:01Z","method":"GET","path":"/fence","body":{"vds":"b"},"status":200,"responseSize":1,"latencyMs":5}
+`
+	path := filepath.Join(t.TempDir(), "requests.jsonl")
+	require.NoError(t, os.WriteFile(path, []byte(log), 0644))
+
+	requests, skipped, err := readLog(path)
+	require.NoError(t, err)
+	require.Equal(t, 1, skipped)
+	require.Len(t, requests, 2)
+	require.Equal(t, "/fence", requests[0].Path)
+	require.Equal(t, "/slice", requests[1].Path)
+}
+
+func TestSummarize(t *testing.T) {
+	results := []result{
+		{Path: "/slice", Status: 200, ReplayStatus: 200, LatencyMs: 10, ReplayLatencyMs: 6, LatencyDeltaMs: -4},
+		{Path: "/slice", Status: 200, ReplayStatus: 503, LatencyMs: 20, ReplayLatencyMs: 30, LatencyDeltaMs: 10},
+		{Path: "/fence", Error: "connection refused"},
+	}
+	summaries := summarize(results)
+	require.Len(t, summaries, 2)
+
+	require.Equal(t, "/fence", summaries[0].path)
+	require.Equal(t, 1, summaries[0].errors)
+
+	require.Equal(t, "/slice", summaries[1].path)
+	require.Equal(t, 2, summaries[1].requests)
+	require.Equal(t, 1, summaries[1].mismatches)
+	require.Equal(t, 10.0, percentile(summaries[1].recorded, 50))
+	require.Equal(t, -4.0, percentile(summaries[1].deltas, 50))
+}
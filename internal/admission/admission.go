@@ -0,0 +1,165 @@
+package admission
+
+import (
+	"container/list"
+	"context"
+	"fmt"
+	"sync"
+	"time"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+const mb = 1024 * 1024
+
+type waiter struct {
+	bytes uint64
+	ready chan struct{}
+}
+
+/** Global memory budget shared by all requests in flight
+ *
+ * Requests state how much memory they need before reading any data. Requests
+ * that fit in what is left of the budget are admitted right away, while
+ * others wait in line until enough memory is released. Waiting requests are
+ * admitted in the order they arrived, such that large requests are not
+ * starved by a stream of small ones.
+ *
+ * Requests that have waited longer than the timeout are rejected as the
+ * server is overloaded, and requests whose context is done while waiting
+ * leave the line right away. Requests larger than the whole budget are
+ * rejected immediately, as they can never be served.
+ */
+type Controller struct {
+	capacity uint64
+	timeout  time.Duration
+
+	lock    sync.Mutex
+	used    uint64
+	waiters *list.List
+}
+
+func NewController(capacity uint64, timeout time.Duration) *Controller {
+	return &Controller{
+		capacity: capacity,
+		timeout:  timeout,
+		waiters:  list.New(),
+	}
+}
+
+func (c *Controller) Acquire(ctx context.Context, bytes uint64) (func(), error) {
+	if bytes > c.capacity {
+		return nil, core.NewInvalidArgument(fmt.Sprintf(
+			"Request needs an estimated %d MB of memory, which is more than "+
+				"the server's limit of %d MB. Split the request into smaller parts",
+			(bytes+mb-1)/mb,
+			c.capacity/mb,
+		))
+	}
+
+	release := func() { c.release(bytes) }
+
+	c.lock.Lock()
+	if c.waiters.Len() == 0 && c.used+bytes <= c.capacity {
+		c.used += bytes
+		c.lock.Unlock()
+		return release, nil
+	}
+	w := &waiter{bytes: bytes, ready: make(chan struct{})}
+	element := c.waiters.PushBack(w)
+	c.lock.Unlock()
+
+	timer := time.NewTimer(c.timeout)
+	defer timer.Stop()
+
+	var err error
+	select {
+	case <-w.ready:
+		return release, nil
+	case <-timer.C:
+		err = core.NewResourceExhausted(fmt.Sprintf(
+			"Server is busy, timed out after %v waiting for %d MB of memory. "+
+				"Try again later",
+			c.timeout,
+			(bytes+mb-1)/mb,
+		))
+	case <-ctx.Done():
+		err = core.NewResourceExhausted(fmt.Sprintf(
+			"Request was cancelled while waiting for %d MB of memory: %v",
+			(bytes+mb-1)/mb,
+			ctx.Err(),
+		))
+	}
+
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	select {
+	case <-w.ready:
+		if ctx.Err() == nil {
+			// Admitted while timing out
+			return release, nil
+		}
+		// Admitted while cancelled, hand the memory on
+		c.used -= bytes
+	default:
+		c.waiters.Remove(element)
+	}
+	c.admit()
+	return nil, err
+}
+
+/** Budget that only hands out memory that is free right away
+ *
+ * For work that can be skipped, like reading ahead, which must never make
+ * requests wait. Acquiring fails instead of waiting when the memory is not
+ * free or other requests are already waiting for it.
+ */
+func (c *Controller) Spare() core.MemoryBudget {
+	return spare{controller: c}
+}
+
+type spare struct {
+	controller *Controller
+}
+
+func (s spare) Acquire(ctx context.Context, bytes uint64) (func(), error) {
+	c := s.controller
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	if c.waiters.Len() > 0 || c.used+bytes > c.capacity {
+		return nil, core.NewResourceExhausted(fmt.Sprintf(
+			"No spare memory for %d MB",
+			(bytes+mb-1)/mb,
+		))
+	}
+	c.used += bytes
+	return func() { c.release(bytes) }, nil
+}
+
+func (c *Controller) release(bytes uint64) {
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	c.used -= bytes
+	c.admit()
+}
+
+/** Admit waiting requests, in order, while they fit. Expects lock held */
+func (c *Controller) admit() {
+	for c.waiters.Len() > 0 {
+		element := c.waiters.Front()
+		w := element.Value.(*waiter)
+		if c.used+w.bytes > c.capacity {
+			return
+		}
+		c.used += w.bytes
+		c.waiters.Remove(element)
+		close(w.ready)
+	}
+}
+
+/** Memory currently admitted, and number of requests waiting */
+func (c *Controller) Usage() (used uint64, waiting int) {
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	return c.used, c.waiters.Len()
+}
@@ -0,0 +1,179 @@
+package admission
+
+import (
+	"context"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+func TestAdmitsRequestsThatFit(t *testing.T) {
+	controller := NewController(100, time.Second)
+
+	release1, err := controller.Acquire(context.Background(), 60)
+	require.NoError(t, err)
+	release2, err := controller.Acquire(context.Background(), 40)
+	require.NoError(t, err)
+
+	used, waiting := controller.Usage()
+	require.Equal(t, uint64(100), used)
+	require.Equal(t, 0, waiting)
+
+	release1()
+	release2()
+
+	used, _ = controller.Usage()
+	require.Equal(t, uint64(0), used)
+}
+
+func TestRejectsRequestsLargerThanBudget(t *testing.T) {
+	controller := NewController(100, time.Second)
+
+	_, err := controller.Acquire(context.Background(), 101)
+	require.IsType(t, &core.InvalidArgument{}, err)
+}
+
+func TestQueuedRequestIsAdmittedOnRelease(t *testing.T) {
+	controller := NewController(100, time.Second)
+
+	release, err := controller.Acquire(context.Background(), 80)
+	require.NoError(t, err)
+
+	admitted := make(chan error)
+	go func() {
+		release, err := controller.Acquire(context.Background(), 50)
+		if err == nil {
+			release()
+		}
+		admitted <- err
+	}()
+
+	require.Eventually(t, func() bool {
+		_, waiting := controller.Usage()
+		return waiting == 1
+	}, time.Second, time.Millisecond)
+
+	release()
+	require.NoError(t, <-admitted)
+}
+
+func TestQueuedRequestTimesOut(t *testing.T) {
+	controller := NewController(100, 10*time.Millisecond)
+
+	release, err := controller.Acquire(context.Background(), 80)
+	require.NoError(t, err)
+	defer release()
+
+	_, err = controller.Acquire(context.Background(), 50)
+	require.IsType(t, &core.ResourceExhausted{}, err)
+
+	used, waiting := controller.Usage()
+	require.Equal(t, uint64(80), used)
+	require.Equal(t, 0, waiting)
+}
+
+func TestCancelledRequestLeavesTheQueue(t *testing.T) {
+	controller := NewController(100, time.Minute)
+
+	release, err := controller.Acquire(context.Background(), 80)
+	require.NoError(t, err)
+	defer release()
+
+	ctx, cancel := context.WithCancel(context.Background())
+	cancelled := make(chan error)
+	go func() {
+		_, err := controller.Acquire(ctx, 50)
+		cancelled <- err
+	}()
+	require.Eventually(t, func() bool {
+		_, waiting := controller.Usage()
+		return waiting == 1
+	}, time.Second, time.Millisecond)
+
+	cancel()
+	require.IsType(t, &core.ResourceExhausted{}, <-cancelled)
+
+	used, waiting := controller.Usage()
+	require.Equal(t, uint64(80), used)
+	require.Equal(t, 0, waiting)
+
+	/* Requests behind the cancelled one are not held up by it */
+	small, err := controller.Acquire(context.Background(), 20)
+	require.NoError(t, err)
+	small()
+}
+
+func TestQueuedRequestsAreAdmittedInOrder(t *testing.T) {
+	controller := NewController(100, time.Second)
+
+	release, err := controller.Acquire(context.Background(), 100)
+	require.NoError(t, err)
+
+	order := make(chan int, 2)
+	large := make(chan func())
+	go func() {
+		release, _ := controller.Acquire(context.Background(), 90)
+		order <- 1
+		large <- release
+	}()
+	require.Eventually(t, func() bool {
+		_, waiting := controller.Usage()
+		return waiting == 1
+	}, time.Second, time.Millisecond)
+
+	/*
+	 * The small request would fit once the large one is admitted, but must
+	 * not overtake it
+	 */
+	go func() {
+		release, _ := controller.Acquire(context.Background(), 20)
+		order <- 2
+		release()
+	}()
+	require.Eventually(t, func() bool {
+		_, waiting := controller.Usage()
+		return waiting == 2
+	}, time.Second, time.Millisecond)
+
+	release()
+	require.Equal(t, 1, <-order)
+	(<-large)()
+	require.Equal(t, 2, <-order)
+}
+
+func TestSpareMemoryNeverWaits(t *testing.T) {
+	controller := NewController(100, time.Second)
+	spare := controller.Spare()
+
+	release, err := spare.Acquire(context.Background(), 60)
+	require.NoError(t, err)
+
+	_, err = spare.Acquire(context.Background(), 50)
+	require.IsType(t, &core.ResourceExhausted{}, err)
+
+	/* Spare memory is not handed out while requests are waiting */
+	waiting := make(chan error)
+	go func() {
+		release, err := controller.Acquire(context.Background(), 50)
+		if err == nil {
+			release()
+		}
+		waiting <- err
+	}()
+	require.Eventually(t, func() bool {
+		_, waiting := controller.Usage()
+		return waiting == 1
+	}, time.Second, time.Millisecond)
+
+	_, err = spare.Acquire(context.Background(), 10)
+	require.IsType(t, &core.ResourceExhausted{}, err)
+
+	release()
+	require.NoError(t, <-waiting)
+
+	used, _ := controller.Usage()
+	require.Equal(t, uint64(0), used)
+}
@@ -1,10 +1,8 @@
 package cache
 
 import (
-	"bytes"
-	"crypto/sha1"
-	"encoding/gob"
 	"fmt"
+	"sync/atomic"
 
 	"unsafe"
 	"github.com/dgraph-io/ristretto"
@@ -13,6 +11,7 @@ import (
 type CacheEntry struct {
 	data     [][]byte
 	metadata []byte
+	vds      []string
 }
 
 func (c *CacheEntry) Data() [][]byte {
@@ -23,16 +22,42 @@ func (c *CacheEntry) Metadata() []byte {
 	return c.metadata
 }
 
+/** The VDS the entry was read from */
+func (c *CacheEntry) Vds() []string {
+	return c.vds
+}
+
+/** Whether the entry was read from exactly the given VDS
+ *
+ * Keys are hashes of requests. Hits are checked against the VDS of the
+ * request before being served, such that no key, however it came to be,
+ * serves data from another VDS.
+ */
+func (c *CacheEntry) ReadFrom(vds []string) bool {
+	if len(c.vds) != len(vds) {
+		return false
+	}
+	for i := range vds {
+		if c.vds[i] != vds[i] {
+			return false
+		}
+	}
+	return true
+}
+
 func (c *CacheEntry) Size() int {
 	var dataLength int
 	for _, val := range c.data {
 		dataLength += len(val)
 	}
+	for _, vds := range c.vds {
+		dataLength += len(vds)
+	}
 	return dataLength + len(c.metadata) + int(unsafe.Sizeof(*c))
 }
 
-func NewCacheEntry(data [][]byte, metadata []byte) CacheEntry {
-	return CacheEntry{ data: data, metadata: metadata }
+func NewCacheEntry(data [][]byte, metadata []byte, vds []string) CacheEntry {
+	return CacheEntry{ data: data, metadata: metadata, vds: vds }
 }
 
 type Cache interface {
@@ -40,21 +65,116 @@ type Cache interface {
 	Set(string, CacheEntry)
 }
 
+/** Hit and miss counts of one cache tier */
+type TierStats struct {
+	Tier   string
+	Hits   uint64
+	Misses uint64
+}
+
+/** Caches that keep track of their hit rates, per tier */
+type StatsReporter interface {
+	Stats() []TierStats
+}
+
+/** Caches that can tell which tier an entry was found in
+ *
+ * Tiers are named as in StatsReporter.
+ */
+type TierLookup interface {
+	Lookup(string) (val CacheEntry, tier string, hit bool)
+}
+
+/** Caches that can tell whether they hold an entry without counting it as
+ *  a hit or a miss
+ */
+type Container interface {
+	Contains(string) bool
+}
+
+/** Whether c holds key. Counted as a lookup by caches that can not tell */
+func Contains(c Cache, key string) bool {
+	if container, ok := c.(Container); ok {
+		return container.Contains(key)
+	}
+	_, hit := c.Get(key)
+	return hit
+}
+
+/** Get key from c, along with the tier it was found in if c can tell */
+func Lookup(c Cache, key string) (CacheEntry, string, bool) {
+	if tiered, ok := c.(TierLookup); ok {
+		return tiered.Lookup(key)
+	}
+	val, hit := c.Get(key)
+	return val, "", hit
+}
+
+type tierCounters struct {
+	hits   atomic.Uint64
+	misses atomic.Uint64
+}
+
+func (c *tierCounters) record(hit bool) {
+	if hit {
+		c.hits.Add(1)
+	} else {
+		c.misses.Add(1)
+	}
+}
+
+func (c *tierCounters) stats(tier string) TierStats {
+	return TierStats{ Tier: tier, Hits: c.hits.Load(), Misses: c.misses.Load() }
+}
+
+/** The value stored in ristretto
+ *
+ * Ristretto only keeps a hash of the key, so the key is stored alongside the
+ * entry for eviction callbacks to know what was evicted.
+ */
+type ristrettoValue struct {
+	key   string
+	entry CacheEntry
+}
+
 type RistrettoCache struct {
 	ristretto.Cache
+	counters tierCounters
 }
 func (c *RistrettoCache) Set(key string, val CacheEntry) {
-	c.Cache.Set(key, val, int64(val.Size()))
+	c.Cache.Set(key, ristrettoValue{ key: key, entry: val }, int64(val.Size()))
 }
 func (c *RistrettoCache) Get(key string) (val CacheEntry, hit bool) {
 	v, hit := c.Cache.Get(key)
 	if hit {
-		val = v.(CacheEntry)
+		val = v.(ristrettoValue).entry
 	}
+	c.counters.record(hit)
 	return val, hit;
 }
+func (c *RistrettoCache) Lookup(key string) (val CacheEntry, tier string, hit bool) {
+	val, hit = c.Get(key)
+	return val, "memory", hit
+}
+func (c *RistrettoCache) Contains(key string) bool {
+	_, hit := c.Cache.Get(key)
+	return hit
+}
+func (c *RistrettoCache) Stats() []TierStats {
+	return []TierStats{ c.counters.stats("memory") }
+}
 
 func NewRistrettoCache(cacheSize uint64) *RistrettoCache {
+	return newRistrettoCache(cacheSize, nil)
+}
+
+/** Create a ristretto cache which calls onEvict for every entry that is
+ *  evicted from, or rejected by, the cache. onEvict may be nil.
+ */
+func newRistrettoCache(
+	cacheSize uint64,
+	onEvict func(key string, val CacheEntry),
+) *RistrettoCache {
 	/**  Maxcost and NumCounters
 	 *
 	 * This Ristretto cache is configured with a max size in bytes (the
@@ -71,7 +191,7 @@ func NewRistrettoCache(cacheSize uint64) *RistrettoCache {
 	 * [1] https://github.com/dgraph-io/ristretto#Config
 	 */
 	avgEntrySize := 1 * 1024 * 1024
-	cache, err := ristretto.NewCache(&ristretto.Config{
+	config := ristretto.Config{
 		NumCounters:        10 * int64(cacheSize) / int64(avgEntrySize),
 		MaxCost:            int64(cacheSize),
 		BufferItems:        64,
@@ -83,7 +203,18 @@ func NewRistrettoCache(cacheSize uint64) *RistrettoCache {
 		 * cost/size twice.
 		 */
 		IgnoreInternalCost: true,
-	})
+	}
+	if onEvict != nil {
+		callback := func(item *ristretto.Item) {
+			if value, ok := item.Value.(ristrettoValue); ok {
+				onEvict(value.key, value.entry)
+			}
+		}
+		config.OnEvict = callback
+		config.OnReject = callback
+	}
+
+	cache, err := ristretto.NewCache(&config)
 	if err != nil {
 		panic(fmt.Errorf("failed to create cache, err: %v", err))
 	}
@@ -99,6 +230,10 @@ func (c *NoCache) Get(key string) (CacheEntry, bool) {
 
 func (c *NoCache) Set(key string, val CacheEntry) {}
 
+func (c *NoCache) Contains(key string) bool {
+	return false
+}
+
 func NewNoCache() *NoCache {
 	return &NoCache{}
 }
@@ -115,25 +250,3 @@ func NewCache(cachesize uint64) Cache {
 	}
 	return NewRistrettoCache(cachesize * 1024 * 1024)
 }
-
-/** Compute a sha1 hash of any object
- *
- * The sha1 is cryptographically broken and hence this hasher should not be
- * used for security. Rather it's intended to compute hashes that can be used
- * as keys in a cache.
- */
-func Hash(val interface{}) (string, error) {
-	/*
-	 * Ideally the buffer and the encoder should be reused for more efficient
-	 * memory-allocation, but that would not be thread-safe and the effort to
-	 * make it so out weighs the benefit.
-	 */
-	var buffer bytes.Buffer
-
-	encoder := gob.NewEncoder(&buffer)
-	err := encoder.Encode(val)
-	if (err != nil) {
-		return "", err
-	}
-	return fmt.Sprintf("%x", sha1.Sum(buffer.Bytes())), nil
-}
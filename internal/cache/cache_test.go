@@ -18,17 +18,17 @@ func TestRistrettoCacheMaxSize(t *testing.T) {
 	/** CacheEntry with a memory footprint of exactly 1 KB
 	 *
 	 * The true size (in memory) is given by the size of the struct itself,
-	 * which for cacheEntry is 48 bytes plus the size of the two buffers. I.e:
+	 * which for cacheEntry is 72 bytes plus the size of the buffers. I.e:
 	 *
-	 * unsafe.Sizeof(entry) + len(entry.Data) + len(entry.Metadata) =
-	 * 48                   + 512             + 464                 = 1024
+	 * unsafe.Sizeof(entry) + len(entry.Data) + len(entry.Metadata) + len(vds) =
+	 * 72                   + 512             + 432                 + 8        = 1024
 	 */
 	data := make([][]byte, 4)
 	for i := range data {
 		data[i] = make([]byte, 128)
 	}
-	metadata := make([]byte, 464)
-	entry := NewCacheEntry(data, metadata)
+	metadata := make([]byte, 432)
+	entry := NewCacheEntry(data, metadata, []string{"some.vds"})
 
 	cacheSize := 1 * 1024 * 1024 // 1 MB
 	maxEntries := cacheSize / 1024
@@ -70,3 +70,11 @@ func TestRistrettoCacheMaxSize(t *testing.T) {
 		hits,
 	)
 }
+
+func TestCacheEntryIsReadFromItsVds(t *testing.T) {
+	entry := NewCacheEntry(nil, nil, []string{"a.vds", "b.vds"})
+	require.True(t, entry.ReadFrom([]string{"a.vds", "b.vds"}))
+	require.False(t, entry.ReadFrom([]string{"b.vds", "a.vds"}))
+	require.False(t, entry.ReadFrom([]string{"a.vds"}))
+	require.False(t, entry.ReadFrom(nil))
+}
@@ -0,0 +1,475 @@
+package cache
+
+import (
+	"bytes"
+	"container/list"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+
+	"github.com/cespare/xxhash/v2"
+)
+
+/** On-disk layout of a cache entry
+ *
+ * Every entry is stored in its own file, named by a hash of the key and the
+ * generation of the entry:
+ *
+ *     magic     [4]byte  "OSC2"
+ *     checksum  uint64   xxhash of the payload
+ *     length    uint64   size of the payload in bytes
+ *     payload:
+ *         key       uint32 length + bytes
+ *         vds       uint32 count, then uint32 length + bytes per url
+ *         metadata  uint64 length + bytes
+ *         data      uint32 count, then uint64 length + bytes per buffer
+ *
+ * All integers are little endian. The key is stored in the payload so that
+ * the index can be rebuilt from the files on startup.
+ */
+var diskEntryMagic = [4]byte{'O', 'S', 'C', '2'}
+
+const (
+	diskEntryHeaderSize = 4 + 8 + 8
+	diskEntrySuffix     = ".entry"
+)
+
+/** An entry in the index
+ *
+ * Every write of a key gets a new generation, and so a file of its own.
+ * Files are never overwritten, and a file is only removed once its entry is
+ * gone from the index.
+ */
+type diskEntry struct {
+	key        string
+	generation uint64
+	size       uint64
+}
+
+/** Response cache backed by files in a local directory
+ *
+ * The cache is bounded by the total size of its files and evicts the least
+ * recently used entries when full. The index of entries is held in memory and
+ * rebuilt from the directory when the cache is created, so that entries
+ * survive restarts. Entries are checksummed and any entry that fails
+ * verification is dropped and reported as a miss.
+ *
+ * Entries are read with plain file reads. Every hit has to be copied into
+ * memory that outlives the request anyway, and reads of recently used files
+ * are served from the page cache.
+ *
+ * The lock only guards the index. Files are written to a temporary file and
+ * renamed into place, and read and removed, without holding it. Concurrent
+ * operations on the same key work on different generations, so a read
+ * either finds a whole file or none, and no operation removes a newer entry
+ * than the one it looked up.
+ */
+type DiskCache struct {
+	dir      string
+	maxSize  uint64
+	counters tierCounters
+
+	lock       sync.Mutex
+	size       uint64
+	generation uint64
+	lru        *list.List
+	entries    map[string]*list.Element
+}
+
+/** Create a disk cache in dir, limited to maxSize bytes
+ *
+ * The directory is created if it does not exist. Entries already in the
+ * directory are loaded into the index, ordered by modification time.
+ */
+func NewDiskCache(dir string, maxSize uint64) (*DiskCache, error) {
+	if err := os.MkdirAll(dir, 0o700); err != nil {
+		return nil, err
+	}
+
+	c := &DiskCache{
+		dir:     dir,
+		maxSize: maxSize,
+		lru:     list.New(),
+		entries: make(map[string]*list.Element),
+	}
+	if err := c.load(); err != nil {
+		return nil, err
+	}
+	return c, nil
+}
+
+func (c *DiskCache) path(key string, generation uint64) string {
+	return filepath.Join(c.dir, fmt.Sprintf(
+		"%016x.%016x%s",
+		xxhash.Sum64String(key),
+		generation,
+		diskEntrySuffix,
+	))
+}
+
+/** Generation of an entry, as found in its file name */
+func parseGeneration(name string) (uint64, bool) {
+	name = strings.TrimSuffix(name, diskEntrySuffix)
+	dot := strings.LastIndexByte(name, '.')
+	if dot < 0 {
+		return 0, false
+	}
+	generation, err := strconv.ParseUint(name[dot+1:], 16, 64)
+	return generation, err == nil
+}
+
+func removeFiles(paths []string) {
+	for _, path := range paths {
+		os.Remove(path)
+	}
+}
+
+func (c *DiskCache) load() error {
+	files, err := os.ReadDir(c.dir)
+	if err != nil {
+		return err
+	}
+
+	type loaded struct {
+		entry   diskEntry
+		modtime int64
+	}
+	var found []loaded
+	for _, file := range files {
+		name := file.Name()
+		path := filepath.Join(c.dir, name)
+		if strings.HasSuffix(name, diskEntrySuffix+".tmp") {
+			os.Remove(path)
+			continue
+		}
+		if file.IsDir() || !strings.HasSuffix(name, diskEntrySuffix) {
+			continue
+		}
+		info, err := file.Info()
+		if err != nil {
+			continue
+		}
+		generation, ok := parseGeneration(name)
+		if !ok {
+			os.Remove(path)
+			continue
+		}
+		key, err := readDiskEntryKey(path)
+		if err != nil || c.path(key, generation) != path {
+			os.Remove(path)
+			continue
+		}
+		found = append(found, loaded{
+			entry: diskEntry{
+				key:        key,
+				generation: generation,
+				size:       uint64(info.Size()),
+			},
+			modtime: info.ModTime().UnixNano(),
+		})
+	}
+
+	// Most recently written entries end up at the front of the lru list
+	sort.Slice(found, func(i, j int) bool {
+		if found[i].entry.generation != found[j].entry.generation {
+			return found[i].entry.generation > found[j].entry.generation
+		}
+		return found[i].modtime > found[j].modtime
+	})
+
+	var stale []string
+	c.lock.Lock()
+	for _, f := range found {
+		c.generation = max(c.generation, f.entry.generation)
+		// Only the newest generation of a key is kept
+		if _, exists := c.entries[f.entry.key]; exists {
+			stale = append(stale, c.path(f.entry.key, f.entry.generation))
+			continue
+		}
+		c.entries[f.entry.key] = c.lru.PushBack(f.entry)
+		c.size += f.entry.size
+	}
+	stale = append(stale, c.evict()...)
+	c.lock.Unlock()
+
+	removeFiles(stale)
+	return nil
+}
+
+func (c *DiskCache) Get(key string) (CacheEntry, bool) {
+	c.lock.Lock()
+	element, exists := c.entries[key]
+	var entry diskEntry
+	if exists {
+		c.lru.MoveToFront(element)
+		entry = element.Value.(diskEntry)
+	}
+	c.lock.Unlock()
+
+	if !exists {
+		c.counters.record(false)
+		return CacheEntry{}, false
+	}
+
+	buffer, err := os.ReadFile(c.path(key, entry.generation))
+	if err != nil {
+		// Replaced or evicted since it was looked up
+		c.counters.record(false)
+		return CacheEntry{}, false
+	}
+
+	storedKey, val, err := decodeDiskEntry(buffer)
+	if err == nil && storedKey != key {
+		err = errors.New("key mismatch")
+	}
+	if err != nil {
+		c.remove(entry)
+		c.counters.record(false)
+		return CacheEntry{}, false
+	}
+
+	c.counters.record(true)
+	return val, true
+}
+
+/** Write the entry to disk
+ *
+ * Entries larger than the cache itself are not stored. Failing to write an
+ * entry is not an error for the caller, the cache simply does not hold it.
+ */
+func (c *DiskCache) Set(key string, val CacheEntry) {
+	buffer := encodeDiskEntry(key, val)
+	size := uint64(len(buffer))
+	if size > c.maxSize {
+		return
+	}
+
+	c.lock.Lock()
+	c.generation++
+	entry := diskEntry{key: key, generation: c.generation, size: size}
+	c.lock.Unlock()
+
+	path := c.path(key, entry.generation)
+	temporary, err := os.CreateTemp(c.dir, filepath.Base(path)+".*.tmp")
+	if err != nil {
+		return
+	}
+	_, err = temporary.Write(buffer)
+	if closeErr := temporary.Close(); err == nil {
+		err = closeErr
+	}
+	if err == nil {
+		err = os.Rename(temporary.Name(), path)
+	}
+	if err != nil {
+		os.Remove(temporary.Name())
+		return
+	}
+
+	var stale []string
+	c.lock.Lock()
+	if element, exists := c.entries[key]; exists {
+		current := element.Value.(diskEntry)
+		if current.generation > entry.generation {
+			// A later write of the same key won the race
+			c.lock.Unlock()
+			os.Remove(path)
+			return
+		}
+		c.size -= current.size
+		c.lru.Remove(element)
+		stale = append(stale, c.path(key, current.generation))
+	}
+	c.entries[key] = c.lru.PushFront(entry)
+	c.size += size
+	stale = append(stale, c.evict()...)
+	c.lock.Unlock()
+
+	removeFiles(stale)
+}
+
+func (c *DiskCache) Contains(key string) bool {
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	_, exists := c.entries[key]
+	return exists
+}
+
+func (c *DiskCache) Lookup(key string) (CacheEntry, string, bool) {
+	entry, hit := c.Get(key)
+	return entry, "disk", hit
+}
+
+func (c *DiskCache) Stats() []TierStats {
+	return []TierStats{c.counters.stats("disk")}
+}
+
+/** Drop least recently used entries until the cache fits, and return the
+ *  files to remove once the lock is released. Expects lock held
+ */
+func (c *DiskCache) evict() []string {
+	var evicted []string
+	for c.size > c.maxSize {
+		element := c.lru.Back()
+		entry := element.Value.(diskEntry)
+		c.lru.Remove(element)
+		delete(c.entries, entry.key)
+		c.size -= entry.size
+		evicted = append(evicted, c.path(entry.key, entry.generation))
+	}
+	return evicted
+}
+
+/** Drop the entry, unless its key has been written again since */
+func (c *DiskCache) remove(entry diskEntry) {
+	c.lock.Lock()
+	element, exists := c.entries[entry.key]
+	if !exists || element.Value.(diskEntry).generation != entry.generation {
+		c.lock.Unlock()
+		return
+	}
+	c.lru.Remove(element)
+	delete(c.entries, entry.key)
+	c.size -= entry.size
+	c.lock.Unlock()
+
+	os.Remove(c.path(entry.key, entry.generation))
+}
+
+func encodeDiskEntry(key string, val CacheEntry) []byte {
+	payloadSize := 4 + len(key) + 4 + 8 + len(val.metadata) + 4
+	for _, vds := range val.vds {
+		payloadSize += 4 + len(vds)
+	}
+	for _, data := range val.data {
+		payloadSize += 8 + len(data)
+	}
+
+	buffer := make([]byte, diskEntryHeaderSize, diskEntryHeaderSize+payloadSize)
+	buffer = binary.LittleEndian.AppendUint32(buffer, uint32(len(key)))
+	buffer = append(buffer, key...)
+	buffer = binary.LittleEndian.AppendUint32(buffer, uint32(len(val.vds)))
+	for _, vds := range val.vds {
+		buffer = binary.LittleEndian.AppendUint32(buffer, uint32(len(vds)))
+		buffer = append(buffer, vds...)
+	}
+	buffer = binary.LittleEndian.AppendUint64(buffer, uint64(len(val.metadata)))
+	buffer = append(buffer, val.metadata...)
+	buffer = binary.LittleEndian.AppendUint32(buffer, uint32(len(val.data)))
+	for _, data := range val.data {
+		buffer = binary.LittleEndian.AppendUint64(buffer, uint64(len(data)))
+		buffer = append(buffer, data...)
+	}
+
+	payload := buffer[diskEntryHeaderSize:]
+	copy(buffer[0:4], diskEntryMagic[:])
+	binary.LittleEndian.PutUint64(buffer[4:12], xxhash.Sum64(payload))
+	binary.LittleEndian.PutUint64(buffer[12:20], uint64(len(payload)))
+	return buffer
+}
+
+var errCorruptDiskEntry = errors.New("corrupt disk cache entry")
+
+/** Consumes length-prefixed fields from a payload */
+type payloadReader struct {
+	buffer []byte
+	err    error
+}
+
+func (r *payloadReader) next(n uint64) []byte {
+	if r.err != nil || n > uint64(len(r.buffer)) {
+		r.err = errCorruptDiskEntry
+		return nil
+	}
+	out := r.buffer[:n:n]
+	r.buffer = r.buffer[n:]
+	return out
+}
+
+func (r *payloadReader) uint32() uint32 {
+	field := r.next(4)
+	if field == nil {
+		return 0
+	}
+	return binary.LittleEndian.Uint32(field)
+}
+
+func (r *payloadReader) uint64() uint64 {
+	field := r.next(8)
+	if field == nil {
+		return 0
+	}
+	return binary.LittleEndian.Uint64(field)
+}
+
+func decodeDiskEntry(buffer []byte) (string, CacheEntry, error) {
+	if len(buffer) < diskEntryHeaderSize ||
+		!bytes.Equal(buffer[0:4], diskEntryMagic[:]) {
+		return "", CacheEntry{}, errCorruptDiskEntry
+	}
+	checksum := binary.LittleEndian.Uint64(buffer[4:12])
+	length := binary.LittleEndian.Uint64(buffer[12:20])
+	payload := buffer[diskEntryHeaderSize:]
+	if uint64(len(payload)) != length || xxhash.Sum64(payload) != checksum {
+		return "", CacheEntry{}, errCorruptDiskEntry
+	}
+
+	reader := payloadReader{buffer: payload}
+	key := string(reader.next(uint64(reader.uint32())))
+	nvds := reader.uint32()
+	if uint64(nvds) > uint64(len(reader.buffer))/4 {
+		return "", CacheEntry{}, errCorruptDiskEntry
+	}
+	vds := make([]string, nvds)
+	for i := range vds {
+		vds[i] = string(reader.next(uint64(reader.uint32())))
+	}
+	metadata := reader.next(reader.uint64())
+	count := reader.uint32()
+	if uint64(count) > uint64(len(reader.buffer))/8 {
+		return "", CacheEntry{}, errCorruptDiskEntry
+	}
+	data := make([][]byte, count)
+	for i := range data {
+		data[i] = reader.next(reader.uint64())
+	}
+	if reader.err != nil || len(reader.buffer) != 0 {
+		return "", CacheEntry{}, errCorruptDiskEntry
+	}
+	return key, NewCacheEntry(data, metadata, vds), nil
+}
+
+/** Read only the key of an entry, without verifying the checksum */
+func readDiskEntryKey(path string) (string, error) {
+	file, err := os.Open(path)
+	if err != nil {
+		return "", err
+	}
+	defer file.Close()
+
+	header := make([]byte, diskEntryHeaderSize+4)
+	if _, err := io.ReadFull(file, header); err != nil {
+		return "", err
+	}
+	if !bytes.Equal(header[0:4], diskEntryMagic[:]) {
+		return "", errCorruptDiskEntry
+	}
+	length := binary.LittleEndian.Uint64(header[12:20])
+	keyLength := uint64(binary.LittleEndian.Uint32(header[diskEntryHeaderSize:]))
+	if keyLength+4 > length {
+		return "", errCorruptDiskEntry
+	}
+
+	key := make([]byte, keyLength)
+	if _, err := io.ReadFull(file, key); err != nil {
+		return "", err
+	}
+	return string(key), nil
+}
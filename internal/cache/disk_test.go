@@ -0,0 +1,213 @@
+package cache
+
+import (
+	"os"
+	"path/filepath"
+	"sync"
+	"sync/atomic"
+	"testing"
+
+	"github.com/stretchr/testify/require"
+)
+
+func newTestEntry(fill byte) CacheEntry {
+	data := [][]byte{make([]byte, 100), make([]byte, 50)}
+	for _, buffer := range data {
+		for i := range buffer {
+			buffer[i] = fill
+		}
+	}
+	return NewCacheEntry(data, []byte(`{"metadata": true}`), []string{"a.vds", "b.vds"})
+}
+
+func TestDiskCacheRoundtrip(t *testing.T) {
+	cache, err := NewDiskCache(t.TempDir(), 1024*1024)
+	require.NoError(t, err)
+
+	entry := newTestEntry(1)
+	cache.Set("key", entry)
+
+	out, hit := cache.Get("key")
+	require.True(t, hit)
+	require.Equal(t, entry.Data(), out.Data())
+	require.Equal(t, entry.Metadata(), out.Metadata())
+	require.Equal(t, entry.Vds(), out.Vds())
+
+	_, hit = cache.Get("other key")
+	require.False(t, hit)
+
+	stats := cache.Stats()
+	require.Equal(t, []TierStats{{Tier: "disk", Hits: 1, Misses: 1}}, stats)
+}
+
+func TestDiskCacheIsReloaded(t *testing.T) {
+	dir := t.TempDir()
+	cache, err := NewDiskCache(dir, 1024*1024)
+	require.NoError(t, err)
+
+	entry := newTestEntry(2)
+	cache.Set("key", entry)
+
+	reloaded, err := NewDiskCache(dir, 1024*1024)
+	require.NoError(t, err)
+
+	out, hit := reloaded.Get("key")
+	require.True(t, hit)
+	require.Equal(t, entry.Data(), out.Data())
+}
+
+func TestDiskCacheDetectsCorruption(t *testing.T) {
+	dir := t.TempDir()
+	cache, err := NewDiskCache(dir, 1024*1024)
+	require.NoError(t, err)
+
+	cache.Set("key", newTestEntry(3))
+
+	files, err := filepath.Glob(filepath.Join(dir, "*"+diskEntrySuffix))
+	require.NoError(t, err)
+	require.Len(t, files, 1)
+	path := files[0]
+	buffer, err := os.ReadFile(path)
+	require.NoError(t, err)
+	buffer[len(buffer)-1] ^= 0xff
+	require.NoError(t, os.WriteFile(path, buffer, 0o600))
+
+	_, hit := cache.Get("key")
+	require.False(t, hit, "Expected corrupt entry to be a miss")
+
+	_, err = os.Stat(path)
+	require.True(t, os.IsNotExist(err), "Expected corrupt entry to be removed")
+}
+
+func TestDiskCacheKeepsOneFilePerKey(t *testing.T) {
+	dir := t.TempDir()
+	cache, err := NewDiskCache(dir, 1024*1024)
+	require.NoError(t, err)
+
+	latest := newTestEntry(2)
+	cache.Set("key", newTestEntry(1))
+	cache.Set("key", latest)
+
+	files, err := filepath.Glob(filepath.Join(dir, "*"+diskEntrySuffix))
+	require.NoError(t, err)
+	require.Len(t, files, 1)
+
+	out, hit := cache.Get("key")
+	require.True(t, hit)
+	require.Equal(t, latest.Data(), out.Data())
+
+	reloaded, err := NewDiskCache(dir, 1024*1024)
+	require.NoError(t, err)
+	out, hit = reloaded.Get("key")
+	require.True(t, hit)
+	require.Equal(t, latest.Data(), out.Data())
+}
+
+func TestDiskCacheConcurrentWritesOfSameKey(t *testing.T) {
+	dir := t.TempDir()
+	entrySize := uint64(len(encodeDiskEntry("key0", newTestEntry(0))))
+	cache, err := NewDiskCache(dir, 4*entrySize)
+	require.NoError(t, err)
+
+	keys := []string{"key0", "key1", "key2", "key3", "key4", "key5"}
+	var torn atomic.Bool
+	var wg sync.WaitGroup
+	for worker := 0; worker < 8; worker++ {
+		wg.Add(1)
+		go func(worker int) {
+			defer wg.Done()
+			for i := 0; i < 50; i++ {
+				key := keys[(worker+i)%len(keys)]
+				fill := byte(worker)
+				cache.Set(key, newTestEntry(fill))
+				out, hit := cache.Get(key)
+				if !hit {
+					continue
+				}
+				// Any whole entry will do, as long as it is not torn
+				data := out.Data()
+				for _, buffer := range data {
+					for _, b := range buffer {
+						if len(data) != 2 || b != data[0][0] {
+							torn.Store(true)
+						}
+					}
+				}
+			}
+		}(worker)
+	}
+	wg.Wait()
+	require.False(t, torn.Load(), "Expected only whole entries to be read")
+
+	files, err := filepath.Glob(filepath.Join(dir, "*"+diskEntrySuffix))
+	require.NoError(t, err)
+	require.Len(t, files, len(cache.entries))
+	require.Equal(t, uint64(len(files))*entrySize, cache.size)
+	for key := range cache.entries {
+		_, hit := cache.Get(key)
+		require.Truef(t, hit, "Expected indexed %s to be readable", key)
+	}
+}
+
+func TestDiskCacheMaxSize(t *testing.T) {
+	dir := t.TempDir()
+	entrySize := uint64(len(encodeDiskEntry("key0", newTestEntry(0))))
+	maxEntries := 3
+
+	cache, err := NewDiskCache(dir, uint64(maxEntries)*entrySize)
+	require.NoError(t, err)
+
+	keys := []string{"key0", "key1", "key2", "key3", "key4"}
+	for i, key := range keys {
+		cache.Set(key, newTestEntry(byte(i)))
+	}
+
+	for i, key := range keys {
+		_, hit := cache.Get(key)
+		expected := i >= len(keys)-maxEntries
+		require.Equalf(t, expected, hit, "Unexpected hit for %s", key)
+	}
+
+	files, err := filepath.Glob(filepath.Join(dir, "*"+diskEntrySuffix))
+	require.NoError(t, err)
+	require.Len(t, files, maxEntries)
+}
+
+func TestTieredCacheLookupReportsTier(t *testing.T) {
+	cache, err := NewTieredCache(1, t.TempDir(), 1)
+	require.NoError(t, err)
+	tiered := cache.(*TieredCache)
+
+	entry := newTestEntry(1)
+	tiered.disk.Set("key", entry)
+
+	_, tier, hit := Lookup(cache, "key")
+	require.True(t, hit)
+	require.Equal(t, "disk", tier)
+
+	// Entries found on disk are promoted to memory
+	tiered.memory.Wait()
+	out, tier, hit := Lookup(cache, "key")
+	require.True(t, hit)
+	require.Equal(t, "memory", tier)
+	require.Equal(t, entry.Data(), out.Data())
+
+	_, _, hit = Lookup(cache, "other key")
+	require.False(t, hit)
+
+	_, tier, hit = Lookup(NewNoCache(), "key")
+	require.False(t, hit)
+	require.Equal(t, "", tier)
+}
+
+func TestContainsIsNotCountedAsLookup(t *testing.T) {
+	cache, err := NewDiskCache(t.TempDir(), 1024*1024)
+	require.NoError(t, err)
+
+	cache.Set("key", newTestEntry(1))
+	require.True(t, Contains(cache, "key"))
+	require.False(t, Contains(cache, "other key"))
+	require.Equal(t, []TierStats{{Tier: "disk"}}, cache.Stats())
+
+	require.False(t, Contains(NewNoCache(), "key"))
+}
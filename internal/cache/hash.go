@@ -0,0 +1,104 @@
+package cache
+
+import (
+	"crypto/sha256"
+	"encoding/binary"
+	"encoding/hex"
+	"hash"
+	"math"
+	"unsafe"
+)
+
+/** Streaming hasher for computing cache keys
+ *
+ * Fields are fed to the hasher one by one and are never serialized into an
+ * intermediate buffer. Variable-length fields are prefixed with their length
+ * and optional fields with a presence flag, so that different sequences of
+ * fields can not produce the same stream of bytes.
+ *
+ * Float buffers, such as surfaces and coordinates, are hashed from their raw
+ * in-memory representation. Hashing a large surface therefore costs one pass
+ * over memory and no allocations.
+ *
+ * Requests are chosen by clients, so keys are SHA-256 sums. A client that
+ * could craft two requests with the same key would otherwise be served the
+ * cached response of the other, possibly from a VDS it has no access to.
+ */
+type Hasher struct {
+	digest  hash.Hash
+	scratch [8]byte
+}
+
+func NewHasher() *Hasher {
+	return &Hasher{digest: sha256.New()}
+}
+
+func (h *Hasher) writeUint64(value uint64) {
+	binary.LittleEndian.PutUint64(h.scratch[:], value)
+	h.digest.Write(h.scratch[:])
+}
+
+func (h *Hasher) WriteInt(value int) {
+	h.writeUint64(uint64(value))
+}
+
+func (h *Hasher) WriteBool(value bool) {
+	if value {
+		h.writeUint64(1)
+	} else {
+		h.writeUint64(0)
+	}
+}
+
+func (h *Hasher) WriteFloat32(value float32) {
+	h.writeUint64(uint64(math.Float32bits(value)))
+}
+
+func (h *Hasher) WriteString(value string) {
+	h.WriteInt(len(value))
+	h.digest.Write(unsafe.Slice(unsafe.StringData(value), len(value)))
+}
+
+func (h *Hasher) WriteStrings(values []string) {
+	h.WriteInt(len(values))
+	for _, value := range values {
+		h.WriteString(value)
+	}
+}
+
+/** Write an optional int. A nil pointer hashes differently from any value */
+func (h *Hasher) WriteOptionalInt(value *int) {
+	h.WriteBool(value != nil)
+	if value != nil {
+		h.WriteInt(*value)
+	}
+}
+
+/** Write an optional float. A nil pointer hashes differently from any value */
+func (h *Hasher) WriteOptionalFloat32(value *float32) {
+	h.WriteBool(value != nil)
+	if value != nil {
+		h.WriteFloat32(*value)
+	}
+}
+
+func (h *Hasher) WriteFloat32s(values []float32) {
+	h.WriteInt(len(values))
+	if len(values) == 0 {
+		return
+	}
+	raw := unsafe.Slice((*byte)(unsafe.Pointer(&values[0])), len(values)*4)
+	h.digest.Write(raw)
+}
+
+func (h *Hasher) WriteFloat32Matrix(values [][]float32) {
+	h.WriteInt(len(values))
+	for _, row := range values {
+		h.WriteFloat32s(row)
+	}
+}
+
+/** Hex-encoded hash of everything written so far */
+func (h *Hasher) Sum() string {
+	return hex.EncodeToString(h.digest.Sum(nil))
+}
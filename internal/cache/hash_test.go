@@ -0,0 +1,101 @@
+package cache
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/require"
+)
+
+func TestHasherIsDeterministic(t *testing.T) {
+	hash := func() string {
+		hasher := NewHasher()
+		hasher.WriteString("vds")
+		hasher.WriteFloat32Matrix([][]float32{{1, 2}, {3, 4}})
+		return hasher.Sum()
+	}
+	require.Equal(t, hash(), hash())
+}
+
+func TestHasherGivesUniqueHash(t *testing.T) {
+	zero := 0
+
+	testCases := []struct {
+		name  string
+		write func(*Hasher)
+	}{
+		{
+			name: "Strings split differently",
+			write: func(h *Hasher) {
+				h.WriteString("ab")
+				h.WriteString("c")
+			},
+		},
+		{
+			name: "Strings split differently 2",
+			write: func(h *Hasher) {
+				h.WriteString("a")
+				h.WriteString("bc")
+			},
+		},
+		{
+			name: "Matrix rows split differently",
+			write: func(h *Hasher) {
+				h.WriteFloat32Matrix([][]float32{{1, 2, 3}, {4}})
+			},
+		},
+		{
+			name: "Matrix rows split differently 2",
+			write: func(h *Hasher) {
+				h.WriteFloat32Matrix([][]float32{{1, 2}, {3, 4}})
+			},
+		},
+		{
+			name: "Missing optional int",
+			write: func(h *Hasher) {
+				h.WriteOptionalInt(nil)
+			},
+		},
+		{
+			name: "Zero optional int",
+			write: func(h *Hasher) {
+				h.WriteOptionalInt(&zero)
+			},
+		},
+		{
+			name:  "Nothing written",
+			write: func(h *Hasher) {},
+		},
+	}
+
+	hashes := make(map[string]string)
+	for _, testCase := range testCases {
+		hasher := NewHasher()
+		testCase.write(hasher)
+		hash := hasher.Sum()
+
+		other, exists := hashes[hash]
+		require.Falsef(t, exists,
+			"Expected unique hashes but [%s] collides with [%s]",
+			testCase.name, other,
+		)
+		hashes[hash] = testCase.name
+	}
+}
+
+func TestHasherDistinguishesMissingFloat(t *testing.T) {
+	zero := float32(0)
+
+	missing := NewHasher()
+	missing.WriteOptionalFloat32(nil)
+
+	supplied := NewHasher()
+	supplied.WriteOptionalFloat32(&zero)
+
+	require.NotEqual(t, missing.Sum(), supplied.Sum())
+}
+
+func TestHasherGivesFullSha256(t *testing.T) {
+	hasher := NewHasher()
+	hasher.WriteString("vds")
+	require.Len(t, hasher.Sum(), 64)
+}
@@ -0,0 +1,90 @@
+package cache
+
+/** Number of evicted entries that can be waiting to be written to disk */
+const demotionQueueSize = 64
+
+type demotion struct {
+	key   string
+	entry CacheEntry
+}
+
+/** Memory cache with a disk cache as second tier
+ *
+ * New entries go to memory. Entries evicted from memory are demoted to disk
+ * and entries found on disk are promoted back into memory. Demotion happens
+ * in the background, so eviction never waits for the disk. If the disk falls
+ * behind, evicted entries are dropped rather than queued indefinitely.
+ */
+type TieredCache struct {
+	memory    *RistrettoCache
+	disk      *DiskCache
+	demotions chan demotion
+}
+
+func (c *TieredCache) Get(key string) (CacheEntry, bool) {
+	entry, _, hit := c.Lookup(key)
+	return entry, hit
+}
+
+func (c *TieredCache) Lookup(key string) (CacheEntry, string, bool) {
+	if entry, hit := c.memory.Get(key); hit {
+		return entry, "memory", true
+	}
+
+	entry, hit := c.disk.Get(key)
+	if hit {
+		c.memory.Set(key, entry)
+	}
+	return entry, "disk", hit
+}
+
+func (c *TieredCache) Contains(key string) bool {
+	return c.memory.Contains(key) || c.disk.Contains(key)
+}
+
+func (c *TieredCache) Set(key string, val CacheEntry) {
+	c.memory.Set(key, val)
+}
+
+func (c *TieredCache) Stats() []TierStats {
+	return append(c.memory.Stats(), c.disk.Stats()...)
+}
+
+func (c *TieredCache) demote(key string, val CacheEntry) {
+	select {
+	case c.demotions <- demotion{key: key, entry: val}:
+	default:
+	}
+}
+
+func (c *TieredCache) writeDemotions() {
+	for d := range c.demotions {
+		// Entries promoted from disk are still there, no need to rewrite them
+		if !c.disk.Contains(d.key) {
+			c.disk.Set(d.key, d.entry)
+		}
+	}
+}
+
+/** Return a new cache with a memory tier of 'memorySize' (megabytes) and a
+ *  disk tier of 'diskSize' (megabytes) in the directory 'dir'
+ *
+ *  With a memory size of zero the disk is used directly.
+ */
+func NewTieredCache(memorySize uint64, dir string, diskSize uint64) (Cache, error) {
+	disk, err := NewDiskCache(dir, diskSize*1024*1024)
+	if err != nil {
+		return nil, err
+	}
+	if memorySize == 0 {
+		return disk, nil
+	}
+
+	tiered := &TieredCache{
+		disk:      disk,
+		demotions: make(chan demotion, demotionQueueSize),
+	}
+	tiered.memory = newRistrettoCache(memorySize*1024*1024, tiered.demote)
+	go tiered.writeDemotions()
+	return tiered, nil
+}
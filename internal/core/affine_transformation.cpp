@@ -0,0 +1,109 @@
+#include <cmath>
+
+#include "affine_transformation.hpp"
+
+Point AffineTransformation::operator*(Point p) const noexcept (true) {
+    return {
+        this->at(0)[0] * p.x + this->at(0)[1] * p.y + this->at(0)[2],
+        this->at(1)[0] * p.x + this->at(1)[1] * p.y + this->at(1)[2],
+    };
+};
+
+bool operator==(
+    AffineTransformation const& left,
+    AffineTransformation const& right
+) noexcept (true) {
+    const auto& lhs = static_cast< const AffineTransformation::base_type& >(left);
+    const auto& rhs = static_cast< const AffineTransformation::base_type& >(right);
+
+    return lhs == rhs;
+};
+
+void AffineTransformation::transform(
+    Point const* points,
+    std::size_t npoints,
+    Point* out
+) const noexcept (true) {
+    auto const& m = static_cast< const base_type& >(*this);
+    for (std::size_t i = 0; i < npoints; ++i) {
+        double const x = points[i].x;
+        double const y = points[i].y;
+        out[i] = {
+            m[0][0] * x + m[0][1] * y + m[0][2],
+            m[1][0] * x + m[1][1] * y + m[1][2],
+        };
+    }
+}
+
+AffineTransformation operator*(
+    AffineTransformation const& left,
+    AffineTransformation const& right
+) noexcept (true) {
+    const auto& l = static_cast< const AffineTransformation::base_type& >(left);
+    const auto& r = static_cast< const AffineTransformation::base_type& >(right);
+
+    AffineTransformation::base_type product;
+    for (int row = 0; row < 2; ++row) {
+        product[row] = {
+            l[row][0] * r[0][0] + l[row][1] * r[1][0],
+            l[row][0] * r[0][1] + l[row][1] * r[1][1],
+            l[row][0] * r[0][2] + l[row][1] * r[1][2] + l[row][2],
+        };
+    }
+    return AffineTransformation(product);
+}
+
+AffineTransformation AffineTransformation::from_images(
+    Point origin,
+    Point x,
+    Point y
+) noexcept (true) {
+    return AffineTransformation(base_type({{
+        x.x - origin.x, y.x - origin.x, origin.x,
+        x.y - origin.y, y.y - origin.y, origin.y
+    }}));
+}
+
+AffineTransformation AffineTransformation::from_rotation(
+    double xori,
+    double yori,
+    double xinc,
+    double yinc,
+    double rot
+) noexcept (true) {
+    double rad = rot * (M_PI / 180);
+    /**
+    * Matrix is composed by applying affine transformations [1] in the
+    * following order:
+    * - scaling by xinc, yinc
+    * - counterclockwise rotation by angle rad around the center
+    * - translation by the offset (xori, yori)
+    *
+    * By scaling unit vectors, rotating coordinate system axes and moving
+    * coordinate system center to new position we transform index-based
+    * rows-and-columns cartesian coordinate system into CDP-surface one.
+    *
+    * [1] https://en.wikipedia.org/wiki/Affine_transformation
+    */
+    return AffineTransformation(base_type({{
+        xinc * std::cos(rad),  -yinc * std::sin(rad), xori,
+        xinc * std::sin(rad),   yinc * std::cos(rad), yori
+    }}));
+}
+
+AffineTransformation AffineTransformation::inverse_from_rotation(
+    double xori,
+    double yori,
+    double xinc,
+    double yinc,
+    double rot
+) noexcept(true) {
+    double rad = rot * (M_PI / 180);
+    /**
+     * Matrix inverse to the one above.
+     */
+    return AffineTransformation(base_type({{
+        std::cos(rad) / xinc, std::sin(rad) / xinc, -(std::sin(rad) * yori + std::cos(rad) * xori) / xinc,
+       -std::sin(rad) / yinc, std::cos(rad) / yinc,  (std::sin(rad) * xori - std::cos(rad) * yori) / yinc
+    }}));
+}
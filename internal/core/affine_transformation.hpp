@@ -0,0 +1,70 @@
+#ifndef ONESEISMIC_API_AFFINE_TRANSFORMATION_HPP
+#define ONESEISMIC_API_AFFINE_TRANSFORMATION_HPP
+
+#include <array>
+#include <cstddef>
+
+struct Point {
+    double x;
+    double y;
+};
+
+struct AffineTransformation : private std::array< std::array< double, 3>, 2 > {
+    using base_type = std::array< std::array< double, 3 >, 2 >;
+
+    explicit AffineTransformation(base_type x) : base_type(std::move(x)) {}
+
+    Point operator*(Point p) const noexcept (true);
+
+    friend bool operator==(
+        AffineTransformation const& left,
+        AffineTransformation const& right
+    ) noexcept (true);
+
+    /* Composition, i.e. (left * right) * p == left * (right * p) */
+    friend AffineTransformation operator*(
+        AffineTransformation const& left,
+        AffineTransformation const& right
+    ) noexcept (true);
+
+    /**
+     * Make transformation which maps (0, 0), (1, 0) and (0, 1) to origin, x
+     * and y respectively. Any affine transformation is fully described by
+     * these three images.
+     */
+    static AffineTransformation from_images(
+        Point origin,
+        Point x,
+        Point y
+    ) noexcept (true);
+
+    /**
+     * Apply the transformation to npoints points. Equivalent to applying
+     * operator* to every point, but lets the compiler vectorize the loop. In
+     * and out may point to the same buffer.
+     */
+    void transform(
+        Point const* points,
+        std::size_t npoints,
+        Point* out
+    ) const noexcept (true);
+
+    static AffineTransformation from_rotation(
+        double xori,
+        double yori,
+        double xinc,
+        double yinc,
+        double rot
+    ) noexcept (true);
+
+    /* Make inverse transformation to the one created from rotation */
+    static AffineTransformation inverse_from_rotation(
+        double xori,
+        double yori,
+        double xinc,
+        double yinc,
+        double rot
+    )noexcept (true);
+};
+
+#endif /* ONESEISMIC_API_AFFINE_TRANSFORMATION_HPP */
@@ -0,0 +1,107 @@
+package core
+
+import (
+	"sync"
+	"time"
+)
+
+/** Remembers successful authorization checks for a short while
+ *
+ * Checking that a sas-token grants read access costs a round-trip to blob
+ * storage. Successful checks are remembered per blob and token for at most
+ * the configured time to live, and never beyond the expiry of the token.
+ * Failed checks are never remembered, so a token that has just been granted
+ * access is not rejected because of an earlier failure.
+ *
+ * The time to live is a revocation delay. A token that is revoked, e.g. by
+ * removing the stored access policy it refers to, keeps passing the check
+ * until its entry runs out. The cache is therefore off unless enabled.
+ */
+type AuthorizationCache struct {
+	ttl      time.Duration
+	capacity int
+
+	lock    sync.Mutex
+	expires map[string]time.Time
+}
+
+func NewAuthorizationCache(ttl time.Duration, capacity int) *AuthorizationCache {
+	return &AuthorizationCache{
+		ttl:      ttl,
+		capacity: capacity,
+		expires:  make(map[string]time.Time),
+	}
+}
+
+func authorizationKey(connection Connection) string {
+	return connection.Url() + "\x00" + connection.ConnectionString()
+}
+
+func (c *AuthorizationCache) IsAuthorizedToRead(connection Connection) bool {
+	key := authorizationKey(connection)
+	now := time.Now()
+
+	c.lock.Lock()
+	expires, exists := c.expires[key]
+	c.lock.Unlock()
+	if exists && now.Before(expires) {
+		return true
+	}
+
+	if !connection.IsAuthorizedToRead() {
+		return false
+	}
+
+	expires = now.Add(c.ttl)
+	if expiry, ok := connection.Expiry(); ok && expiry.Before(expires) {
+		expires = expiry
+	}
+
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	if len(c.expires) >= c.capacity {
+		c.purge(now)
+	}
+	if len(c.expires) < c.capacity {
+		c.expires[key] = expires
+	}
+	return true
+}
+
+/** Drop expired entries, or everything if nothing has expired. Expects lock held */
+func (c *AuthorizationCache) purge(now time.Time) {
+	for key, expires := range c.expires {
+		if !now.Before(expires) {
+			delete(c.expires, key)
+		}
+	}
+	if len(c.expires) >= c.capacity {
+		c.expires = make(map[string]time.Time)
+	}
+}
+
+/** Connection whose authorization checks go through an AuthorizationCache */
+type cachedAuthorizationConnection struct {
+	Connection
+	cache *AuthorizationCache
+}
+
+func (c *cachedAuthorizationConnection) IsAuthorizedToRead() bool {
+	return c.cache.IsAuthorizedToRead(c.Connection)
+}
+
+/** Wrap a ConnectionMaker such that authorization checks of the connections
+ *  it makes are cached
+ */
+func WithAuthorizationCache(
+	makeConnection ConnectionMaker,
+	cache *AuthorizationCache,
+) ConnectionMaker {
+	return func(blob, sas string) (Connection, error) {
+		connection, err := makeConnection(blob, sas)
+		if err != nil {
+			return nil, err
+		}
+		return &cachedAuthorizationConnection{Connection: connection, cache: cache}, nil
+	}
+}
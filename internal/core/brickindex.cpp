@@ -0,0 +1,215 @@
+#include "brickindex.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+std::size_t nbricks_of(int const* shape, int const* brick_size) noexcept (false) {
+    std::size_t nbricks = 1;
+    for (int i = 0; i < BrickIndex::dimensions; ++i) {
+        if (shape[i] < 1 or brick_size[i] < 1) {
+            throw std::invalid_argument("Brick index of empty volume or bricks");
+        }
+        nbricks *= (shape[i] + brick_size[i] - 1) / brick_size[i];
+    }
+    return nbricks;
+}
+
+} // namespace
+
+BrickIndex::BrickIndex(
+    int const*  shape,
+    int const*  brick_size,
+    float const fillvalue
+) : m_fillvalue(fillvalue) {
+    std::size_t const nbricks = nbricks_of(shape, brick_size);
+    for (int i = 0; i < BrickIndex::dimensions; ++i) {
+        this->m_shape[i]      = shape[i];
+        this->m_brick_size[i] = brick_size[i];
+        this->m_bricks[i]     = (shape[i] + brick_size[i] - 1) / brick_size[i];
+    }
+    this->m_summaries.resize(nbricks, brick_summary{});
+}
+
+std::size_t BrickIndex::size(
+    int const* shape,
+    int const* brick_size
+) noexcept (false) {
+    return sizeof(BrickIndex) + nbricks_of(shape, brick_size) * sizeof(brick_summary);
+}
+
+float BrickIndex::fillvalue() const noexcept (true) {
+    return this->m_fillvalue;
+}
+
+std::size_t BrickIndex::index_of(int const* brick) const noexcept (true) {
+    return brick[0] + std::size_t(this->m_bricks[0]) *
+        (brick[1] + std::size_t(this->m_bricks[1]) * brick[2]);
+}
+
+bool BrickIndex::touched(
+    int const* lower,
+    int const* upper,
+    int*       first,
+    int*       last
+) const noexcept (true) {
+    for (int i = 0; i < BrickIndex::dimensions; ++i) {
+        int const lo = std::max(lower[i], 0);
+        int const hi = std::min(upper[i], this->m_shape[i]);
+        if (hi <= lo) return false;
+
+        first[i] = lo / this->m_brick_size[i];
+        last[i]  = (hi - 1) / this->m_brick_size[i];
+    }
+    return true;
+}
+
+bool BrickIndex::all_fill(
+    int const* lower,
+    int const* upper
+) const noexcept (true) {
+    if (not this->any_fill()) return false;
+
+    int first[BrickIndex::dimensions];
+    int last[BrickIndex::dimensions];
+    if (not this->touched(lower, upper, first, last)) return false;
+
+    std::lock_guard< std::mutex > lock(this->m_lock);
+    return this->bricks_fill(first, last);
+}
+
+bool BrickIndex::all_fill(
+    float const*      positions,
+    std::size_t const npositions,
+    std::size_t const stride,
+    int const         skip_dimension,
+    int const         reach
+) const noexcept (true) {
+    if (npositions == 0 or not this->any_fill()) return false;
+
+    int previous_first[BrickIndex::dimensions] = {};
+    int previous_last[BrickIndex::dimensions]  = {};
+
+    std::lock_guard< std::mutex > lock(this->m_lock);
+    for (std::size_t p = 0; p < npositions; ++p) {
+        float const* position = positions + p * stride;
+
+        int lower[BrickIndex::dimensions];
+        int upper[BrickIndex::dimensions];
+        for (int i = 0; i < BrickIndex::dimensions; ++i) {
+            if (i == skip_dimension) {
+                lower[i] = 0;
+                upper[i] = std::numeric_limits< int >::max();
+            } else {
+                lower[i] = int(position[i]) - reach;
+                upper[i] = int(position[i]) + reach + 1;
+            }
+        }
+
+        int first[BrickIndex::dimensions];
+        int last[BrickIndex::dimensions];
+        if (not this->touched(lower, upper, first, last)) return false;
+
+        bool const same = p > 0
+            and std::equal(first, first + BrickIndex::dimensions, previous_first)
+            and std::equal(last,  last  + BrickIndex::dimensions, previous_last);
+        if (same) continue;
+
+        if (not this->bricks_fill(first, last)) return false;
+        std::copy(first, first + BrickIndex::dimensions, previous_first);
+        std::copy(last,  last  + BrickIndex::dimensions, previous_last);
+    }
+    return true;
+}
+
+bool BrickIndex::bricks_fill(
+    int const* first,
+    int const* last
+) const noexcept (true) {
+    int brick[BrickIndex::dimensions];
+    for (brick[2] = first[2]; brick[2] <= last[2]; ++brick[2]) {
+    for (brick[1] = first[1]; brick[1] <= last[1]; ++brick[1]) {
+    for (brick[0] = first[0]; brick[0] <= last[0]; ++brick[0]) {
+        brick_summary const& summary = this->m_summaries[this->index_of(brick)];
+        if (not summary.known or not summary.all_fill) return false;
+    }}}
+    return true;
+}
+
+bool BrickIndex::any_fill() const noexcept (true) {
+    return this->m_fill_bricks.load(std::memory_order_relaxed) > 0;
+}
+
+brick_summary BrickIndex::summary(int const* brick) const noexcept (true) {
+    for (int i = 0; i < BrickIndex::dimensions; ++i) {
+        if (brick[i] < 0 or brick[i] >= this->m_bricks[i]) return brick_summary{};
+    }
+    std::lock_guard< std::mutex > lock(this->m_lock);
+    return this->m_summaries[this->index_of(brick)];
+}
+
+void BrickIndex::update(
+    float const* data,
+    int const*   lower,
+    int const*   upper
+) noexcept (false) {
+    /* Bricks wholly inside the region. The last brick along a dimension may
+     * be cut short by the end of the volume. */
+    int first[BrickIndex::dimensions];
+    int end[BrickIndex::dimensions];
+    std::size_t extent[BrickIndex::dimensions];
+    for (int i = 0; i < BrickIndex::dimensions; ++i) {
+        if (lower[i] < 0 or upper[i] > this->m_shape[i]) return;
+
+        int const size = this->m_brick_size[i];
+        first[i] = (lower[i] + size - 1) / size;
+        end[i]   = first[i];
+        while (end[i] < this->m_bricks[i] and
+               std::min((end[i] + 1) * size, this->m_shape[i]) <= upper[i]) {
+            ++end[i];
+        }
+        if (end[i] == first[i]) return;
+        extent[i] = upper[i] - lower[i];
+    }
+
+    int brick[BrickIndex::dimensions];
+    for (brick[2] = first[2]; brick[2] < end[2]; ++brick[2]) {
+    for (brick[1] = first[1]; brick[1] < end[1]; ++brick[1]) {
+    for (brick[0] = first[0]; brick[0] < end[0]; ++brick[0]) {
+        std::size_t const index = this->index_of(brick);
+        {
+            std::lock_guard< std::mutex > lock(this->m_lock);
+            if (this->m_summaries[index].known) continue;
+        }
+
+        int from[BrickIndex::dimensions];
+        int to[BrickIndex::dimensions];
+        for (int i = 0; i < BrickIndex::dimensions; ++i) {
+            from[i] = brick[i] * this->m_brick_size[i] - lower[i];
+            to[i]   = std::min(
+                from[i] + this->m_brick_size[i],
+                this->m_shape[i] - lower[i]
+            );
+        }
+
+        brick_summary summary{};
+        summary.all_fill = true;
+        summary.known    = true;
+        for (int k = from[2]; k < to[2] and summary.all_fill; ++k) {
+        for (int j = from[1]; j < to[1] and summary.all_fill; ++j) {
+            float const* trace = data + (j + k * extent[1]) * extent[0];
+            summary.all_fill = std::all_of(
+                trace + from[0],
+                trace + to[0],
+                [this](float sample) { return sample == this->m_fillvalue; }
+            );
+        }}
+
+        std::lock_guard< std::mutex > lock(this->m_lock);
+        if (this->m_summaries[index].known) continue;
+        this->m_summaries[index] = summary;
+        if (summary.all_fill) ++this->m_fill_bricks;
+    }}}
+}
@@ -0,0 +1,112 @@
+#ifndef ONESEISMIC_API_BRICKINDEX_HPP
+#define ONESEISMIC_API_BRICKINDEX_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/** What is known about the samples of a single brick (chunk) of a volume */
+struct brick_summary {
+    /* All samples equal the fill value */
+    bool all_fill;
+    /* The brick has been summarized */
+    bool known;
+};
+
+/** Summaries of the bricks of a volume, filled in as bricks are read
+ *
+ * Bricks are summarized from reads that cover them whole, such that the
+ * index is built lazily by the reads a datahandle does anyway, e.g. when a
+ * region is warmed up. Regions where every brick is known to be all fill
+ * can be answered without reading anything.
+ *
+ * Summarizing a brick stops at its first sample that is not fill, so bricks
+ * with data cost next to nothing to index. Until some brick is known to be
+ * all fill, no region can be, and queries return without looking.
+ *
+ * Only the first three dimensions are indexed. Regions are given as
+ * [lower, upper) sample ranges along each of them, and buffers with dimension
+ * 0 varying fastest, as read by the OpenVDS subset requests. The index is
+ * safe to use from multiple threads.
+ */
+class BrickIndex {
+public:
+    static constexpr int dimensions = 3;
+
+    BrickIndex(
+        int const*  shape,
+        int const*  brick_size,
+        float const fillvalue
+    ) noexcept (false);
+
+    /** Bytes held by the index of a volume of shape in bricks of brick_size */
+    static std::size_t size(
+        int const* shape,
+        int const* brick_size
+    ) noexcept (false);
+
+    float fillvalue() const noexcept (true);
+
+    /** Summarize the bricks that lie wholly inside the region from the
+     *  samples read for it. Bricks already known are left as they are.
+     */
+    void update(
+        float const* data,
+        int const*   lower,
+        int const*   upper
+    ) noexcept (false);
+
+    /** True if the region is not empty and every brick it touches is known
+     *  to be all fill
+     */
+    bool all_fill(int const* lower, int const* upper) const noexcept (true);
+
+    /** True if every brick within reach of any of the positions is known to
+     *  be all fill. Positions are stride floats apart, and span the whole
+     *  volume along skip_dimension, which is ignored if negative. Checks the
+     *  whole batch under a single lock, and positions in the same bricks as
+     *  the one before them only once.
+     */
+    bool all_fill(
+        float const*      positions,
+        std::size_t const npositions,
+        std::size_t const stride,
+        int const         skip_dimension,
+        int const         reach
+    ) const noexcept (true);
+
+    /** False as long as no brick is known to be all fill */
+    bool any_fill() const noexcept (true);
+
+    brick_summary summary(int const* brick) const noexcept (true);
+
+private:
+    int m_shape[dimensions];
+    int m_brick_size[dimensions];
+    int m_bricks[dimensions];
+    float m_fillvalue;
+
+    mutable std::mutex m_lock;
+    std::vector< brick_summary > m_summaries;
+    std::atomic< std::size_t > m_fill_bricks{0};
+
+    std::size_t index_of(int const* brick) const noexcept (true);
+
+    /** Bricks touched by the region, clamped to the volume. Returns false if
+     *  the region is empty
+     */
+    bool touched(
+        int const* lower,
+        int const* upper,
+        int*       first,
+        int*       last
+    ) const noexcept (true);
+
+    /** True if every brick in [first, last] is known to be all fill. Expects
+     *  lock held
+     */
+    bool bricks_fill(int const* first, int const* last) const noexcept (true);
+};
+
+#endif /* ONESEISMIC_API_BRICKINDEX_HPP */
@@ -0,0 +1,64 @@
+#include "bufferusage.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+thread_local buffer_usage current_buffer_usage = {};
+
+} /* namespace */
+
+buffer_usage& thread_buffer_usage() noexcept(true) {
+    return current_buffer_usage;
+}
+
+void buffers_allocated(std::size_t bytes) noexcept(true) {
+    buffer_usage& usage = current_buffer_usage;
+    usage.live += bytes;
+    usage.peak  = std::max(usage.peak, usage.live);
+}
+
+void buffers_released(std::size_t bytes) noexcept(true) {
+    current_buffer_usage.live -= bytes;
+}
+
+TrackedBuffer::TrackedBuffer(std::size_t bytes) noexcept(true)
+    : m_bytes(bytes)
+{
+    buffers_allocated(this->m_bytes);
+}
+
+TrackedBuffer::TrackedBuffer(TrackedBuffer const& other) noexcept(true)
+    : m_bytes(other.m_bytes)
+{
+    buffers_allocated(this->m_bytes);
+}
+
+TrackedBuffer::TrackedBuffer(TrackedBuffer&& other) noexcept(true)
+    : m_bytes(other.m_bytes)
+{
+    other.m_bytes = 0;
+}
+
+TrackedBuffer& TrackedBuffer::operator=(TrackedBuffer other) noexcept(true) {
+    std::swap(this->m_bytes, other.m_bytes);
+    return *this;
+}
+
+TrackedBuffer::~TrackedBuffer() {
+    buffers_released(this->m_bytes);
+}
+
+void TrackedBuffer::resize(std::size_t bytes) noexcept(true) {
+    if (bytes > this->m_bytes) {
+        buffers_allocated(bytes - this->m_bytes);
+    } else if (bytes < this->m_bytes) {
+        buffers_released(this->m_bytes - bytes);
+    }
+    this->m_bytes = bytes;
+}
+
+void TrackedBuffer::release() noexcept(true) {
+    this->m_bytes = 0;
+}
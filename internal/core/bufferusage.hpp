@@ -0,0 +1,54 @@
+#ifndef ONESEISMIC_API_BUFFERUSAGE_HPP
+#define ONESEISMIC_API_BUFFERUSAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/** Bytes of data buffers allocated by the calling thread
+ *
+ * Only the large buffers of a request are counted: samples of subvolumes,
+ * responses, temporaries of double datahandles and resampled segments.
+ * Buffers may be released by another thread than the one that allocated
+ * them, so live can drift, and only differences between two points in time
+ * on the same thread are meaningful. peak is the highest live seen since it
+ * was last reset.
+ */
+struct buffer_usage {
+    std::int64_t live;
+    std::int64_t peak;
+};
+
+buffer_usage& thread_buffer_usage() noexcept(true);
+
+void buffers_allocated(std::size_t bytes) noexcept(true);
+void buffers_released(std::size_t bytes) noexcept(true);
+
+/** Count bytes as allocated by the calling thread for as long as the object
+ *  lives
+ *
+ * Kept next to the buffer it accounts for. Copies count their bytes again,
+ * as the buffers they sit next to are copied too.
+ */
+class TrackedBuffer {
+public:
+    explicit TrackedBuffer(std::size_t bytes = 0) noexcept(true);
+    TrackedBuffer(TrackedBuffer const& other) noexcept(true);
+    TrackedBuffer(TrackedBuffer&& other) noexcept(true);
+    TrackedBuffer& operator=(TrackedBuffer other) noexcept(true);
+    ~TrackedBuffer();
+
+    /** Account for a buffer that has grown or shrunk to bytes */
+    void resize(std::size_t bytes) noexcept(true);
+
+    /** Stop accounting for the buffer without counting it as released
+     *
+     * For buffers that are handed over to the caller, which releases them
+     * with buffers_released.
+     */
+    void release() noexcept(true);
+
+private:
+    std::size_t m_bytes;
+};
+
+#endif // ONESEISMIC_API_BUFFERUSAGE_HPP
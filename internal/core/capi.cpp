@@ -1,8 +1,17 @@
 #include "ctypes.h"
 #include "capi.h"
 
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <time.h>
+
 #include "cppapi.hpp"
 
+#include "bufferusage.hpp"
+#include "datahandle.hpp"
 #include "exceptions.hpp"
 #include "subvolume.hpp"
 
@@ -15,13 +24,150 @@ void response_delete(struct response* buf) {
         return;
 
     delete[] buf->data;
+    buffers_released(buf->size);
     *buf = response_create();
 }
 
+struct Stage {
+    const char* name;
+    double seconds;
+};
+
 struct Context {
     std::string errmsg;
+    std::vector< Stage > stages;
+    io_stats io = {};
+    std::vector< read_event > reads;
+    resource_stats resources = {};
 };
 
+namespace {
+
+/** Record the wall time spent in a scope as a named stage on the context
+ *
+ * The stage is recorded whether the scope is left normally or by an
+ * exception. Names must be string literals, as only the pointer is kept.
+ */
+class StageTimer {
+public:
+    StageTimer(Context* ctx, const char* name)
+        : ctx(ctx), name(name), start(std::chrono::steady_clock::now())
+    {}
+
+    ~StageTimer() {
+        if (not this->ctx) return;
+
+        std::chrono::duration< double > const elapsed =
+            std::chrono::steady_clock::now() - this->start;
+        try {
+            this->ctx->stages.push_back({this->name, elapsed.count()});
+        } catch (...) {
+            /* Timings are best effort and must never fail the request */
+        }
+    }
+
+private:
+    Context* ctx;
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+};
+
+/** Account the storage reads done by the calling thread in a scope to the
+ *  context
+ *
+ * The individual reads are moved to the context too, up to max_thread_reads
+ * per context.
+ */
+class IORecorder {
+public:
+    explicit IORecorder(Context* ctx)
+        : ctx(ctx), before(thread_io_stats()), first_read(thread_reads().size())
+    {}
+
+    ~IORecorder() {
+        std::vector< read_event >& reads = thread_reads();
+        auto const first = reads.begin() + this->first_read;
+
+        if (this->ctx) {
+            io_stats const& after = thread_io_stats();
+            io_stats& io = this->ctx->io;
+            io.requests         += after.requests         - this->before.requests;
+            io.subcube_requests += after.subcube_requests - this->before.subcube_requests;
+            io.trace_requests   += after.trace_requests   - this->before.trace_requests;
+            io.sample_requests  += after.sample_requests  - this->before.sample_requests;
+            io.chunks           += after.chunks           - this->before.chunks;
+            io.chunk_bytes      += after.chunk_bytes      - this->before.chunk_bytes;
+            io.read_seconds     += after.read_seconds     - this->before.read_seconds;
+
+            std::size_t const room = max_thread_reads - std::min(
+                max_thread_reads, this->ctx->reads.size()
+            );
+            auto const last = first + std::min< std::size_t >(room, reads.end() - first);
+            try {
+                this->ctx->reads.insert(this->ctx->reads.end(), first, last);
+            } catch (...) {
+                /* The timeline is best effort and must never fail the request */
+            }
+        }
+        reads.erase(first, reads.end());
+    }
+
+private:
+    Context* ctx;
+    io_stats before;
+    std::size_t first_read;
+};
+
+double thread_cpu_seconds() noexcept(true) {
+    timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0;
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/** Account the data buffers and CPU time of the calling thread in a scope to
+ *  the context
+ *
+ * Work the core hands off to other threads, like OpenVDS' decompression,
+ * is not included.
+ */
+class ResourceRecorder {
+public:
+    explicit ResourceRecorder(Context* ctx)
+        : ctx(ctx),
+          usage(thread_buffer_usage()),
+          live_before(usage.live),
+          peak_before(usage.peak),
+          cpu_before(thread_cpu_seconds())
+    {
+        this->usage.peak = this->usage.live;
+    }
+
+    ~ResourceRecorder() {
+        std::int64_t const peak     = this->usage.peak - this->live_before;
+        std::int64_t const retained = this->usage.live - this->live_before;
+        this->usage.peak = std::max(this->peak_before, this->usage.peak);
+
+        if (not this->ctx) return;
+
+        resource_stats& resources = this->ctx->resources;
+        resources.peak_bytes = std::max< std::int64_t >(
+            resources.peak_bytes,
+            resources.retained_bytes + peak
+        );
+        resources.retained_bytes += retained;
+        resources.cpu_seconds    += thread_cpu_seconds() - this->cpu_before;
+    }
+
+private:
+    Context* ctx;
+    buffer_usage& usage;
+    std::int64_t live_before;
+    std::int64_t peak_before;
+    double cpu_before;
+};
+
+} // namespace
+
 Context* context_new() {
     return new Context{};
 }
@@ -38,6 +184,96 @@ const char* errmsg(Context* ctx) {
     return ctx->errmsg.c_str();
 }
 
+int context_stage_count(Context* ctx, size_t* out) {
+    if (not ctx) return STATUS_NULLPTR_ERROR;
+    if (not out) return STATUS_NULLPTR_ERROR;
+
+    *out = ctx->stages.size();
+    return STATUS_OK;
+}
+
+int context_stage(
+    Context* ctx,
+    size_t index,
+    const char** name,
+    double* seconds
+) {
+    if (not ctx) return STATUS_NULLPTR_ERROR;
+    if (not name or not seconds) {
+        ctx->errmsg = "Invalid out pointer";
+        return STATUS_NULLPTR_ERROR;
+    }
+    if (index >= ctx->stages.size()) {
+        ctx->errmsg = "Stage index out of range";
+        return STATUS_BAD_REQUEST;
+    }
+
+    *name    = ctx->stages[index].name;
+    *seconds = ctx->stages[index].seconds;
+    return STATUS_OK;
+}
+
+int context_take_io_stats(Context* ctx, io_stats* out) {
+    if (not ctx) return STATUS_NULLPTR_ERROR;
+    if (not out) {
+        ctx->errmsg = "Invalid out pointer";
+        return STATUS_NULLPTR_ERROR;
+    }
+
+    *out = ctx->io;
+    ctx->io = {};
+    return STATUS_OK;
+}
+
+int context_read_count(Context* ctx, size_t* out) {
+    if (not ctx) return STATUS_NULLPTR_ERROR;
+    if (not out) return STATUS_NULLPTR_ERROR;
+
+    *out = ctx->reads.size();
+    return STATUS_OK;
+}
+
+int context_read(Context* ctx, size_t index, read_event* out) {
+    if (not ctx) return STATUS_NULLPTR_ERROR;
+    if (not out) {
+        ctx->errmsg = "Invalid out pointer";
+        return STATUS_NULLPTR_ERROR;
+    }
+    if (index >= ctx->reads.size()) {
+        ctx->errmsg = "Read index out of range";
+        return STATUS_BAD_REQUEST;
+    }
+
+    *out = ctx->reads[index];
+    return STATUS_OK;
+}
+
+int context_clear_reads(Context* ctx) {
+    if (not ctx) return STATUS_OK;
+
+    ctx->reads.clear();
+    return STATUS_OK;
+}
+
+int context_take_resource_stats(Context* ctx, resource_stats* out) {
+    if (not ctx) return STATUS_NULLPTR_ERROR;
+    if (not out) {
+        ctx->errmsg = "Invalid out pointer";
+        return STATUS_NULLPTR_ERROR;
+    }
+
+    *out = ctx->resources;
+    ctx->resources = {};
+    return STATUS_OK;
+}
+
+int context_clear_stages(Context* ctx) {
+    if (not ctx) return STATUS_OK;
+
+    ctx->stages.clear();
+    return STATUS_OK;
+}
+
 int handle_exception(Context* ctx, std::exception_ptr eptr) {
     try {
         if (eptr) std::rethrow_exception(eptr);
@@ -64,6 +300,8 @@ int single_datahandle_new(
     try {
         if (not ds_out) throw detail::nullptr_error("Invalid out pointer");
 
+        StageTimer timer(ctx, "open");
+        ResourceRecorder resources(ctx);
         *ds_out = new SingleDataHandle(make_single_datahandle(url, credentials));
         return STATUS_OK;
     } catch (...) {
@@ -84,6 +322,8 @@ int double_datahandle_new(
         if (not datahandle)
             throw detail::nullptr_error("Invalid datahandle pointer");
 
+        StageTimer timer(ctx, "open");
+        ResourceRecorder resources(ctx);
         *datahandle = new DoubleDataHandle(make_double_datahandle(url_A, credentials_A, url_B, credentials_B, bin_operator));
         return STATUS_OK;
     } catch (...) {
@@ -105,6 +345,29 @@ int datahandle_free(Context* ctx, DataHandle* ds) {
     }
 }
 
+int datahandle_index_bricks(Context* ctx, DataHandle* datahandle) {
+    try {
+        if (not datahandle) throw detail::nullptr_error("Invalid datahandle");
+
+        datahandle->index_bricks();
+        return STATUS_OK;
+    } catch (...) {
+        return handle_exception(ctx, std::current_exception());
+    }
+}
+
+int brick_index_size(Context* ctx, DataHandle* datahandle, size_t* out) {
+    try {
+        if (not out) throw detail::nullptr_error("Invalid out pointer");
+        if (not datahandle) throw detail::nullptr_error("Invalid datahandle");
+
+        *out = datahandle->brick_index_size();
+        return STATUS_OK;
+    } catch (...) {
+        return handle_exception(ctx, std::current_exception());
+    }
+}
+
 int regular_surface_new(
     Context* ctx,
     float* data,
@@ -165,6 +428,8 @@ int subvolume_new(
         if (not bottom)
             throw detail::nullptr_error("Invalid bottom surface");
 
+        StageTimer timer(ctx, "subvolume");
+        ResourceRecorder resources(ctx);
         *out = make_subvolume(
             datahandle->get_metadata(),
             *reference,
@@ -177,11 +442,42 @@ int subvolume_new(
     }
 }
 
+int subvolume_constant_window_new(
+    Context* ctx,
+    DataHandle* datahandle,
+    RegularSurface* reference,
+    float above,
+    float below,
+    SurfaceBoundedSubVolume** out
+) {
+    try {
+        if (not out)
+            throw detail::nullptr_error("Invalid out pointer");
+        if (not datahandle)
+            throw detail::nullptr_error("Invalid datahandle");
+        if (not reference)
+            throw detail::nullptr_error("Invalid reference surface");
+
+        StageTimer timer(ctx, "subvolume");
+        ResourceRecorder resources(ctx);
+        *out = make_subvolume(
+            datahandle->get_metadata(),
+            *reference,
+            above,
+            below
+        );
+        return STATUS_OK;
+    } catch (...) {
+        return handle_exception(ctx, std::current_exception());
+    }
+}
+
 int subvolume_free(Context* ctx, SurfaceBoundedSubVolume* subvolume) {
     try {
         if (not subvolume)
             return STATUS_OK;
 
+        ResourceRecorder resources(ctx);
         delete subvolume;
 
         return STATUS_OK;
@@ -215,6 +511,9 @@ int slice(
             bounds++;
         }
 
+        StageTimer timer(ctx, "slice");
+        IORecorder io(ctx);
+        ResourceRecorder resources(ctx);
         cppapi::slice(*datahandle, direction, lineno, slice_bounds, out);
         return STATUS_OK;
     } catch (...) {
@@ -268,6 +567,9 @@ int fence(
         if (not datahandle)
             throw detail::nullptr_error("Invalid datahandle");
 
+        StageTimer timer(ctx, "fence");
+        IORecorder io(ctx);
+        ResourceRecorder resources(ctx);
         cppapi::fence(
             *datahandle,
             coordinate_system,
@@ -283,6 +585,151 @@ int fence(
     }
 }
 
+int slice_buffer_size(
+    Context* ctx,
+    DataHandle* datahandle,
+    int lineno,
+    axis_name ax,
+    struct Bound* bounds,
+    size_t nbounds,
+    size_t* out,
+    size_t* scratch
+) {
+    try {
+        if (not out or not scratch)
+            throw detail::nullptr_error("Invalid out pointer");
+        if (not datahandle)
+            throw detail::nullptr_error("Invalid datahandle");
+
+        Direction const direction(ax);
+
+        std::vector< Bound > slice_bounds(bounds, bounds + nbounds);
+
+        *out = cppapi::slice_buffer_size(*datahandle, direction, lineno, slice_bounds);
+        *scratch = cppapi::slice_scratch_size(*datahandle, direction, lineno, slice_bounds);
+        return STATUS_OK;
+    } catch (...) {
+        return handle_exception(ctx, std::current_exception());
+    }
+}
+
+int fence_buffer_size(
+    Context* ctx,
+    DataHandle* datahandle,
+    size_t npoints,
+    size_t* out,
+    size_t* scratch
+) {
+    try {
+        if (not out or not scratch)
+            throw detail::nullptr_error("Invalid out pointer");
+        if (not datahandle)
+            throw detail::nullptr_error("Invalid datahandle");
+
+        *out = cppapi::fence_buffer_size(*datahandle, npoints);
+        *scratch = cppapi::fence_scratch_size(*datahandle, npoints);
+        return STATUS_OK;
+    } catch (...) {
+        return handle_exception(ctx, std::current_exception());
+    }
+}
+
+int subvolume_buffer_size(
+    Context* ctx,
+    SurfaceBoundedSubVolume* subvolume,
+    size_t* out
+) {
+    try {
+        if (not out)
+            throw detail::nullptr_error("Invalid out pointer");
+        if (not subvolume)
+            throw detail::nullptr_error("Invalid subvolume");
+
+        *out = subvolume->buffer_size();
+        return STATUS_OK;
+    } catch (...) {
+        return handle_exception(ctx, std::current_exception());
+    }
+}
+
+int fetch_scratch_size(
+    Context* ctx,
+    DataHandle* datahandle,
+    SurfaceBoundedSubVolume* subvolume,
+    enum interpolation_method interpolation_method,
+    size_t from,
+    size_t to,
+    size_t* out
+) {
+    try {
+        if (not out)
+            throw detail::nullptr_error("Invalid out pointer");
+        if (not datahandle)
+            throw detail::nullptr_error("Invalid datahandle");
+        if (not subvolume)
+            throw detail::nullptr_error("Invalid subvolume");
+
+        *out = cppapi::fetch_scratch_size(
+            *datahandle,
+            *subvolume,
+            interpolation_method,
+            from,
+            to
+        );
+        return STATUS_OK;
+    } catch (...) {
+        return handle_exception(ctx, std::current_exception());
+    }
+}
+
+int prefetch_slabs(
+    Context* ctx,
+    DataHandle* datahandle,
+    struct Bound* bounds,
+    size_t nbounds,
+    size_t* nslabs,
+    size_t* slab_size
+) {
+    try {
+        if (not nslabs or not slab_size)
+            throw detail::nullptr_error("Invalid out pointer");
+        if (not datahandle)
+            throw detail::nullptr_error("Invalid datahandle");
+
+        std::vector< Bound > prefetch_bounds(bounds, bounds + nbounds);
+
+        std::int64_t size = 0;
+        *nslabs = cppapi::prefetch_slabs(*datahandle, prefetch_bounds, &size);
+        *slab_size = size;
+        return STATUS_OK;
+    } catch (...) {
+        return handle_exception(ctx, std::current_exception());
+    }
+}
+
+int prefetch_slab(
+    Context* ctx,
+    DataHandle* datahandle,
+    struct Bound* bounds,
+    size_t nbounds,
+    size_t index
+) {
+    try {
+        if (not datahandle)
+            throw detail::nullptr_error("Invalid datahandle");
+
+        std::vector< Bound > prefetch_bounds(bounds, bounds + nbounds);
+
+        StageTimer timer(ctx, "prefetch");
+        IORecorder io(ctx);
+        ResourceRecorder resources(ctx);
+        cppapi::prefetch_slab(*datahandle, prefetch_bounds, index);
+        return STATUS_OK;
+    } catch (...) {
+        return handle_exception(ctx, std::current_exception());
+    }
+}
+
 int fence_metadata(
     Context* ctx,
     DataHandle* datahandle,
@@ -313,6 +760,8 @@ int metadata(
         if (not datahandle)
             throw detail::nullptr_error("Invalid datahandle");
 
+        StageTimer timer(ctx, "metadata");
+        ResourceRecorder resources(ctx);
         cppapi::metadata(*datahandle, out);
         return STATUS_OK;
     } catch (...) {
@@ -370,6 +819,7 @@ int attribute(
         }
 
         ResampledSegmentBlueprint dst_segment_blueprint = ResampledSegmentBlueprint(stepsize);
+        ResourceRecorder resources(ctx);
 
         void* outs[nattributes];
         for (int i = 0; i < nattributes; ++i) {
@@ -377,14 +827,19 @@ int attribute(
             outs[i] = static_cast< char* >(out) + offset;
         }
 
-        cppapi::fetch_subvolume(
-            *datahandle,
-            *src_subvolume,
-            interpolation_method,
-            from,
-            to
-        );
+        {
+            StageTimer timer(ctx, "fetch");
+            IORecorder io(ctx);
+            cppapi::fetch_subvolume(
+                *datahandle,
+                *src_subvolume,
+                interpolation_method,
+                from,
+                to
+            );
+        }
 
+        StageTimer timer(ctx, "attributes");
         cppapi::attributes(
             *src_subvolume,
             &dst_segment_blueprint,
@@ -426,3 +881,7 @@ int align_surfaces(
         return handle_exception(ctx, std::current_exception());
     }
 }
+
+void set_alignment_threads(size_t nthreads) {
+    cppapi::set_alignment_threads(nthreads);
+}
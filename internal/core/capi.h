@@ -39,6 +39,44 @@ int context_free(Context* ctx);
 /** Read out the last error msg set on the context */
 const char* errmsg(Context* ctx);
 
+/** Number of stages timed on the context
+ *
+ * Functions that do significant work record the wall time of their stages,
+ * e.g. opening a VDS or fetching data, on the context they are called with.
+ * Stages accumulate over calls until cleared.
+ */
+int context_stage_count(Context* ctx, size_t* out);
+
+/** Name and duration, in seconds, of the stage at index
+ *
+ * The name is owned by the library and valid for the lifetime of the
+ * program.
+ */
+int context_stage(
+    Context* ctx,
+    size_t index,
+    const char** name,
+    double* seconds
+);
+
+/** Forget all stages timed on the context so far */
+int context_clear_stages(Context* ctx);
+
+/** Read out, and reset, the storage reads done by calls made with the context */
+int context_take_io_stats(Context* ctx, struct io_stats* out);
+
+/** Number of storage reads timed on the context */
+int context_read_count(Context* ctx, size_t* out);
+
+/** The index'th storage read timed on the context, in the order they were done */
+int context_read(Context* ctx, size_t index, struct read_event* out);
+
+/** Forget all storage reads timed on the context so far */
+int context_clear_reads(Context* ctx);
+
+/** Read out, and reset, the memory and CPU used by calls made with the context */
+int context_take_resource_stats(Context* ctx, struct resource_stats* out);
+
 response response_create();
 void response_delete(struct response*);
 
@@ -64,6 +102,14 @@ int double_datahandle_new(
 
 int datahandle_free(Context* ctx, DataHandle* f);
 
+/** Summarize the chunks the handle reads whole, such that chunks known to be
+ *  all fill are not read again. Meant for handles shared by many requests.
+ *  brick_index_size is the memory the index takes.
+ */
+int datahandle_index_bricks(Context* ctx, DataHandle* datahandle);
+
+int brick_index_size(Context* ctx, DataHandle* datahandle, size_t* out);
+
 struct RegularSurface;
 typedef struct RegularSurface RegularSurface;
 
@@ -98,6 +144,15 @@ int subvolume_new(
     SurfaceBoundedSubVolume** out
 );
 
+int subvolume_constant_window_new(
+    Context* ctx,
+    DataHandle* datahandle,
+    RegularSurface* reference,
+    float above,
+    float below,
+    SurfaceBoundedSubVolume** out
+);
+
 int subvolume_free(
     Context* ctx,
     SurfaceBoundedSubVolume* subvolume
@@ -140,6 +195,75 @@ int fence(
     response* out
 );
 
+/** Buffer size estimates
+ *
+ * Number of bytes that the corresponding call reads into and returns (out),
+ * and of the scratch buffers it allocates on top of that while reading
+ * (scratch). These are computed from metadata only, such that the cost of a
+ * request is known before any data is read.
+ *
+ * subvolume_buffer_size is the memory held by the subvolume itself, and
+ * fetch_scratch_size the scratch buffers of fetching the segments in range
+ * [from, to) in a call to attribute.
+ */
+int slice_buffer_size(
+    Context* ctx,
+    DataHandle* datahandle,
+    int lineno,
+    enum axis_name direction,
+    struct Bound* bounds,
+    size_t nbounds,
+    size_t* out,
+    size_t* scratch
+);
+
+int fence_buffer_size(
+    Context* ctx,
+    DataHandle* datahandle,
+    size_t npoints,
+    size_t* out,
+    size_t* scratch
+);
+
+int subvolume_buffer_size(
+    Context* ctx,
+    SurfaceBoundedSubVolume* subvolume,
+    size_t* out
+);
+
+int fetch_scratch_size(
+    Context* ctx,
+    DataHandle* datahandle,
+    SurfaceBoundedSubVolume* subvolume,
+    enum interpolation_method interpolation_method,
+    size_t from,
+    size_t to,
+    size_t* out
+);
+
+/** Cache warm-up
+ *
+ * Read the part of the cube restricted by bounds, slab by slab, such that
+ * its chunks are cached by the datahandle. prefetch_slabs returns the number
+ * of slabs and the number of bytes a single slab is read into.
+ */
+int prefetch_slabs(
+    Context* ctx,
+    DataHandle* datahandle,
+    struct Bound* bounds,
+    size_t nbounds,
+    size_t* nslabs,
+    size_t* slab_size
+);
+
+int prefetch_slab(
+    Context* ctx,
+    DataHandle* datahandle,
+    struct Bound* bounds,
+    size_t nbounds,
+    size_t index
+);
+
 int fence_metadata(
     Context* ctx,
     DataHandle* datahandle,
@@ -194,6 +318,11 @@ int align_surfaces(
     int* primary_is_top
 );
 
+/** Threads align_surfaces may start on top of the calling threads, shared by
+ *  all calls. With none, every call aligns its surfaces in its own thread.
+ */
+void set_alignment_threads(size_t nthreads);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,7 @@ import (
 	"fmt"
 	"strings"
 	"net/url"
+	"time"
 
 	"github.com/Azure/azure-sdk-for-go/sdk/storage/azblob/blob"
 )
@@ -64,6 +65,8 @@ type Connection interface {
 	Url()              string
 	ConnectionString() string
 	IsAuthorizedToRead()    bool
+	// Expiry of the credentials, if they expire
+	Expiry()           (time.Time, bool)
 }
 
 type AzureConnection struct {
@@ -71,6 +74,8 @@ type AzureConnection struct {
 	container string
 	host      string
 	sas       string
+	// https, or http for local stand-ins of blob storage
+	scheme    string
 }
 
 func (c *AzureConnection) Url() string {
@@ -78,7 +83,8 @@ func (c *AzureConnection) Url() string {
 }
 
 func (c *AzureConnection) ConnectionString() string {
-	return fmt.Sprintf("BlobEndpoint=https://%s;SharedAccessSignature=?%s",
+	return fmt.Sprintf("BlobEndpoint=%s://%s;SharedAccessSignature=?%s",
+		c.scheme,
 		c.host,
 		c.sas,
 	)
@@ -110,7 +116,8 @@ func (c *AzureConnection) IsAuthorizedToRead() bool {
 	}
 
 	client, err := blob.NewClientWithNoCredential(
-		fmt.Sprintf("https://%s/%s/%s/VolumeDataLayout?%s",
+		fmt.Sprintf("%s://%s/%s/%s/VolumeDataLayout?%s",
+			c.scheme,
 			c.host,
 			c.container,
 			c.blobPath,
@@ -127,6 +134,26 @@ func (c *AzureConnection) IsAuthorizedToRead() bool {
 	return err == nil
 }
 
+/** Expiry time of the sas token, as given by its 'se' (Signed Expiry) field
+ *
+ * Azure accepts both full UTC timestamps and plain dates.
+ */
+func (c *AzureConnection) Expiry() (time.Time, bool) {
+	query, err := url.ParseQuery(c.sas)
+	if err != nil || !query.Has("se") {
+		return time.Time{}, false
+	}
+
+	se := query.Get("se")
+	for _, layout := range []string{time.RFC3339, "2006-01-02T15:04Z", "2006-01-02"} {
+		expiry, err := time.Parse(layout, se)
+		if err == nil {
+			return expiry, true
+		}
+	}
+	return time.Time{}, false
+}
+
 func NewAzureConnection(
 	blobPath  string,
 	container string,
@@ -138,6 +165,7 @@ func NewAzureConnection(
 		container: container,
 		host:      host,
 		sas:       sas,
+		scheme:    "https",
 	}
 }
 
@@ -157,6 +185,10 @@ func (c *FileConnection) IsAuthorizedToRead() bool {
 	return true
 }
 
+func (c *FileConnection) Expiry() (time.Time, bool) {
+	return time.Time{}, false
+}
+
 func NewFileConnection(path string) *FileConnection {
 	return &FileConnection{ url: path }
 }
@@ -174,17 +206,30 @@ func makeUrl(path string) (*url.URL, error) {
 	return url.Parse(path)
 }
 
+/*
+ * Plain http is only allowed to storage accounts that are explicitly listed
+ * with it, which in practice are local stand-ins for blob storage.
+ */
 func isAllowed(allowlist []*url.URL, requested *url.URL) error {
 	for _, candidate := range allowlist {
-		if strings.EqualFold(requested.Hostname(), candidate.Hostname()) {
-			return nil
+		if !strings.EqualFold(requested.Hostname(), candidate.Hostname()) {
+			continue
 		}
+		if isPlainHttp(requested) && !isPlainHttp(candidate) {
+			continue
+		}
+		return nil
 	}
 	msg := "unsupported storage account: %s. This API is configured to work "  +
 		"with a pre-defined set of storage accounts. Contact the system admin " +
 		"to get your storage account on the allowlist"
 	return NewInvalidArgument(fmt.Sprintf(msg, requested.Host))
 }
+
+func isPlainHttp(u *url.URL) bool {
+	return strings.EqualFold(u.Scheme, "http")
+}
+
 /*
  * Strip leading ? if present from the input SAS token
  */
@@ -232,6 +277,9 @@ func MakeAzureConnection(accounts []string) ConnectionMaker {
 			blobUrl.Host,
 			sanitizeSAS(sas),
 		)
+		if isPlainHttp(blobUrl) {
+			connection.scheme = "http"
+		}
 
 		/*
 		 * OpenVDS (v3.0.3) segfaults on sas-tokens where the srt-field (allowed
@@ -1,10 +1,14 @@
 #ifndef ONESEISMIC_API_COORDINATE_TRANSFORMER_HPP
 #define ONESEISMIC_API_COORDINATE_TRANSFORMER_HPP
 
+#include <cstddef>
 #include <stdexcept>
 
+#include <OpenVDS/OpenVDS.h>
 #include <OpenVDS/IJKCoordinateTransformer.h>
 
+#include "affine_transformation.hpp"
+
 class CoordinateTransformer {
 public:
     virtual OpenVDS::IntVector3 VoxelIndexToIJKIndex(const OpenVDS::IntVector3& voxelIndex) const = 0;
@@ -14,6 +18,74 @@ public:
     virtual OpenVDS::DoubleVector3 IJKIndexToAnnotation(const OpenVDS::IntVector3& ijkIndex) const = 0;
     virtual OpenVDS::DoubleVector3 IJKPositionToAnnotation(const OpenVDS::DoubleVector3& ijkPosition) const = 0;
     virtual OpenVDS::DoubleVector3 WorldToAnnotation(OpenVDS::DoubleVector3 worldPosition) const = 0;
+
+    /**
+     * Horizontal part of WorldToAnnotation as an affine transformation from
+     * world (x, y) to annotated (inline, crossline) coordinates. The cube
+     * geometry is affine, so the transformation is fully described by the
+     * images of three points.
+     *
+     * The images are taken next to the origin of the survey rather than at
+     * world (0, 0). Georeferenced surveys sit far from (0, 0), e.g. at UTM
+     * coordinates, and WorldToAnnotation of points that far outside the
+     * survey would be differences of large, nearly equal numbers.
+     */
+    AffineTransformation horizontal_world_to_annotation() const {
+        auto const origin = this->IJKIndexToWorld({0, 0, 0});
+        double const x0 = origin[0];
+        double const y0 = origin[1];
+
+        auto annotation = [this, x0, y0](double dx, double dy) {
+            auto const position = this->WorldToAnnotation({x0 + dx, y0 + dy, 0});
+            return Point{ position[0], position[1] };
+        };
+        AffineTransformation const from_origin = AffineTransformation::from_images(
+            annotation(0, 0), annotation(1, 0), annotation(0, 1)
+        );
+        AffineTransformation const to_origin = AffineTransformation::from_images(
+            { -x0, -y0 }, { 1 - x0, -y0 }, { -x0, 1 - y0 }
+        );
+        return from_origin * to_origin;
+    }
+
+    /**
+     * Horizontal part of IJKPositionToAnnotation as an affine transformation
+     * from (i, j) positions to annotated (inline, crossline) coordinates.
+     */
+    AffineTransformation horizontal_ijk_to_annotation() const {
+        auto annotation = [this](double i, double j) {
+            auto const position = this->IJKPositionToAnnotation({i, j, 0});
+            return Point{ position[0], position[1] };
+        };
+        return AffineTransformation::from_images(
+            annotation(0, 0), annotation(1, 0), annotation(0, 1)
+        );
+    }
+
+    /**
+     * Batched WorldToAnnotation for npoints points in the horizontal plane.
+     * The transformation is derived once per call, instead of making a
+     * virtual call per point. In and out may point to the same buffer.
+     */
+    void world_to_annotation(
+        Point const* world,
+        std::size_t npoints,
+        Point* annotation
+    ) const {
+        this->horizontal_world_to_annotation().transform(world, npoints, annotation);
+    }
+
+    /**
+     * Batched IJKPositionToAnnotation for npoints points in the horizontal
+     * plane. In and out may point to the same buffer.
+     */
+    void ijk_position_to_annotation(
+        Point const* ijk,
+        std::size_t npoints,
+        Point* annotation
+    ) const {
+        this->horizontal_ijk_to_annotation().transform(ijk, npoints, annotation);
+    }
 };
 
 class SingleCoordinateTransformer : public CoordinateTransformer {
@@ -150,7 +222,66 @@ public:
         }
     }
 
+    /**
+     * Batched to_cube_a_voxel_position for npositions positions, each made of
+     * OpenVDS::Dimensionality_Max values of type T. The offsets are resolved
+     * once per call.
+     */
+    template<typename T>
+    void to_cube_a_voxel_positions(
+        T* out_cube_a_positions,
+        T const* intersection_cube_positions,
+        std::size_t npositions
+    ) const {
+        this->to_cube_voxel_positions(
+            out_cube_a_positions,
+            intersection_cube_positions,
+            npositions,
+            this->m_intersection_zero_as_cube_a_index
+        );
+    }
+
+    /**
+     * Batched to_cube_b_voxel_position for npositions positions, each made of
+     * OpenVDS::Dimensionality_Max values of type T.
+     */
+    template<typename T>
+    void to_cube_b_voxel_positions(
+        T* out_cube_b_positions,
+        T const* intersection_cube_positions,
+        std::size_t npositions
+    ) const {
+        this->to_cube_voxel_positions(
+            out_cube_b_positions,
+            intersection_cube_positions,
+            npositions,
+            this->m_intersection_zero_as_cube_b_index
+        );
+    }
+
 private:
+    template<typename T>
+    void to_cube_voxel_positions(
+        T* out,
+        T const* in,
+        std::size_t npositions,
+        OpenVDS::IntVector3 const& intersection_zero
+    ) const {
+        constexpr int ndims = OpenVDS::Dimensionality_Max;
+
+        T offset[ndims] = {0};
+        for (int ijk_index = 0; ijk_index < 3; ++ijk_index) {
+            auto voxel_index = m_transformer_a.IJKToVoxelDimensionMap()[ijk_index];
+            offset[voxel_index] = intersection_zero[ijk_index];
+        }
+
+        for (std::size_t v = 0; v < npositions; ++v) {
+            for (int d = 0; d < ndims; ++d) {
+                out[v * ndims + d] = in[v * ndims + d] + offset[d];
+            }
+        }
+    }
+
     OpenVDS::IntVector3 as_cube_a_ijk_index(const OpenVDS::IntVector3& ijkIndex) const {
         auto as_cube_a_index = OpenVDS::IntVector3(ijkIndex);
         for (int index = 0; index < 3; ++index) {
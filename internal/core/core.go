@@ -9,9 +9,12 @@ package core
 */
 import "C"
 import (
+	"context"
 	"errors"
 	"fmt"
+	"math"
 	"strings"
+	"time"
 	"unsafe"
 )
 
@@ -418,9 +421,158 @@ func (surface *RegularSurface) toCRegularSurface(cdata []C.float) (cRegularSurfa
 	return cRegularSurface{cSurface: cSurface, cData: cdata}, nil
 }
 
+/** Level of detail the core reads data at. Coarser levels are never used */
+const LevelOfDetail = 0
+
+/** Budget for memory used by requests in flight
+ *
+ * Acquire blocks until the requested number of bytes are available and
+ * returns a function that gives them back. It fails if the bytes can not be
+ * made available, or if ctx is done before they are.
+ */
+type MemoryBudget interface {
+	Acquire(ctx context.Context, bytes uint64) (release func(), err error)
+}
+
 type DSHandle struct {
 	dataHandle *C.struct_DataHandle
 	ctx        *C.struct_Context
+	pooled     *pooledHandle
+	budget     MemoryBudget
+	budgetCtx  context.Context
+	stages     *Stages
+	io         *IOStats
+	resources  *ResourceStats
+}
+
+/** Handle that accounts the memory of its requests against budget, waiting
+ *  for it no longer than ctx lives
+ */
+func (v DSHandle) WithBudget(ctx context.Context, budget MemoryBudget) DSHandle {
+	v.budget = budget
+	v.budgetCtx = ctx
+	return v
+}
+
+/** Memory of a request that returns a response of size bytes, read with
+ *  scratch bytes of scratch buffers. The response and the scratch buffers
+ *  are alive at the same time while reading, and the response and its Go
+ *  copy afterwards.
+ */
+func responseReservation(size, scratch C.size_t) uint64 {
+	if scratch > size {
+		return uint64(size) + uint64(scratch)
+	}
+	return 2 * uint64(size)
+}
+
+/** Reserve memory for a request before reading any data */
+func (v DSHandle) reserve(bytes uint64) (release func(), err error) {
+	if v.budget == nil {
+		return func() {}, nil
+	}
+	defer v.stages.Start("admission")()
+	return v.budget.Acquire(v.budgetCtx, bytes)
+}
+
+/** Handle that records the stages of its requests in stages
+ *
+ * Stages already timed on the handle's context, like opening the VDS, are
+ * recorded right away.
+ */
+func (v DSHandle) WithStages(stages *Stages) DSHandle {
+	v.stages = stages
+	v.collectStats(v.ctx)
+	return v
+}
+
+/** Handle that counts the storage reads of its requests in io */
+func (v DSHandle) WithIOStats(io *IOStats) DSHandle {
+	v.io = io
+	return v
+}
+
+/** Handle that accounts the memory and CPU its requests use in the C++ core
+ *  to resources
+ */
+func (v DSHandle) WithResourceStats(resources *ResourceStats) DSHandle {
+	v.resources = resources
+	return v
+}
+
+/** Move the stages, reads and resource usage recorded on ctx by the C++ core
+ *  into the handle's statistics
+ */
+func (v DSHandle) collectStats(ctx *C.struct_Context) {
+	if v.resources != nil {
+		var usage C.struct_resource_stats
+		if C.context_take_resource_stats(ctx, &usage) == C.STATUS_OK {
+			v.resources.Add(ResourceUsage{
+				PeakBytes:     uint64(usage.peak_bytes),
+				RetainedBytes: int64(usage.retained_bytes),
+				CPUTime:       time.Duration(float64(usage.cpu_seconds) * float64(time.Second)),
+			})
+		}
+	}
+
+	if v.io != nil {
+		var io C.struct_io_stats
+		if C.context_take_io_stats(ctx, &io) == C.STATUS_OK {
+			v.io.Add(IOTotals{
+				Requests:        uint64(io.requests),
+				SubcubeRequests: uint64(io.subcube_requests),
+				TraceRequests:   uint64(io.trace_requests),
+				SampleRequests:  uint64(io.sample_requests),
+				Chunks:          uint64(io.chunks),
+				ChunkBytes:      uint64(io.chunk_bytes),
+				ReadTime:        time.Duration(float64(io.read_seconds) * float64(time.Second)),
+			})
+		}
+
+		var count C.size_t
+		if C.context_read_count(ctx, &count) == C.STATUS_OK && count > 0 {
+			reads := make([]ReadEvent, 0, count)
+			for i := C.size_t(0); i < count; i++ {
+				var read C.struct_read_event
+				if C.context_read(ctx, i, &read) != C.STATUS_OK {
+					continue
+				}
+				reads = append(reads, ReadEvent{
+					Start:    fromUnixSeconds(float64(read.start)),
+					Duration: time.Duration(float64(read.seconds) * float64(time.Second)),
+					Chunks:   uint64(read.chunks),
+				})
+			}
+			v.io.AddReads(reads...)
+		}
+		C.context_clear_reads(ctx)
+	}
+
+	if v.stages == nil {
+		return
+	}
+
+	var count C.size_t
+	if C.context_stage_count(ctx, &count) != C.STATUS_OK {
+		return
+	}
+	for i := C.size_t(0); i < count; i++ {
+		var name *C.char
+		var seconds C.double
+		if C.context_stage(ctx, i, &name, &seconds) != C.STATUS_OK {
+			continue
+		}
+		v.stages.Add(
+			C.GoString(name),
+			time.Duration(float64(seconds)*float64(time.Second)),
+		)
+	}
+	C.context_clear_stages(ctx)
+}
+
+func fromUnixSeconds(seconds float64) time.Time {
+	whole := math.Floor(seconds)
+	return time.Unix(int64(whole), int64((seconds-whole)*float64(time.Second)))
 }
 
 func (v DSHandle) DataHandle() *C.struct_DataHandle {
@@ -438,6 +590,11 @@ func (v DSHandle) Error(status C.int) error {
 func (v DSHandle) Close() error {
 	defer C.context_free(v.ctx)
 
+	if v.pooled != nil {
+		v.pooled.release()
+		return nil
+	}
+
 	cerr := C.datahandle_free(v.ctx, v.dataHandle)
 	return toError(cerr, v.ctx)
 }
@@ -492,8 +649,16 @@ func CreateDSHandle(connections []Connection, operator uint32) (DSHandle, error)
 }
 
 func (v DSHandle) GetMetadata() ([]byte, error) {
+	if v.pooled != nil {
+		return v.pooled.getMetadata(v)
+	}
+	return v.readMetadata()
+}
+
+func (v DSHandle) readMetadata() ([]byte, error) {
 	var result C.struct_response = C.response_create()
 	cerr := C.metadata(v.context(), v.DataHandle(), &result)
+	v.collectStats(v.context())
 
 	defer C.response_delete(&result)
 
@@ -8,6 +8,7 @@ package core
 import "C"
 import (
 	"fmt"
+	"sort"
 	"unsafe"
 )
 
@@ -67,31 +68,24 @@ func (v DSHandle) GetAttributesAlongSurface(
 	}
 	defer cReferenceSurface.Close()
 
-	cTopSurfaceData, err := referenceSurface.toCdata(-above)
-	if err != nil {
-		return nil, err
-	}
-
-	cTopSurface, err := referenceSurface.toCRegularSurface(cTopSurfaceData)
-	if err != nil {
-		return nil, err
-	}
-	defer cTopSurface.Close()
-
-	cBottomSurfaceData, err := referenceSurface.toCdata(below)
-	if err != nil {
-		return nil, err
-	}
-	cBottomSurface, err := referenceSurface.toCRegularSurface(cBottomSurfaceData)
-	if err != nil {
-		return nil, err
+	// The window is constant, so top and bottom boundaries are derived from
+	// the reference surface in the core instead of being materialized here.
+	newSubVolume := func(
+		cCtx *C.Context,
+		cSubVolume **C.struct_SurfaceBoundedSubVolume,
+	) C.int {
+		return C.subvolume_constant_window_new(
+			cCtx,
+			v.DataHandle(),
+			cReferenceSurface.get(),
+			C.float(above),
+			C.float(below),
+			cSubVolume,
+		)
 	}
-	defer cBottomSurface.Close()
 
 	return v.getAttributes(
-		cReferenceSurface,
-		cTopSurface,
-		cBottomSurface,
+		newSubVolume,
 		nrows,
 		ncols,
 		targetAttributes,
@@ -168,10 +162,22 @@ func (v DSHandle) GetAttributesBetweenSurfaces(
 		cBottomSurface = cPrimarySurface
 	}
 
+	newSubVolume := func(
+		cCtx *C.Context,
+		cSubVolume **C.struct_SurfaceBoundedSubVolume,
+	) C.int {
+		return C.subvolume_new(
+			cCtx,
+			v.DataHandle(),
+			cPrimarySurface.get(),
+			cTopSurface.get(),
+			cBottomSurface.get(),
+			cSubVolume,
+		)
+	}
+
 	return v.getAttributes(
-		cPrimarySurface,
-		cTopSurface,
-		cBottomSurface,
+		newSubVolume,
 		nrows,
 		ncols,
 		targetAttributes,
@@ -180,6 +186,14 @@ func (v DSHandle) GetAttributesBetweenSurfaces(
 	)
 }
 
+/** Set the number of threads, shared by all requests, that may help align
+ *  the surfaces of GetAttributesBetweenSurfaces. With none, every request
+ *  aligns its surfaces by itself.
+ */
+func SetAlignmentThreads(nthreads int) {
+	C.set_alignment_threads(C.size_t(nthreads))
+}
+
 func (v DSHandle) normalizeAttributes(
 	attributes []string,
 ) ([]int, error) {
@@ -208,10 +222,63 @@ func max(a, b int) int {
 	return b
 }
 
+// the size of the data processed in one goroutine
+// decides how many parts data is split into
+// value should be experimented with
+func attributeChunkSize(nrows int) int {
+	return max(nrows, 1)
+}
+
+/** Number of chunks, each computed by its own goroutine, that attributes of
+ *  a surface of nrows x ncols are split into
+ */
+func AttributeChunks(nrows, ncols int) int {
+	chunkSize := attributeChunkSize(nrows)
+	return (nrows*ncols + chunkSize - 1) / chunkSize
+}
+
+/** Scratch memory of fetching the largest nconcurrent of the chunks of
+ *  chunkSize segments that the hsize segments of the subvolume are split
+ *  into
+ */
+func (v DSHandle) fetchScratchSize(
+	cCtx *C.Context,
+	cSubVolume *C.struct_SurfaceBoundedSubVolume,
+	interpolation int,
+	hsize int,
+	chunkSize int,
+	nconcurrent int,
+) (uint64, error) {
+	var sizes []uint64
+	for from := 0; from < hsize; from += chunkSize {
+		var size C.size_t
+		cerr := C.fetch_scratch_size(
+			cCtx,
+			v.DataHandle(),
+			cSubVolume,
+			C.enum_interpolation_method(interpolation),
+			C.size_t(from),
+			C.size_t(min(from+chunkSize, hsize)),
+			&size,
+		)
+		if err := toError(cerr, cCtx); err != nil {
+			return 0, err
+		}
+		sizes = append(sizes, uint64(size))
+	}
+
+	sort.Slice(sizes, func(i, j int) bool { return sizes[i] > sizes[j] })
+	var total uint64
+	for i := 0; i < len(sizes) && i < nconcurrent; i++ {
+		total += sizes[i]
+	}
+	return total, nil
+}
+
+// getAttributes creates the subvolume with newSubVolume and calculates
+// requested attributes for all its segments.
 func (v DSHandle) getAttributes(
-	cReferenceSurface cRegularSurface,
-	cTopSurface cRegularSurface,
-	cBottomSurface cRegularSurface,
+	newSubVolume func(*C.Context, **C.struct_SurfaceBoundedSubVolume) C.int,
 	nrows int,
 	ncols int,
 	targetAttributes []int,
@@ -223,19 +290,16 @@ func (v DSHandle) getAttributes(
 	var cSubVolume *C.struct_SurfaceBoundedSubVolume
 	var cCtx = C.context_new()
 	defer C.context_free(cCtx)
-	cerr := C.subvolume_new(
-		cCtx,
-		v.DataHandle(),
-		cReferenceSurface.get(),
-		cTopSurface.get(),
-		cBottomSurface.get(),
-		&cSubVolume,
-	)
+	cerr := newSubVolume(cCtx, &cSubVolume)
+	v.collectStats(cCtx)
 
 	if err := toError(cerr, cCtx); err != nil {
 		return nil, err
 	}
-	defer C.subvolume_free(cCtx, cSubVolume)
+	defer func() {
+		C.subvolume_free(cCtx, cSubVolume)
+		v.collectStats(cCtx)
+	}()
 
 	cAttributes := make([]C.enum_attribute, len(targetAttributes))
 	for i := range targetAttributes {
@@ -244,21 +308,48 @@ func (v DSHandle) getAttributes(
 
 	nAttributes := len(cAttributes)
 	var mapsize = hsize * 4
-	buffer := make([]byte, mapsize*nAttributes)
-
-	// note that it is possible to hit go's own goroutines limit
-	// but we do not deal with it here
 
 	// max number of goroutines running at the same time
 	// too low number doesn't utilize all CPU, too high overuses it
 	// value should be experimented with
 	maxConcurrentGoroutines := max(nrows/2, 1)
-	guard := make(chan struct{}, maxConcurrentGoroutines)
 
-	// the size of the data processed in one goroutine
-	// decides how many parts data is split into
-	// value should be experimented with
-	chunkSize := max(nrows, 1)
+	chunkSize := attributeChunkSize(nrows)
+
+	/*
+	 * The subvolume, the attribute maps and the scratch buffers of fetching
+	 * the chunks that run at the same time make up the memory of the
+	 * request. The subvolume has only reserved its memory at this point, it
+	 * is filled once data is fetched.
+	 */
+	var subvolumeSize C.size_t
+	cerr = C.subvolume_buffer_size(cCtx, cSubVolume, &subvolumeSize)
+	if err := toError(cerr, cCtx); err != nil {
+		return nil, err
+	}
+	scratch, err := v.fetchScratchSize(
+		cCtx,
+		cSubVolume,
+		interpolation,
+		hsize,
+		chunkSize,
+		maxConcurrentGoroutines,
+	)
+	if err != nil {
+		return nil, err
+	}
+	release, err := v.reserve(
+		uint64(subvolumeSize) + uint64(mapsize*nAttributes) + scratch,
+	)
+	if err != nil {
+		return nil, err
+	}
+	defer release()
+	buffer := make([]byte, mapsize*nAttributes)
+
+	// note that it is possible to hit go's own goroutines limit
+	// but we do not deal with it here
+	guard := make(chan struct{}, maxConcurrentGoroutines)
 
 	from := 0
 	to := from + chunkSize
@@ -284,6 +375,7 @@ func (v DSHandle) getAttributes(
 				C.size_t(to),
 				unsafe.Pointer(&buffer[0]),
 			)
+			v.collectStats(cCtx)
 
 			errs <- toError(cerr_attributes, cCtx)
 			<-guard
@@ -35,8 +35,30 @@ func (v DSHandle) GetFence(
 		}
 	}
 
+	/*
+	 * The response is read into a buffer in C, next to the scratch buffers
+	 * of the read, and then copied into Go once those are freed
+	 */
+	var size C.size_t
+	var scratch C.size_t
+	cerr := C.fence_buffer_size(
+		v.context(),
+		v.DataHandle(),
+		C.size_t(len(coordinates)),
+		&size,
+		&scratch,
+	)
+	if err := v.Error(cerr); err != nil {
+		return nil, err
+	}
+	release, err := v.reserve(responseReservation(size, scratch))
+	if err != nil {
+		return nil, err
+	}
+	defer release()
+
 	var result C.struct_response = C.response_create()
-	cerr := C.fence(
+	cerr = C.fence(
 		v.context(),
 		v.DataHandle(),
 		C.enum_coordinate_system(coordinateSystem),
@@ -46,6 +68,7 @@ func (v DSHandle) GetFence(
 		(*C.float)(fillValue),
 		&result,
 	)
+	v.collectStats(v.context())
 
 	defer C.response_delete(&result)
 
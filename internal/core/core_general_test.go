@@ -1,13 +1,20 @@
 package core
 
 import (
+	"context"
 	"encoding/binary"
 	"errors"
 	"fmt"
 	"math"
+	"net/http/httptest"
+	"os"
+	"path/filepath"
 	"testing"
+	"time"
 
 	"github.com/stretchr/testify/require"
+
+	"github.com/equinor/oneseismic-api/internal/fakeblob"
 )
 
 func make_connection(name string) Connection {
@@ -86,3 +93,362 @@ func TestOnly3DSupported(t *testing.T) {
 
 	require.ErrorContains(t, err, "3 dimensions, got 4")
 }
+
+func TestHandlePoolReusesHandles(t *testing.T) {
+	pool := NewHandlePool(time.Minute, 1, nil)
+	connections := []Connection{well_known}
+
+	first, err := pool.Open(connections, BinaryOperatorNoOperator)
+	require.NoError(t, err)
+	firstMetadata, err := first.GetMetadata()
+	require.NoError(t, err)
+	first.Close()
+
+	second, err := pool.Open(connections, BinaryOperatorNoOperator)
+	require.NoError(t, err)
+	defer second.Close()
+	require.Equal(t, first.DataHandle(), second.DataHandle(),
+		"Expected pooled handle to be reused")
+
+	secondMetadata, err := second.GetMetadata()
+	require.NoError(t, err)
+	require.Equal(t, firstMetadata, secondMetadata)
+
+	other, err := pool.Open([]Connection{samples10}, BinaryOperatorNoOperator)
+	require.NoError(t, err)
+	defer other.Close()
+	require.NotEqual(t, second.DataHandle(), other.DataHandle())
+
+	/*
+	 * The pool only fits one handle, so the first one is evicted but must
+	 * stay valid until the request using it is done.
+	 */
+	_, err = second.GetMetadata()
+	require.NoError(t, err)
+}
+
+func TestHandlePoolChargesBrickIndexToBudget(t *testing.T) {
+	budget := &recordingBudget{}
+	pool := NewHandlePool(time.Minute, 1, budget)
+
+	handle, err := pool.Open([]Connection{well_known}, BinaryOperatorNoOperator)
+	require.NoError(t, err)
+	defer handle.Close()
+	require.Greater(t, budget.reserved, uint64(0))
+
+	/* Handles outside the pool are not indexed */
+	budget.reserved = 0
+	private, err := NewDSHandle(well_known)
+	require.NoError(t, err)
+	defer private.Close()
+	require.Equal(t, uint64(0), budget.reserved)
+}
+
+func TestHandlePoolExpiredHandlesAreNotReused(t *testing.T) {
+	pool := NewHandlePool(0, 1, nil)
+	connections := []Connection{well_known}
+
+	first, err := pool.Open(connections, BinaryOperatorNoOperator)
+	require.NoError(t, err)
+	defer first.Close()
+
+	second, err := pool.Open(connections, BinaryOperatorNoOperator)
+	require.NoError(t, err)
+	defer second.Close()
+
+	require.NotEqual(t, first.DataHandle(), second.DataHandle())
+}
+
+type countingConnection struct {
+	FileConnection
+	authorized bool
+	expiry     time.Time
+	checks     int
+}
+
+func (c *countingConnection) IsAuthorizedToRead() bool {
+	c.checks++
+	return c.authorized
+}
+
+func (c *countingConnection) Expiry() (time.Time, bool) {
+	return c.expiry, !c.expiry.IsZero()
+}
+
+func TestAuthorizationCacheRemembersSuccess(t *testing.T) {
+	cache := NewAuthorizationCache(time.Minute, 10)
+	connection := &countingConnection{authorized: true}
+
+	require.True(t, cache.IsAuthorizedToRead(connection))
+	require.True(t, cache.IsAuthorizedToRead(connection))
+	require.Equal(t, 1, connection.checks)
+}
+
+func TestAuthorizationCacheDoesNotRememberFailure(t *testing.T) {
+	cache := NewAuthorizationCache(time.Minute, 10)
+	connection := &countingConnection{authorized: false}
+
+	require.False(t, cache.IsAuthorizedToRead(connection))
+	connection.authorized = true
+	require.True(t, cache.IsAuthorizedToRead(connection))
+	require.Equal(t, 2, connection.checks)
+}
+
+func TestAuthorizationCacheRespectsTokenExpiry(t *testing.T) {
+	cache := NewAuthorizationCache(time.Minute, 10)
+	connection := &countingConnection{
+		authorized: true,
+		expiry:     time.Now().Add(-time.Second),
+	}
+
+	require.True(t, cache.IsAuthorizedToRead(connection))
+	require.True(t, cache.IsAuthorizedToRead(connection))
+	require.Equal(t, 2, connection.checks)
+}
+
+func TestPooledHandleRemembersAuthorizationUntilExpiry(t *testing.T) {
+	pooled := &pooledHandle{
+		expires:    time.Now().Add(time.Hour),
+		authorized: make(map[string]time.Time),
+	}
+	connection := &countingConnection{
+		authorized: true,
+		expiry:     time.Now().Add(time.Minute),
+	}
+
+	require.True(t, pooled.isAuthorized([]Connection{connection}))
+	require.True(t, pooled.isAuthorized([]Connection{connection}))
+	require.Equal(t, 1, connection.checks)
+
+	connection.expiry = time.Now().Add(-time.Second)
+	pooled.authorized[connection.ConnectionString()] = connection.expiry
+	connection.authorized = false
+	require.False(t, pooled.isAuthorized([]Connection{connection}))
+	require.Equal(t, 2, connection.checks)
+}
+
+func TestPlainHttpOnlyToExplicitAccounts(t *testing.T) {
+	makeConnection := MakeAzureConnection([]string{
+		"https://account.blob.core.windows.net",
+		"http://127.0.0.1:10000",
+	})
+
+	connection, err := makeConnection(
+		"https://account.blob.core.windows.net/container/cube", "sv=1",
+	)
+	require.NoError(t, err)
+	require.Equal(t,
+		"BlobEndpoint=https://account.blob.core.windows.net;SharedAccessSignature=?sv=1",
+		connection.ConnectionString(),
+	)
+
+	_, err = makeConnection(
+		"http://account.blob.core.windows.net/container/cube", "sv=1",
+	)
+	require.IsType(t, &InvalidArgument{}, err)
+
+	connection, err = makeConnection("http://127.0.0.1:10000/container/cube", "sv=1")
+	require.NoError(t, err)
+	require.Equal(t,
+		"BlobEndpoint=http://127.0.0.1:10000;SharedAccessSignature=?sv=1",
+		connection.ConnectionString(),
+	)
+}
+
+func TestAuthorizationAgainstBlobStandIn(t *testing.T) {
+	root := t.TempDir()
+	server := httptest.NewServer(fakeblob.NewServer(root, fakeblob.Faults{}, 1))
+	defer server.Close()
+
+	layout := filepath.Join(root, "container", "cube", "VolumeDataLayout")
+	require.NoError(t, os.MkdirAll(filepath.Dir(layout), 0755))
+	require.NoError(t, os.WriteFile(layout, []byte("{}"), 0644))
+
+	makeConnection := MakeAzureConnection([]string{server.URL})
+
+	connection, err := makeConnection(server.URL+"/container/cube", "sv=1")
+	require.NoError(t, err)
+	require.True(t, connection.IsAuthorizedToRead())
+
+	connection, err = makeConnection(server.URL+"/container/missing", "sv=1")
+	require.NoError(t, err)
+	require.False(t, connection.IsAuthorizedToRead())
+}
+
+func stageNames(stages *Stages) []string {
+	var names []string
+	for _, stage := range stages.Durations() {
+		names = append(names, stage.Name)
+	}
+	return names
+}
+
+func TestStagesAreSummed(t *testing.T) {
+	stages := NewStages()
+	stages.Add("fetch", time.Second)
+	stages.Add("fetch", 2*time.Second)
+	stages.Add("decode", time.Millisecond)
+
+	require.Equal(t, []StageDuration{
+		{Name: "decode", Duration: time.Millisecond},
+		{Name: "fetch", Duration: 3 * time.Second},
+	}, stages.Durations())
+}
+
+func TestStagesAreRecordedByCore(t *testing.T) {
+	handle, err := NewDSHandle(well_known)
+	require.NoError(t, err)
+	defer handle.Close()
+
+	stages := NewStages()
+	handle = handle.WithStages(stages)
+	require.Equal(t, []string{"open"}, stageNames(stages))
+
+	_, err = handle.GetSlice(1, AxisI, []Bound{})
+	require.NoError(t, err)
+	require.Equal(t, []string{"open", "slice"}, stageNames(stages))
+}
+
+func TestResourcePeaksStackOnRetainedBuffers(t *testing.T) {
+	resources := NewResourceStats()
+	/* A subvolume is made, filled with some scratch space, and freed */
+	resources.Add(ResourceUsage{PeakBytes: 100, RetainedBytes: 100, CPUTime: time.Millisecond})
+	resources.Add(ResourceUsage{PeakBytes: 30, CPUTime: 2 * time.Millisecond})
+	resources.Add(ResourceUsage{PeakBytes: 20, CPUTime: 2 * time.Millisecond})
+	resources.Add(ResourceUsage{RetainedBytes: -100})
+	resources.Add(ResourceUsage{PeakBytes: 50})
+
+	require.Equal(t, uint64(130), resources.PeakBytes())
+	require.Equal(t, 5*time.Millisecond, resources.CPUTime())
+}
+
+func TestResourcesAreRecordedByCore(t *testing.T) {
+	handle, err := NewDSHandle(well_known)
+	require.NoError(t, err)
+	defer handle.Close()
+
+	resources := NewResourceStats()
+	handle = handle.WithResourceStats(resources)
+
+	data, err := handle.GetSlice(1, AxisI, []Bound{})
+	require.NoError(t, err)
+	require.GreaterOrEqual(t, resources.PeakBytes(), uint64(len(data)))
+}
+
+/** Budget that grants everything and remembers the largest reservation */
+type recordingBudget struct {
+	reserved uint64
+}
+
+func (b *recordingBudget) Acquire(ctx context.Context, bytes uint64) (func(), error) {
+	if bytes > b.reserved {
+		b.reserved = bytes
+	}
+	return func() {}, nil
+}
+
+func TestReservationsCoverThePeakOfTheCore(t *testing.T) {
+	single, err := NewDSHandle(samples10)
+	require.NoError(t, err)
+	defer single.Close()
+
+	double, err := CreateDSHandle(
+		[]Connection{samples10, samples10},
+		BinaryOperatorAddition,
+	)
+	require.NoError(t, err)
+	defer double.Close()
+
+	interpolation, _ := GetInterpolationMethod("linear")
+	surface := samples10Surface([][]float32{
+		{20, 20},
+		{20, 20},
+		{20, 20},
+	})
+
+	requests := map[string]func(DSHandle) error{
+		"slice": func(handle DSHandle) error {
+			_, err := handle.GetSlice(1, AxisI, []Bound{})
+			return err
+		},
+		"fence": func(handle DSHandle) error {
+			_, err := handle.GetFence(
+				CoordinateSystemIndex,
+				[][]float32{{0, 0}, {1, 1}, {2, 0.5}},
+				interpolation,
+				nil,
+			)
+			return err
+		},
+		"attributes": func(handle DSHandle) error {
+			_, err := handle.GetAttributesAlongSurface(
+				surface,
+				8,
+				8,
+				4,
+				[]string{"min", "max"},
+				interpolation,
+			)
+			return err
+		},
+	}
+
+	handles := map[string]DSHandle{"single": single, "double": double}
+	for handleName, handle := range handles {
+		for name, request := range requests {
+			budget := &recordingBudget{}
+			resources := NewResourceStats()
+			err := request(handle.WithBudget(context.Background(), budget).WithResourceStats(resources))
+			require.NoError(t, err)
+			require.GreaterOrEqualf(t, budget.reserved, resources.PeakBytes(),
+				"[%s %s] Reservation below the measured peak", handleName, name,
+			)
+		}
+	}
+}
+
+func TestReadsAreTimedByCore(t *testing.T) {
+	handle, err := NewDSHandle(well_known)
+	require.NoError(t, err)
+	defer handle.Close()
+
+	io := NewIOStats()
+	handle = handle.WithIOStats(io)
+
+	before := time.Now()
+	_, err = handle.GetSlice(1, AxisI, []Bound{})
+	require.NoError(t, err)
+
+	reads := io.Reads()
+	require.Len(t, reads, int(io.Totals().Requests))
+	require.NotEmpty(t, reads)
+	require.False(t, reads[0].Start.Before(before.Add(-time.Second)))
+	require.Greater(t, reads[0].Chunks, uint64(0))
+}
+
+func TestReadsAreCountedByFetchMethod(t *testing.T) {
+	handle, err := NewDSHandle(well_known)
+	require.NoError(t, err)
+	defer handle.Close()
+
+	io := NewIOStats()
+	handle = handle.WithIOStats(io)
+
+	_, err = handle.GetSlice(1, AxisI, []Bound{})
+	require.NoError(t, err)
+	totals := io.Totals()
+	require.Greater(t, totals.SubcubeRequests, uint64(0))
+	require.Equal(t, totals.Requests, totals.SubcubeRequests)
+
+	interpolation, _ := GetInterpolationMethod("nearest")
+	_, err = handle.GetFence(
+		CoordinateSystemIndex,
+		[][]float32{{0, 0}, {1, 1}},
+		interpolation,
+		nil,
+	)
+	require.NoError(t, err)
+	totals = io.Totals()
+	require.Greater(t, totals.TraceRequests, uint64(0))
+	require.Equal(t, totals.Requests, totals.SubcubeRequests+totals.TraceRequests)
+}
@@ -0,0 +1,78 @@
+package core
+
+/*
+#include <capi.h>
+#include <ctypes.h>
+#include <stdlib.h>
+*/
+import "C"
+
+/** A region of the cube to read into the chunk cache of a handle
+ *
+ * The region is read in slabs, one at a time, such that memory is bounded
+ * and warming a large region can be followed and stopped between slabs.
+ */
+type PrefetchRegion struct {
+	bounds []C.struct_Bound
+	// Number of slabs the region is read in
+	Slabs int
+	// Bytes a single slab is read into
+	SlabSize uint64
+}
+
+func (r PrefetchRegion) cBounds() *C.struct_Bound {
+	if len(r.bounds) == 0 {
+		return nil
+	}
+	return &r.bounds[0]
+}
+
+/** The part of the cube restricted by bounds, the whole cube if there are
+ *  none. Bounds follow the same rules as those of slices.
+ */
+func (v DSHandle) GetPrefetchRegion(bounds []Bound) (PrefetchRegion, error) {
+	cBounds, err := newCSliceBounds(bounds)
+	if err != nil {
+		return PrefetchRegion{}, err
+	}
+	region := PrefetchRegion{bounds: cBounds}
+
+	var slabs, slabSize C.size_t
+	cerr := C.prefetch_slabs(
+		v.context(),
+		v.DataHandle(),
+		region.cBounds(),
+		C.size_t(len(cBounds)),
+		&slabs,
+		&slabSize,
+	)
+	if err := v.Error(cerr); err != nil {
+		return PrefetchRegion{}, err
+	}
+
+	region.Slabs = int(slabs)
+	region.SlabSize = uint64(slabSize)
+	return region, nil
+}
+
+/** Read slab index of the region, such that its chunks are cached by the
+ *  handle. The data itself is dropped.
+ */
+func (v DSHandle) Prefetch(region PrefetchRegion, index int) error {
+	release, err := v.reserve(region.SlabSize)
+	if err != nil {
+		return err
+	}
+	defer release()
+
+	cerr := C.prefetch_slab(
+		v.context(),
+		v.DataHandle(),
+		region.cBounds(),
+		C.size_t(len(region.bounds)),
+		C.size_t(index),
+	)
+	v.collectStats(v.context())
+
+	return v.Error(cerr)
+}
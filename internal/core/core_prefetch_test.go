@@ -0,0 +1,48 @@
+package core
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/require"
+)
+
+func TestPrefetchReadsRegion(t *testing.T) {
+	handle, err := NewDSHandle(well_known)
+	require.NoError(t, err)
+	defer handle.Close()
+
+	io := NewIOStats()
+	handle = handle.WithIOStats(io)
+
+	direction := "i"
+	lower := 0
+	upper := 1
+	bounds := []Bound{{Direction: &direction, Lower: &lower, Upper: &upper}}
+
+	region, err := handle.GetPrefetchRegion(bounds)
+	require.NoError(t, err)
+	require.GreaterOrEqual(t, region.Slabs, 1)
+	require.Greater(t, region.SlabSize, uint64(0))
+
+	for i := 0; i < region.Slabs; i++ {
+		require.NoError(t, handle.Prefetch(region, i))
+	}
+	require.Equal(t, uint64(region.Slabs), io.Totals().SubcubeRequests)
+
+	err = handle.Prefetch(region, region.Slabs)
+	require.Error(t, err)
+}
+
+func TestPrefetchRejectsInvalidBounds(t *testing.T) {
+	handle, err := NewDSHandle(well_known)
+	require.NoError(t, err)
+	defer handle.Close()
+
+	direction := "i"
+	lower := 10
+	upper := 1
+	_, err = handle.GetPrefetchRegion(
+		[]Bound{{Direction: &direction, Lower: &lower, Upper: &upper}},
+	)
+	require.IsType(t, &InvalidArgument{}, err)
+}
@@ -49,7 +49,32 @@ func (v DSHandle) GetSlice(lineno, direction int, bounds []Bound) ([]byte, error
 		bound = &cBounds[0]
 	}
 
-	cerr := C.slice(
+	/*
+	 * The response is read into a buffer in C, next to the scratch buffers
+	 * of the read, and then copied into Go once those are freed
+	 */
+	var size C.size_t
+	var scratch C.size_t
+	cerr := C.slice_buffer_size(
+		v.context(),
+		v.DataHandle(),
+		C.int(lineno),
+		C.enum_axis_name(direction),
+		bound,
+		C.size_t(len(cBounds)),
+		&size,
+		&scratch,
+	)
+	if err := v.Error(cerr); err != nil {
+		return nil, err
+	}
+	release, err := v.reserve(responseReservation(size, scratch))
+	if err != nil {
+		return nil, err
+	}
+	defer release()
+
+	cerr = C.slice(
 		v.context(),
 		v.DataHandle(),
 		C.int(lineno),
@@ -58,6 +83,7 @@ func (v DSHandle) GetSlice(lineno, direction int, bounds []Bound) ([]byte, error
 		C.size_t(len(cBounds)),
 		&result,
 	)
+	v.collectStats(v.context())
 
 	defer C.response_delete(&result)
 	if err := v.Error(cerr); err != nil {
@@ -31,11 +31,80 @@ void fence(
     response* out
 ) noexcept (false);
 
+/**
+ * Size of the buffers that slice and fence read into, i.e. their response
+ * size, and of the scratch buffers they need on top of it while reading.
+ * Computed without reading any data.
+ */
+std::int64_t slice_buffer_size(
+    DataHandle& datahandle,
+    Direction const direction,
+    int lineno,
+    std::vector< Bound > const& bounds
+) noexcept (false);
+
+std::int64_t slice_scratch_size(
+    DataHandle& datahandle,
+    Direction const direction,
+    int lineno,
+    std::vector< Bound > const& bounds
+) noexcept (false);
+
+std::int64_t fence_buffer_size(
+    DataHandle& datahandle,
+    std::size_t npoints
+) noexcept (false);
+
+std::int64_t fence_scratch_size(
+    DataHandle& datahandle,
+    std::size_t npoints
+) noexcept (false);
+
+/**
+ * Read a region of the cube, the whole cube restricted by bounds, such that
+ * its chunks are cached by the datahandle. The region is read in slabs along
+ * the inline axis, one per call to prefetch_slab, which bounds the memory
+ * needed and lets the caller follow progress. prefetch_slabs returns the
+ * number of slabs and the memory needed to read the largest slab.
+ */
+std::size_t prefetch_slabs(
+    DataHandle& datahandle,
+    std::vector< Bound > const& bounds,
+    std::int64_t* slab_size
+) noexcept (false);
+
+void prefetch_slab(
+    DataHandle& datahandle,
+    std::vector< Bound > const& bounds,
+    std::size_t index
+) noexcept (false);
+
+/**
+ * How fetch_subvolume reads the data. AUTOMATIC picks the cheapest method
+ * for the segments, the others force a method, such that the methods can be
+ * compared against each other.
+ */
+enum class FetchMethod { AUTOMATIC, SLAB, TRACES, SAMPLES };
+
 void fetch_subvolume(
     DataHandle& datahandle,
     SurfaceBoundedSubVolume& subvolume,
     enum interpolation_method interpolation,
     std::size_t from,
+    std::size_t to,
+    FetchMethod method = FetchMethod::AUTOMATIC
+) noexcept (false);
+
+/**
+ * Size of the scratch buffers fetch_subvolume needs to read the segments in
+ * range [from, to), on top of the subvolume itself. Computed without reading
+ * any data.
+ */
+std::int64_t fetch_scratch_size(
+    DataHandle& datahandle,
+    SurfaceBoundedSubVolume const& subvolume,
+    enum interpolation_method interpolation,
+    std::size_t from,
     std::size_t to
 ) noexcept (false);
 
@@ -76,6 +145,13 @@ void align_surfaces(
     bool* primary_is_top
 ) noexcept (false);
 
+/**
+ * Set the number of threads align_surfaces may start on top of the calling
+ * threads. The threads are shared by all calls, and calls that find none spare
+ * align their surfaces in the calling thread.
+ */
+void set_alignment_threads(std::size_t nthreads) noexcept (true);
+
 void slice_metadata(
     DataHandle& datahandle,
     Direction const direction,
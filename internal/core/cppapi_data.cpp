@@ -1,8 +1,14 @@
 #include "ctypes.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
+#include <future>
+#include <limits>
 #include <string>
 #include <memory>
+#include <thread>
 
 #include <OpenVDS/OpenVDS.h>
 #include <OpenVDS/KnownMetadata.h>
@@ -10,6 +16,8 @@
 
 #include "attribute.hpp"
 #include "axis.hpp"
+#include "bufferusage.hpp"
+#include "cppapi.hpp"
 #include "datahandle.hpp"
 #include "direction.hpp"
 #include "exceptions.hpp"
@@ -23,12 +31,17 @@ namespace {
 
 void to_response(
     std::unique_ptr< char[] > data,
+    TrackedBuffer tracked,
     std::int64_t const size,
     response* response
 ) {
-    /* The data should *not* be free'd on success, as it's returned to CGO */
+    /*
+     * The data should *not* be free'd on success, as it's returned to CGO.
+     * It is counted as released by response_delete.
+     */
     response->data = data.release();
     response->size = static_cast<unsigned long>(size);
+    tracked.release();
 }
 
 bool equal(const char* lhs, const char* rhs) {
@@ -125,18 +138,411 @@ void append(std::vector< std::unique_ptr< AttributeMap > >& vec, T obj) {
     vec.push_back( std::unique_ptr< T >( new T( std::move(obj) ) ) );
 }
 
-} // namespace
+/**
+ * Whole traces are only read when they are not much longer than the segments
+ * we actually need from them. OpenVDS has no notion of partial traces, so a
+ * trace request always touches every brick along the sample axis. Reading
+ * twice as much as needed is cheap compared to sending one coordinate per
+ * sample, but for narrow windows in deep volumes the extra bricks would
+ * dominate.
+ */
+constexpr std::size_t max_trace_overread_factor = 4;
 
-namespace cppapi {
+/**
+ * The slab is only read when its volume is not much larger than the number of
+ * samples we actually need. Slabs are read with a single subset request, which
+ * maps directly to the bricks in the file, so some overread is fine.
+ */
+constexpr std::size_t max_slab_overread_factor = 4;
 
-void slice(
+/**
+ * Index of the first sample of the segment in the trace
+ */
+long first_sample_index(Axis const& sample, Segment const& segment) {
+    return std::lround(
+        (segment.top_sample_position() - sample.min()) / sample.stepsize()
+    );
+}
+
+/**
+ * Neighbouring voxels and weight needed to interpolate a position along one
+ * horizontal axis. Mirrors the OpenVDS interpolation, where voxel centers are
+ * found at n + 0.5 and positions outside the volume are clamped to the edge.
+ */
+struct Stencil {
+    int lower;
+    int upper;
+    float weight;
+
+    bool aligned() const noexcept (true) {
+        return this->lower == this->upper or this->weight == 0;
+    }
+};
+
+Stencil make_stencil(
+    float position,
+    int nsamples,
+    enum interpolation_method interpolation
+) noexcept (true) {
+    auto clamp = [nsamples](int index) {
+        return std::max(0, std::min(index, nsamples - 1));
+    };
+
+    if (interpolation == NEAREST) {
+        int const index = clamp(int(std::floor(position)));
+        return { index, index, 0 };
+    }
+
+    float const x = position - 0.5f;
+    int const index = int(std::floor(x));
+    return { clamp(index), clamp(index + 1), x - index };
+}
+
+bool supports_slab(enum interpolation_method interpolation) noexcept (true) {
+    return interpolation == NEAREST or interpolation == LINEAR;
+}
+
+/**
+ * Smallest subcube containing every segment in the subvolume in range
+ * [from, to) and all the neighbouring traces needed to interpolate them.
+ */
+SubCube slab_bounds(
+    MetadataHandle const& metadata,
+    SurfaceBoundedSubVolume const& subvolume,
+    std::vector< std::size_t > const& cells,
+    voxel const* traces,
+    enum interpolation_method interpolation
+) {
+    Axis const& iline  = metadata.iline();
+    Axis const& xline  = metadata.xline();
+    Axis const& sample = metadata.sample();
+
+    int ilower = iline.nsamples(),  iupper = 0;
+    int xlower = xline.nsamples(),  xupper = 0;
+    long slower = sample.nsamples(), supper = 0;
+
+    for (std::size_t t = 0; t < cells.size(); ++t) {
+        auto const i = make_stencil(
+            traces[t][iline.dimension()], iline.nsamples(), interpolation
+        );
+        auto const x = make_stencil(
+            traces[t][xline.dimension()], xline.nsamples(), interpolation
+        );
+        ilower = std::min(ilower, i.lower);
+        iupper = std::max(iupper, i.upper + 1);
+        xlower = std::min(xlower, x.lower);
+        xupper = std::max(xupper, x.upper + 1);
+
+        auto const segment = subvolume.vertical_segment(cells[t]);
+        long const first = first_sample_index(sample, segment);
+        slower = std::min(slower, first);
+        supper = std::max(supper, first + long(segment.size()));
+    }
+
+    SubCube slab(metadata);
+    slab.bounds.lower[iline.dimension()]  = ilower;
+    slab.bounds.upper[iline.dimension()]  = iupper;
+    slab.bounds.lower[xline.dimension()]  = xlower;
+    slab.bounds.upper[xline.dimension()]  = xupper;
+    slab.bounds.lower[sample.dimension()] = std::max(0L, slower);
+    slab.bounds.upper[sample.dimension()] = std::min(long(sample.nsamples()), supper);
+    return slab;
+}
+
+std::size_t volume(SubCube const& subcube) noexcept (true) {
+    std::size_t size = 1;
+    for (int d = 0; d < OpenVDS::Dimensionality_Max; ++d) {
+        size *= subcube.bounds.upper[d] - subcube.bounds.lower[d];
+    }
+    return size;
+}
+
+/**
+ * Read all segments in the subvolume in range [from, to) from one slab of the
+ * volume and interpolate them horizontally locally. Segments that fall on
+ * the traces in the file are copied as is.
+ */
+void fetch_slab(
     DataHandle& datahandle,
+    SurfaceBoundedSubVolume& subvolume,
+    std::vector< std::size_t > const& cells,
+    voxel const* traces,
+    SubCube const& slab,
+    enum interpolation_method interpolation,
+    std::size_t from
+) {
+    MetadataHandle const& metadata = datahandle.get_metadata();
+    Axis const& iline  = metadata.iline();
+    Axis const& xline  = metadata.xline();
+    Axis const& sample = metadata.sample();
+
+    auto const& lower = slab.bounds.lower;
+    auto const& upper = slab.bounds.upper;
+
+    /* Subset buffers are laid out with dimension 0 moving the fastest */
+    std::int64_t stride[OpenVDS::Dimensionality_Max] = { 1 };
+    for (int d = 1; d < OpenVDS::Dimensionality_Max; ++d) {
+        stride[d] = stride[d - 1] * (upper[d - 1] - lower[d - 1]);
+    }
+
+    std::int64_t const size = datahandle.subcube_buffer_size(slab);
+    std::unique_ptr< float[] > buffer(new float[size / sizeof(float)]);
+    TrackedBuffer const tracked(size);
+    datahandle.read_subcube(buffer.get(), size, slab);
+
+    std::int64_t const step = stride[sample.dimension()];
+    auto column = [&](int i, int x, long k) {
+        return buffer.get()
+            + (i - lower[iline.dimension()])  * stride[iline.dimension()]
+            + (x - lower[xline.dimension()])  * stride[xline.dimension()]
+            + (k - lower[sample.dimension()]) * step;
+    };
+
+    float* dst = subvolume.data(from);
+    for (std::size_t t = 0; t < cells.size(); ++t) {
+        auto const segment = subvolume.vertical_segment(cells[t]);
+        std::size_t const n = segment.size();
+        long const k = first_sample_index(sample, segment);
+        if (k < lower[sample.dimension()] or
+            k + long(n) > upper[sample.dimension()]) {
+            throw std::runtime_error(
+                "segment at position " + std::to_string(cells[t]) +
+                " is outside of the slab"
+            );
+        }
+
+        auto const i = make_stencil(
+            traces[t][iline.dimension()], iline.nsamples(), interpolation
+        );
+        auto const x = make_stencil(
+            traces[t][xline.dimension()], xline.nsamples(), interpolation
+        );
+
+        if (i.aligned() and x.aligned()) {
+            float const* src = column(i.lower, x.lower, k);
+            for (std::size_t s = 0; s < n; ++s) dst[s] = src[s * step];
+        } else {
+            float const* a = column(i.lower, x.lower, k);
+            float const* b = column(i.lower, x.upper, k);
+            float const* c = column(i.upper, x.lower, k);
+            float const* d = column(i.upper, x.upper, k);
+
+            float const w00 = (1 - i.weight) * (1 - x.weight);
+            float const w01 = (1 - i.weight) * x.weight;
+            float const w10 = i.weight * (1 - x.weight);
+            float const w11 = i.weight * x.weight;
+            for (std::size_t s = 0; s < n; ++s) {
+                std::int64_t const o = s * step;
+                dst[s] = w00 * a[o] + w01 * b[o] + w10 * c[o] + w11 * d[o];
+            }
+        }
+        dst += n;
+    }
+}
+
+/**
+ * Read all segments in the subvolume in range [from, to) as runs of whole
+ * traces, one trace per non-empty horizontal position. Horizontal
+ * interpolation is done once per trace. Vertically the segments are aligned
+ * with the samples in the file, so each segment is a plain copy out of its
+ * trace.
+ */
+void fetch_trace_runs(
+    DataHandle& datahandle,
+    SurfaceBoundedSubVolume& subvolume,
+    std::vector< std::size_t > const& cells,
+    voxel const* traces,
+    enum interpolation_method interpolation,
+    std::size_t from
+) {
+    MetadataHandle const& metadata = datahandle.get_metadata();
+    Axis const& sample = metadata.sample();
+    std::size_t const trace_length = sample.nsamples();
+
+    std::int64_t const size = datahandle.traces_buffer_size(cells.size());
+    std::unique_ptr< float[] > buffer(new float[size / sizeof(float)]);
+    TrackedBuffer const tracked(size);
+
+    datahandle.read_traces(
+        buffer.get(),
+        size,
+        traces,
+        cells.size(),
+        interpolation
+    );
+
+    float* dst = subvolume.data(from);
+    for (std::size_t t = 0; t < cells.size(); ++t) {
+        auto segment = subvolume.vertical_segment(cells[t]);
+
+        long const start = first_sample_index(sample, segment);
+        if (start < 0 or start + segment.size() > trace_length) {
+            throw std::runtime_error(
+                "segment at position " + std::to_string(cells[t]) +
+                " is outside of the trace"
+            );
+        }
+
+        float const* src = buffer.get() + t * trace_length + start;
+        std::copy(src, src + segment.size(), dst);
+        dst += segment.size();
+    }
+}
+
+/**
+ * Read all segments in the subvolume in range [from, to) sample by sample.
+ * Used when the segments are short compared to the traces, in which case
+ * reading full traces would fetch a lot of data we have no use for.
+ */
+void fetch_samples(
+    DataHandle& datahandle,
+    SurfaceBoundedSubVolume& subvolume,
+    std::vector< std::size_t > const& cells,
+    voxel const* traces,
+    enum interpolation_method interpolation,
+    std::size_t from,
+    std::size_t nsamples
+) {
+    MetadataHandle const& metadata = datahandle.get_metadata();
+    auto sample = metadata.sample();
+
+    std::unique_ptr< voxel[] > samples(new voxel[nsamples]{{0}});
+
+    std::size_t cur = 0;
+    for (std::size_t t = 0; t < cells.size(); ++t) {
+        auto segment = subvolume.vertical_segment(cells[t]);
+
+        double k = sample.to_sample_position(segment.top_sample_position());
+        for (int idx = 0; idx < segment.size(); ++idx) {
+            std::copy(std::begin(traces[t]), std::end(traces[t]), samples[cur]);
+            samples[cur][ sample.dimension() ] = k + idx;
+            ++cur;
+        }
+    }
+
+    if (cur != nsamples){
+        throw std::runtime_error("calculated nsamples " + std::to_string(nsamples) +
+                                 " and actual samples " + std::to_string(cur) + " differ");
+    }
+
+    auto const size = datahandle.samples_buffer_size(nsamples);
+
+    datahandle.read_samples(
+        subvolume.data(from),
+        size,
+        samples.get(),
+        nsamples,
+        interpolation
+    );
+}
+
+/**
+ * How the segments of a subvolume in range [from, to) are read, as picked by
+ * plan_fetch. Shared by the fetch and the estimate of its memory, such that
+ * both agree on the buffers needed.
+ */
+struct FetchPlan {
+    enum Method { NOTHING, SLAB, TRACES, SAMPLES };
+
+    Method method;
+    /* Non-empty cells and their horizontal voxel positions */
+    std::vector< std::size_t > cells;
+    std::unique_ptr< voxel[] > traces;
+    /* The slab to read, only meaningful for SLAB */
+    SubCube slab;
+    std::size_t nsamples;
+};
+
+/**
+ * Pick the cheapest way of reading the data: a single slab containing all
+ * the segments, runs of whole traces or, as the last resort, individual
+ * samples. Any method but AUTOMATIC is used as is.
+ */
+FetchPlan plan_fetch(
+    MetadataHandle const& metadata,
+    SurfaceBoundedSubVolume const& subvolume,
+    enum interpolation_method interpolation,
+    std::size_t from,
+    std::size_t to,
+    cppapi::FetchMethod method = cppapi::FetchMethod::AUTOMATIC
+) {
+    auto const horizontal_grid = subvolume.horizontal_grid();
+    if (to > horizontal_grid.size()){
+        throw std::invalid_argument("'to' must be less than surface size");
+    }
+
+    Axis const& iline  = metadata.iline();
+    Axis const& xline  = metadata.xline();
+    Axis const& sample = metadata.sample();
+
+    FetchPlan plan{ FetchPlan::NOTHING, {}, nullptr, SubCube(metadata), 0 };
+    plan.nsamples = subvolume.nsamples(from, to);
+    if (plan.nsamples == 0){
+        return plan;
+    }
+
+    plan.cells.reserve(to - from);
+    for (std::size_t i = from; i < to; ++i) {
+        if (not subvolume.is_empty(i)) plan.cells.push_back(i);
+    }
+
+    plan.traces.reset(new voxel[plan.cells.size()]{{0}});
+    for (std::size_t t = 0; t < plan.cells.size(); ++t) {
+        auto const& position = subvolume.horizontal_position(plan.cells[t]);
+
+        plan.traces[t][ iline.dimension() ] = position[0];
+        plan.traces[t][ xline.dimension() ] = position[1];
+    }
+
+    switch (method) {
+        case cppapi::FetchMethod::AUTOMATIC:
+            break;
+        case cppapi::FetchMethod::SLAB:
+            if (not supports_slab(interpolation)) {
+                throw std::invalid_argument(
+                    "Slabs can not be read with the requested interpolation"
+                );
+            }
+            plan.slab = slab_bounds(
+                metadata, subvolume, plan.cells, plan.traces.get(), interpolation
+            );
+            plan.method = FetchPlan::SLAB;
+            return plan;
+        case cppapi::FetchMethod::TRACES:
+            plan.method = FetchPlan::TRACES;
+            return plan;
+        case cppapi::FetchMethod::SAMPLES:
+            plan.method = FetchPlan::SAMPLES;
+            return plan;
+    }
+
+    if (supports_slab(interpolation)) {
+        plan.slab = slab_bounds(
+            metadata, subvolume, plan.cells, plan.traces.get(), interpolation
+        );
+        if (volume(plan.slab) <= max_slab_overread_factor * plan.nsamples) {
+            plan.method = FetchPlan::SLAB;
+            return plan;
+        }
+    }
+
+    if (plan.cells.size() * sample.nsamples() <= max_trace_overread_factor * plan.nsamples) {
+        plan.method = FetchPlan::TRACES;
+    } else {
+        plan.method = FetchPlan::SAMPLES;
+    }
+    return plan;
+}
+
+/**
+ * The part of the cube covered by the requested slice.
+ */
+SubCube slice_subcube(
+    MetadataHandle const& metadata,
     Direction const direction,
     int lineno,
-    std::vector< Bound > const& slicebounds,
-    response* out
+    std::vector< Bound > const& slicebounds
 ) {
-    MetadataHandle const& metadata = datahandle.get_metadata();
     Axis const& axis = metadata.get_axis(direction);
 
     if (direction.is_sample()) {
@@ -151,13 +557,68 @@ void slice(
     SubCube bounds(metadata);
     bounds.constrain(metadata, slicebounds);
     bounds.set_slice(axis, lineno, direction.coordinate_system());
+    return bounds;
+}
+
+/** Max number of bytes a single slab reads when prefetching a region */
+constexpr std::int64_t max_prefetch_slab_bytes = 64 * 1024 * 1024;
+
+/**
+ * The part of the cube to prefetch, which is the whole cube unless
+ * restricted by bounds.
+ */
+SubCube prefetch_region(
+    MetadataHandle const& metadata,
+    std::vector< Bound > const& bounds
+) {
+    for (auto const& bound : bounds) {
+        validate_vertical_axis(metadata.sample(), Direction(bound.name));
+    }
+
+    SubCube region(metadata);
+    region.constrain(metadata, bounds);
+    return region;
+}
+
+/**
+ * Number of inlines per slab of the region, such that a slab reads at most
+ * max_prefetch_slab_bytes, but always at least one line.
+ */
+int prefetch_slab_lines(
+    MetadataHandle const& metadata,
+    SubCube const& region
+) {
+    int const dimension = metadata.iline().dimension();
+    std::int64_t const nlines =
+        region.bounds.upper[dimension] - region.bounds.lower[dimension];
+    std::int64_t const line_bytes = volume(region) / nlines * sizeof(float);
+    return std::max< std::int64_t >(
+        1,
+        std::min(nlines, max_prefetch_slab_bytes / line_bytes)
+    );
+}
+
+} // namespace
+
+namespace cppapi {
+
+void slice(
+    DataHandle& datahandle,
+    Direction const direction,
+    int lineno,
+    std::vector< Bound > const& slicebounds,
+    response* out
+) {
+    MetadataHandle const& metadata = datahandle.get_metadata();
+    SubCube const bounds = slice_subcube(metadata, direction, lineno, slicebounds);
 
     std::int64_t const size = datahandle.subcube_buffer_size(bounds);
 
     std::unique_ptr<char[]> data(new char[size]);
+    TrackedBuffer tracked(size);
     datahandle.read_subcube(data.get(), size, bounds);
 
-    return to_response(std::move(data), size, out);
+    return to_response(std::move(data), std::move(tracked), size, out);
 }
 
 void fence(
@@ -175,30 +636,44 @@ void fence(
 
     std::unique_ptr< voxel[] > coords(new voxel[npoints]{{0}});
 
+    /*
+     * All points are transformed to annotation in one go, which spares us a
+     * virtual call per point in the transformer
+     */
+    std::vector< Point > annotations(npoints);
+    for (size_t i = 0; i < npoints; i++) {
+        annotations[i] = { coordinates[2 * i], coordinates[2 * i + 1] };
+    }
+
     CoordinateTransformer const& coordinate_transformer = metadata.coordinate_transformer();
-    auto transform_coordinate = [&] (const float x, const float y) {
-        switch (coordinate_system) {
-            case INDEX:
-                return coordinate_transformer.IJKPositionToAnnotation({x, y, 0});
-            case ANNOTATION:
-                return OpenVDS::Vector<double, 3> {x, y, 0};
-            case CDP:
-                return coordinate_transformer.WorldToAnnotation({x, y, 0});
-            default: {
-                throw std::runtime_error("Unhandled coordinate system");
-            }
+    switch (coordinate_system) {
+        case INDEX:
+            coordinate_transformer.ijk_position_to_annotation(
+                annotations.data(), npoints, annotations.data()
+            );
+            break;
+        case ANNOTATION:
+            break;
+        case CDP:
+            coordinate_transformer.world_to_annotation(
+                annotations.data(), npoints, annotations.data()
+            );
+            break;
+        default: {
+            throw std::runtime_error("Unhandled coordinate system");
         }
-    };
+    }
+
     Axis inline_axis    = metadata.iline();
     Axis crossline_axis = metadata.xline();
     Axis samples_axis   = metadata.sample();
     auto nsamples       = samples_axis.nsamples();
 
     for (size_t i = 0; i < npoints; i++) {
-        const float x = *(coordinates++);
-        const float y = *(coordinates++);
+        const float x = coordinates[2 * i];
+        const float y = coordinates[2 * i + 1];
 
-        auto coordinate = transform_coordinate(x, y);
+        const double coordinate[] = { annotations[i].x, annotations[i].y };
 
         auto validate_boundary = [&] (const int voxel, Axis const& axis) {
             if (!axis.inrange_with_margin(coordinate[voxel])) {
@@ -225,6 +700,7 @@ void fence(
     std::int64_t const size = datahandle.traces_buffer_size(npoints);
 
     std::unique_ptr< char[] > data(new char[size]);
+    TrackedBuffer tracked(size);
 
     datahandle.read_traces(
         data.get(),
@@ -236,74 +712,173 @@ void fence(
     if (!noval_indicies.empty()){
             write_fillvalue(data.get(), noval_indicies, nsamples, *fillValue);
     }
-    return to_response(std::move(data), size, out);
+    return to_response(std::move(data), std::move(tracked), size, out);
 }
 
 
-void fetch_subvolume(
+std::int64_t slice_buffer_size(
     DataHandle& datahandle,
-    SurfaceBoundedSubVolume& subvolume,
-    enum interpolation_method interpolation,
-    std::size_t from,
-    std::size_t to
+    Direction const direction,
+    int lineno,
+    std::vector< Bound > const& slicebounds
 ) {
-    auto const horizontal_grid = subvolume.horizontal_grid();
-    if (to > horizontal_grid.size()){
-        throw std::invalid_argument("'to' must be less than surface size");
-    }
+    MetadataHandle const& metadata = datahandle.get_metadata();
+    SubCube const bounds = slice_subcube(metadata, direction, lineno, slicebounds);
+    return datahandle.subcube_buffer_size(bounds);
+}
 
+std::int64_t slice_scratch_size(
+    DataHandle& datahandle,
+    Direction const direction,
+    int lineno,
+    std::vector< Bound > const& slicebounds
+) {
     MetadataHandle const& metadata = datahandle.get_metadata();
-    CoordinateTransformer const& transform = metadata.coordinate_transformer();
+    SubCube const bounds = slice_subcube(metadata, direction, lineno, slicebounds);
+    return datahandle.subcube_scratch_size(bounds);
+}
 
-    auto iline  = metadata.iline ();
-    auto xline  = metadata.xline();
-    auto sample = metadata.sample();
+std::int64_t fence_buffer_size(
+    DataHandle& datahandle,
+    std::size_t npoints
+) {
+    return datahandle.traces_buffer_size(npoints);
+}
 
-    std::size_t const nsamples = subvolume.nsamples(from, to);
-    if (nsamples == 0){
-        return;
-    }
-    std::unique_ptr< voxel[] > samples(new voxel[nsamples]{{0}});
+std::int64_t fence_scratch_size(
+    DataHandle& datahandle,
+    std::size_t npoints
+) {
+    /* The positions of the points, as annotation and as voxels */
+    std::int64_t const positions = npoints * (sizeof(Point) + sizeof(voxel));
+    return positions + datahandle.traces_scratch_size(npoints);
+}
 
-    std::size_t cur = 0;
-    for (int i = from; i < to; ++i) {
-        if (subvolume.is_empty(i)) {
-            continue;
-        }
+std::size_t prefetch_slabs(
+    DataHandle& datahandle,
+    std::vector< Bound > const& bounds,
+    std::int64_t* slab_size
+) {
+    MetadataHandle const& metadata = datahandle.get_metadata();
+    SubCube const region = prefetch_region(metadata, bounds);
+    int const lines = prefetch_slab_lines(metadata, region);
 
-        auto segment = subvolume.vertical_segment(i);
+    int const dimension = metadata.iline().dimension();
+    int const nlines =
+        region.bounds.upper[dimension] - region.bounds.lower[dimension];
 
-        auto const cdp = horizontal_grid.to_cdp(i);
-        auto ij = transform.WorldToAnnotation({cdp.x, cdp.y, 0});
+    SubCube slab = region;
+    slab.bounds.upper[dimension] = slab.bounds.lower[dimension] + lines;
+    *slab_size = datahandle.subcube_buffer_size(slab)
+        + datahandle.subcube_scratch_size(slab);
 
-        ij[0]  = iline.to_sample_position(ij[0]);
-        ij[1]  = xline.to_sample_position(ij[1]);
+    return (nlines + lines - 1) / lines;
+}
 
-        double k = sample.to_sample_position(segment.top_sample_position());
-        for (int idx = 0; idx < segment.size(); ++idx) {
-            samples[cur][  iline.dimension() ] = ij[0];
-            samples[cur][  xline.dimension() ] = ij[1];
-            samples[cur][ sample.dimension() ] = k + idx;
-            ++cur;
-        }
+void prefetch_slab(
+    DataHandle& datahandle,
+    std::vector< Bound > const& bounds,
+    std::size_t index
+) {
+    MetadataHandle const& metadata = datahandle.get_metadata();
+    SubCube const region = prefetch_region(metadata, bounds);
+    int const lines = prefetch_slab_lines(metadata, region);
+
+    int const dimension = metadata.iline().dimension();
+    int const nlines =
+        region.bounds.upper[dimension] - region.bounds.lower[dimension];
+    if (index >= std::size_t((nlines + lines - 1) / lines)) {
+        throw std::invalid_argument("Prefetch slab out of range");
     }
 
-    if (cur != nsamples){
-        throw std::runtime_error("calculated nsamples " + std::to_string(nsamples) +
-                                 " and actual samples " + std::to_string(cur) + " differ");
-    }
+    SubCube slab = region;
+    slab.bounds.lower[dimension] = region.bounds.lower[dimension] + index * lines;
+    slab.bounds.upper[dimension] = std::min(
+        slab.bounds.lower[dimension] + lines,
+        region.bounds.upper[dimension]
+    );
 
-    auto const size = datahandle.samples_buffer_size(nsamples);
+    /* The data itself is thrown away, what matters is that it is cached */
+    std::int64_t const size = datahandle.subcube_buffer_size(slab);
+    std::unique_ptr< char[] > buffer(new char[size]);
+    TrackedBuffer const tracked(size);
+    datahandle.read_subcube(buffer.get(), size, slab);
+}
 
-    datahandle.read_samples(
-        subvolume.data(from),
-        size,
-        samples.get(),
-        nsamples,
-        interpolation
+void fetch_subvolume(
+    DataHandle& datahandle,
+    SurfaceBoundedSubVolume& subvolume,
+    enum interpolation_method interpolation,
+    std::size_t from,
+    std::size_t to,
+    FetchMethod method
+) {
+    MetadataHandle const& metadata = datahandle.get_metadata();
+    FetchPlan const plan = plan_fetch(
+        metadata, subvolume, interpolation, from, to, method
     );
+
+    switch (plan.method) {
+        case FetchPlan::NOTHING:
+            return;
+        case FetchPlan::SLAB:
+            return fetch_slab(
+                datahandle,
+                subvolume,
+                plan.cells,
+                plan.traces.get(),
+                plan.slab,
+                interpolation,
+                from
+            );
+        case FetchPlan::TRACES:
+            return fetch_trace_runs(
+                datahandle, subvolume, plan.cells, plan.traces.get(), interpolation, from
+            );
+        case FetchPlan::SAMPLES:
+            return fetch_samples(
+                datahandle,
+                subvolume,
+                plan.cells,
+                plan.traces.get(),
+                interpolation,
+                from,
+                plan.nsamples
+            );
+    }
 }
 
+std::int64_t fetch_scratch_size(
+    DataHandle& datahandle,
+    SurfaceBoundedSubVolume const& subvolume,
+    enum interpolation_method interpolation,
+    std::size_t from,
+    std::size_t to
+) {
+    MetadataHandle const& metadata = datahandle.get_metadata();
+    FetchPlan const plan = plan_fetch(metadata, subvolume, interpolation, from, to);
+
+    std::size_t const ncells = plan.cells.size();
+    std::int64_t const positions = ncells * (sizeof(std::size_t) + sizeof(voxel));
+    switch (plan.method) {
+        case FetchPlan::NOTHING:
+            return 0;
+        case FetchPlan::SLAB:
+            return positions
+                + datahandle.subcube_buffer_size(plan.slab)
+                + datahandle.subcube_scratch_size(plan.slab);
+        case FetchPlan::TRACES:
+            return positions
+                + datahandle.traces_buffer_size(ncells)
+                + datahandle.traces_scratch_size(ncells);
+        case FetchPlan::SAMPLES:
+            /* Samples are read straight into the subvolume */
+            return positions
+                + plan.nsamples * sizeof(voxel)
+                + datahandle.samples_scratch_size(plan.nsamples);
+    }
+    throw std::runtime_error("Unhandled fetch method");
+}
 
 void attributes(
     SurfaceBoundedSubVolume const& src_subvolume,
@@ -349,28 +924,147 @@ void attributes(
 
 namespace {
 
-struct SurfacesCrossoverValidator {
-    // assuming that samples axis in the file has positive increasing values
-    bool have_crossed(float primary, float secondary) {
-        if (primary > secondary) {
-            this->primary_is_bottom = true;
-        } else if (primary < secondary) {
-            this->primary_is_top = true;
-        } else { //primary == secondary
-            return false;
-        }
-        return this->primary_is_top == this->primary_is_bottom;
+/**
+ * Surfaces below this size are aligned in the calling thread, as spawning
+ * threads would cost more than it saves.
+ */
+constexpr std::size_t min_cells_per_alignment_task = 1 << 16;
+
+/**
+ * Threads that align_surfaces may start on top of the calling threads,
+ * shared by all requests. Requests already run concurrently, so by default
+ * every request aligns its surfaces by itself.
+ */
+std::atomic< std::size_t > spare_alignment_threads{0};
+
+/**
+ * Up to wanted spare alignment threads, handed back when the object dies.
+ * Never waits, callers make do with what is spare.
+ */
+class AlignmentThreads {
+public:
+    explicit AlignmentThreads(std::size_t wanted) noexcept (true) {
+        std::size_t spare = spare_alignment_threads.load();
+        do {
+            this->m_count = std::min(wanted, spare);
+        } while (not spare_alignment_threads.compare_exchange_weak(
+            spare, spare - this->m_count
+        ));
     }
 
-    bool is_primary_top() {
-        return this->primary_is_top;
+    AlignmentThreads(AlignmentThreads const&) = delete;
+    AlignmentThreads& operator=(AlignmentThreads const&) = delete;
+
+    ~AlignmentThreads() {
+        spare_alignment_threads += this->m_count;
+    }
+
+    std::size_t count() const noexcept (true) {
+        return this->m_count;
     }
 
 private:
-    bool primary_is_top = false;
-    bool primary_is_bottom = false;
+    std::size_t m_count;
 };
 
+/**
+ * Indices of the first cells in a range of the primary surface where the
+ * primary surface is found above and below the secondary one, if any.
+ *
+ * Assumes that samples axis in the file has positive increasing values.
+ */
+struct CrossoverCandidates {
+    static constexpr std::size_t none = std::numeric_limits< std::size_t >::max();
+
+    std::size_t first_top    = none;
+    std::size_t first_bottom = none;
+
+    void merge(CrossoverCandidates const& other) noexcept (true) {
+        this->first_top    = std::min(this->first_top,    other.first_top);
+        this->first_bottom = std::min(this->first_bottom, other.first_bottom);
+    }
+
+    bool have_crossed() const noexcept (true) {
+        return this->first_top != none and this->first_bottom != none;
+    }
+
+    /** The cell where the serial walk over the surface finds the crossover */
+    std::size_t crossover() const noexcept (true) {
+        return std::max(this->first_top, this->first_bottom);
+    }
+};
+
+/**
+ * Align rows [row_from, row_to) of the primary surface. to_secondary maps
+ * primary grid positions to secondary grid positions and is evaluated from
+ * the start of each row.
+ */
+CrossoverCandidates align_rows(
+    RegularSurface const& primary,
+    RegularSurface const& secondary,
+    RegularSurface& aligned,
+    AffineTransformation const& to_secondary,
+    std::size_t row_from,
+    std::size_t row_to
+) {
+    CrossoverCandidates candidates;
+
+    BoundedGrid const& primary_grid = primary.grid();
+    BoundedGrid const& secondary_grid = secondary.grid();
+    std::size_t const ncols = primary_grid.ncols();
+
+    Point const origin = to_secondary * Point{0, 0};
+    Point const next = to_secondary * Point{0, 1};
+    Point const step = { next.x - origin.x, next.y - origin.y };
+
+    std::vector< double > xs(ncols);
+    std::vector< double > ys(ncols);
+    for (std::size_t row = row_from; row < row_to; ++row) {
+        Point const start = to_secondary * Point{double(row), 0};
+        for (std::size_t col = 0; col < ncols; ++col) {
+            xs[col] = start.x + col * step.x;
+            ys[col] = start.y + col * step.y;
+        }
+
+        for (std::size_t col = 0; col < ncols; ++col) {
+            std::size_t const i = row * ncols + col;
+
+            if (primary.fillvalue() == primary[i]) {
+                aligned[i] = aligned.fillvalue();
+                continue;
+            }
+            // calculated value can be out of bounds, also negative
+            auto secondary_row = std::lround(xs[col]);
+            auto secondary_col = std::lround(ys[col]);
+
+            if (secondary_row < 0 || secondary_row >= secondary_grid.nrows() ||
+                (secondary_col < 0 || secondary_col >= secondary_grid.ncols()))
+            {
+                aligned[i] = aligned.fillvalue();
+                continue;
+            }
+
+            auto secondary_value = secondary[as_pair(secondary_row, secondary_col)];
+
+            if(secondary.fillvalue() == secondary_value) {
+                aligned[i] = aligned.fillvalue();
+                continue;
+            }
+
+            aligned[i] = secondary_value;
+
+            if (primary[i] < secondary_value and candidates.first_top == CrossoverCandidates::none) {
+                candidates.first_top = i;
+            } else if (primary[i] > secondary_value and candidates.first_bottom == CrossoverCandidates::none) {
+                candidates.first_bottom = i;
+            }
+        }
+        /* Nothing later in the range can move the crossover point */
+        if (candidates.have_crossed()) break;
+    }
+    return candidates;
+}
+
 } //namespace
 
 void align_surfaces(
@@ -384,44 +1078,53 @@ void align_surfaces(
             "Expected primary and aligned surfaces to differ in data only.");
     }
 
-    SurfacesCrossoverValidator surfaces;
-
-    for (std::size_t i = 0; i < primary.size(); ++i) {
-        if (primary.fillvalue() == primary[i]) {
-            aligned[i] = aligned.fillvalue();
-            continue;
-        }
-        auto secondary_pos = secondary.grid().from_cdp(primary.grid().to_cdp(i));
-        // calculated value can be out of bounds, also negative
-        auto secondary_row = std::lround(secondary_pos.x);
-        auto secondary_col = std::lround(secondary_pos.y);
-
-        if (secondary_row < 0 || secondary_row >= secondary.grid().nrows() ||
-            (secondary_col < 0 || secondary_col >= secondary.grid().ncols()))
-        {
-            aligned[i] = aligned.fillvalue();
-            continue;
-        }
-
-        auto secondary_value = secondary[as_pair(secondary_row, secondary_col)];
-
-        if(secondary.fillvalue() == secondary_value) {
-            aligned[i] = aligned.fillvalue();
-            continue;
-        }
+    /*
+     * Primary grid position -> world -> secondary grid position, composed
+     * into a single map
+     */
+    AffineTransformation const to_secondary =
+        secondary.grid().m_inverse_transformation * primary.grid().m_transformation;
+
+    std::size_t const nrows = primary.grid().nrows();
+    std::size_t const wanted = std::max< std::size_t >(1, std::min< std::size_t >({
+        primary.size() / min_cells_per_alignment_task,
+        nrows
+    }));
+    /* Declared before the tasks, such that the threads are handed back only
+     * after the tasks are done */
+    AlignmentThreads const threads(wanted - 1);
+    std::size_t const ntasks = threads.count() + 1;
+    std::size_t const rows_per_task = (nrows + ntasks - 1) / ntasks;
+
+    auto align = [&](std::size_t task) {
+        std::size_t const from = std::min(nrows, task * rows_per_task);
+        std::size_t const to   = std::min(nrows, from + rows_per_task);
+        return align_rows(primary, secondary, aligned, to_secondary, from, to);
+    };
 
-        aligned[i] = secondary_value;
+    std::vector< std::future< CrossoverCandidates > > tasks;
+    for (std::size_t task = 1; task < ntasks; ++task) {
+        tasks.push_back(std::async(std::launch::async, align, task));
+    }
 
-        if (surfaces.have_crossed(primary[i], aligned[i])) {
-            std::size_t row = primary.grid().row(i);
-            std::size_t col = primary.grid().col(i);
-            throw detail::bad_request("Surfaces intersect at primary surface point ("
-                                        + std::to_string(row) + ", "
-                                        + std::to_string(col) + ")");
-        }
+    CrossoverCandidates candidates = align(0);
+    for (auto& task : tasks) {
+        candidates.merge(task.get());
+    }
 
+    if (candidates.have_crossed()) {
+        std::size_t const i = candidates.crossover();
+        std::size_t row = primary.grid().row(i);
+        std::size_t col = primary.grid().col(i);
+        throw detail::bad_request("Surfaces intersect at primary surface point ("
+                                    + std::to_string(row) + ", "
+                                    + std::to_string(col) + ")");
     }
-    *primary_is_top = surfaces.is_primary_top();
+    *primary_is_top = candidates.first_top != CrossoverCandidates::none;
+}
+
+void set_alignment_threads(std::size_t nthreads) noexcept (true) {
+    spare_alignment_threads = nthreads;
 }
 
 } // namespace cppapi
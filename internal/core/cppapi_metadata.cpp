@@ -9,6 +9,7 @@
 #include "axis.hpp"
 #include "axis_type.hpp"
 #include "boundingbox.hpp"
+#include "bufferusage.hpp"
 #include "datahandle.hpp"
 #include "direction.hpp"
 #include "exceptions.hpp"
@@ -41,6 +42,8 @@ void to_response(nlohmann::json const& metadata, response* response) {
 
     response->data = tmp.release();
     response->size = dump.size();
+    /* Counted as released by response_delete */
+    buffers_allocated(dump.size());
 }
 
 nlohmann::json json_axis(
@@ -68,4 +68,45 @@ struct Bound {
     enum axis_name name;
 };
 
+/** Storage reads done on behalf of a request
+ *
+ * chunks counts the VDS chunks the reads touch, and chunk_bytes their
+ * decoded size. read_seconds is the time spent waiting for OpenVDS to
+ * complete the reads. The requests are split by how they fetch data:
+ * subcubes (slabs of the volume), whole traces or individual samples.
+ */
+struct io_stats {
+    unsigned long requests;
+    unsigned long subcube_requests;
+    unsigned long trace_requests;
+    unsigned long sample_requests;
+    unsigned long chunks;
+    unsigned long chunk_bytes;
+    double        read_seconds;
+};
+
+/** A single storage read, for the timeline of a request
+ *
+ * start is the time the read was waited on, in seconds since the unix
+ * epoch, and seconds how long it took to complete.
+ */
+struct read_event {
+    double        start;
+    double        seconds;
+    unsigned long chunks;
+};
+
+/** Memory and CPU used on behalf of a request
+ *
+ * peak_bytes is the most memory held in data buffers at any time, and
+ * retained_bytes the part of it still held when the calls returned, e.g.
+ * responses and subvolumes handed to the caller. It is negative for calls
+ * that release buffers. cpu_seconds is the CPU time of the calling thread.
+ */
+struct resource_stats {
+    unsigned long peak_bytes;
+    long          retained_bytes;
+    double        cpu_seconds;
+};
+
 #endif // ONESEISMIC_API_CTYPES_H
@@ -1,10 +1,17 @@
 #include "datahandle.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include <OpenVDS/KnownMetadata.h>
 #include <OpenVDS/OpenVDS.h>
 
+#include "bufferusage.hpp"
 #include "exceptions.hpp"
 #include "metadatahandle.hpp"
 #include "subcube.hpp"
@@ -25,8 +32,19 @@ OpenVDS::InterpolationMethod to_interpolation(interpolation_method interpolation
     }
 }
 
+thread_local io_stats current_io_stats = {};
+thread_local std::vector< read_event > current_reads;
+
 } /* namespace */
 
+io_stats const& thread_io_stats() noexcept(true) {
+    return current_io_stats;
+}
+
+std::vector< read_event >& thread_reads() noexcept(true) {
+    return current_reads;
+}
+
 OpenVDS::VolumeDataFormat DataHandle::format() noexcept(true) {
     /*
      * We always want to request data in OpenVDS::VolumeDataFormat::Format_R32
@@ -49,7 +67,198 @@ SingleDataHandle make_single_datahandle(
 }
 
 SingleDataHandle::SingleDataHandle(OpenVDS::VDSHandle handle)
-    :m_handle(handle), m_access_manager(OpenVDS::GetAccessManager(handle)), m_metadata(SingleMetadataHandle::create(m_access_manager.GetVolumeDataLayout())) {}
+    :m_handle(handle), m_access_manager(OpenVDS::GetAccessManager(handle)), m_metadata(SingleMetadataHandle::create(m_access_manager.GetVolumeDataLayout())) {
+
+    /*
+     * All chunks but the last along each dimension have the same size, so
+     * the first chunk gives the chunk grid of the whole volume.
+     */
+    int min[OpenVDS::Dimensionality_Max] = {};
+    int max[OpenVDS::Dimensionality_Max] = {};
+    this->m_access_manager.GetChunkMinMax(
+        OpenVDS::Dimensions_012,
+        SingleDataHandle::lod_level,
+        SingleDataHandle::channel,
+        0,
+        min,
+        max
+    );
+    for (int i = 0; i < OpenVDS::Dimensionality_Max; ++i) {
+        this->m_chunk_size[i] = std::max(max[i] - min[i], 1);
+    }
+}
+
+void SingleDataHandle::index_bricks() noexcept (false) {
+    if (this->m_bricks) return;
+
+    /*
+     * Dead zones of surveys are either no-value samples or, for data loaded
+     * from SEG-Y, zero traces. Skipped reads are answered with the fill value
+     * itself, so the choice only decides which bricks can be skipped.
+     */
+    auto const* layout = this->m_access_manager.GetVolumeDataLayout();
+    auto const descriptor = layout->GetChannelDescriptor(SingleDataHandle::channel);
+    float const fillvalue = descriptor.IsUseNoValue() ? descriptor.GetNoValue() : 0;
+
+    int shape[BrickIndex::dimensions];
+    for (int i = 0; i < BrickIndex::dimensions; ++i) {
+        shape[i] = layout->GetDimensionNumSamples(i);
+    }
+    this->m_bricks = std::make_shared< BrickIndex >(
+        shape,
+        this->m_chunk_size,
+        fillvalue
+    );
+}
+
+std::int64_t SingleDataHandle::brick_index_size() const noexcept (false) {
+    auto const* layout = this->m_access_manager.GetVolumeDataLayout();
+    int shape[BrickIndex::dimensions];
+    for (int i = 0; i < BrickIndex::dimensions; ++i) {
+        shape[i] = layout->GetDimensionNumSamples(i);
+    }
+    return BrickIndex::size(shape, this->m_chunk_size);
+}
+
+/** Wait for the request, accounting it to the calling thread */
+void SingleDataHandle::wait_for(
+    std::shared_ptr< OpenVDS::VolumeDataRequest > const& request,
+    std::uint64_t nchunks
+) noexcept (false) {
+    auto const start = std::chrono::steady_clock::now();
+    std::chrono::duration< double > const started =
+        std::chrono::system_clock::now().time_since_epoch();
+    bool const success = request.get()->WaitForCompletion();
+    std::chrono::duration< double > const elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::uint64_t chunk_samples = 1;
+    for (int i = 0; i < OpenVDS::Dimensionality_Max; ++i) {
+        chunk_samples *= this->m_chunk_size[i];
+    }
+
+    current_io_stats.requests     += 1;
+    current_io_stats.chunks       += nchunks;
+    current_io_stats.chunk_bytes  += nchunks * chunk_samples * sizeof(float);
+    current_io_stats.read_seconds += elapsed.count();
+
+    if (current_reads.size() < max_thread_reads) {
+        try {
+            current_reads.push_back({started.count(), elapsed.count(), nchunks});
+        } catch (...) {
+            /* The timeline is best effort and must never fail the read */
+        }
+    }
+
+    if (!success) {
+        throw std::runtime_error("Failed to read from VDS.");
+    }
+}
+
+/** Number of chunks intersecting the subcube */
+std::uint64_t SingleDataHandle::chunks_in(
+    SubCube const& subcube
+) const noexcept (true) {
+    std::uint64_t nchunks = 1;
+    for (int i = 0; i < OpenVDS::Dimensionality_Max; ++i) {
+        int const lower = subcube.bounds.lower[i];
+        int const upper = subcube.bounds.upper[i];
+        if (upper <= lower) continue;
+
+        int const size = this->m_chunk_size[i];
+        nchunks *= (upper - 1) / size - lower / size + 1;
+    }
+    return nchunks;
+}
+
+/** Number of chunks holding the positions
+ *
+ * The skip_dimension is left out of the chunk keys, and every key is counted
+ * as all the chunks along that dimension, as is the case for whole traces.
+ * Pass a negative skip_dimension to count the chunks of single samples.
+ * Interpolation can touch neighbouring chunks, which is not counted.
+ *
+ * The count is found in a single pass without a buffer, as the smaller of
+ * two upper bounds of the distinct chunks: the runs of consecutive positions
+ * in the same chunk, and the chunks in the bounding box of the positions.
+ * Positions are walked trace by trace or cell by cell, so both are close.
+ */
+std::uint64_t SingleDataHandle::chunks_at(
+    voxel const* positions,
+    std::size_t npositions,
+    int skip_dimension
+) const noexcept (false) {
+    if (npositions == 0) return 0;
+
+    int first[OpenVDS::Dimensionality_Max];
+    int last[OpenVDS::Dimensionality_Max];
+    int previous[OpenVDS::Dimensionality_Max] = {};
+    std::uint64_t runs = 0;
+    for (std::size_t p = 0; p < npositions; ++p) {
+        bool same = p > 0;
+        for (int i = 0; i < OpenVDS::Dimensionality_Max; ++i) {
+            int const key = (i == skip_dimension)
+                ? 0
+                : int(positions[p][i]) / this->m_chunk_size[i];
+            same = same and key == previous[i];
+            previous[i] = key;
+            first[i] = (p == 0) ? key : std::min(first[i], key);
+            last[i]  = (p == 0) ? key : std::max(last[i], key);
+        }
+        if (not same) ++runs;
+    }
+
+    std::uint64_t boxed = 1;
+    for (int i = 0; i < OpenVDS::Dimensionality_Max; ++i) {
+        boxed *= last[i] - first[i] + 1;
+    }
+    std::uint64_t const distinct = std::min(runs, boxed);
+
+    std::uint64_t along = 1;
+    if (skip_dimension >= 0) {
+        auto const* layout = this->m_access_manager.GetVolumeDataLayout();
+        int const nsamples = layout->GetDimensionNumSamples(skip_dimension);
+        int const size     = this->m_chunk_size[skip_dimension];
+        along = (nsamples + size - 1) / size;
+    }
+    return distinct * along;
+}
+
+/** True if every chunk the positions read from is known to be all fill
+ *
+ * Positions are widened by the reach of the widest interpolation, such that
+ * any interpolation of the fill value is the fill value itself. As for
+ * chunks_at, the skip_dimension is read whole.
+ */
+bool SingleDataHandle::all_fill_at(
+    voxel const* positions,
+    std::size_t npositions,
+    int skip_dimension
+) const noexcept (true) {
+    int constexpr reach = 2;
+    if (npositions == 0 or not this->m_bricks) return false;
+
+    return this->m_bricks->all_fill(
+        positions[0],
+        npositions,
+        OpenVDS::Dimensionality_Max,
+        skip_dimension,
+        reach
+    );
+}
+
+/** Answer a read of chunks that are all fill without reading them */
+void SingleDataHandle::write_fill(
+    void* const buffer,
+    std::int64_t size
+) const noexcept (true) {
+    float* const samples = static_cast< float* >(buffer);
+    std::fill(samples, samples + size / sizeof(float), this->m_bricks->fillvalue());
+}
+
+BrickIndex const* SingleDataHandle::brick_index() const noexcept (true) {
+    return this->m_bricks.get();
+}
 
 void SingleDataHandle::close() {
     OpenVDS::Close(m_handle);
@@ -87,6 +296,12 @@ void SingleDataHandle::read_subcube(
     std::int64_t size,
     SubCube const& subcube
 ) noexcept (false) {
+    if (this->m_bricks and
+        this->m_bricks->all_fill(subcube.bounds.lower, subcube.bounds.upper)) {
+        this->write_fill(buffer, size);
+        return;
+    }
+
     auto request = this->m_access_manager.RequestVolumeSubset(
         buffer,
         size,
@@ -97,10 +312,15 @@ void SingleDataHandle::read_subcube(
         subcube.bounds.upper,
         SingleDataHandle::format()
     );
-    bool const success = request.get()->WaitForCompletion();
-
-    if (!success) {
-        throw std::runtime_error("Failed to read from VDS.");
+    current_io_stats.subcube_requests += 1;
+    this->wait_for(request, this->chunks_in(subcube));
+
+    if (this->m_bricks) {
+        this->m_bricks->update(
+            static_cast< float const* >(buffer),
+            subcube.bounds.lower,
+            subcube.bounds.upper
+        );
     }
 }
 
@@ -117,6 +337,10 @@ void SingleDataHandle::read_traces(
     enum interpolation_method const interpolation_method
 ) noexcept (false) {
     int const dimension = this->get_metadata().sample().dimension();
+    if (this->all_fill_at(coordinates, ntraces, dimension)) {
+        this->write_fill(buffer, size);
+        return;
+    }
 
     auto request = this->m_access_manager.RequestVolumeTraces(
         (float*)buffer,
@@ -129,11 +353,27 @@ void SingleDataHandle::read_traces(
         ::to_interpolation(interpolation_method),
         dimension
     );
-    bool const success = request.get()->WaitForCompletion();
+    current_io_stats.trace_requests += 1;
+    this->wait_for(request, this->chunks_at(coordinates, ntraces, dimension));
+}
 
-    if (!success) {
-        throw std::runtime_error("Failed to read from VDS.");
-    }
+/* Reads go straight into the caller's buffer */
+std::int64_t SingleDataHandle::subcube_scratch_size(
+    SubCube const&
+) noexcept (false) {
+    return 0;
+}
+
+std::int64_t SingleDataHandle::traces_scratch_size(
+    std::size_t const
+) noexcept (false) {
+    return 0;
+}
+
+std::int64_t SingleDataHandle::samples_scratch_size(
+    std::size_t const
+) noexcept (false) {
+    return 0;
 }
 
 std::int64_t SingleDataHandle::samples_buffer_size(
@@ -152,6 +392,11 @@ void SingleDataHandle::read_samples(
     std::size_t const nsamples,
     enum interpolation_method const interpolation_method
 ) noexcept (false) {
+    if (this->all_fill_at(samples, nsamples, -1)) {
+        this->write_fill(buffer, size);
+        return;
+    }
+
     auto request = this->m_access_manager.RequestVolumeSamples(
         (float*)buffer,
         size,
@@ -162,11 +407,8 @@ void SingleDataHandle::read_samples(
         nsamples,
         ::to_interpolation(interpolation_method)
     );
-
-    bool const success = request.get()->WaitForCompletion();
-    if (!success) {
-        throw std::runtime_error("Failed to read from VDS.");
-    }
+    current_io_stats.sample_requests += 1;
+    this->wait_for(request, this->chunks_at(samples, nsamples, -1));
 }
 
 DoubleDataHandle make_double_datahandle(
@@ -238,8 +480,6 @@ void DoubleDataHandle::read_subcube(
     transformer.to_cube_a_voxel_position(subcube_a.bounds.lower, subcube.bounds.lower);
     transformer.to_cube_a_voxel_position(subcube_a.bounds.upper, subcube.bounds.upper);
 
-    std::vector<char> buffer_a(size);
-
     this->m_datahandle_a.read_subcube(
         buffer,
         size,
@@ -251,6 +491,7 @@ void DoubleDataHandle::read_subcube(
     transformer.to_cube_b_voxel_position(subcube_b.bounds.upper, subcube.bounds.upper);
 
     std::vector<char> buffer_b(size);
+    TrackedBuffer const tracked_b(size);
 
     this->m_datahandle_b.read_subcube(
         buffer_b.data(),
@@ -277,17 +518,15 @@ void DoubleDataHandle::read_traces(
 
     std::size_t coordinates_buffer_size = OpenVDS::Dimensionality_Max * ntraces;
     std::vector<float> coordinates_a(coordinates_buffer_size);
-    for (int v = 0; v < ntraces; v++) {
-        transformer.to_cube_a_voxel_position(coordinates_a.data() + OpenVDS::Dimensionality_Max * v, coordinates[v]);
-    }
+    TrackedBuffer const tracked_coordinates(2 * coordinates_buffer_size * sizeof(float));
+    transformer.to_cube_a_voxel_positions(coordinates_a.data(), (float const*)coordinates, ntraces);
 
     std::vector<float> coordinates_b(coordinates_buffer_size);
-    for (int v = 0; v < ntraces; v++) {
-        transformer.to_cube_b_voxel_position(coordinates_b.data() + OpenVDS::Dimensionality_Max * v, coordinates[v]);
-    }
+    transformer.to_cube_b_voxel_positions(coordinates_b.data(), (float const*)coordinates, ntraces);
 
     std::size_t size_a = this->m_datahandle_a.traces_buffer_size(ntraces);
     std::vector<float> buffer_a((std::size_t)size_a / sizeof(float));
+    TrackedBuffer const tracked_a(size_a);
     this->m_datahandle_a.read_traces(
         buffer_a.data(),
         size_a,
@@ -298,6 +537,7 @@ void DoubleDataHandle::read_traces(
 
     std::size_t size_b = this->m_datahandle_b.traces_buffer_size(ntraces);
     std::vector<float> buffer_b((std::size_t)size_b / sizeof(float));
+    TrackedBuffer const tracked_b(size_b);
     this->m_datahandle_b.read_traces(
         buffer_b.data(),
         size_b,
@@ -318,6 +558,7 @@ void DoubleDataHandle::read_traces(
         floatBuffer);
 
     std::vector<float> res_buffer_b(this->get_metadata().sample().nsamples() * ntraces);
+    TrackedBuffer const tracked_res_b(res_buffer_b.size() * sizeof(float));
     this->extract_continuous_part_of_trace(
         &buffer_b,
         m_datahandle_b.get_metadata().sample().nsamples(),
@@ -328,6 +569,47 @@ void DoubleDataHandle::read_traces(
     m_binary_operator((float*)buffer, (float* const)res_buffer_b.data(), (std::size_t)size / sizeof(float));
 }
 
+void DoubleDataHandle::index_bricks() noexcept(false) {
+    this->m_datahandle_a.index_bricks();
+    this->m_datahandle_b.index_bricks();
+}
+
+std::int64_t DoubleDataHandle::brick_index_size() const noexcept(false) {
+    return this->m_datahandle_a.brick_index_size()
+        + this->m_datahandle_b.brick_index_size();
+}
+
+/* The second operand is read into a buffer of its own */
+std::int64_t DoubleDataHandle::subcube_scratch_size(
+    SubCube const& subcube
+) noexcept(false) {
+    return this->subcube_buffer_size(subcube);
+}
+
+/*
+ * Coordinates and whole traces of both operands, and the part of the traces
+ * of the second operand that is combined with the first
+ */
+std::int64_t DoubleDataHandle::traces_scratch_size(
+    std::size_t const ntraces
+) noexcept(false) {
+    std::int64_t const coordinates =
+        2 * OpenVDS::Dimensionality_Max * ntraces * sizeof(float);
+    return coordinates
+        + this->m_datahandle_a.traces_buffer_size(ntraces)
+        + this->m_datahandle_b.traces_buffer_size(ntraces)
+        + this->traces_buffer_size(ntraces);
+}
+
+/* Positions of both operands, and the samples of the second operand */
+std::int64_t DoubleDataHandle::samples_scratch_size(
+    std::size_t const nsamples
+) noexcept(false) {
+    std::int64_t const positions =
+        2 * OpenVDS::Dimensionality_Max * nsamples * sizeof(float);
+    return positions + this->samples_buffer_size(nsamples);
+}
+
 void DoubleDataHandle::extract_continuous_part_of_trace(
     std::vector<float>* source_traces,
     int source_trace_length,
@@ -365,16 +647,13 @@ void DoubleDataHandle::read_samples(
      */
 
     std::vector<float> samples_a(samples_buffer_size);
+    TrackedBuffer const tracked_samples(2 * samples_buffer_size * sizeof(float));
     auto transformer_a = this->m_metadata.coordinate_transformer();
-    for (int v = 0; v < nsamples; v++) {
-        transformer_a.to_cube_a_voxel_position(samples_a.data() + OpenVDS::Dimensionality_Max * v, samples[v]);
-    }
+    transformer_a.to_cube_a_voxel_positions(samples_a.data(), (float const*)samples, nsamples);
 
     std::vector<float> samples_b(samples_buffer_size);
     auto transformer_b = this->m_metadata.coordinate_transformer();
-    for (int v = 0; v < nsamples; v++) {
-        transformer_b.to_cube_b_voxel_position(samples_b.data() + OpenVDS::Dimensionality_Max * v, samples[v]);
-    }
+    transformer_b.to_cube_b_voxel_positions(samples_b.data(), (float const*)samples, nsamples);
 
     this->m_datahandle_a.read_samples(
         buffer,
@@ -385,6 +664,7 @@ void DoubleDataHandle::read_samples(
     );
 
     std::vector<float> buffer_b((std::size_t)size / sizeof(float));
+    TrackedBuffer const tracked_b(size);
 
     this->m_datahandle_b.read_samples(
         buffer_b.data(),
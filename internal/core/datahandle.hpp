@@ -3,15 +3,34 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <OpenVDS/OpenVDS.h>
 #include <functional>
 
+#include "brickindex.hpp"
 #include "metadatahandle.hpp"
 #include "subcube.hpp"
 
 using voxel = float[OpenVDS::Dimensionality_Max];
 
+/** Reads done by the calling thread since it started
+ *
+ * OpenVDS requests are waited on by the thread that made them, so the reads
+ * caused by a single call into the library can be found by comparing the
+ * statistics before and after the call.
+ */
+io_stats const& thread_io_stats() noexcept(true);
+
+/** Reads done by the calling thread that are not yet accounted to a request
+ *
+ * Callers move the reads they are interested in out of the list. At most
+ * max_thread_reads are kept, later reads are only counted in the statistics.
+ */
+std::vector< read_event >& thread_reads() noexcept(true);
+
+constexpr std::size_t max_thread_reads = 1024;
+
 class DataHandle {
 
 public:
@@ -48,6 +67,24 @@ public:
         enum interpolation_method const interpolation_method
     ) noexcept(false) = 0;
 
+    /**
+     * Bytes of scratch buffers the corresponding read allocates on top of the
+     * buffer it reads into, such that the memory of a read is known before
+     * any data is read.
+     */
+    virtual std::int64_t subcube_scratch_size(SubCube const& subcube) noexcept(false) = 0;
+    virtual std::int64_t traces_scratch_size(std::size_t const ntraces) noexcept(false) = 0;
+    virtual std::int64_t samples_scratch_size(std::size_t const nsamples) noexcept(false) = 0;
+
+    /**
+     * Start summarizing the chunks read whole, such that later reads of
+     * chunks known to be all fill are answered without reading them. Only
+     * worth it for handles that are shared by many requests.
+     * brick_index_size is the memory the index takes.
+     */
+    virtual void index_bricks() noexcept(false) = 0;
+    virtual std::int64_t brick_index_size() const noexcept(false) = 0;
+
     static OpenVDS::VolumeDataFormat format() noexcept(true);
 };
 
@@ -91,10 +128,45 @@ public:
         enum interpolation_method const interpolation_method
     ) noexcept (false);
 
+    std::int64_t subcube_scratch_size(SubCube const& subcube) noexcept (false);
+    std::int64_t traces_scratch_size(std::size_t const ntraces) noexcept (false);
+    std::int64_t samples_scratch_size(std::size_t const nsamples) noexcept (false);
+
+    void index_bricks() noexcept (false);
+    std::int64_t brick_index_size() const noexcept (false);
+
+    /** Summaries of the chunks read whole so far, shared by copies. nullptr
+     *  until index_bricks is called
+     */
+    BrickIndex const* brick_index() const noexcept (true);
+
 private:
     OpenVDS::VDSHandle m_handle;
     OpenVDS::VolumeDataAccessManager m_access_manager;
     SingleMetadataHandle m_metadata;
+    /* Number of samples in a chunk along each dimension */
+    int m_chunk_size[OpenVDS::Dimensionality_Max];
+    std::shared_ptr< BrickIndex > m_bricks;
+
+    void wait_for(
+        std::shared_ptr< OpenVDS::VolumeDataRequest > const& request,
+        std::uint64_t nchunks
+    ) noexcept(false);
+
+    std::uint64_t chunks_in(SubCube const& subcube) const noexcept(true);
+    std::uint64_t chunks_at(
+        voxel const* positions,
+        std::size_t npositions,
+        int skip_dimension
+    ) const noexcept(false);
+
+    bool all_fill_at(
+        voxel const* positions,
+        std::size_t npositions,
+        int skip_dimension
+    ) const noexcept(true);
+
+    void write_fill(void* const buffer, std::int64_t size) const noexcept(true);
 
     static int constexpr lod_level = 0;
     static int constexpr channel = 0;
@@ -151,6 +223,13 @@ public:
         enum interpolation_method const interpolation_method
     ) noexcept(false);
 
+    std::int64_t subcube_scratch_size(SubCube const& subcube) noexcept(false);
+    std::int64_t traces_scratch_size(std::size_t const ntraces) noexcept(false);
+    std::int64_t samples_scratch_size(std::size_t const nsamples) noexcept(false);
+
+    void index_bricks() noexcept(false);
+    std::int64_t brick_index_size() const noexcept(false);
+
 private:
     SingleDataHandle m_datahandle_a;
     SingleDataHandle m_datahandle_b;
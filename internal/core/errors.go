@@ -25,3 +25,16 @@ func (e *InternalError) Error() string {
 func NewInternalError(msg string) *InternalError {
 	return &InternalError{ message: msg }
 }
+
+/** The server does not currently have the resources to serve the request */
+type ResourceExhausted struct {
+	message string
+}
+
+func (e *ResourceExhausted) Error() string {
+	return e.message
+}
+
+func NewResourceExhausted(msg string) *ResourceExhausted {
+	return &ResourceExhausted{ message: msg }
+}
@@ -0,0 +1,114 @@
+package core
+
+import (
+	"fmt"
+	"sort"
+	"sync"
+	"time"
+)
+
+/** Storage reads, as counted by the C++ core
+ *
+ * Chunks are the VDS chunks touched by the reads and ChunkBytes their decoded
+ * size. ReadTime is the time spent waiting for reads to complete, summed over
+ * reads that run in parallel. The requests are also counted by how they
+ * fetch data: as subcubes, whole traces or individual samples.
+ */
+type IOTotals struct {
+	Requests        uint64
+	SubcubeRequests uint64
+	TraceRequests   uint64
+	SampleRequests  uint64
+	Chunks          uint64
+	ChunkBytes      uint64
+	ReadTime        time.Duration
+}
+
+/** A single storage read, as timed by the C++ core */
+type ReadEvent struct {
+	Start    time.Time
+	Duration time.Duration
+	Chunks   uint64
+}
+
+/** Max number of reads kept per request. Later reads are still counted */
+const maxReadEvents = 1000
+
+/** Storage reads done on behalf of a single request
+ *
+ * All methods are safe to call concurrently and on a nil *IOStats, in which
+ * case nothing is recorded.
+ */
+type IOStats struct {
+	lock   sync.Mutex
+	totals IOTotals
+	reads  []ReadEvent
+}
+
+func NewIOStats() *IOStats {
+	return &IOStats{}
+}
+
+func (s *IOStats) Add(totals IOTotals) {
+	if s == nil {
+		return
+	}
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	s.totals.Requests += totals.Requests
+	s.totals.SubcubeRequests += totals.SubcubeRequests
+	s.totals.TraceRequests += totals.TraceRequests
+	s.totals.SampleRequests += totals.SampleRequests
+	s.totals.Chunks += totals.Chunks
+	s.totals.ChunkBytes += totals.ChunkBytes
+	s.totals.ReadTime += totals.ReadTime
+}
+
+/** Keep the reads for the timeline of the request */
+func (s *IOStats) AddReads(reads ...ReadEvent) {
+	if s == nil {
+		return
+	}
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	room := maxReadEvents - len(s.reads)
+	if len(reads) > room {
+		reads = reads[:room]
+	}
+	s.reads = append(s.reads, reads...)
+}
+
+/** Reads of the request, ordered by start */
+func (s *IOStats) Reads() []ReadEvent {
+	if s == nil {
+		return nil
+	}
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	reads := make([]ReadEvent, len(s.reads))
+	copy(reads, s.reads)
+	sort.SliceStable(reads, func(i, j int) bool {
+		return reads[i].Start.Before(reads[j].Start)
+	})
+	return reads
+}
+
+func (s *IOStats) Totals() IOTotals {
+	if s == nil {
+		return IOTotals{}
+	}
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	return s.totals
+}
+
+func (s *IOStats) String() string {
+	totals := s.Totals()
+	return fmt.Sprintf(
+		"io_requests=%d chunks=%d chunk_bytes=%d read_time=%v",
+		totals.Requests,
+		totals.Chunks,
+		totals.ChunkBytes,
+		totals.ReadTime,
+	)
+}
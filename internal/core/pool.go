@@ -0,0 +1,308 @@
+package core
+
+/*
+#include <capi.h>
+#include <ctypes.h>
+#include <stdlib.h>
+*/
+import "C"
+import (
+	"container/list"
+	"context"
+	"fmt"
+	"strings"
+	"sync"
+	"time"
+)
+
+/** An opened data handle shared between requests
+ *
+ * The handle holds the parsed layout and axes of the VDS and is immutable
+ * once opened, so requests can read through it concurrently. It is freed once
+ * it has been evicted from the pool and the last request using it is done.
+ */
+type pooledHandle struct {
+	key        string
+	dataHandle *C.struct_DataHandle
+	expires    time.Time
+
+	lock       sync.Mutex
+	refs       int
+	evicted    bool
+	authorized map[string]time.Time
+	metadata   []byte
+
+	releaseIndex func()
+}
+
+func (h *pooledHandle) acquire() {
+	h.lock.Lock()
+	h.refs++
+	h.lock.Unlock()
+}
+
+func (h *pooledHandle) release() {
+	h.lock.Lock()
+	h.refs--
+	free := h.refs == 0 && h.evicted
+	h.lock.Unlock()
+
+	if free {
+		h.free()
+	}
+}
+
+func (h *pooledHandle) evict() {
+	h.lock.Lock()
+	h.evicted = true
+	free := h.refs == 0
+	h.lock.Unlock()
+
+	if free {
+		h.free()
+	}
+}
+
+func (h *pooledHandle) free() {
+	var cctx = C.context_new()
+	defer C.context_free(cctx)
+	C.datahandle_free(cctx, h.dataHandle)
+	h.releaseIndex()
+}
+
+/** Time until which a successful check of connection may be relied on
+ *
+ * That is the lifetime of the handle, or the expiry of the credentials if
+ * they expire before it.
+ */
+func (h *pooledHandle) authorizedUntil(connection Connection) time.Time {
+	until := h.expires
+	if expiry, ok := connection.Expiry(); ok && expiry.Before(until) {
+		until = expiry
+	}
+	return until
+}
+
+/** Verify that all connections may read through the handle
+ *
+ * The handle was opened with someone else's credentials, so requests with
+ * other credentials must prove that they are allowed to read the VDS. Such
+ * checks are remembered until the credentials expire, and checked again if
+ * they are presented after that.
+ */
+func (h *pooledHandle) isAuthorized(connections []Connection) bool {
+	now := time.Now()
+	for _, connection := range connections {
+		credentials := connection.ConnectionString()
+
+		h.lock.Lock()
+		until, known := h.authorized[credentials]
+		if known && !now.Before(until) {
+			delete(h.authorized, credentials)
+			known = false
+		}
+		h.lock.Unlock()
+		if known {
+			continue
+		}
+
+		if !connection.IsAuthorizedToRead() {
+			return false
+		}
+
+		h.lock.Lock()
+		h.authorized[credentials] = h.authorizedUntil(connection)
+		h.lock.Unlock()
+	}
+	return true
+}
+
+func (h *pooledHandle) getMetadata(handle DSHandle) ([]byte, error) {
+	h.lock.Lock()
+	metadata := h.metadata
+	h.lock.Unlock()
+	if metadata != nil {
+		return metadata, nil
+	}
+
+	metadata, err := handle.readMetadata()
+	if err != nil {
+		return nil, err
+	}
+
+	h.lock.Lock()
+	h.metadata = metadata
+	h.lock.Unlock()
+	return metadata, nil
+}
+
+/** Pool of opened data handles, keyed by the requested VDSs
+ *
+ * Opening a handle reads and parses the layout of the VDS from storage, and
+ * the metadata of the VDS is rendered from that layout. Reusing opened
+ * handles makes both free for repeated requests against the same VDS.
+ *
+ * Handles live for at most the configured time to live, so that changes to
+ * the underlying blobs are eventually picked up. They are never kept beyond
+ * the expiry of the sas-token they were opened with, as the handle keeps
+ * using that token to read data. When the pool is full the least recently
+ * used handle is evicted.
+ *
+ * Pooled handles index the chunks they read, such that chunks known to be
+ * all fill are not read again by later requests. The index lives as long as
+ * the handle and its memory is taken from indexBudget, which should never
+ * wait, for as long. Handles are pooled without an index when the budget
+ * can not spare it. With no budget, every pooled handle is indexed.
+ */
+type HandlePool struct {
+	ttl         time.Duration
+	capacity    int
+	indexBudget MemoryBudget
+
+	lock    sync.Mutex
+	lru     *list.List
+	handles map[string]*list.Element
+}
+
+func NewHandlePool(
+	ttl time.Duration,
+	capacity int,
+	indexBudget MemoryBudget,
+) *HandlePool {
+	return &HandlePool{
+		ttl:         ttl,
+		capacity:    capacity,
+		indexBudget: indexBudget,
+		lru:         list.New(),
+		handles:     make(map[string]*list.Element),
+	}
+}
+
+/** Index the chunks read through the handle, if the budget can spare the
+ *  memory. Returns the function that gives the memory back.
+ */
+func (p *HandlePool) indexBricks(handle DSHandle) func() {
+	release := func() {}
+	if p.indexBudget != nil {
+		var size C.size_t
+		cerr := C.brick_index_size(handle.ctx, handle.dataHandle, &size)
+		if toError(cerr, handle.ctx) != nil {
+			return func() {}
+		}
+		var err error
+		release, err = p.indexBudget.Acquire(context.Background(), uint64(size))
+		if err != nil {
+			return func() {}
+		}
+	}
+
+	cerr := C.datahandle_index_bricks(handle.ctx, handle.dataHandle)
+	if toError(cerr, handle.ctx) != nil {
+		release()
+		return func() {}
+	}
+	return release
+}
+
+func handlePoolKey(connections []Connection, operator uint32) string {
+	urls := make([]string, len(connections))
+	for i, connection := range connections {
+		urls[i] = connection.Url()
+	}
+	return fmt.Sprintf("%d\x00%s", operator, strings.Join(urls, "\x00"))
+}
+
+/** Get a handle to the requested VDSs, opening it if it is not in the pool
+ *
+ * The returned handle has its own context and must be closed by the caller,
+ * as with any other handle.
+ */
+func (p *HandlePool) Open(connections []Connection, operator uint32) (DSHandle, error) {
+	key := handlePoolKey(connections, operator)
+	now := time.Now()
+
+	p.lock.Lock()
+	var pooled *pooledHandle
+	if element, exists := p.handles[key]; exists {
+		pooled = element.Value.(*pooledHandle)
+		if now.Before(pooled.expires) {
+			p.lru.MoveToFront(element)
+			pooled.acquire()
+		} else {
+			p.remove(element)
+			pooled = nil
+		}
+	}
+	p.lock.Unlock()
+
+	if pooled != nil {
+		if !pooled.isAuthorized(connections) {
+			pooled.release()
+			/*
+			 * Fall back to opening a private handle with the requester's own
+			 * credentials, which fails the same way it would without a pool.
+			 */
+			return CreateDSHandle(connections, operator)
+		}
+		return DSHandle{dataHandle: pooled.dataHandle, ctx: C.context_new(), pooled: pooled}, nil
+	}
+
+	handle, err := CreateDSHandle(connections, operator)
+	if err != nil {
+		return handle, err
+	}
+
+	expires := now.Add(p.ttl)
+	for _, connection := range connections {
+		if expiry, ok := connection.Expiry(); ok && expiry.Before(expires) {
+			expires = expiry
+		}
+	}
+	if !now.Before(expires) {
+		return handle, nil
+	}
+
+	pooled = &pooledHandle{
+		key:          key,
+		dataHandle:   handle.dataHandle,
+		expires:      expires,
+		refs:         1,
+		authorized:   make(map[string]time.Time),
+		releaseIndex: p.indexBricks(handle),
+	}
+	for _, connection := range connections {
+		pooled.authorized[connection.ConnectionString()] = pooled.authorizedUntil(connection)
+	}
+	handle.pooled = pooled
+
+	p.lock.Lock()
+	defer p.lock.Unlock()
+	if element, exists := p.handles[key]; exists {
+		p.remove(element)
+	}
+	p.handles[key] = p.lru.PushFront(pooled)
+	for p.lru.Len() > p.capacity {
+		p.remove(p.lru.Back())
+	}
+	return handle, nil
+}
+
+/** Open a handle through the pool, or directly if there is no pool */
+func OpenDSHandle(
+	pool *HandlePool,
+	connections []Connection,
+	operator uint32,
+) (DSHandle, error) {
+	if pool == nil {
+		return CreateDSHandle(connections, operator)
+	}
+	return pool.Open(connections, operator)
+}
+
+/** Remove a handle from the pool. Expects lock held */
+func (p *HandlePool) remove(element *list.Element) {
+	pooled := element.Value.(*pooledHandle)
+	p.lru.Remove(element)
+	delete(p.handles, pooled.key)
+	pooled.evict()
+}
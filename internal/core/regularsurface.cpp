@@ -3,67 +3,6 @@
 
 #include "regularsurface.hpp"
 
-Point AffineTransformation::operator*(Point p) const noexcept (true) {
-    return {
-        this->at(0)[0] * p.x + this->at(0)[1] * p.y + this->at(0)[2],
-        this->at(1)[0] * p.x + this->at(1)[1] * p.y + this->at(1)[2],
-    };
-};
-
-bool operator==(
-    AffineTransformation const& left,
-    AffineTransformation const& right
-) noexcept (true) {
-    const auto& lhs = static_cast< const AffineTransformation::base_type& >(left);
-    const auto& rhs = static_cast< const AffineTransformation::base_type& >(right);
-
-    return lhs == rhs;
-};
-
-AffineTransformation AffineTransformation::from_rotation(
-    double xori,
-    double yori,
-    double xinc,
-    double yinc,
-    double rot
-) noexcept (true) {
-    double rad = rot * (M_PI / 180);
-    /**
-    * Matrix is composed by applying affine transformations [1] in the
-    * following order:
-    * - scaling by xinc, yinc
-    * - counterclockwise rotation by angle rad around the center
-    * - translation by the offset (xori, yori)
-    *
-    * By scaling unit vectors, rotating coordinate system axes and moving
-    * coordinate system center to new position we transform index-based
-    * rows-and-columns cartesian coordinate system into CDP-surface one.
-    *
-    * [1] https://en.wikipedia.org/wiki/Affine_transformation
-    */
-    return AffineTransformation(base_type({{
-        xinc * std::cos(rad),  -yinc * std::sin(rad), xori,
-        xinc * std::sin(rad),   yinc * std::cos(rad), yori
-    }}));
-}
-
-AffineTransformation AffineTransformation::inverse_from_rotation(
-    double xori,
-    double yori,
-    double xinc,
-    double yinc,
-    double rot
-) noexcept(true) {
-    double rad = rot * (M_PI / 180);
-    /**
-     * Matrix inverse to the one above.
-     */
-    return AffineTransformation(base_type({{
-        std::cos(rad) / xinc, std::sin(rad) / xinc, -(std::sin(rad) * yori + std::cos(rad) * xori) / xinc,
-       -std::sin(rad) / yinc, std::cos(rad) / yinc,  (std::sin(rad) * xori - std::cos(rad) * yori) / yinc
-    }}));
-}
-
 bool Grid::operator==(const Grid& other) const noexcept(true) {
     return this->m_transformation == other.m_transformation;
 }
@@ -1,42 +1,7 @@
 #ifndef ONESEISMIC_API_REGULAR_SURFACE_HPP
 #define ONESEISMIC_API_REGULAR_SURFACE_HPP
 
-#include <array>
-
-struct Point {
-    double x;
-    double y;
-};
-
-struct AffineTransformation : private std::array< std::array< double, 3>, 2 > {
-    using base_type = std::array< std::array< double, 3 >, 2 >;
-
-    explicit AffineTransformation(base_type x) : base_type(std::move(x)) {}
-
-    Point operator*(Point p) const noexcept (true);
-
-    friend bool operator==(
-        AffineTransformation const& left,
-        AffineTransformation const& right
-    ) noexcept (true);
-
-    static AffineTransformation from_rotation(
-        double xori,
-        double yori,
-        double xinc,
-        double yinc,
-        double rot
-    ) noexcept (true);
-
-    /* Make inverse transformation to the one created from rotation */
-    static AffineTransformation inverse_from_rotation(
-        double xori,
-        double yori,
-        double xinc,
-        double yinc,
-        double rot
-    )noexcept (true);
-};
+#include "affine_transformation.hpp"
 
 /**
  * Represents a geometrical plane which is seen and intended as a grid.
@@ -0,0 +1,83 @@
+package core
+
+import (
+	"fmt"
+	"sync"
+	"time"
+)
+
+/** Memory and CPU used by a single call into the C++ core
+ *
+ * PeakBytes is the most memory held in data buffers during the call, and
+ * RetainedBytes how much of it the call left allocated, e.g. subvolumes and
+ * responses. Calls that free buffers retain a negative amount.
+ */
+type ResourceUsage struct {
+	PeakBytes     uint64
+	RetainedBytes int64
+	CPUTime       time.Duration
+}
+
+/** Memory and CPU used by the C++ core on behalf of a single request
+ *
+ * The peak of the request is found by stacking the peak of each call on
+ * top of what earlier calls retained. Calls that run in parallel, like the
+ * chunks of attribute requests, are stacked as if they ran one after the
+ * other, so their scratch buffers count only once. CPU time is summed
+ * over all calls.
+ *
+ * All methods are safe to call concurrently and on a nil *ResourceStats, in
+ * which case nothing is recorded.
+ */
+type ResourceStats struct {
+	lock     sync.Mutex
+	retained int64
+	peak     uint64
+	cpu      time.Duration
+}
+
+func NewResourceStats() *ResourceStats {
+	return &ResourceStats{}
+}
+
+func (s *ResourceStats) Add(usage ResourceUsage) {
+	if s == nil {
+		return
+	}
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	peak := s.retained + int64(usage.PeakBytes)
+	if peak > 0 && uint64(peak) > s.peak {
+		s.peak = uint64(peak)
+	}
+	s.retained += usage.RetainedBytes
+	s.cpu += usage.CPUTime
+}
+
+/** Most memory held in data buffers by the core at any time */
+func (s *ResourceStats) PeakBytes() uint64 {
+	if s == nil {
+		return 0
+	}
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	return s.peak
+}
+
+/** CPU time spent in the core by the threads that called it */
+func (s *ResourceStats) CPUTime() time.Duration {
+	if s == nil {
+		return 0
+	}
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	return s.cpu
+}
+
+func (s *ResourceStats) String() string {
+	return fmt.Sprintf(
+		"peak_buffer_bytes=%d cpu_time=%v",
+		s.PeakBytes(),
+		s.CPUTime(),
+	)
+}
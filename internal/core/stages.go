@@ -0,0 +1,70 @@
+package core
+
+import (
+	"sort"
+	"sync"
+	"time"
+)
+
+/** Time spent in the named stages of a single request
+ *
+ * Stages are recorded both by the Go layers, e.g. decoding the request and
+ * writing the response, and by the C++ core through the context of each call.
+ * Time spent in the same stage is summed, also when the stage runs in
+ * parallel chunks, such as fetching data for attributes.
+ *
+ * All methods are safe to call concurrently and on a nil *Stages, in which
+ * case nothing is recorded.
+ */
+type Stages struct {
+	lock      sync.Mutex
+	durations map[string]time.Duration
+}
+
+func NewStages() *Stages {
+	return &Stages{durations: make(map[string]time.Duration)}
+}
+
+func (s *Stages) Add(name string, duration time.Duration) {
+	if s == nil {
+		return
+	}
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	s.durations[name] += duration
+}
+
+/** Start timing a stage, which is recorded when the returned function is called
+ *
+ *     defer stages.Start("decode")()
+ */
+func (s *Stages) Start(name string) func() {
+	if s == nil {
+		return func() {}
+	}
+	start := time.Now()
+	return func() { s.Add(name, time.Since(start)) }
+}
+
+type StageDuration struct {
+	Name     string
+	Duration time.Duration
+}
+
+/** Recorded stages, ordered by name */
+func (s *Stages) Durations() []StageDuration {
+	if s == nil {
+		return nil
+	}
+	s.lock.Lock()
+	defer s.lock.Unlock()
+
+	durations := make([]StageDuration, 0, len(s.durations))
+	for name, duration := range s.durations {
+		durations = append(durations, StageDuration{Name: name, Duration: duration})
+	}
+	sort.Slice(durations, func(i, j int) bool {
+		return durations[i].Name < durations[j].Name
+	})
+	return durations
+}
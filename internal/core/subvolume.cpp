@@ -1,6 +1,7 @@
 #include <cassert>
 #include <cmath>
 #include <stdexcept>
+#include <vector>
 
 #include "axis.hpp"
 #include "subvolume.hpp"
@@ -34,6 +35,31 @@ enum class Border {
     Bottom
 };
 
+namespace {
+
+/**
+ * Map from annotated (inline, crossline) coordinates to sample positions along
+ * the inline and crossline axes, i.e. Axis::to_sample_position for both axes.
+ */
+AffineTransformation annotation_to_voxel(Axis& iline, Axis& xline) {
+    auto scale = [](Axis& axis) {
+        if (axis.max() == axis.min()) return 0.0;
+        return double(axis.to_sample_position(axis.max()) - axis.to_sample_position(axis.min()))
+            / (double(axis.max()) - axis.min());
+    };
+    double const si = scale(iline);
+    double const sx = scale(xline);
+    double const oi = iline.to_sample_position(iline.min()) - si * iline.min();
+    double const ox = xline.to_sample_position(xline.min()) - sx * xline.min();
+
+    return AffineTransformation(AffineTransformation::base_type({{
+        si, 0,  oi,
+        0,  sx, ox
+    }}));
+}
+
+} // namespace
+
 SurfaceBoundedSubVolume* make_subvolume(
     MetadataHandle const& metadata,
     RegularSurface const& reference,
@@ -44,20 +70,58 @@ SurfaceBoundedSubVolume* make_subvolume(
         throw std::runtime_error("Expected surfaces to have the same plane and size");
     }
 
+    auto sample = metadata.sample();
+    RawSegmentBlueprint segment_blueprint = RawSegmentBlueprint(sample.stepsize(), sample.min());
+    std::unique_ptr<SurfaceBoundedSubVolume> subvolume(
+        new SurfaceBoundedSubVolume(reference, top, bottom, segment_blueprint)
+    );
+    subvolume->make_segments(metadata);
+    return subvolume.release();
+}
+
+SurfaceBoundedSubVolume* make_subvolume(
+    MetadataHandle const& metadata,
+    RegularSurface const& reference,
+    float above,
+    float below
+) {
+    auto sample = metadata.sample();
+    RawSegmentBlueprint segment_blueprint = RawSegmentBlueprint(sample.stepsize(), sample.min());
+    std::unique_ptr<SurfaceBoundedSubVolume> subvolume(
+        new SurfaceBoundedSubVolume(reference, above, below, segment_blueprint)
+    );
+    subvolume->make_segments(metadata);
+    return subvolume.release();
+}
+
+void SurfaceBoundedSubVolume::make_segments(MetadataHandle const& metadata) {
     CoordinateTransformer const& transform = metadata.coordinate_transformer();
 
     auto iline = metadata.iline();
     auto xline = metadata.xline();
     auto sample = metadata.sample();
 
-    RawSegmentBlueprint segment_blueprint = RawSegmentBlueprint(sample.stepsize(), sample.min());
-    std::unique_ptr<SurfaceBoundedSubVolume> subvolume_unique_ptr(
-        new SurfaceBoundedSubVolume(reference, top, bottom, segment_blueprint)
-    );
-    SurfaceBoundedSubVolume* subvolume = subvolume_unique_ptr.get();
-    auto const horizontal_grid = subvolume->horizontal_grid();
+    RawSegmentBlueprint const& segment_blueprint = this->m_segment_blueprint;
+    auto const horizontal_grid = this->horizontal_grid();
+
+    this->m_segment_offsets[0] = 0;
+
+    /**
+     * Surface cells are mapped to annotated and voxel coordinates by composite
+     * affine maps which are built once. The positions of a whole row are
+     * computed up front in a pass of their own, which has no branches and is
+     * left to the compiler to vectorize, before the cells are checked one by
+     * one.
+     */
+    AffineTransformation const to_annotation =
+        transform.horizontal_world_to_annotation() * horizontal_grid.m_transformation;
+    AffineTransformation const to_voxel =
+        annotation_to_voxel(iline, xline) * to_annotation;
 
-    subvolume->m_segment_offsets[0] = 0;
+    std::size_t const ncols = horizontal_grid.ncols();
+    std::vector< Point > row_cells(ncols);
+    std::vector< Point > row_annotations(ncols);
+    std::vector< Point > row_voxels(ncols);
 
     /**
      * Try to establish how far away from the start each segment in the
@@ -68,113 +132,124 @@ SurfaceBoundedSubVolume* make_subvolume(
      * is not interested), simply set beginning of the next segment same as
      * current one as no data is expected to be fetched.
      */
-    for (int i = 0; i < horizontal_grid.size(); ++i) {
-        float reference_depth = reference[i];
-        float top_depth = top[i];
-        float bottom_depth = bottom[i];
-
-        if (
-            reference_depth == reference.fillvalue() ||
-            top_depth == top.fillvalue() ||
-            bottom_depth == bottom.fillvalue()
-        ) {
-            subvolume->m_segment_offsets[i + 1] = subvolume->m_segment_offsets[i];
-            continue;
+    for (std::size_t row = 0; row < horizontal_grid.nrows(); ++row) {
+        for (std::size_t col = 0; col < ncols; ++col) {
+            row_cells[col] = Point{ double(row), double(col) };
         }
+        to_annotation.transform(row_cells.data(), ncols, row_annotations.data());
+        to_voxel.transform(row_cells.data(), ncols, row_voxels.data());
+
+        for (std::size_t col = 0; col < ncols; ++col) {
+            std::size_t const i = row * ncols + col;
+
+            float reference_depth = this->m_ref[i];
+            float top_depth = this->top_boundary(i);
+            float bottom_depth = this->bottom_boundary(i);
+
+            if (
+                reference_depth == this->m_ref.fillvalue() ||
+                (this->m_top and top_depth == this->m_top->fillvalue()) ||
+                (this->m_bottom and bottom_depth == this->m_bottom->fillvalue())
+            ) {
+                this->m_segment_offsets[i + 1] = this->m_segment_offsets[i];
+                continue;
+            }
 
-        if (
-            reference_depth < top_depth ||
-            reference_depth > bottom_depth
-        ) {
-            throw std::runtime_error(
-                "Planes are not ordered as top <= reference <= bottom"
-            );
-        }
+            if (
+                reference_depth < top_depth ||
+                reference_depth > bottom_depth
+            ) {
+                throw std::runtime_error(
+                    "Planes are not ordered as top <= reference <= bottom"
+                );
+            }
 
-        auto const cdp = horizontal_grid.to_cdp(i);
-        auto ij = transform.WorldToAnnotation({cdp.x, cdp.y, 0});
+            Point const& ij = row_annotations[col];
 
-        if (not iline.inrange_with_margin(ij[0]) or not xline.inrange_with_margin(ij[1])) {
-            subvolume->m_segment_offsets[i + 1] = subvolume->m_segment_offsets[i];
-            continue;
-        }
+            if (not iline.inrange_with_margin(ij.x) or not xline.inrange_with_margin(ij.y)) {
+                this->m_segment_offsets[i + 1] = this->m_segment_offsets[i];
+                continue;
+            }
 
-        if (not sample.inrange(top_depth) or
-            not sample.inrange(bottom_depth))
-        {
-            auto row = horizontal_grid.row(i);
-            auto col = horizontal_grid.col(i);
-            throw std::runtime_error(
-                "Vertical window is out of vertical bounds at"
-                " row: " + std::to_string(row) +
-                " col:" + std::to_string(col) +
-                ". Request: [" + utils::to_string_with_precision(top_depth) +
-                ", " + utils::to_string_with_precision(bottom_depth) +
-                "]. Seismic bounds: [" + utils::to_string_with_precision(sample.min())
-                + ", " + utils::to_string_with_precision(sample.max()) + "]"
-            );
-        }
+            if (not sample.inrange(top_depth) or
+                not sample.inrange(bottom_depth))
+            {
+                throw std::runtime_error(
+                    "Vertical window is out of vertical bounds at"
+                    " row: " + std::to_string(row) +
+                    " col:" + std::to_string(col) +
+                    ". Request: [" + utils::to_string_with_precision(top_depth) +
+                    ", " + utils::to_string_with_precision(bottom_depth) +
+                    "]. Seismic bounds: [" + utils::to_string_with_precision(sample.min())
+                    + ", " + utils::to_string_with_precision(sample.max()) + "]"
+                );
+            }
 
-        auto calculate_margin = [&](Border border) {
-            std::int8_t margin = segment_blueprint.preferred_margin();
-            while (margin > 0) {
-                float sample_position;
-                if (border == Border::Top) {
-                    sample_position = segment_blueprint.top_sample_position(top_depth, margin);
-                } else {
-                    sample_position = segment_blueprint.bottom_sample_position(bottom_depth, margin);
+            auto calculate_margin = [&](Border border) {
+                std::int8_t margin = segment_blueprint.preferred_margin();
+                while (margin > 0) {
+                    float sample_position;
+                    if (border == Border::Top) {
+                        sample_position = segment_blueprint.top_sample_position(top_depth, margin);
+                    } else {
+                        sample_position = segment_blueprint.bottom_sample_position(bottom_depth, margin);
+                    }
+                    if (sample.inrange(sample_position)) {
+                        return margin;
+                    }
+                    --margin;
                 }
-                if (sample.inrange(sample_position)) {
-                    return margin;
-                }
-                --margin;
-            }
-            return margin;
+                return margin;
 
-        };
+            };
 
-        std::int8_t top_margin = calculate_margin(Border::Top);
-        bool is_top_margin_atypical = (top_margin != segment_blueprint.preferred_margin());
+            std::int8_t top_margin = calculate_margin(Border::Top);
+            bool is_top_margin_atypical = (top_margin != segment_blueprint.preferred_margin());
 
-        std::int8_t bottom_margin = calculate_margin(Border::Bottom);
-        bool is_bottom_margin_atypical = (bottom_margin != segment_blueprint.preferred_margin());
+            std::int8_t bottom_margin = calculate_margin(Border::Bottom);
+            bool is_bottom_margin_atypical = (bottom_margin != segment_blueprint.preferred_margin());
 
-        // limitation from makima samples interpolation algorithm
-        const int min_samples = 4;
-        assert(
-            (void("Current logic relies on relationship between min_samples and preferred_margin"),
-             min_samples == 2 * segment_blueprint.preferred_margin())
-        );
-        auto size = segment_blueprint.size(top_depth, bottom_depth, top_margin, bottom_margin);
-        if (size < min_samples) {
-            if (is_top_margin_atypical && is_bottom_margin_atypical) {
-                throw std::runtime_error(
-                    "Segment size is too small. Top margin: " +
-                    std::to_string(top_margin) + ", bottom margin: " +
-                    std::to_string(bottom_margin)
-                );
+            // limitation from makima samples interpolation algorithm
+            const int min_samples = 4;
+            assert(
+                (void("Current logic relies on relationship between min_samples and preferred_margin"),
+                 min_samples == 2 * segment_blueprint.preferred_margin())
+            );
+            auto size = segment_blueprint.size(top_depth, bottom_depth, top_margin, bottom_margin);
+            if (size < min_samples) {
+                if (is_top_margin_atypical && is_bottom_margin_atypical) {
+                    throw std::runtime_error(
+                        "Segment size is too small. Top margin: " +
+                        std::to_string(top_margin) + ", bottom margin: " +
+                        std::to_string(bottom_margin)
+                    );
+                }
+
+                int diff = min_samples - size;
+                if (is_top_margin_atypical) {
+                    bottom_margin += diff;
+                    is_bottom_margin_atypical = true;
+                } else {
+                    top_margin += diff;
+                    is_top_margin_atypical = true;
+                }
             }
 
-            int diff = min_samples - size;
             if (is_top_margin_atypical) {
-                bottom_margin += diff;
-                is_bottom_margin_atypical = true;
-            } else {
-                top_margin += diff;
-                is_top_margin_atypical = true;
+                this->m_segment_top_margins.emplace(i, top_margin);
             }
-        }
 
-        if (is_top_margin_atypical) {
-            subvolume->m_segment_top_margins.emplace(i, top_margin);
-        }
+            this->m_horizontal_positions[i] = {
+                float(row_voxels[col].x),
+                float(row_voxels[col].y)
+            };
 
-        subvolume->m_segment_offsets[i + 1] =
-            subvolume->m_segment_offsets[i] + segment_blueprint.size(top_depth, bottom_depth, top_margin, bottom_margin);
+            this->m_segment_offsets[i + 1] =
+                this->m_segment_offsets[i] + segment_blueprint.size(top_depth, bottom_depth, top_margin, bottom_margin);
+        }
     }
-    subvolume->m_data.reserve(subvolume->m_segment_offsets[horizontal_grid.size()]);
-
-    return subvolume_unique_ptr.release();
+    this->m_data.reserve(this->m_segment_offsets[horizontal_grid.size()]);
+    this->m_tracked.resize(this->m_data.capacity() * sizeof(float));
 }
 
 void SurfaceBoundedSubVolume::reinitialize(
@@ -182,7 +257,7 @@ void SurfaceBoundedSubVolume::reinitialize(
     RawSegment& segment
 ) const {
     segment.reinitialize(
-        m_ref[index], m_top[index], m_bottom[index],
+        m_ref[index], top_boundary(index), bottom_boundary(index),
         top_margin(index),
         m_data.begin() + m_segment_offsets[index], m_data.begin() + m_segment_offsets[index + 1]
     );
@@ -192,7 +267,7 @@ void SurfaceBoundedSubVolume::reinitialize(
     std::size_t index,
     ResampledSegment& segment
 ) const {
-    segment.reinitialize(m_ref[index], m_top[index], m_bottom[index]);
+    segment.reinitialize(m_ref[index], top_boundary(index), bottom_boundary(index));
 }
 
 void resample(RawSegment const& src_segment, ResampledSegment& dst_segment) {
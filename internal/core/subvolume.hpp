@@ -2,11 +2,13 @@
 #define ONESEISMIC_API_SUBVOLUME_HPP
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <stdexcept>
 #include <unordered_map>
 #include <vector>
 
+#include "bufferusage.hpp"
 #include "metadatahandle.hpp"
 #include "regularsurface.hpp"
 
@@ -397,12 +399,14 @@ public:
     )
         : Segment(reference, top_boundary, bottom_boundary), m_blueprint(blueprint) {
         this->m_data = std::vector<double>(this->size());
+        this->m_tracked.resize(this->m_data.capacity() * sizeof(double));
     }
 
     void reinitialize(float reference, float top_boundary, float bottom_boundary) {
         Segment::reinitialize(reference, top_boundary, bottom_boundary);
 
         this->m_data.resize(this->size());
+        this->m_tracked.resize(this->m_data.capacity() * sizeof(double));
     }
 
     std::vector<double>::iterator begin() noexcept { return m_data.begin(); }
@@ -441,6 +445,7 @@ protected:
 private:
     ResampledSegmentBlueprint const* m_blueprint;
     std::vector<double> m_data;
+    TrackedBuffer m_tracked;
 };
 
 /**
@@ -460,6 +465,13 @@ class SurfaceBoundedSubVolume {
         RegularSurface const& bottom
     );
 
+    friend SurfaceBoundedSubVolume* make_subvolume(
+        MetadataHandle const& metadata,
+        RegularSurface const& reference,
+        float above,
+        float below
+    );
+
 public:
     BoundedGrid const& horizontal_grid() const noexcept {
         return m_ref.grid();
@@ -474,8 +486,8 @@ public:
     RawSegment vertical_segment(std::size_t index) const noexcept {
         return RawSegment(
             this->m_ref[index],
-            this->m_top[index],
-            this->m_bottom[index],
+            this->top_boundary(index),
+            this->bottom_boundary(index),
             this->top_margin(index),
             m_data.begin() + m_segment_offsets[index],
             m_data.begin() + m_segment_offsets[index + 1],
@@ -502,6 +514,42 @@ public:
         return m_ref.fillvalue();
     }
 
+    /**
+     * Top boundary (in annotated coordinates of samples axis) of the segment
+     * at provided index. Either read from the top surface or, for constant
+     * windows, calculated from the reference.
+     */
+    float top_boundary(std::size_t index) const {
+        return this->m_top ? (*this->m_top)[index] : this->m_ref[index] - this->m_above;
+    }
+
+    /**
+     * Bottom boundary (in annotated coordinates of samples axis) of the
+     * segment at provided index.
+     */
+    float bottom_boundary(std::size_t index) const {
+        return this->m_bottom ? (*this->m_bottom)[index] : this->m_ref[index] + this->m_below;
+    }
+
+    /**
+     * Horizontal position of the segment at provided index as sample positions
+     * along the inline and crossline axes (in that order), i.e. as voxel
+     * coordinates ready to be passed to OpenVDS. Only meaningful for non-empty
+     * segments.
+     */
+    std::array<float, 2> const& horizontal_position(std::size_t index) const noexcept {
+        return this->m_horizontal_positions[index];
+    }
+
+    /**
+     * Bytes held by the subvolume for its samples and horizontal positions,
+     * whether the samples have been fetched yet or not.
+     */
+    std::size_t buffer_size() const noexcept {
+        return this->m_data.capacity() * sizeof(float)
+            + this->m_horizontal_positions.capacity() * sizeof(std::array<float, 2>);
+    }
+
     /**
      * Reinitialize segments with data at provided index.
      * Purpose of this functionality is to avoid creating new segment objects.
@@ -521,12 +569,38 @@ private:
         RegularSurface const& bottom,
         RawSegmentBlueprint segment_blueprint
     )
-        : m_ref(reference), m_top(top), m_bottom(bottom), m_segment_blueprint(segment_blueprint) {
+        : m_ref(reference), m_top(&top), m_bottom(&bottom), m_segment_blueprint(segment_blueprint) {
 
         this->m_segment_offsets = std::vector<std::size_t>(horizontal_grid().size() + 1);
+        this->m_horizontal_positions = std::vector<std::array<float, 2>>(horizontal_grid().size());
+        this->m_tracked_positions.resize(
+            this->m_horizontal_positions.capacity() * sizeof(std::array<float, 2>)
+        );
     }
 
+    SurfaceBoundedSubVolume(
+        RegularSurface const& reference,
+        float above,
+        float below,
+        RawSegmentBlueprint segment_blueprint
+    )
+        : m_ref(reference), m_above(above), m_below(below), m_segment_blueprint(segment_blueprint) {
+
+        this->m_segment_offsets = std::vector<std::size_t>(horizontal_grid().size() + 1);
+        this->m_horizontal_positions = std::vector<std::array<float, 2>>(horizontal_grid().size());
+        this->m_tracked_positions.resize(
+            this->m_horizontal_positions.capacity() * sizeof(std::array<float, 2>)
+        );
+    }
+
+    /**
+     * Establish segment sizes, margins and horizontal positions for all
+     * segments in the subvolume.
+     */
+    void make_segments(MetadataHandle const& metadata);
+
     std::vector<float> m_data;
+    TrackedBuffer m_tracked;
     /**
      * Distances from data start to start of every segment, i.e.
      * m_segment_offsets[i] contains number of samples one must skip from start
@@ -534,6 +608,14 @@ private:
      */
     std::vector<std::size_t> m_segment_offsets;
 
+    /**
+     * Horizontal voxel positions of the segments, calculated once when the
+     * subvolume is made so that the fetch does not have to repeat the
+     * transformations.
+     */
+    std::vector<std::array<float, 2>> m_horizontal_positions;
+    TrackedBuffer m_tracked_positions;
+
     /**
      * In order to not bloat structure unnecessary, contains only margins
      * that are different from preferred blueprint margin.
@@ -541,8 +623,15 @@ private:
     std::unordered_map<std::size_t, std::uint8_t> m_segment_top_margins;
 
     RegularSurface const& m_ref;
-    RegularSurface const& m_top;
-    RegularSurface const& m_bottom;
+    /**
+     * Top and bottom surfaces are null for constant windows, in which case
+     * the boundaries are given by m_above and m_below relative to the
+     * reference.
+     */
+    RegularSurface const* m_top = nullptr;
+    RegularSurface const* m_bottom = nullptr;
+    float m_above = 0;
+    float m_below = 0;
 
     RawSegmentBlueprint m_segment_blueprint;
 };
@@ -558,6 +647,20 @@ SurfaceBoundedSubVolume* make_subvolume(
     RegularSurface const& bottom
 );
 
+/**
+ * Constructs new SurfaceBoundedSubVolume object with a constant window around
+ * the reference surface, i.e. top = reference - above and bottom = reference
+ * + below. Equivalent to providing the shifted surfaces, but without
+ * materializing them.
+ * Note that object would be allocated on heap.
+ */
+SurfaceBoundedSubVolume* make_subvolume(
+    MetadataHandle const& metadata,
+    RegularSurface const& reference,
+    float above,
+    float below
+);
+
 /**
  * Resamples source segment into destination.
  */
@@ -0,0 +1,404 @@
+package fakeblob
+
+import (
+	"crypto/md5"
+	"encoding/base64"
+	"encoding/json"
+	"encoding/xml"
+	"fmt"
+	"io"
+	"math/rand"
+	"net/http"
+	"os"
+	"path/filepath"
+	"strconv"
+	"strings"
+	"sync"
+	"time"
+)
+
+/** Behaviour of the network and storage account that is simulated
+ *
+ * Latency is added before every response, plus a uniformly distributed
+ * extra delay of up to Jitter. Bandwidth, in bytes per second, caps the
+ * speed at which each response body is sent. ErrorRate is the fraction of
+ * reads that fail with 503 Server Busy, which the Azure SDK retries.
+ */
+type Faults struct {
+	Latency   time.Duration
+	Jitter    time.Duration
+	Bandwidth int64
+	ErrorRate float64
+}
+
+/** Stand-in for Azure Blob Storage, serving blobs from a directory
+ *
+ * Implements the subset of the Blob REST API that OpenVDS and the server
+ * need to read and write VDSs: Get Blob (with ranges), Get Blob Properties,
+ * Put Blob, Put Block and Put Block List. Urls are on the form
+ * /<container>/<blob>, and blobs are stored as files at the same path below
+ * the root directory. User metadata (x-ms-meta-*) is stored next to the
+ * blobs, below the .metadata directory.
+ *
+ * Sas-tokens are accepted without being checked.
+ */
+type Server struct {
+	root   string
+	faults Faults
+
+	lock sync.Mutex
+	rng  *rand.Rand
+}
+
+func NewServer(root string, faults Faults, seed int64) *Server {
+	return &Server{
+		root:   root,
+		faults: faults,
+		rng:    rand.New(rand.NewSource(seed)),
+	}
+}
+
+const apiVersion = "2021-08-06"
+
+type properties struct {
+	Metadata    map[string]string `json:"metadata"`
+	ContentType string            `json:"contentType,omitempty"`
+}
+
+/** Path of the blob or its properties, or an error if it escapes the root */
+func (s *Server) path(dir string, urlPath string) (string, error) {
+	clean := filepath.Clean("/" + urlPath)
+	container, blob, _ := strings.Cut(strings.TrimPrefix(clean, "/"), "/")
+	if container == "" || blob == "" || strings.HasPrefix(container, ".") {
+		return "", fmt.Errorf("invalid blob path: %s", urlPath)
+	}
+	return filepath.Join(s.root, dir, container, filepath.FromSlash(blob)), nil
+}
+
+func (s *Server) blobPath(urlPath string) (string, error) {
+	return s.path("", urlPath)
+}
+
+func (s *Server) propertiesPath(urlPath string) (string, error) {
+	path, err := s.path(".metadata", urlPath)
+	return path + ".json", err
+}
+
+func (s *Server) blockPath(urlPath string, blockid string) (string, error) {
+	path, err := s.path(".blocks", urlPath)
+	id := base64.RawURLEncoding.EncodeToString([]byte(blockid))
+	return filepath.Join(path, id), err
+}
+
+func (s *Server) random() float64 {
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	return s.rng.Float64()
+}
+
+func (s *Server) delay() {
+	delay := s.faults.Latency
+	if s.faults.Jitter > 0 {
+		delay += time.Duration(s.random() * float64(s.faults.Jitter))
+	}
+	time.Sleep(delay)
+}
+
+func (s *Server) ServeHTTP(w http.ResponseWriter, r *http.Request) {
+	s.delay()
+
+	w.Header().Set("x-ms-version", apiVersion)
+	w.Header().Set("x-ms-request-id", strconv.FormatInt(time.Now().UnixNano(), 36))
+
+	switch r.Method {
+	case http.MethodGet, http.MethodHead:
+		if s.faults.ErrorRate > 0 && s.random() < s.faults.ErrorRate {
+			writeError(w, http.StatusServiceUnavailable, "ServerBusy",
+				"The server is busy (injected)")
+			return
+		}
+		s.read(w, r)
+	case http.MethodPut:
+		switch r.URL.Query().Get("comp") {
+		case "":
+			s.putBlob(w, r)
+		case "block":
+			s.putBlock(w, r)
+		case "blocklist":
+			s.putBlockList(w, r)
+		default:
+			writeError(w, http.StatusNotImplemented, "NotImplemented",
+				"Unsupported operation")
+		}
+	default:
+		writeError(w, http.StatusMethodNotAllowed, "UnsupportedHttpVerb",
+			"Unsupported method")
+	}
+}
+
+func writeError(w http.ResponseWriter, status int, code string, message string) {
+	w.Header().Set("x-ms-error-code", code)
+	w.Header().Set("Content-Type", "application/xml")
+	w.WriteHeader(status)
+	fmt.Fprintf(
+		w,
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>"+
+			"<Error><Code>%s</Code><Message>%s</Message></Error>",
+		code,
+		message,
+	)
+}
+
+/** Byte range from the x-ms-range or Range header, inclusive */
+func parseRange(r *http.Request, size int64) (start int64, end int64, partial bool, err error) {
+	header := r.Header.Get("x-ms-range")
+	if header == "" {
+		header = r.Header.Get("Range")
+	}
+	if header == "" {
+		return 0, size - 1, false, nil
+	}
+
+	first, last, found := strings.Cut(strings.TrimPrefix(header, "bytes="), "-")
+	if !found {
+		return 0, 0, false, fmt.Errorf("invalid range: %s", header)
+	}
+	start, err = strconv.ParseInt(first, 10, 64)
+	if err != nil {
+		return 0, 0, false, fmt.Errorf("invalid range: %s", header)
+	}
+	end = size - 1
+	if last != "" {
+		end, err = strconv.ParseInt(last, 10, 64)
+		if err != nil {
+			return 0, 0, false, fmt.Errorf("invalid range: %s", header)
+		}
+	}
+	end = min(end, size-1)
+	if start > end {
+		return 0, 0, false, fmt.Errorf("unsatisfiable range: %s", header)
+	}
+	return start, end, true, nil
+}
+
+func (s *Server) read(w http.ResponseWriter, r *http.Request) {
+	path, err := s.blobPath(r.URL.Path)
+	if err != nil {
+		writeError(w, http.StatusBadRequest, "InvalidUri", err.Error())
+		return
+	}
+	file, err := os.Open(path)
+	if err != nil {
+		writeError(w, http.StatusNotFound, "BlobNotFound",
+			"The specified blob does not exist.")
+		return
+	}
+	defer file.Close()
+
+	info, err := file.Stat()
+	if err != nil || info.IsDir() {
+		writeError(w, http.StatusNotFound, "BlobNotFound",
+			"The specified blob does not exist.")
+		return
+	}
+	size := info.Size()
+
+	props := properties{}
+	if propertiesPath, err := s.propertiesPath(r.URL.Path); err == nil {
+		if data, err := os.ReadFile(propertiesPath); err == nil {
+			json.Unmarshal(data, &props)
+		}
+	}
+
+	header := w.Header()
+	for key, value := range props.Metadata {
+		header.Set("x-ms-meta-"+key, value)
+	}
+	contentType := props.ContentType
+	if contentType == "" {
+		contentType = "application/octet-stream"
+	}
+	header.Set("Content-Type", contentType)
+	header.Set("x-ms-blob-type", "BlockBlob")
+	header.Set("Accept-Ranges", "bytes")
+	header.Set("ETag", fmt.Sprintf("\"0x%X\"", info.ModTime().UnixNano()))
+	header.Set("Last-Modified", info.ModTime().UTC().Format(http.TimeFormat))
+
+	if r.Method == http.MethodHead {
+		header.Set("Content-Length", strconv.FormatInt(size, 10))
+		w.WriteHeader(http.StatusOK)
+		return
+	}
+
+	start, end, partial, err := parseRange(r, size)
+	if err != nil {
+		writeError(w, http.StatusRequestedRangeNotSatisfiable, "InvalidRange",
+			err.Error())
+		return
+	}
+	length := end - start + 1
+	if size == 0 {
+		length = 0
+	}
+
+	header.Set("Content-Length", strconv.FormatInt(length, 10))
+	status := http.StatusOK
+	if partial {
+		header.Set("Content-Range", fmt.Sprintf("bytes %d-%d/%d", start, end, size))
+		status = http.StatusPartialContent
+	}
+	w.WriteHeader(status)
+
+	if _, err := file.Seek(start, io.SeekStart); err != nil {
+		return
+	}
+	s.send(w, io.LimitReader(file, length))
+}
+
+/** Copy the body to the client, at no more than the bandwidth cap */
+func (s *Server) send(w io.Writer, body io.Reader) {
+	if s.faults.Bandwidth <= 0 {
+		io.Copy(w, body)
+		return
+	}
+
+	const chunk = 32 * 1024
+	buffer := make([]byte, chunk)
+	start := time.Now()
+	var sent int64
+	for {
+		n, err := body.Read(buffer)
+		if n > 0 {
+			sent += int64(n)
+			due := time.Duration(float64(sent) / float64(s.faults.Bandwidth) * float64(time.Second))
+			time.Sleep(due - time.Since(start))
+			if _, err := w.Write(buffer[:n]); err != nil {
+				return
+			}
+		}
+		if err != nil {
+			return
+		}
+	}
+}
+
+func readProperties(r *http.Request) properties {
+	props := properties{
+		Metadata:    map[string]string{},
+		ContentType: r.Header.Get("x-ms-blob-content-type"),
+	}
+	for key, values := range r.Header {
+		lower := strings.ToLower(key)
+		if strings.HasPrefix(lower, "x-ms-meta-") && len(values) > 0 {
+			props.Metadata[strings.TrimPrefix(lower, "x-ms-meta-")] = values[0]
+		}
+	}
+	return props
+}
+
+/** Write the file through a temporary, such that readers never see parts */
+func writeFile(path string, body io.Reader) ([]byte, error) {
+	if err := os.MkdirAll(filepath.Dir(path), 0755); err != nil {
+		return nil, err
+	}
+	tmp, err := os.CreateTemp(filepath.Dir(path), ".upload-*")
+	if err != nil {
+		return nil, err
+	}
+	defer os.Remove(tmp.Name())
+
+	hash := md5.New()
+	_, err = io.Copy(io.MultiWriter(tmp, hash), body)
+	if closeErr := tmp.Close(); err == nil {
+		err = closeErr
+	}
+	if err != nil {
+		return nil, err
+	}
+	return hash.Sum(nil), os.Rename(tmp.Name(), path)
+}
+
+func (s *Server) commit(w http.ResponseWriter, r *http.Request, body io.Reader) {
+	path, err := s.blobPath(r.URL.Path)
+	if err != nil {
+		writeError(w, http.StatusBadRequest, "InvalidUri", err.Error())
+		return
+	}
+	propertiesPath, _ := s.propertiesPath(r.URL.Path)
+
+	props, err := json.Marshal(readProperties(r))
+	if err == nil {
+		_, err = writeFile(propertiesPath, strings.NewReader(string(props)))
+	}
+	var digest []byte
+	if err == nil {
+		digest, err = writeFile(path, body)
+	}
+	if err != nil {
+		writeError(w, http.StatusInternalServerError, "InternalError", err.Error())
+		return
+	}
+
+	w.Header().Set("Content-MD5", base64.StdEncoding.EncodeToString(digest))
+	w.Header().Set("ETag", fmt.Sprintf("\"0x%X\"", time.Now().UnixNano()))
+	w.Header().Set("Last-Modified", time.Now().UTC().Format(http.TimeFormat))
+	w.Header().Set("x-ms-request-server-encrypted", "false")
+	w.WriteHeader(http.StatusCreated)
+}
+
+func (s *Server) putBlob(w http.ResponseWriter, r *http.Request) {
+	s.commit(w, r, r.Body)
+}
+
+func (s *Server) putBlock(w http.ResponseWriter, r *http.Request) {
+	path, err := s.blockPath(r.URL.Path, r.URL.Query().Get("blockid"))
+	if err == nil {
+		_, err = writeFile(path, r.Body)
+	}
+	if err != nil {
+		writeError(w, http.StatusInternalServerError, "InternalError", err.Error())
+		return
+	}
+	w.WriteHeader(http.StatusCreated)
+}
+
+type blockList struct {
+	Blocks []string `xml:",any"`
+}
+
+func (s *Server) putBlockList(w http.ResponseWriter, r *http.Request) {
+	var list blockList
+	if err := xml.NewDecoder(r.Body).Decode(&list); err != nil {
+		writeError(w, http.StatusBadRequest, "InvalidXmlDocument", err.Error())
+		return
+	}
+
+	var blocks []io.Reader
+	var files []*os.File
+	defer func() {
+		for _, file := range files {
+			file.Close()
+		}
+	}()
+	for _, id := range list.Blocks {
+		path, err := s.blockPath(r.URL.Path, strings.TrimSpace(id))
+		if err != nil {
+			writeError(w, http.StatusBadRequest, "InvalidUri", err.Error())
+			return
+		}
+		file, err := os.Open(path)
+		if err != nil {
+			writeError(w, http.StatusBadRequest, "InvalidBlockList",
+				"The specified block list is invalid.")
+			return
+		}
+		files = append(files, file)
+		blocks = append(blocks, file)
+	}
+
+	s.commit(w, r, io.MultiReader(blocks...))
+
+	if path, err := s.path(".blocks", r.URL.Path); err == nil {
+		os.RemoveAll(path)
+	}
+}
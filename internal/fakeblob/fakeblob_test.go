@@ -0,0 +1,123 @@
+package fakeblob
+
+import (
+	"io"
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+)
+
+func do(
+	t *testing.T,
+	method string,
+	url string,
+	body string,
+	headers map[string]string,
+) (*http.Response, string) {
+	request, err := http.NewRequest(method, url, strings.NewReader(body))
+	require.NoError(t, err)
+	for key, value := range headers {
+		request.Header.Set(key, value)
+	}
+	response, err := http.DefaultClient.Do(request)
+	require.NoError(t, err)
+	defer response.Body.Close()
+	data, err := io.ReadAll(response.Body)
+	require.NoError(t, err)
+	return response, string(data)
+}
+
+func TestPutAndGetBlob(t *testing.T) {
+	server := httptest.NewServer(NewServer(t.TempDir(), Faults{}, 1))
+	defer server.Close()
+	url := server.URL + "/container/cube/VolumeDataLayout?sv=2021&sig=x"
+
+	response, _ := do(t, http.MethodPut, url, "0123456789", map[string]string{
+		"x-ms-blob-type":         "BlockBlob",
+		"x-ms-meta-vdschunkmeta": "abc",
+	})
+	require.Equal(t, http.StatusCreated, response.StatusCode)
+
+	response, body := do(t, http.MethodGet, url, "", nil)
+	require.Equal(t, http.StatusOK, response.StatusCode)
+	require.Equal(t, "0123456789", body)
+	require.Equal(t, "abc", response.Header.Get("x-ms-meta-vdschunkmeta"))
+
+	response, body = do(t, http.MethodGet, url, "", map[string]string{
+		"x-ms-range": "bytes=2-5",
+	})
+	require.Equal(t, http.StatusPartialContent, response.StatusCode)
+	require.Equal(t, "2345", body)
+	require.Equal(t, "bytes 2-5/10", response.Header.Get("Content-Range"))
+
+	response, body = do(t, http.MethodGet, url, "", map[string]string{
+		"Range": "bytes=8-",
+	})
+	require.Equal(t, http.StatusPartialContent, response.StatusCode)
+	require.Equal(t, "89", body)
+
+	response, _ = do(t, http.MethodHead, url, "", nil)
+	require.Equal(t, http.StatusOK, response.StatusCode)
+	require.Equal(t, int64(10), response.ContentLength)
+	require.Equal(t, "BlockBlob", response.Header.Get("x-ms-blob-type"))
+}
+
+func TestMissingBlob(t *testing.T) {
+	server := httptest.NewServer(NewServer(t.TempDir(), Faults{}, 1))
+	defer server.Close()
+
+	response, _ := do(t, http.MethodHead, server.URL+"/container/missing", "", nil)
+	require.Equal(t, http.StatusNotFound, response.StatusCode)
+	require.Equal(t, "BlobNotFound", response.Header.Get("x-ms-error-code"))
+
+	response, _ = do(t, http.MethodGet, server.URL+"/container/../../etc/passwd", "", nil)
+	require.Equal(t, http.StatusNotFound, response.StatusCode)
+}
+
+func TestPutBlockList(t *testing.T) {
+	server := httptest.NewServer(NewServer(t.TempDir(), Faults{}, 1))
+	defer server.Close()
+	url := server.URL + "/container/blob"
+
+	for id, data := range map[string]string{"YQ==": "first,", "Yg==": "second"} {
+		response, _ := do(t, http.MethodPut, url+"?comp=block&blockid="+id, data, nil)
+		require.Equal(t, http.StatusCreated, response.StatusCode)
+	}
+
+	blocklist := `<?xml version="1.0" encoding="utf-8"?>` +
+		`<BlockList><Latest>YQ==</Latest><Uncommitted>Yg==</Uncommitted></BlockList>`
+	response, _ := do(t, http.MethodPut, url+"?comp=blocklist", blocklist, nil)
+	require.Equal(t, http.StatusCreated, response.StatusCode)
+
+	_, body := do(t, http.MethodGet, url, "", nil)
+	require.Equal(t, "first,second", body)
+}
+
+func TestInjectedFaults(t *testing.T) {
+	root := t.TempDir()
+	upload := httptest.NewServer(NewServer(root, Faults{}, 1))
+	defer upload.Close()
+	do(t, http.MethodPut, upload.URL+"/container/blob", strings.Repeat("x", 8192), nil)
+
+	failing := httptest.NewServer(NewServer(root, Faults{ErrorRate: 1}, 1))
+	defer failing.Close()
+	response, _ := do(t, http.MethodGet, failing.URL+"/container/blob", "", nil)
+	require.Equal(t, http.StatusServiceUnavailable, response.StatusCode)
+	require.Equal(t, "ServerBusy", response.Header.Get("x-ms-error-code"))
+
+	slow := httptest.NewServer(NewServer(root, Faults{
+		Latency:   50 * time.Millisecond,
+		Bandwidth: 32 * 1024,
+	}, 1))
+	defer slow.Close()
+	start := time.Now()
+	response, body := do(t, http.MethodGet, slow.URL+"/container/blob", "", nil)
+	require.Equal(t, http.StatusOK, response.StatusCode)
+	require.Len(t, body, 8192)
+	/* 50ms of latency, and 8 KiB at 32 KiB/s takes 250ms */
+	require.GreaterOrEqual(t, time.Since(start), 300*time.Millisecond)
+}
@@ -0,0 +1,184 @@
+package flightrecorder
+
+import (
+	"net/http"
+	"sync"
+	"time"
+
+	"github.com/gin-gonic/gin"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+/** Storage reads of a request, as counted by the C++ core */
+type IO struct {
+	Requests   uint64  `json:"requests"`
+	Chunks     uint64  `json:"chunks"`
+	ChunkBytes uint64  `json:"chunkBytes"`
+	ReadMs     float64 `json:"readMs"`
+}
+
+/** A single storage read, relative to the start of the request */
+type Read struct {
+	OffsetMs   float64 `json:"offsetMs"`
+	DurationMs float64 `json:"durationMs"`
+	Chunks     uint64  `json:"chunks"`
+}
+
+/** Breakdown of a single slow request
+ *
+ * QueueWaitMs is the time spent waiting for the scheduler and the memory
+ * budget. Cache tells how the response cache was used: "hit", "derived"
+ * from other cached responses, or "miss". SurfaceSize and AttributeChunks
+ * are only set for attribute requests. Reads is the timeline of the
+ * storage reads, which is cut short for requests with very many reads.
+ */
+type Record struct {
+	Time            time.Time          `json:"time"`
+	Method          string             `json:"method"`
+	Path            string             `json:"path"`
+	Request         string             `json:"request,omitempty"`
+	Status          int                `json:"status"`
+	LatencyMs       float64            `json:"latencyMs"`
+	StagesMs        map[string]float64 `json:"stagesMs,omitempty"`
+	QueueWaitMs     float64            `json:"queueWaitMs"`
+	Cache           string             `json:"cache,omitempty"`
+	SurfaceSize     int                `json:"surfaceSize,omitempty"`
+	AttributeChunks int                `json:"attributeChunks,omitempty"`
+	IO              *IO                `json:"io,omitempty"`
+	Reads           []Read             `json:"reads,omitempty"`
+	PeakBufferBytes uint64             `json:"peakBufferBytes,omitempty"`
+	CoreCPUMs       float64            `json:"coreCpuMs,omitempty"`
+}
+
+/** Keeps the most recent requests that were slower than a threshold
+ *
+ * Records are kept in a ring buffer of fixed capacity, such that the
+ * recorder can stay on in production. All methods are safe to call
+ * concurrently.
+ */
+type Recorder struct {
+	threshold time.Duration
+	lock      sync.Mutex
+	records   []Record
+	next      int
+	full      bool
+}
+
+func NewRecorder(threshold time.Duration, capacity int) *Recorder {
+	return &Recorder{
+		threshold: threshold,
+		records:   make([]Record, max(capacity, 1)),
+	}
+}
+
+func (r *Recorder) Add(record Record) {
+	r.lock.Lock()
+	defer r.lock.Unlock()
+	r.records[r.next] = record
+	r.next = (r.next + 1) % len(r.records)
+	if r.next == 0 {
+		r.full = true
+	}
+}
+
+/** Recorded requests, the most recent first */
+func (r *Recorder) Records() []Record {
+	r.lock.Lock()
+	defer r.lock.Unlock()
+
+	n := r.next
+	if r.full {
+		n = len(r.records)
+	}
+	records := make([]Record, 0, n)
+	for i := 1; i <= n; i++ {
+		index := (r.next - i + len(r.records)) % len(r.records)
+		records = append(records, r.records[index])
+	}
+	return records
+}
+
+func milliseconds(duration time.Duration) float64 {
+	return float64(duration) / float64(time.Millisecond)
+}
+
+/** Breakdown of the request from what the handlers stored on the context */
+func newRecord(ctx *gin.Context, start time.Time, latency time.Duration) Record {
+	record := Record{
+		Time:            start.UTC(),
+		Method:          ctx.Request.Method,
+		Path:            ctx.Request.URL.Path,
+		Request:         ctx.GetString("request"),
+		Status:          ctx.Writer.Status(),
+		LatencyMs:       milliseconds(latency),
+		Cache:           ctx.GetString("cache"),
+		SurfaceSize:     ctx.GetInt("surface-size"),
+		AttributeChunks: ctx.GetInt("attribute-chunks"),
+	}
+
+	stages, _ := ctx.Get("stages")
+	if stages, ok := stages.(*core.Stages); ok {
+		record.StagesMs = map[string]float64{}
+		for _, stage := range stages.Durations() {
+			record.StagesMs[stage.Name] = milliseconds(stage.Duration)
+			if stage.Name == "schedule" || stage.Name == "admission" {
+				record.QueueWaitMs += milliseconds(stage.Duration)
+			}
+		}
+	}
+
+	io, _ := ctx.Get("io")
+	if io, ok := io.(*core.IOStats); ok {
+		totals := io.Totals()
+		record.IO = &IO{
+			Requests:   totals.Requests,
+			Chunks:     totals.Chunks,
+			ChunkBytes: totals.ChunkBytes,
+			ReadMs:     milliseconds(totals.ReadTime),
+		}
+		for _, read := range io.Reads() {
+			record.Reads = append(record.Reads, Read{
+				OffsetMs:   milliseconds(read.Start.Sub(start)),
+				DurationMs: milliseconds(read.Duration),
+				Chunks:     read.Chunks,
+			})
+		}
+	}
+
+	resources, _ := ctx.Get("resources")
+	if resources, ok := resources.(*core.ResourceStats); ok {
+		record.PeakBufferBytes = resources.PeakBytes()
+		record.CoreCPUMs = milliseconds(resources.CPUTime())
+	}
+
+	return record
+}
+
+/** Record every request that takes longer than the threshold
+ *
+ * Register it ahead of the error handler to see the final status of failed
+ * requests.
+ */
+func (r *Recorder) Middleware() gin.HandlerFunc {
+	return func(ctx *gin.Context) {
+		start := time.Now()
+		ctx.Next()
+
+		latency := time.Since(start)
+		if latency < r.threshold {
+			return
+		}
+		r.Add(newRecord(ctx, start, latency))
+	}
+}
+
+/** Serve the recorded requests as json */
+func (r *Recorder) Handler() gin.HandlerFunc {
+	return func(ctx *gin.Context) {
+		ctx.JSON(http.StatusOK, gin.H{
+			"thresholdMs": milliseconds(r.threshold),
+			"records":     r.Records(),
+		})
+	}
+}
@@ -0,0 +1,96 @@
+package flightrecorder
+
+import (
+	"encoding/json"
+	"net/http"
+	"net/http/httptest"
+	"testing"
+	"time"
+
+	"github.com/gin-gonic/gin"
+	"github.com/stretchr/testify/require"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+func paths(records []Record) []string {
+	var out []string
+	for _, record := range records {
+		out = append(out, record.Path)
+	}
+	return out
+}
+
+func TestRecordsAreKeptInRing(t *testing.T) {
+	recorder := NewRecorder(0, 3)
+	require.Empty(t, recorder.Records())
+
+	recorder.Add(Record{Path: "a"})
+	recorder.Add(Record{Path: "b"})
+	require.Equal(t, []string{"b", "a"}, paths(recorder.Records()))
+
+	recorder.Add(Record{Path: "c"})
+	recorder.Add(Record{Path: "d"})
+	require.Equal(t, []string{"d", "c", "b"}, paths(recorder.Records()))
+}
+
+func TestOnlySlowRequestsAreRecorded(t *testing.T) {
+	recorder := NewRecorder(50*time.Millisecond, 10)
+
+	app := gin.New()
+	app.Use(recorder.Middleware())
+	app.POST("fast", func(ctx *gin.Context) {
+		ctx.Status(http.StatusOK)
+	})
+	app.POST("slow", func(ctx *gin.Context) {
+		stages := core.NewStages()
+		stages.Add("schedule", 20*time.Millisecond)
+		stages.Add("admission", 10*time.Millisecond)
+		stages.Add("write", time.Millisecond)
+		ctx.Set("stages", stages)
+		ctx.Set("cache", "miss")
+		ctx.Set("surface-size", 1000)
+		ctx.Set("attribute-chunks", 10)
+
+		io := core.NewIOStats()
+		io.Add(core.IOTotals{Requests: 1, Chunks: 4, ReadTime: 40 * time.Millisecond})
+		io.AddReads(core.ReadEvent{
+			Start:    time.Now(),
+			Duration: 40 * time.Millisecond,
+			Chunks:   4,
+		})
+		ctx.Set("io", io)
+
+		time.Sleep(60 * time.Millisecond)
+		ctx.Status(http.StatusOK)
+	})
+	metrics := gin.New()
+	metrics.GET("debug/slow-requests", recorder.Handler())
+
+	for _, path := range []string{"/fast", "/slow"} {
+		app.ServeHTTP(httptest.NewRecorder(), httptest.NewRequest(http.MethodPost, path, nil))
+	}
+
+	w := httptest.NewRecorder()
+	metrics.ServeHTTP(w, httptest.NewRequest(http.MethodGet, "/debug/slow-requests", nil))
+	require.Equal(t, http.StatusOK, w.Code)
+
+	var response struct {
+		ThresholdMs float64  `json:"thresholdMs"`
+		Records     []Record `json:"records"`
+	}
+	require.NoError(t, json.Unmarshal(w.Body.Bytes(), &response))
+	require.Equal(t, 50.0, response.ThresholdMs)
+	require.Len(t, response.Records, 1)
+
+	record := response.Records[0]
+	require.Equal(t, "/slow", record.Path)
+	require.GreaterOrEqual(t, record.LatencyMs, 60.0)
+	require.Equal(t, 30.0, record.QueueWaitMs)
+	require.Equal(t, "miss", record.Cache)
+	require.Equal(t, 1000, record.SurfaceSize)
+	require.Equal(t, 10, record.AttributeChunks)
+	require.Equal(t, uint64(4), record.IO.Chunks)
+	require.Len(t, record.Reads, 1)
+	require.GreaterOrEqual(t, record.Reads[0].OffsetMs, 0.0)
+}
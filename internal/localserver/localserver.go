@@ -0,0 +1,157 @@
+package localserver
+
+import (
+	"fmt"
+	"net"
+	"net/http"
+	"net/url"
+	"strings"
+	"time"
+
+	"github.com/gin-contrib/gzip"
+	"github.com/gin-gonic/gin"
+
+	"github.com/equinor/oneseismic-api/api/handlers"
+	"github.com/equinor/oneseismic-api/api/middleware"
+	"github.com/equinor/oneseismic-api/internal/admission"
+	"github.com/equinor/oneseismic-api/internal/cache"
+	"github.com/equinor/oneseismic-api/internal/core"
+	"github.com/equinor/oneseismic-api/internal/scheduler"
+)
+
+/** Max number of opened VDS handles kept for reuse, as in the server */
+const maxPooledHandles = 64
+
+/** Server settings that matter for performance, mirroring the server options */
+type Options struct {
+	// Response cache size in megabytes
+	CacheSize      uint64
+	HandleCacheTTL time.Duration
+	// Memory budget in megabytes
+	MemoryBudget   uint64
+	SchedulerSlots int
+	// Storage accounts, e.g. local stand-ins, that vds urls may point to
+	StorageAccounts []string
+}
+
+/** Connections to local files. The vds is the path of the file, and the
+ *  sas is ignored.
+ */
+func MakeFileConnection() core.ConnectionMaker {
+	return func(path, sas string) (core.Connection, error) {
+		return core.NewFileConnection(fmt.Sprintf("file://%s", path)), nil
+	}
+}
+
+/** Connections to the storage accounts for urls, and to files otherwise */
+func makeConnection(accounts []string) core.ConnectionMaker {
+	files := MakeFileConnection()
+	if len(accounts) == 0 {
+		return files
+	}
+	azure := core.MakeAzureConnection(accounts)
+	return func(vds, sas string) (core.Connection, error) {
+		if strings.Contains(vds, "://") {
+			return azure(vds, sas)
+		}
+		return files(vds, sas)
+	}
+}
+
+/** Storage accounts of the vds urls among the given locations, which may
+ *  also be paths to local files
+ */
+func StorageAccountsOf(locations []string) []string {
+	var accounts []string
+	seen := map[string]bool{}
+	for _, location := range locations {
+		if !strings.Contains(location, "://") {
+			continue
+		}
+		u, err := url.Parse(location)
+		if err != nil {
+			continue
+		}
+		account := u.Scheme + "://" + u.Host
+		if !seen[account] {
+			seen[account] = true
+			accounts = append(accounts, account)
+		}
+	}
+	return accounts
+}
+
+/** The data endpoints of the server, reading local VDS files
+ *
+ * Used by tools that measure the server without a storage account, or
+ * against a local stand-in for one (see internal/fakeblob). The
+ * given middleware runs for every data request, after errors have been
+ * written.
+ */
+func New(opts Options, middlewares ...gin.HandlerFunc) *gin.Engine {
+	endpoint := handlers.Endpoint{
+		MakeVdsConnection: makeConnection(opts.StorageAccounts),
+		Cache:             cache.NewCache(opts.CacheSize),
+	}
+	var spareBudget core.MemoryBudget
+	if opts.MemoryBudget > 0 {
+		controller := admission.NewController(
+			opts.MemoryBudget*1024*1024,
+			30*time.Second,
+		)
+		endpoint.Admission = controller
+		spareBudget = controller.Spare()
+	}
+	if opts.HandleCacheTTL > 0 {
+		endpoint.Handles = core.NewHandlePool(
+			opts.HandleCacheTTL,
+			maxPooledHandles,
+			spareBudget,
+		)
+	}
+	if opts.SchedulerSlots > 0 {
+		endpoint.Scheduler = scheduler.NewScheduler(
+			opts.SchedulerSlots,
+			scheduler.ClassConfig{Weight: 4, MaxWait: 30 * time.Second},
+			scheduler.ClassConfig{
+				Weight:   1,
+				MaxSlots: (opts.SchedulerSlots + 1) / 2,
+				MaxWait:  5 * time.Minute,
+			},
+		)
+	}
+
+	gin.SetMode(gin.ReleaseMode)
+	app := gin.New()
+	app.Use(gin.Recovery())
+	app.Use(gzip.Gzip(gzip.BestSpeed))
+
+	seismic := app.Group("/")
+	seismic.Use(middleware.ErrorHandler)
+	seismic.Use(middlewares...)
+
+	seismic.GET("metadata", endpoint.MetadataGet)
+	seismic.POST("metadata", endpoint.MetadataPost)
+
+	seismic.GET("slice", endpoint.SliceGet)
+	seismic.POST("slice", endpoint.SlicePost)
+
+	seismic.GET("fence", endpoint.FenceGet)
+	seismic.POST("fence", endpoint.FencePost)
+
+	attributesSurface := seismic.Group("attributes").Group("surface")
+	attributesSurface.POST("along", endpoint.AttributesAlongSurfacePost)
+	attributesSurface.POST("between", endpoint.AttributesBetweenSurfacesPost)
+
+	return app
+}
+
+/** Serve on a free local port, returning the url of the server */
+func Start(handler http.Handler) (string, error) {
+	listener, err := net.Listen("tcp", "127.0.0.1:0")
+	if err != nil {
+		return "", err
+	}
+	go http.Serve(listener, handler)
+	return "http://" + listener.Addr().String(), nil
+}
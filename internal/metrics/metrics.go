@@ -9,6 +9,10 @@ import (
 	"github.com/gin-gonic/gin"
 	"github.com/prometheus/client_golang/prometheus"
 	"github.com/prometheus/client_golang/prometheus/promhttp"
+
+	"github.com/equinor/oneseismic-api/internal/cache"
+	"github.com/equinor/oneseismic-api/internal/core"
+	"github.com/equinor/oneseismic-api/internal/scheduler"
 )
 
 const (
@@ -17,6 +21,7 @@ const (
 	m  = 60 * s
 	kb = 1024
 	mb = 1024*kb
+	gb = 1024*mb
 )
 
 type Metrics struct {
@@ -26,6 +31,13 @@ type Metrics struct {
 	requestDurations *prometheus.HistogramVec
 	responseSizes    *prometheus.HistogramVec
 	requestCount     *prometheus.CounterVec
+	stageDurations   *prometheus.HistogramVec
+	ioRequests       *prometheus.CounterVec
+	ioChunks         *prometheus.CounterVec
+	ioChunkBytes     *prometheus.CounterVec
+	ioReadSeconds    *prometheus.CounterVec
+	peakBufferBytes  *prometheus.HistogramVec
+	coreCPUSeconds   *prometheus.HistogramVec
 }
 
 /** Create a new metric instance
@@ -53,11 +65,56 @@ func NewMetrics() *Metrics {
 			Name: "oneseismic_api_requests_count",
 			Help: "oneseismic-api number of requests.",
 		}, []string{"method", "path", "storage_account"}),
+
+		stageDurations: prometheus.NewHistogramVec(prometheus.HistogramOpts{
+			Name:    "oneseismic_api_stage_durations_histogram_seconds",
+			Help:    "oneseismic-api latency distributions of the stages of a request.",
+			Buckets: []float64{1*ms, 10*ms, 50*ms, 100*ms, 500*ms, 1*s, 5*s, 20*s, 1*m},
+		}, []string{"path", "stage"}),
+
+		ioRequests: prometheus.NewCounterVec(prometheus.CounterOpts{
+			Name: "oneseismic_api_io_requests_total",
+			Help: "oneseismic-api number of read requests made to OpenVDS.",
+		}, []string{"storage_account"}),
+
+		ioChunks: prometheus.NewCounterVec(prometheus.CounterOpts{
+			Name: "oneseismic_api_io_chunks_total",
+			Help: "oneseismic-api number of VDS chunks touched by reads.",
+		}, []string{"storage_account"}),
+
+		ioChunkBytes: prometheus.NewCounterVec(prometheus.CounterOpts{
+			Name: "oneseismic_api_io_chunk_bytes_total",
+			Help: "oneseismic-api decoded size of the VDS chunks touched by reads.",
+		}, []string{"storage_account"}),
+
+		ioReadSeconds: prometheus.NewCounterVec(prometheus.CounterOpts{
+			Name: "oneseismic_api_io_read_seconds_total",
+			Help: "oneseismic-api time spent waiting for reads from OpenVDS.",
+		}, []string{"storage_account"}),
+
+		peakBufferBytes: prometheus.NewHistogramVec(prometheus.HistogramOpts{
+			Name:    "oneseismic_api_peak_buffer_histogram_bytes",
+			Help:    "oneseismic-api distributions of the most memory held in data buffers by the core during a request.",
+			Buckets: []float64{1*mb, 10*mb, 50*mb, 100*mb, 500*mb, 1*gb, 2*gb, 5*gb},
+		}, []string{"path"}),
+
+		coreCPUSeconds: prometheus.NewHistogramVec(prometheus.HistogramOpts{
+			Name:    "oneseismic_api_core_cpu_histogram_seconds",
+			Help:    "oneseismic-api distributions of the CPU time spent in the core during a request.",
+			Buckets: []float64{1*ms, 10*ms, 50*ms, 100*ms, 500*ms, 1*s, 5*s, 20*s, 1*m},
+		}, []string{"path"}),
 	}
 
 	registry.MustRegister(metrics.requestDurations)
 	registry.MustRegister(metrics.responseSizes)
 	registry.MustRegister(metrics.requestCount)
+	registry.MustRegister(metrics.stageDurations)
+	registry.MustRegister(metrics.ioRequests)
+	registry.MustRegister(metrics.ioChunks)
+	registry.MustRegister(metrics.ioChunkBytes)
+	registry.MustRegister(metrics.ioReadSeconds)
+	registry.MustRegister(metrics.peakBufferBytes)
+	registry.MustRegister(metrics.coreCPUSeconds)
 
 	return metrics;
 }
@@ -67,6 +124,9 @@ func NewGinMiddleware(metrics *Metrics) gin.HandlerFunc {
 	return func(ctx *gin.Context) {
 		start := time.Now()
 		ctx.Next()
+		stages, _ := ctx.Get("stages")
+		io, _ := ctx.Get("io")
+		resources, _ := ctx.Get("resources")
 
 		go func() {
 			path     := ctx.Request.URL.Path
@@ -85,10 +145,96 @@ func NewGinMiddleware(metrics *Metrics) gin.HandlerFunc {
 
 			metrics.responseSizes.WithLabelValues(path, status).Observe(size)
 			metrics.updateRequestCountMetric(method, path, vdsURLs)
+
+			if stages, ok := stages.(*core.Stages); ok {
+				for _, stage := range stages.Durations() {
+					metrics.stageDurations.WithLabelValues(
+						path,
+						stage.Name,
+					).Observe(stage.Duration.Seconds())
+				}
+			}
+
+			if io, ok := io.(*core.IOStats); ok {
+				metrics.updateIOMetrics(io.Totals(), vdsURLs)
+			}
+
+			if resources, ok := resources.(*core.ResourceStats); ok {
+				metrics.peakBufferBytes.WithLabelValues(path).Observe(
+					float64(resources.PeakBytes()),
+				)
+				metrics.coreCPUSeconds.WithLabelValues(path).Observe(
+					resources.CPUTime().Seconds(),
+				)
+			}
 		}()
 	}
 }
 
+/** Export hits and misses for every tier of the response cache
+ *
+ * Counters are read from the cache when metrics are scraped, so the cache
+ * itself does not depend on prometheus.
+ */
+func (metrics *Metrics) RegisterCacheStats(reporter cache.StatsReporter) {
+	for i, stats := range reporter.Stats() {
+		index := i
+		labels := prometheus.Labels{"tier": stats.Tier}
+
+		metrics.registry.MustRegister(prometheus.NewCounterFunc(
+			prometheus.CounterOpts{
+				Name:        "oneseismic_api_cache_hits_total",
+				Help:        "oneseismic-api number of response cache hits per tier.",
+				ConstLabels: labels,
+			},
+			func() float64 { return float64(reporter.Stats()[index].Hits) },
+		))
+		metrics.registry.MustRegister(prometheus.NewCounterFunc(
+			prometheus.CounterOpts{
+				Name:        "oneseismic_api_cache_misses_total",
+				Help:        "oneseismic-api number of response cache misses per tier.",
+				ConstLabels: labels,
+			},
+			func() float64 { return float64(reporter.Stats()[index].Misses) },
+		))
+	}
+}
+
+/** Export queue depth, running requests and wait times per scheduling class */
+func (metrics *Metrics) RegisterScheduler(s *scheduler.Scheduler) {
+	waits := prometheus.NewHistogramVec(prometheus.HistogramOpts{
+		Name:    "oneseismic_api_scheduler_wait_seconds",
+		Help:    "oneseismic-api time requests wait to be scheduled.",
+		Buckets: []float64{1*ms, 10*ms, 50*ms, 100*ms, 500*ms, 1*s, 5*s, 30*s},
+	}, []string{"class"})
+	metrics.registry.MustRegister(waits)
+	s.SetWaitObserver(func(class scheduler.Class, wait time.Duration) {
+		waits.WithLabelValues(class.String()).Observe(wait.Seconds())
+	})
+
+	for i, stats := range s.Stats() {
+		index := i
+		labels := prometheus.Labels{"class": stats.Class}
+
+		metrics.registry.MustRegister(prometheus.NewGaugeFunc(
+			prometheus.GaugeOpts{
+				Name:        "oneseismic_api_scheduler_queued_requests",
+				Help:        "oneseismic-api number of requests waiting to be scheduled.",
+				ConstLabels: labels,
+			},
+			func() float64 { return float64(s.Stats()[index].Queued) },
+		))
+		metrics.registry.MustRegister(prometheus.NewGaugeFunc(
+			prometheus.GaugeOpts{
+				Name:        "oneseismic_api_scheduler_running_requests",
+				Help:        "oneseismic-api number of scheduled requests in progress.",
+				ConstLabels: labels,
+			},
+			func() float64 { return float64(s.Stats()[index].Running) },
+		))
+	}
+}
+
 func extractStorageAccounts(vdsURLs []string) []string{
 	var storageAccounts []string
 	for _, vdsURL := range vdsURLs {
@@ -113,6 +259,16 @@ func (metrics *Metrics) updateRequestCountMetric(method string, path string, vds
 	}
 }
 
+/** Account the reads of a request to every storage account it read from */
+func (metrics *Metrics) updateIOMetrics(totals core.IOTotals, vdsURLs []string) {
+	for _, storageAccount := range extractStorageAccounts(vdsURLs) {
+		metrics.ioRequests.WithLabelValues(storageAccount).Add(float64(totals.Requests))
+		metrics.ioChunks.WithLabelValues(storageAccount).Add(float64(totals.Chunks))
+		metrics.ioChunkBytes.WithLabelValues(storageAccount).Add(float64(totals.ChunkBytes))
+		metrics.ioReadSeconds.WithLabelValues(storageAccount).Add(totals.ReadTime.Seconds())
+	}
+}
+
 /** New gin handler for prometheus
  *
  * A tiny helper that sets up a handle for promethus and wraps it in
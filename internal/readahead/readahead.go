@@ -0,0 +1,153 @@
+package readahead
+
+import (
+	"sync"
+	"time"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+const (
+	// Number of goroutines reading ahead
+	workers = 2
+	// Number of reads that can wait for a worker. Later reads are dropped
+	queueSize = 16
+	// Max number of sequences followed at the same time
+	maxSequences = 4096
+	// Sequences that are not continued within this time start over
+	sequenceTTL = time.Minute
+)
+
+type sequence struct {
+	position int
+	step     int
+	seen     time.Time
+}
+
+/** Reads ahead of clients that step through the lines of a volume
+ *
+ * Each request is a position in a sequence, e.g. the line number of a slice,
+ * where the sequence is everything else about the request and who made it.
+ * Once a sequence moves in steady steps, the next positions are read in the
+ * background such that the following requests are likely to be cached.
+ *
+ * Reads ahead never hold up requests: they are dropped when the workers
+ * fall behind, and only use spare memory from the budget. Each key is only
+ * read by one worker at a time.
+ */
+type ReadAhead struct {
+	depth  int
+	budget core.MemoryBudget
+
+	lock      sync.Mutex
+	sequences map[string]*sequence
+	inflight  map[string]bool
+	jobs      chan func()
+}
+
+/** Read depth positions ahead, taking memory from budget, which may be nil */
+func New(depth int, budget core.MemoryBudget) *ReadAhead {
+	r := &ReadAhead{
+		depth:     depth,
+		budget:    budget,
+		sequences: make(map[string]*sequence),
+		inflight:  make(map[string]bool),
+		jobs:      make(chan func(), queueSize),
+	}
+	for i := 0; i < workers; i++ {
+		go r.work()
+	}
+	return r
+}
+
+/** Budget that reads ahead take their memory from. nil if unlimited */
+func (r *ReadAhead) Budget() core.MemoryBudget {
+	return r.budget
+}
+
+/** Record that position of a sequence was requested, and return the positions
+ *  to read ahead, nearest first
+ *
+ * A sequence moves steadily when it takes the same step twice in a row, like
+ * stepping through annotated lines with an increment, or when it steps to a
+ * neighbouring position. Other steps, like jumping around in the volume,
+ * read nothing ahead.
+ */
+func (r *ReadAhead) Next(key string, position int) []int {
+	now := time.Now()
+
+	r.lock.Lock()
+	defer r.lock.Unlock()
+
+	s, exists := r.sequences[key]
+	if !exists || now.Sub(s.seen) > sequenceTTL {
+		if len(r.sequences) >= maxSequences {
+			r.forgetStale(now)
+		}
+		if len(r.sequences) < maxSequences {
+			r.sequences[key] = &sequence{position: position, seen: now}
+		}
+		return nil
+	}
+
+	step := position - s.position
+	steady := step != 0 && (step == s.step || step == 1 || step == -1)
+	s.position = position
+	s.step = step
+	s.seen = now
+	if !steady {
+		return nil
+	}
+
+	ahead := make([]int, r.depth)
+	for i := range ahead {
+		ahead[i] = position + (i+1)*step
+	}
+	return ahead
+}
+
+/** Forget sequences that have not moved for a while. Expects lock held */
+func (r *ReadAhead) forgetStale(now time.Time) {
+	for key, s := range r.sequences {
+		if now.Sub(s.seen) > sequenceTTL {
+			delete(r.sequences, key)
+		}
+	}
+}
+
+/** Run read in the background, unless key is already being read or the
+ *  workers are busy. Reports whether the read was scheduled.
+ */
+func (r *ReadAhead) Schedule(key string, read func()) bool {
+	r.lock.Lock()
+	if r.inflight[key] {
+		r.lock.Unlock()
+		return false
+	}
+	r.inflight[key] = true
+	r.lock.Unlock()
+
+	job := func() {
+		defer r.done(key)
+		read()
+	}
+	select {
+	case r.jobs <- job:
+		return true
+	default:
+		r.done(key)
+		return false
+	}
+}
+
+func (r *ReadAhead) done(key string) {
+	r.lock.Lock()
+	defer r.lock.Unlock()
+	delete(r.inflight, key)
+}
+
+func (r *ReadAhead) work() {
+	for job := range r.jobs {
+		job()
+	}
+}
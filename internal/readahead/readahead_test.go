@@ -0,0 +1,85 @@
+package readahead
+
+import (
+	"fmt"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+)
+
+func TestSteadyStepsAreReadAhead(t *testing.T) {
+	r := New(3, nil)
+
+	require.Empty(t, r.Next("inline", 10))
+	require.Equal(t, []int{12, 13, 14}, r.Next("inline", 11))
+	require.Equal(t, []int{13, 14, 15}, r.Next("inline", 12))
+
+	/* Stepping back reads ahead backwards */
+	require.Equal(t, []int{10, 9, 8}, r.Next("inline", 11))
+}
+
+func TestRepeatedStepsAreReadAhead(t *testing.T) {
+	r := New(2, nil)
+
+	require.Empty(t, r.Next("inline", 100))
+	require.Empty(t, r.Next("inline", 104))
+	require.Equal(t, []int{112, 116}, r.Next("inline", 108))
+}
+
+func TestJumpsAreNotReadAhead(t *testing.T) {
+	r := New(2, nil)
+
+	require.Empty(t, r.Next("inline", 10))
+	require.Empty(t, r.Next("inline", 50))
+	require.Empty(t, r.Next("inline", 20))
+	require.Empty(t, r.Next("inline", 20))
+}
+
+func TestSequencesAreFollowedSeparately(t *testing.T) {
+	r := New(1, nil)
+
+	require.Empty(t, r.Next("inline", 10))
+	require.Empty(t, r.Next("crossline", 50))
+	require.Equal(t, []int{12}, r.Next("inline", 11))
+	require.Equal(t, []int{48}, r.Next("crossline", 49))
+}
+
+func TestKeysAreReadOnceAtATime(t *testing.T) {
+	r := New(1, nil)
+
+	started := make(chan struct{})
+	unblock := make(chan struct{})
+	require.True(t, r.Schedule("a", func() {
+		close(started)
+		<-unblock
+	}))
+	<-started
+
+	require.False(t, r.Schedule("a", func() {}))
+
+	done := make(chan struct{})
+	require.True(t, r.Schedule("b", func() { close(done) }))
+	<-done
+
+	close(unblock)
+	require.Eventually(t, func() bool {
+		return r.Schedule("a", func() {})
+	}, time.Second, time.Millisecond)
+}
+
+func TestReadsAreDroppedWhenWorkersAreBusy(t *testing.T) {
+	r := New(1, nil)
+
+	unblock := make(chan struct{})
+	defer close(unblock)
+
+	scheduled := 0
+	for i := 0; i < workers+queueSize+10; i++ {
+		if r.Schedule(fmt.Sprintf("key%d", i), func() { <-unblock }) {
+			scheduled++
+		}
+	}
+	require.LessOrEqual(t, scheduled, workers+queueSize)
+	require.GreaterOrEqual(t, scheduled, queueSize)
+}
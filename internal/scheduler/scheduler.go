@@ -0,0 +1,320 @@
+package scheduler
+
+import (
+	"container/heap"
+	"container/list"
+	"context"
+	"fmt"
+	"sync"
+	"time"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+/** Scheduling class of a request */
+type Class int
+
+const (
+	// Requests a user is actively waiting for, like slices and fences
+	Interactive Class = iota
+	// Long running requests, like attribute calculations
+	Batch
+	nclasses
+)
+
+func (c Class) String() string {
+	switch c {
+	case Interactive:
+		return "interactive"
+	case Batch:
+		return "batch"
+	default:
+		return fmt.Sprintf("class(%d)", int(c))
+	}
+}
+
+type ClassConfig struct {
+	// Share of the dispatches when classes compete for free slots
+	Weight int
+	// Max number of slots held by requests of the class at the same time
+	MaxSlots int
+	// Max time a request of the class waits in the queue
+	MaxWait time.Duration
+}
+
+type ClassStats struct {
+	Class   string
+	Queued  int
+	Running int
+}
+
+type waiter struct {
+	deadline time.Time
+	ready    chan struct{}
+	index    int
+}
+
+/** Waiters of a single client, ordered by deadline */
+type waiterHeap []*waiter
+
+func (h waiterHeap) Len() int           { return len(h) }
+func (h waiterHeap) Less(i, j int) bool { return h[i].deadline.Before(h[j].deadline) }
+func (h waiterHeap) Swap(i, j int) {
+	h[i], h[j] = h[j], h[i]
+	h[i].index = i
+	h[j].index = j
+}
+
+func (h *waiterHeap) Push(x any) {
+	w := x.(*waiter)
+	w.index = len(*h)
+	*h = append(*h, w)
+}
+
+func (h *waiterHeap) Pop() any {
+	old := *h
+	w := old[len(old)-1]
+	old[len(old)-1] = nil
+	*h = old[:len(old)-1]
+	return w
+}
+
+type clientWaiters struct {
+	name    string
+	waiters waiterHeap
+	element *list.Element
+}
+
+type classQueue struct {
+	config  ClassConfig
+	credit  int
+	running int
+	queued  int
+	clients map[string]*clientWaiters
+	// Clients with waiting requests, in round robin order
+	order *list.List
+}
+
+/** Schedules data requests onto a fixed number of slots
+ *
+ * Every request must hold a slot while it reads data. When all slots are
+ * taken requests wait in a queue per class, and free slots are handed out by
+ * smooth weighted round robin between the classes that have waiting
+ * requests. Each class is also capped in how many slots it may hold, such
+ * that long running batch requests can never occupy all slots and stall
+ * interactive ones.
+ *
+ * Within a class, clients take turns, so a single client issuing many
+ * requests does not starve others. A client's own requests are served
+ * earliest deadline first. The deadline of a request is the max wait of its
+ * class, or the deadline of the request context if that is sooner. Requests
+ * still waiting at their deadline are rejected as the server is overloaded.
+ */
+type Scheduler struct {
+	slots int
+
+	lock    sync.Mutex
+	running int
+	classes [nclasses]*classQueue
+
+	observeWait func(class Class, wait time.Duration)
+}
+
+func NewScheduler(slots int, interactive, batch ClassConfig) *Scheduler {
+	s := &Scheduler{slots: slots}
+	for class, config := range map[Class]ClassConfig{
+		Interactive: interactive,
+		Batch:       batch,
+	} {
+		if config.Weight < 1 {
+			config.Weight = 1
+		}
+		if config.MaxSlots < 1 || config.MaxSlots > slots {
+			config.MaxSlots = slots
+		}
+		s.classes[class] = &classQueue{
+			config:  config,
+			clients: make(map[string]*clientWaiters),
+			order:   list.New(),
+		}
+	}
+	return s
+}
+
+/** Report the time admitted requests spent waiting for a slot
+ *
+ * Must be set before the scheduler is in use.
+ */
+func (s *Scheduler) SetWaitObserver(observe func(class Class, wait time.Duration)) {
+	s.observeWait = observe
+}
+
+/** Wait for a slot, returning a function that gives the slot back */
+func (s *Scheduler) Acquire(
+	ctx context.Context,
+	class Class,
+	client string,
+) (func(), error) {
+	start := time.Now()
+	queue := s.classes[class]
+
+	release := func() { s.release(class) }
+
+	s.lock.Lock()
+	if queue.queued == 0 && s.available(queue) {
+		s.admit(queue)
+		s.lock.Unlock()
+		s.observe(class, 0)
+		return release, nil
+	}
+
+	deadline := start.Add(queue.config.MaxWait)
+	if contextDeadline, ok := ctx.Deadline(); ok && contextDeadline.Before(deadline) {
+		deadline = contextDeadline
+	}
+	w := &waiter{deadline: deadline, ready: make(chan struct{})}
+	clientQueue := s.enqueue(queue, client, w)
+	s.lock.Unlock()
+
+	timer := time.NewTimer(time.Until(deadline))
+	defer timer.Stop()
+
+	var err error
+	select {
+	case <-w.ready:
+		s.observe(class, time.Since(start))
+		return release, nil
+	case <-timer.C:
+		err = core.NewResourceExhausted(fmt.Sprintf(
+			"Server is busy, timed out after %v waiting to be scheduled. "+
+				"Try again later",
+			time.Since(start).Round(time.Millisecond),
+		))
+	case <-ctx.Done():
+		err = core.NewResourceExhausted(fmt.Sprintf(
+			"Request was cancelled while waiting to be scheduled: %v",
+			ctx.Err(),
+		))
+	}
+
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	select {
+	case <-w.ready:
+		// Admitted while giving up
+		s.running--
+		queue.running--
+		s.dispatch()
+		return nil, err
+	default:
+	}
+	s.dequeue(queue, clientQueue, w.index)
+	return nil, err
+}
+
+func (s *Scheduler) observe(class Class, wait time.Duration) {
+	if s.observeWait != nil {
+		s.observeWait(class, wait)
+	}
+}
+
+func (s *Scheduler) release(class Class) {
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	s.running--
+	s.classes[class].running--
+	s.dispatch()
+}
+
+/** Whether a request of the class can take a slot now. Expects lock held */
+func (s *Scheduler) available(queue *classQueue) bool {
+	return s.running < s.slots && queue.running < queue.config.MaxSlots
+}
+
+/** Expects lock held */
+func (s *Scheduler) admit(queue *classQueue) {
+	s.running++
+	queue.running++
+}
+
+/** Expects lock held */
+func (s *Scheduler) enqueue(queue *classQueue, client string, w *waiter) *clientWaiters {
+	clientQueue, exists := queue.clients[client]
+	if !exists {
+		clientQueue = &clientWaiters{name: client}
+		queue.clients[client] = clientQueue
+	}
+	if clientQueue.element == nil {
+		clientQueue.element = queue.order.PushBack(clientQueue)
+	}
+	heap.Push(&clientQueue.waiters, w)
+	queue.queued++
+	return clientQueue
+}
+
+/** Remove the waiter at index from the client's queue. Expects lock held */
+func (s *Scheduler) dequeue(queue *classQueue, clientQueue *clientWaiters, index int) *waiter {
+	w := heap.Remove(&clientQueue.waiters, index).(*waiter)
+	queue.queued--
+	if clientQueue.waiters.Len() == 0 {
+		queue.order.Remove(clientQueue.element)
+		delete(queue.clients, clientQueue.name)
+	}
+	return w
+}
+
+/** Hand out free slots to waiting requests. Expects lock held */
+func (s *Scheduler) dispatch() {
+	for {
+		queue := s.next()
+		if queue == nil {
+			return
+		}
+
+		clientQueue := queue.order.Front().Value.(*clientWaiters)
+		queue.order.MoveToBack(clientQueue.element)
+		w := s.dequeue(queue, clientQueue, 0)
+
+		s.admit(queue)
+		close(w.ready)
+	}
+}
+
+/** Pick the class to hand the next free slot to. Expects lock held
+ *
+ * Smooth weighted round robin: every eligible class earns its weight in
+ * credit, the class with the most credit wins and pays back the total
+ * weight of all eligible classes.
+ */
+func (s *Scheduler) next() *classQueue {
+	var chosen *classQueue
+	total := 0
+	for _, queue := range s.classes {
+		if queue.queued == 0 || !s.available(queue) {
+			continue
+		}
+		queue.credit += queue.config.Weight
+		total += queue.config.Weight
+		if chosen == nil || queue.credit > chosen.credit {
+			chosen = queue
+		}
+	}
+	if chosen != nil {
+		chosen.credit -= total
+	}
+	return chosen
+}
+
+func (s *Scheduler) Stats() []ClassStats {
+	s.lock.Lock()
+	defer s.lock.Unlock()
+	stats := make([]ClassStats, len(s.classes))
+	for class, queue := range s.classes {
+		stats[class] = ClassStats{
+			Class:   Class(class).String(),
+			Queued:  queue.queued,
+			Running: queue.running,
+		}
+	}
+	return stats
+}
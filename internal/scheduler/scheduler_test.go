@@ -0,0 +1,184 @@
+package scheduler
+
+import (
+	"context"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+
+	"github.com/equinor/oneseismic-api/internal/core"
+)
+
+func newTestScheduler(slots int, batchSlots int) *Scheduler {
+	return NewScheduler(
+		slots,
+		ClassConfig{Weight: 1, MaxWait: time.Second},
+		ClassConfig{Weight: 1, MaxSlots: batchSlots, MaxWait: time.Second},
+	)
+}
+
+func waitForQueued(t *testing.T, s *Scheduler, class Class, queued int) {
+	require.Eventually(t, func() bool {
+		return s.Stats()[class].Queued == queued
+	}, time.Second, time.Millisecond)
+}
+
+/** Start a request in the background, reporting its id once it is admitted */
+func acquireInBackground(
+	t *testing.T,
+	s *Scheduler,
+	class Class,
+	client string,
+	id int,
+	admitted chan<- int,
+) {
+	queued := s.Stats()[class].Queued
+	go func() {
+		release, err := s.Acquire(context.Background(), class, client)
+		if err != nil {
+			admitted <- -1
+			return
+		}
+		admitted <- id
+		release()
+	}()
+	waitForQueued(t, s, class, queued+1)
+}
+
+func TestAdmitsUpToSlots(t *testing.T) {
+	s := newTestScheduler(2, 2)
+
+	release1, err := s.Acquire(context.Background(), Interactive, "a")
+	require.NoError(t, err)
+	release2, err := s.Acquire(context.Background(), Batch, "a")
+	require.NoError(t, err)
+
+	stats := s.Stats()
+	require.Equal(t, 1, stats[Interactive].Running)
+	require.Equal(t, 1, stats[Batch].Running)
+
+	admitted := make(chan int, 1)
+	acquireInBackground(t, s, Interactive, "a", 1, admitted)
+
+	release1()
+	require.Equal(t, 1, <-admitted)
+	release2()
+}
+
+func TestBatchCannotTakeAllSlots(t *testing.T) {
+	s := newTestScheduler(2, 1)
+
+	release, err := s.Acquire(context.Background(), Batch, "a")
+	require.NoError(t, err)
+	defer release()
+
+	admitted := make(chan int, 1)
+	acquireInBackground(t, s, Batch, "a", 1, admitted)
+
+	interactive, err := s.Acquire(context.Background(), Interactive, "a")
+	require.NoError(t, err)
+	interactive()
+
+	require.Equal(t, 1, s.Stats()[Batch].Queued)
+}
+
+func TestClientsTakeTurns(t *testing.T) {
+	s := newTestScheduler(1, 1)
+
+	release, err := s.Acquire(context.Background(), Interactive, "a")
+	require.NoError(t, err)
+
+	admitted := make(chan int, 3)
+	acquireInBackground(t, s, Interactive, "a", 1, admitted)
+	acquireInBackground(t, s, Interactive, "a", 2, admitted)
+	acquireInBackground(t, s, Interactive, "b", 3, admitted)
+
+	release()
+	require.Equal(t, 1, <-admitted)
+	require.Equal(t, 3, <-admitted)
+	require.Equal(t, 2, <-admitted)
+}
+
+func TestClassesShareByWeight(t *testing.T) {
+	s := NewScheduler(
+		1,
+		ClassConfig{Weight: 2, MaxWait: time.Second},
+		ClassConfig{Weight: 1, MaxWait: time.Second},
+	)
+
+	release, err := s.Acquire(context.Background(), Interactive, "a")
+	require.NoError(t, err)
+
+	admitted := make(chan int, 6)
+	for i := 0; i < 3; i++ {
+		acquireInBackground(t, s, Interactive, "a", int(Interactive), admitted)
+		acquireInBackground(t, s, Batch, "a", int(Batch), admitted)
+	}
+
+	release()
+	order := make([]int, 6)
+	for i := range order {
+		order[i] = <-admitted
+	}
+	require.Equal(t, []int{0, 1, 0, 0, 1, 1}, order)
+}
+
+func TestEarliestDeadlineFirst(t *testing.T) {
+	s := newTestScheduler(1, 1)
+
+	release, err := s.Acquire(context.Background(), Interactive, "a")
+	require.NoError(t, err)
+
+	admitted := make(chan int, 2)
+	acquireInBackground(t, s, Interactive, "a", 1, admitted)
+
+	ctx, cancel := context.WithTimeout(context.Background(), 500*time.Millisecond)
+	defer cancel()
+	go func() {
+		release, err := s.Acquire(ctx, Interactive, "a")
+		if err == nil {
+			admitted <- 2
+			release()
+		}
+	}()
+	waitForQueued(t, s, Interactive, 2)
+
+	release()
+	require.Equal(t, 2, <-admitted)
+	require.Equal(t, 1, <-admitted)
+}
+
+func TestQueuedRequestTimesOut(t *testing.T) {
+	s := NewScheduler(
+		1,
+		ClassConfig{MaxWait: 10 * time.Millisecond},
+		ClassConfig{MaxWait: 10 * time.Millisecond},
+	)
+
+	release, err := s.Acquire(context.Background(), Interactive, "a")
+	require.NoError(t, err)
+	defer release()
+
+	_, err = s.Acquire(context.Background(), Interactive, "a")
+	require.IsType(t, &core.ResourceExhausted{}, err)
+
+	stats := s.Stats()
+	require.Equal(t, 0, stats[Interactive].Queued)
+	require.Equal(t, 1, stats[Interactive].Running)
+}
+
+func TestWaitIsObserved(t *testing.T) {
+	s := newTestScheduler(1, 1)
+
+	observed := make(chan Class, 2)
+	s.SetWaitObserver(func(class Class, wait time.Duration) {
+		observed <- class
+	})
+
+	release, err := s.Acquire(context.Background(), Batch, "a")
+	require.NoError(t, err)
+	release()
+
+	require.Equal(t, Batch, <-observed)
+}
@@ -0,0 +1,199 @@
+package warmup
+
+import (
+	"container/list"
+	"context"
+	"errors"
+	"sync"
+
+	"github.com/google/uuid"
+)
+
+const (
+	Queued    = "queued"
+	Running   = "running"
+	Done      = "done"
+	Failed    = "failed"
+	Cancelled = "cancelled"
+)
+
+/** Progress of a warm-up job */
+type Progress struct {
+	// Id to follow or cancel the job with
+	Id string `json:"id" example:"3b241101-e2bb-4255-8caf-4136c566a962"`
+	// The vds urls being warmed up, without sas-tokens
+	Vds []string `json:"vds"`
+	// One of "queued", "running", "done", "failed" and "cancelled"
+	State string `json:"state" example:"running"`
+	// Number of steps done and in total
+	Done  int `json:"done" example:"12"`
+	Total int `json:"total" example:"40"`
+	// Why the job failed, if it did
+	Error string `json:"error,omitempty"`
+} //@name PrefetchProgress
+
+type job struct {
+	lock     sync.Mutex
+	progress Progress
+	cancel   context.CancelFunc
+}
+
+func (j *job) snapshot() Progress {
+	j.lock.Lock()
+	defer j.lock.Unlock()
+	progress := j.progress
+	progress.Vds = append([]string(nil), j.progress.Vds...)
+	return progress
+}
+
+func (j *job) finished() bool {
+	state := j.snapshot().State
+	return state == Done || state == Failed || state == Cancelled
+}
+
+/** Background jobs that warm caches ahead of use
+ *
+ * A job is a number of steps, run one after the other in the background by
+ * a function that is handed a context and a callback to report each step
+ * done. At most maxRunning jobs run at the same time, later jobs wait in
+ * line. Jobs are cancelled through their context, which the function is
+ * expected to check between steps.
+ *
+ * The progress of the last maxJobs jobs is kept, the oldest finished jobs
+ * are forgotten first. New jobs are refused while maxJobs jobs are still
+ * unfinished.
+ */
+type Jobs struct {
+	maxRunning chan struct{}
+	maxJobs    int
+
+	lock  sync.Mutex
+	jobs  map[string]*list.Element
+	order *list.List
+}
+
+func NewJobs(maxRunning, maxJobs int) *Jobs {
+	return &Jobs{
+		maxRunning: make(chan struct{}, maxRunning),
+		maxJobs:    maxJobs,
+		jobs:       make(map[string]*list.Element),
+		order:      list.New(),
+	}
+}
+
+var ErrTooManyJobs = errors.New("Too many warm-up jobs in progress")
+
+/** Start a job of total steps in the background */
+func (j *Jobs) Start(
+	vds []string,
+	total int,
+	run func(ctx context.Context, stepDone func()) error,
+) (Progress, error) {
+	ctx, cancel := context.WithCancel(context.Background())
+	job := &job{
+		progress: Progress{
+			Id:    uuid.New().String(),
+			Vds:   append([]string(nil), vds...),
+			State: Queued,
+			Total: total,
+		},
+		cancel: cancel,
+	}
+
+	j.lock.Lock()
+	j.forget()
+	if j.order.Len() >= j.maxJobs {
+		j.lock.Unlock()
+		cancel()
+		return Progress{}, ErrTooManyJobs
+	}
+	j.jobs[job.progress.Id] = j.order.PushBack(job)
+	j.lock.Unlock()
+
+	go j.run(ctx, job, run)
+	return job.snapshot(), nil
+}
+
+func (j *Jobs) run(
+	ctx context.Context,
+	job *job,
+	run func(ctx context.Context, stepDone func()) error,
+) {
+	defer job.cancel()
+
+	select {
+	case j.maxRunning <- struct{}{}:
+		defer func() { <-j.maxRunning }()
+	case <-ctx.Done():
+		job.finish(ctx.Err())
+		return
+	}
+
+	job.lock.Lock()
+	if job.progress.State == Queued {
+		job.progress.State = Running
+	}
+	job.lock.Unlock()
+
+	stepDone := func() {
+		job.lock.Lock()
+		defer job.lock.Unlock()
+		job.progress.Done++
+	}
+	err := run(ctx, stepDone)
+	if ctx.Err() != nil {
+		err = ctx.Err()
+	}
+	job.finish(err)
+}
+
+func (j *job) finish(err error) {
+	j.lock.Lock()
+	defer j.lock.Unlock()
+	switch {
+	case err == context.Canceled:
+		j.progress.State = Cancelled
+	case err != nil:
+		j.progress.State = Failed
+		j.progress.Error = err.Error()
+	default:
+		j.progress.State = Done
+	}
+}
+
+/** Forget the oldest finished jobs to make room for a new one. Expects lock
+ *  held
+ */
+func (j *Jobs) forget() {
+	for element := j.order.Front(); element != nil && j.order.Len() >= j.maxJobs; {
+		next := element.Next()
+		if job := element.Value.(*job); job.finished() {
+			delete(j.jobs, job.progress.Id)
+			j.order.Remove(element)
+		}
+		element = next
+	}
+}
+
+func (j *Jobs) Get(id string) (Progress, bool) {
+	j.lock.Lock()
+	element, exists := j.jobs[id]
+	j.lock.Unlock()
+	if !exists {
+		return Progress{}, false
+	}
+	return element.Value.(*job).snapshot(), true
+}
+
+/** Cancel the job. Steps that are already running are completed first */
+func (j *Jobs) Cancel(id string) (Progress, bool) {
+	j.lock.Lock()
+	element, exists := j.jobs[id]
+	j.lock.Unlock()
+	if !exists {
+		return Progress{}, false
+	}
+	job := element.Value.(*job)
+	job.cancel()
+	return job.snapshot(), true
+}
@@ -0,0 +1,140 @@
+package warmup
+
+import (
+	"context"
+	"errors"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+)
+
+func waitFor(t *testing.T, jobs *Jobs, id string, state string) Progress {
+	var progress Progress
+	require.Eventually(t, func() bool {
+		progress, _ = jobs.Get(id)
+		return progress.State == state
+	}, time.Second, time.Millisecond)
+	return progress
+}
+
+func TestJobsReportProgress(t *testing.T) {
+	jobs := NewJobs(1, 10)
+
+	progress, err := jobs.Start([]string{"vds"}, 3, func(
+		ctx context.Context,
+		stepDone func(),
+	) error {
+		for i := 0; i < 3; i++ {
+			stepDone()
+		}
+		return nil
+	})
+	require.NoError(t, err)
+	require.Equal(t, 3, progress.Total)
+	require.Equal(t, []string{"vds"}, progress.Vds)
+
+	progress = waitFor(t, jobs, progress.Id, Done)
+	require.Equal(t, 3, progress.Done)
+	require.Empty(t, progress.Error)
+}
+
+func TestFailedJobsReportError(t *testing.T) {
+	jobs := NewJobs(1, 10)
+
+	progress, err := jobs.Start(nil, 1, func(context.Context, func()) error {
+		return errors.New("read failed")
+	})
+	require.NoError(t, err)
+
+	progress = waitFor(t, jobs, progress.Id, Failed)
+	require.Equal(t, "read failed", progress.Error)
+}
+
+func TestRunningJobsAreCancelled(t *testing.T) {
+	jobs := NewJobs(1, 10)
+
+	started := make(chan struct{})
+	progress, err := jobs.Start(nil, 1, func(ctx context.Context, _ func()) error {
+		close(started)
+		<-ctx.Done()
+		return ctx.Err()
+	})
+	require.NoError(t, err)
+	<-started
+
+	_, exists := jobs.Cancel(progress.Id)
+	require.True(t, exists)
+	waitFor(t, jobs, progress.Id, Cancelled)
+}
+
+func TestQueuedJobsAreCancelled(t *testing.T) {
+	jobs := NewJobs(1, 10)
+
+	unblock := make(chan struct{})
+	defer close(unblock)
+	running, err := jobs.Start(nil, 1, func(context.Context, func()) error {
+		<-unblock
+		return nil
+	})
+	require.NoError(t, err)
+	waitFor(t, jobs, running.Id, Running)
+
+	queued, err := jobs.Start(nil, 1, func(context.Context, func()) error {
+		t.Error("Cancelled job was run")
+		return nil
+	})
+	require.NoError(t, err)
+	require.Equal(t, Queued, queued.State)
+
+	jobs.Cancel(queued.Id)
+	waitFor(t, jobs, queued.Id, Cancelled)
+}
+
+func TestUnknownJobsAreNotFound(t *testing.T) {
+	jobs := NewJobs(1, 10)
+
+	_, exists := jobs.Get("unknown")
+	require.False(t, exists)
+	_, exists = jobs.Cancel("unknown")
+	require.False(t, exists)
+}
+
+func TestFinishedJobsAreForgotten(t *testing.T) {
+	jobs := NewJobs(1, 2)
+	noop := func(context.Context, func()) error { return nil }
+
+	first, err := jobs.Start(nil, 0, noop)
+	require.NoError(t, err)
+	waitFor(t, jobs, first.Id, Done)
+
+	second, err := jobs.Start(nil, 0, noop)
+	require.NoError(t, err)
+	waitFor(t, jobs, second.Id, Done)
+
+	_, err = jobs.Start(nil, 0, noop)
+	require.NoError(t, err)
+
+	_, exists := jobs.Get(first.Id)
+	require.False(t, exists)
+	_, exists = jobs.Get(second.Id)
+	require.True(t, exists)
+}
+
+func TestJobsAreRefusedWhenTooManyAreUnfinished(t *testing.T) {
+	jobs := NewJobs(1, 2)
+
+	unblock := make(chan struct{})
+	defer close(unblock)
+	blocked := func(context.Context, func()) error {
+		<-unblock
+		return nil
+	}
+
+	for i := 0; i < 2; i++ {
+		_, err := jobs.Start(nil, 1, blocked)
+		require.NoError(t, err)
+	}
+	_, err := jobs.Start(nil, 1, blocked)
+	require.ErrorIs(t, err, ErrTooManyJobs)
+}
@@ -0,0 +1,153 @@
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "attribute.hpp"
+#include "cppapi.hpp"
+#include "subvolume.hpp"
+
+#include "bench_utils.hpp"
+
+namespace {
+
+float constexpr raw_stepsize = 4;
+std::uint8_t constexpr margin = 2;
+
+/**
+ * Raw segment of window samples with the reference between two samples, such
+ * that resampling has to interpolate every sample.
+ */
+struct SyntheticSegment {
+    explicit SyntheticSegment(std::size_t window)
+        : raw_blueprint(raw_stepsize, 0),
+          resampled_blueprint(raw_stepsize),
+          top(0),
+          bottom((window - 1) * raw_stepsize),
+          reference(window / 2 * raw_stepsize + raw_stepsize / 3),
+          data(raw_blueprint.size(top, bottom, margin, margin))
+    {
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            data[i] = std::sin(i * 0.1f) * 100;
+        }
+    }
+
+    RawSegment raw() const {
+        return RawSegment(
+            reference, top, bottom, margin,
+            data.begin(), data.end(),
+            &raw_blueprint
+        );
+    }
+
+    ResampledSegment resampled() const {
+        return ResampledSegment(reference, top, bottom, &resampled_blueprint);
+    }
+
+    RawSegmentBlueprint raw_blueprint;
+    ResampledSegmentBlueprint resampled_blueprint;
+    float top;
+    float bottom;
+    float reference;
+    std::vector< float > data;
+};
+
+void Resample(benchmark::State& state) {
+    SyntheticSegment const segment(state.range(0));
+    RawSegment const src = segment.raw();
+    ResampledSegment dst = segment.resampled();
+
+    for (auto _ : state) {
+        resample(src, dst);
+        benchmark::DoNotOptimize(*dst.begin());
+    }
+    state.SetItemsProcessed(state.iterations() * dst.size());
+}
+BENCHMARK(Resample)->ArgNames({"window"})->Arg(50)->Arg(200)->Arg(500);
+
+template< typename Attribute >
+void Compute(benchmark::State& state) {
+    SyntheticSegment const segment(state.range(0));
+    ResampledSegment dst = segment.resampled();
+    resample(segment.raw(), dst);
+
+    float out;
+    Attribute attribute(&out, sizeof(out));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(attribute.compute(dst));
+    }
+    state.SetItemsProcessed(state.iterations() * dst.size());
+}
+BENCHMARK(Compute< Mean >)->ArgNames({"window"})->Arg(50)->Arg(500);
+BENCHMARK(Compute< Rms >)->ArgNames({"window"})->Arg(50)->Arg(500);
+BENCHMARK(Compute< Sd >)->ArgNames({"window"})->Arg(50)->Arg(500);
+BENCHMARK(Compute< Median >)->ArgNames({"window"})->Arg(50)->Arg(500);
+BENCHMARK(Compute< MaxAbs >)->ArgNames({"window"})->Arg(50)->Arg(500);
+
+/**
+ * Resampling and attribute reduction over a whole horizon, i.e. the compute
+ * part of an attribute request. Data is fetched once, outside the timed loop.
+ */
+void CalcAttributes(benchmark::State& state) {
+    std::size_t const nrows = state.range(0);
+    std::size_t const ncols = state.range(1);
+    std::size_t const size  = nrows * ncols;
+
+    std::unique_ptr< SingleDataHandle > datahandle;
+    try {
+        datahandle.reset(new SingleDataHandle(make_single_datahandle(
+            bench::vds_url().c_str(), ""
+        )));
+    } catch (std::exception const& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    auto const& metadata = datahandle->get_metadata();
+    auto const window = bench::vertical_window(metadata, state.range(2));
+    state.SetLabel(window.label);
+
+    std::vector< float > values = bench::synthetic_horizon(
+        nrows, ncols, window.reference_min, window.reference_max
+    );
+    RegularSurface reference(
+        values.data(), nrows, ncols,
+        bench::covering_grid(metadata, nrows, ncols),
+        -999.25
+    );
+
+    std::unique_ptr< SurfaceBoundedSubVolume > subvolume(make_subvolume(
+        metadata, reference, window.above, window.below
+    ));
+    cppapi::fetch_subvolume(*datahandle, *subvolume, NEAREST, 0, size);
+
+    std::vector< enum attribute > attributes = { MEAN, RMS, SD, MAXABS };
+    std::vector< float > buffer(size * attributes.size());
+    std::vector< void* > out;
+    for (std::size_t i = 0; i < attributes.size(); ++i) {
+        out.push_back(buffer.data() + i * size);
+    }
+    ResampledSegmentBlueprint const blueprint(metadata.sample().stepsize());
+
+    for (auto _ : state) {
+        cppapi::attributes(
+            *subvolume,
+            &blueprint,
+            attributes.data(),
+            attributes.size(),
+            0,
+            size,
+            out.data()
+        );
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+    datahandle->close();
+}
+BENCHMARK(CalcAttributes)
+    ->ArgNames({"rows", "cols", "window"})
+    ->Args({1000, 1000, 50})
+    ->Args({1000, 1000, 200})
+    ->Args({500, 500, 500})
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
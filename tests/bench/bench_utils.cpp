@@ -0,0 +1,93 @@
+#include "bench_utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace bench {
+
+std::string vds_url() {
+    char const* url = std::getenv("ONESEISMIC_API_BENCH_VDS");
+    if (url and *url) return url;
+    return "file://10_samples_default.vds";
+}
+
+Grid covering_grid(
+    MetadataHandle const& metadata,
+    std::size_t nrows,
+    std::size_t ncols
+) {
+    auto const& transformer = metadata.coordinate_transformer();
+    int const ni = metadata.iline().nsamples();
+    int const nj = metadata.xline().nsamples();
+
+    auto const origin = transformer.IJKIndexToWorld({0, 0, 0});
+    auto const last_i = transformer.IJKIndexToWorld({ni - 1, 0, 0});
+    auto const last_j = transformer.IJKIndexToWorld({0, nj - 1, 0});
+
+    double const ix = last_i[0] - origin[0];
+    double const iy = last_i[1] - origin[1];
+    double const jx = last_j[0] - origin[0];
+    double const jy = last_j[1] - origin[1];
+
+    double const pi = std::acos(-1);
+    double const rotation = std::atan2(iy, ix) * 180 / pi;
+
+    /* Rows follow inlines. Columns go to the left or right of them depending
+     * on the handedness of the cube.
+     */
+    double const handedness = (ix * jy - iy * jx) < 0 ? -1 : 1;
+    double const xinc = std::hypot(ix, iy) / std::max< std::size_t >(nrows - 1, 1);
+    double const yinc = handedness * std::hypot(jx, jy) / std::max< std::size_t >(ncols - 1, 1);
+
+    return Grid(origin[0], origin[1], xinc, yinc, rotation);
+}
+
+VerticalWindow vertical_window(
+    MetadataHandle const& metadata,
+    std::size_t nsamples
+) {
+    auto const sample = metadata.sample();
+    float const stepsize = sample.stepsize();
+    float const middle = (sample.min() + sample.max()) / 2;
+    float const jitter = 2 * stepsize;
+
+    float const room = std::max((sample.max() - sample.min()) / 2 - jitter, 0.0f);
+    float half = (nsamples / 2) * stepsize;
+
+    std::string label;
+    if (half > room) {
+        half = std::floor(room / stepsize) * stepsize;
+        label = "window clamped to " +
+            std::to_string(2 * int(half / stepsize) + 1) + " samples";
+    }
+
+    return VerticalWindow{
+        half,
+        half,
+        middle - jitter,
+        middle + jitter,
+        label,
+    };
+}
+
+std::vector< float > synthetic_horizon(
+    std::size_t nrows,
+    std::size_t ncols,
+    float min,
+    float max
+) {
+    std::vector< float > values(nrows * ncols);
+    float const middle = (min + max) / 2;
+    float const amplitude = (max - min) / 2;
+    for (std::size_t row = 0; row < nrows; ++row) {
+        for (std::size_t col = 0; col < ncols; ++col) {
+            float const wave =
+                std::sin(row * 0.01f) * std::cos(col * 0.013f);
+            values[row * ncols + col] = middle + amplitude * wave;
+        }
+    }
+    return values;
+}
+
+} // namespace bench
@@ -0,0 +1,67 @@
+#ifndef ONESEISMIC_API_BENCH_UTILS_HPP
+#define ONESEISMIC_API_BENCH_UTILS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "metadatahandle.hpp"
+#include "regularsurface.hpp"
+
+namespace bench {
+
+/**
+ * Url of the VDS to benchmark against.
+ *
+ * Defaults to a small cube from testdata, which keeps the benchmarks
+ * runnable anywhere, but is too small for realistic sample windows. Point
+ * ONESEISMIC_API_BENCH_VDS to a larger cube, e.g. one made with
+ * testdata/varsize/make_varsize.py and converted with SEGYImport, for
+ * realistic numbers.
+ */
+std::string vds_url();
+
+/**
+ * Grid of nrows x ncols cells spread evenly over the lateral extent of the
+ * cube, such that every cell falls inside it.
+ */
+Grid covering_grid(
+    MetadataHandle const& metadata,
+    std::size_t nrows,
+    std::size_t ncols
+);
+
+/**
+ * Vertical window of a benchmark, fitted to the sample axis of the cube
+ *
+ * The reference surface should vary between reference_min and reference_max,
+ * which keeps the window inside the cube everywhere. The window is clamped
+ * when the cube has too few samples, in which case label says so.
+ */
+struct VerticalWindow {
+    float above;
+    float below;
+    float reference_min;
+    float reference_max;
+    std::string label;
+};
+
+VerticalWindow vertical_window(
+    MetadataHandle const& metadata,
+    std::size_t nsamples
+);
+
+/**
+ * Smooth synthetic horizon of nrows x ncols cells with values between min
+ * and max.
+ */
+std::vector< float > synthetic_horizon(
+    std::size_t nrows,
+    std::size_t ncols,
+    float min,
+    float max
+);
+
+} // namespace bench
+
+#endif /* ONESEISMIC_API_BENCH_UTILS_HPP */
@@ -0,0 +1,103 @@
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "cppapi.hpp"
+#include "datahandle.hpp"
+
+#include "bench_utils.hpp"
+
+namespace {
+
+using InplaceOperator = void (*)(float*, const float*, std::size_t);
+
+/**
+ * Binary operators of double datahandles, applied to buffers of the size of a
+ * large slice or fence response.
+ */
+template< InplaceOperator inplace >
+void Inplace(benchmark::State& state) {
+    std::size_t const nsamples = state.range(0);
+    std::vector< float > a(nsamples);
+    std::vector< float > b(nsamples);
+    for (std::size_t i = 0; i < nsamples; ++i) {
+        a[i] = 1 + i % 97;
+        b[i] = 1 + i % 89;
+    }
+
+    for (auto _ : state) {
+        inplace(a.data(), b.data(), nsamples);
+        benchmark::DoNotOptimize(a.data());
+    }
+    state.SetBytesProcessed(state.iterations() * nsamples * sizeof(float));
+}
+BENCHMARK(Inplace< inplace_addition >)
+    ->ArgNames({"samples"})->Arg(1000000)->Arg(10000000);
+BENCHMARK(Inplace< inplace_subtraction >)
+    ->ArgNames({"samples"})->Arg(1000000)->Arg(10000000);
+BENCHMARK(Inplace< inplace_multiplication >)
+    ->ArgNames({"samples"})->Arg(1000000)->Arg(10000000);
+BENCHMARK(Inplace< inplace_division >)
+    ->ArgNames({"samples"})->Arg(1000000)->Arg(10000000);
+
+/**
+ * Fence through randomly scattered traces of the cube, in index coordinates.
+ * Includes reading the data, which is served by the OpenVDS cache after the
+ * first iteration.
+ */
+void Fence(benchmark::State& state) {
+    std::size_t const npoints = state.range(0);
+    auto const interpolation = static_cast< interpolation_method >(state.range(1));
+
+    std::unique_ptr< SingleDataHandle > datahandle;
+    try {
+        datahandle.reset(new SingleDataHandle(make_single_datahandle(
+            bench::vds_url().c_str(), ""
+        )));
+    } catch (std::exception const& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    auto const& metadata = datahandle->get_metadata();
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution< float > inlines(
+        0, metadata.iline().nsamples() - 1
+    );
+    std::uniform_real_distribution< float > xlines(
+        0, metadata.xline().nsamples() - 1
+    );
+    std::vector< float > coordinates(npoints * 2);
+    for (std::size_t i = 0; i < npoints; ++i) {
+        coordinates[2 * i]     = inlines(generator);
+        coordinates[2 * i + 1] = xlines(generator);
+    }
+
+    for (auto _ : state) {
+        response out{};
+        cppapi::fence(
+            *datahandle,
+            INDEX,
+            coordinates.data(),
+            npoints,
+            interpolation,
+            nullptr,
+            &out
+        );
+        benchmark::DoNotOptimize(out.data);
+        delete[] out.data;
+    }
+    state.SetItemsProcessed(state.iterations() * npoints);
+    datahandle->close();
+}
+BENCHMARK(Fence)
+    ->ArgNames({"points", "interpolation"})
+    ->Args({1000, NEAREST})
+    ->Args({10000, NEAREST})
+    ->Args({100000, NEAREST})
+    ->Args({100000, CUBIC})
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
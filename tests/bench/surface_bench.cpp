@@ -0,0 +1,112 @@
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "cppapi.hpp"
+#include "datahandle.hpp"
+#include "regularsurface.hpp"
+#include "subvolume.hpp"
+
+#include "bench_utils.hpp"
+
+namespace {
+
+float constexpr fillvalue = -999.25;
+
+/**
+ * Primary and secondary horizons on the same grid, the secondary one well
+ * below the primary, such that they never intersect.
+ */
+void AlignSurfaces(benchmark::State& state) {
+    std::size_t const nrows = state.range(0);
+    std::size_t const ncols = state.range(1);
+    Grid const grid(0, 0, 25, 25, 30);
+
+    std::vector< float > primary_data =
+        bench::synthetic_horizon(nrows, ncols, 100, 200);
+    std::vector< float > secondary_data =
+        bench::synthetic_horizon(nrows, ncols, 300, 400);
+    std::vector< float > aligned_data(nrows * ncols);
+
+    RegularSurface const primary(
+        primary_data.data(), nrows, ncols, grid, fillvalue
+    );
+    RegularSurface const secondary(
+        secondary_data.data(), nrows, ncols, grid, fillvalue
+    );
+    RegularSurface aligned(
+        aligned_data.data(), nrows, ncols, grid, fillvalue
+    );
+
+    bool primary_is_top;
+    for (auto _ : state) {
+        cppapi::align_surfaces(primary, secondary, aligned, &primary_is_top);
+        benchmark::DoNotOptimize(aligned_data.data());
+    }
+    state.SetItemsProcessed(state.iterations() * nrows * ncols);
+}
+BENCHMARK(AlignSurfaces)
+    ->ArgNames({"rows", "cols"})
+    ->Args({1000, 1000})
+    ->Args({3163, 3163})
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * Construction of the subvolume for an attribute request, i.e. the mapping of
+ * every horizon cell to its segment in the cube, from explicit top and bottom
+ * surfaces.
+ */
+void MakeSubvolume(benchmark::State& state) {
+    std::size_t const nrows = state.range(0);
+    std::size_t const ncols = state.range(1);
+
+    std::unique_ptr< SingleDataHandle > datahandle;
+    try {
+        datahandle.reset(new SingleDataHandle(make_single_datahandle(
+            bench::vds_url().c_str(), ""
+        )));
+    } catch (std::exception const& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    auto const& metadata = datahandle->get_metadata();
+    auto const window = bench::vertical_window(metadata, state.range(2));
+    state.SetLabel(window.label);
+
+    Grid const grid = bench::covering_grid(metadata, nrows, ncols);
+    std::vector< float > reference_data = bench::synthetic_horizon(
+        nrows, ncols, window.reference_min, window.reference_max
+    );
+    std::vector< float > top_data(reference_data);
+    std::vector< float > bottom_data(reference_data);
+    for (std::size_t i = 0; i < reference_data.size(); ++i) {
+        top_data[i]    -= window.above;
+        bottom_data[i] += window.below;
+    }
+
+    RegularSurface const reference(
+        reference_data.data(), nrows, ncols, grid, fillvalue
+    );
+    RegularSurface const top(top_data.data(), nrows, ncols, grid, fillvalue);
+    RegularSurface const bottom(
+        bottom_data.data(), nrows, ncols, grid, fillvalue
+    );
+
+    for (auto _ : state) {
+        std::unique_ptr< SurfaceBoundedSubVolume > subvolume(
+            make_subvolume(metadata, reference, top, bottom)
+        );
+        benchmark::DoNotOptimize(subvolume.get());
+    }
+    state.SetItemsProcessed(state.iterations() * nrows * ncols);
+    datahandle->close();
+}
+BENCHMARK(MakeSubvolume)
+    ->ArgNames({"rows", "cols", "window"})
+    ->Args({1000, 1000, 50})
+    ->Args({3163, 3163, 50})
+    ->Args({1000, 1000, 500})
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
@@ -0,0 +1,158 @@
+#include "brickindex.hpp"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+namespace {
+
+/* A 4x4x3 volume of 2x2x2 bricks, where the last bricks along dimension 2
+ * are cut short */
+int const shape[]      = { 4, 4, 3 };
+int const brick_size[] = { 2, 2, 2 };
+float const fill       = -999.25;
+
+std::vector< float > volume(float value) {
+    return std::vector< float >(shape[0] * shape[1] * shape[2], value);
+}
+
+int const whole_lower[] = { 0, 0, 0 };
+int const whole_upper[] = { 4, 4, 3 };
+
+TEST(BrickIndex, NothingIsKnownUpFront) {
+    BrickIndex index(shape, brick_size, fill);
+
+    EXPECT_FALSE(index.any_fill());
+    EXPECT_FALSE(index.all_fill(whole_lower, whole_upper));
+}
+
+TEST(BrickIndex, WholeReadsAreSummarized) {
+    BrickIndex index(shape, brick_size, fill);
+
+    /* Brick (0, 0, 0) is all fill but its last sample */
+    std::vector< float > data = volume(1);
+    for (int k = 0; k < 2; ++k) {
+    for (int j = 0; j < 2; ++j) {
+    for (int i = 0; i < 2; ++i) {
+        data[i + shape[0] * (j + shape[1] * k)] = fill;
+    }}}
+    data[1 + shape[0] * (1 + shape[1] * 1)] = 0;
+    index.update(data.data(), whole_lower, whole_upper);
+
+    int const first[] = { 0, 0, 0 };
+    brick_summary summary = index.summary(first);
+    EXPECT_TRUE(summary.known);
+    EXPECT_FALSE(summary.all_fill);
+
+    int const last[] = { 1, 1, 1 };
+    summary = index.summary(last);
+    EXPECT_TRUE(summary.known);
+    EXPECT_FALSE(summary.all_fill);
+
+    EXPECT_FALSE(index.any_fill());
+}
+
+TEST(BrickIndex, PartialBricksAreNotSummarized) {
+    BrickIndex index(shape, brick_size, fill);
+
+    /* Covers bricks (1, 0, 0) and (1, 1, 0) whole, and others in part */
+    int const lower[] = { 1, 0, 0 };
+    int const upper[] = { 4, 4, 2 };
+    std::vector< float > data(3 * 4 * 2, fill);
+    index.update(data.data(), lower, upper);
+
+    int const partial[] = { 0, 0, 0 };
+    EXPECT_FALSE(index.summary(partial).known);
+
+    int const whole[] = { 1, 1, 0 };
+    EXPECT_TRUE(index.summary(whole).known);
+    EXPECT_TRUE(index.summary(whole).all_fill);
+    EXPECT_TRUE(index.any_fill());
+
+    int const fill_lower[] = { 2, 0, 0 };
+    int const fill_upper[] = { 4, 4, 2 };
+    EXPECT_TRUE(index.all_fill(fill_lower, fill_upper));
+    EXPECT_FALSE(index.all_fill(lower, upper));
+}
+
+TEST(BrickIndex, AllFillRequiresEveryBrick) {
+    BrickIndex index(shape, brick_size, fill);
+
+    std::vector< float > data = volume(fill);
+    data[47] = 0;
+    index.update(data.data(), whole_lower, whole_upper);
+
+    int const lower[] = { 0, 0, 0 };
+    int const upper[] = { 4, 4, 2 };
+    EXPECT_TRUE(index.all_fill(lower, upper));
+    EXPECT_FALSE(index.all_fill(whole_lower, whole_upper));
+}
+
+TEST(BrickIndex, RegionsOutsideTheVolumeAreNotFill) {
+    BrickIndex index(shape, brick_size, fill);
+
+    std::vector< float > data = volume(fill);
+    index.update(data.data(), whole_lower, whole_upper);
+
+    int const lower[] = { 4, 0, 0 };
+    int const upper[] = { 6, 4, 3 };
+    EXPECT_FALSE(index.all_fill(lower, upper));
+
+    /* Regions reaching past the volume only touch the bricks inside it */
+    int const wide_lower[] = { -2, -2, -2 };
+    int const wide_upper[] = {  6,  6,  6 };
+    EXPECT_TRUE(index.all_fill(wide_lower, wide_upper));
+}
+
+TEST(BrickIndex, KnownBricksAreKept) {
+    BrickIndex index(shape, brick_size, fill);
+
+    std::vector< float > data = volume(fill);
+    index.update(data.data(), whole_lower, whole_upper);
+
+    data = volume(1);
+    index.update(data.data(), whole_lower, whole_upper);
+    EXPECT_TRUE(index.all_fill(whole_lower, whole_upper));
+}
+
+TEST(BrickIndex, PositionsAreCheckedWithinReach) {
+    BrickIndex index(shape, brick_size, fill);
+
+    /* Bricks with dimension 0 in [0, 2) are fill, the others are not */
+    std::vector< float > data = volume(fill);
+    for (int k = 0; k < shape[2]; ++k) {
+    for (int j = 0; j < shape[1]; ++j) {
+        data[2 + shape[0] * (j + shape[1] * k)] = 1;
+        data[3 + shape[0] * (j + shape[1] * k)] = 1;
+    }}
+    index.update(data.data(), whole_lower, whole_upper);
+
+    std::size_t const stride = 4;
+    std::vector< float > positions = {
+        0, 0, 0, 0,
+        0, 1, 2, 0,
+        0, 3, 1, 0,
+    };
+    EXPECT_TRUE(index.all_fill(positions.data(), 3, stride, -1, 0));
+
+    /* A reach of 2 touches the bricks that are not fill */
+    EXPECT_FALSE(index.all_fill(positions.data(), 3, stride, -1, 2));
+
+    /* As does reading dimension 0 whole */
+    EXPECT_FALSE(index.all_fill(positions.data(), 3, stride, 0, 0));
+
+    positions.push_back(3);
+    positions.insert(positions.end(), { 0, 0, 0 });
+    EXPECT_FALSE(index.all_fill(positions.data(), 4, stride, -1, 0));
+
+    EXPECT_FALSE(index.all_fill(positions.data(), 0, stride, -1, 0));
+}
+
+TEST(BrickIndex, SizeCoversEveryBrick) {
+    /* 2 x 2 x 2 bricks */
+    EXPECT_EQ(
+        BrickIndex::size(shape, brick_size),
+        sizeof(BrickIndex) + 8 * sizeof(brick_summary)
+    );
+}
+
+} // namespace
@@ -0,0 +1,59 @@
+#include "bufferusage.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+namespace {
+
+TEST(TrackedBuffer, CountsBytesWhileAlive) {
+    buffer_usage& usage = thread_buffer_usage();
+    std::int64_t const live = usage.live;
+    usage.peak = live;
+
+    {
+        TrackedBuffer buffer(100);
+        EXPECT_EQ(usage.live, live + 100);
+
+        buffer.resize(300);
+        EXPECT_EQ(usage.live, live + 300);
+
+        buffer.resize(50);
+        EXPECT_EQ(usage.live, live + 50);
+    }
+    EXPECT_EQ(usage.live, live);
+    EXPECT_EQ(usage.peak, live + 300);
+}
+
+TEST(TrackedBuffer, CopiesCountAgain) {
+    buffer_usage& usage = thread_buffer_usage();
+    std::int64_t const live = usage.live;
+
+    {
+        std::vector< TrackedBuffer > buffers;
+        buffers.emplace_back(100);
+        buffers.push_back(buffers.front());
+        EXPECT_EQ(usage.live, live + 200);
+
+        TrackedBuffer moved(std::move(buffers.back()));
+        buffers.pop_back();
+        EXPECT_EQ(usage.live, live + 200);
+    }
+    EXPECT_EQ(usage.live, live);
+}
+
+TEST(TrackedBuffer, ReleasedBuffersStayCounted) {
+    buffer_usage& usage = thread_buffer_usage();
+    std::int64_t const live = usage.live;
+
+    {
+        TrackedBuffer buffer(100);
+        buffer.release();
+    }
+    EXPECT_EQ(usage.live, live + 100);
+
+    buffers_released(100);
+    EXPECT_EQ(usage.live, live);
+}
+
+} // namespace
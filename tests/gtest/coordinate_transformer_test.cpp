@@ -2,6 +2,9 @@
 #include "ctypes.h"
 #include "datahandle.hpp"
 
+#include <cmath>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -132,4 +135,154 @@ TEST(NegativeCoordinateTransformerTest, NegativeAnnotation) {
     EXPECT_EQ(as_annotation.Y, transformer.WorldToAnnotation(as_cdp).Y);
 }
 
+TEST(BatchedCoordinateTransformerTest, MatchesSinglePointTransformations) {
+    const std::string url = "file://10_negative.vds";
+
+    auto datahandle = make_single_datahandle(
+        url.c_str(),
+        CREDENTIALS.c_str()
+    );
+
+    CoordinateTransformer const& transformer = datahandle.get_metadata().coordinate_transformer();
+
+    std::vector< Point > points = {{8, 4}, {-3.5, 11.25}, {0, 0}, {1, 2.5}};
+    std::vector< Point > world(points.size());
+    std::vector< Point > ijk(points.size());
+    transformer.world_to_annotation(points.data(), points.size(), world.data());
+    transformer.ijk_position_to_annotation(points.data(), points.size(), ijk.data());
+
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        auto const expected_world = transformer.WorldToAnnotation({points[i].x, points[i].y, 0});
+        EXPECT_NEAR(expected_world.X, world[i].x, 1e-9) << "at point " << i;
+        EXPECT_NEAR(expected_world.Y, world[i].y, 1e-9) << "at point " << i;
+
+        auto const expected_ijk = transformer.IJKPositionToAnnotation({points[i].x, points[i].y, 0});
+        EXPECT_NEAR(expected_ijk.X, ijk[i].x, 1e-9) << "at point " << i;
+        EXPECT_NEAR(expected_ijk.Y, ijk[i].y, 1e-9) << "at point " << i;
+    }
+}
+
+TEST(BatchedCoordinateTransformerTest, CubeVoxelPositions) {
+    const std::string a = "file://regular_8x2_cube.vds";
+    const std::string b = "file://shift_4_8x2_cube.vds";
+
+    auto datahandle = make_double_datahandle(
+        a.c_str(),
+        CREDENTIALS.c_str(),
+        b.c_str(),
+        CREDENTIALS.c_str(),
+        binary_operator::DIVISION
+    );
+
+    auto transformer = datahandle.get_metadata().coordinate_transformer();
+
+    constexpr int ndims = OpenVDS::Dimensionality_Max;
+    std::vector< float > positions = {
+        0.5, 1.5, 2.5, 0, 0, 0,
+        3,   4,   1,   0, 0, 0,
+    };
+    std::size_t const npositions = positions.size() / ndims;
+
+    std::vector< float > batch_a(positions.size());
+    std::vector< float > batch_b(positions.size());
+    transformer.to_cube_a_voxel_positions(batch_a.data(), positions.data(), npositions);
+    transformer.to_cube_b_voxel_positions(batch_b.data(), positions.data(), npositions);
+
+    for (std::size_t v = 0; v < npositions; ++v) {
+        float expected_a[ndims] = {0};
+        float expected_b[ndims] = {0};
+        transformer.to_cube_a_voxel_position(expected_a, positions.data() + v * ndims);
+        transformer.to_cube_b_voxel_position(expected_b, positions.data() + v * ndims);
+        for (int d = 0; d < 3; ++d) {
+            EXPECT_EQ(expected_a[d], batch_a[v * ndims + d]) << "position " << v << ", dimension " << d;
+            EXPECT_EQ(expected_b[d], batch_b[v * ndims + d]) << "position " << v << ", dimension " << d;
+        }
+    }
+}
+
+/**
+ * Rotated survey at UTM coordinates, with WorldToAnnotation computed point by
+ * point relative to the survey origin like OpenVDS does.
+ */
+class GeoreferencedTransformer : public CoordinateTransformer {
+public:
+    static constexpr double xori  = 456789.125;
+    static constexpr double yori  = 6789012.375;
+    static constexpr double iinc  = 12.5;
+    static constexpr double xinc  = 25;
+    static constexpr double angle = 0.58817; /* ~33.7 degrees */
+    static constexpr double ilmin = 1000;
+    static constexpr double ilinc = 2;
+    static constexpr double xlmin = 2000;
+    static constexpr double xlinc = 1;
+
+    OpenVDS::IntVector3 VoxelIndexToIJKIndex(const OpenVDS::IntVector3& voxelIndex) const override {
+        return voxelIndex;
+    }
+
+    OpenVDS::DoubleVector3 IJKIndexToWorld(const OpenVDS::IntVector3& ijkIndex) const override {
+        double const i = ijkIndex[0] * iinc;
+        double const j = ijkIndex[1] * xinc;
+        return {
+            xori + i * std::cos(angle) - j * std::sin(angle),
+            yori + i * std::sin(angle) + j * std::cos(angle),
+            0
+        };
+    }
+
+    OpenVDS::DoubleVector3 IJKIndexToAnnotation(const OpenVDS::IntVector3& ijkIndex) const override {
+        return this->IJKPositionToAnnotation({
+            double(ijkIndex[0]), double(ijkIndex[1]), double(ijkIndex[2])
+        });
+    }
+
+    OpenVDS::DoubleVector3 IJKPositionToAnnotation(const OpenVDS::DoubleVector3& ijkPosition) const override {
+        return {
+            ilmin + ijkPosition[0] * ilinc,
+            xlmin + ijkPosition[1] * xlinc,
+            ijkPosition[2]
+        };
+    }
+
+    OpenVDS::DoubleVector3 WorldToAnnotation(OpenVDS::DoubleVector3 worldPosition) const override {
+        double const dx = worldPosition[0] - xori;
+        double const dy = worldPosition[1] - yori;
+        double const i  = ( dx * std::cos(angle) + dy * std::sin(angle)) / iinc;
+        double const j  = (-dx * std::sin(angle) + dy * std::cos(angle)) / xinc;
+        return this->IJKPositionToAnnotation({ i, j, 0 });
+    }
+};
+
+TEST(BatchedCoordinateTransformerTest, LargeWorldCoordinates) {
+    GeoreferencedTransformer const transformer;
+
+    /* Positions across a 400x300 survey and a margin around it, both on and
+     * between traces. Positions are kept off the exact halfway points, where
+     * rounding is decided by the last bit of either implementation */
+    std::vector< Point > points;
+    for (double i = -10.3; i < 410; i += 0.5) {
+        for (double j = -10.3; j < 310; j += 0.5) {
+            points.push_back({
+                GeoreferencedTransformer::xori
+                    + i * GeoreferencedTransformer::iinc * std::cos(GeoreferencedTransformer::angle)
+                    - j * GeoreferencedTransformer::xinc * std::sin(GeoreferencedTransformer::angle),
+                GeoreferencedTransformer::yori
+                    + i * GeoreferencedTransformer::iinc * std::sin(GeoreferencedTransformer::angle)
+                    + j * GeoreferencedTransformer::xinc * std::cos(GeoreferencedTransformer::angle),
+            });
+        }
+    }
+
+    std::vector< Point > annotation(points.size());
+    transformer.world_to_annotation(points.data(), points.size(), annotation.data());
+
+    for (std::size_t p = 0; p < points.size(); ++p) {
+        auto const expected = transformer.WorldToAnnotation({points[p].x, points[p].y, 0});
+        ASSERT_NEAR(expected.X, annotation[p].x, 1e-9) << "at point " << p;
+        ASSERT_NEAR(expected.Y, annotation[p].y, 1e-9) << "at point " << p;
+        ASSERT_EQ(std::lround(expected.X), std::lround(annotation[p].x)) << "at point " << p;
+        ASSERT_EQ(std::lround(expected.Y), std::lround(annotation[p].y)) << "at point " << p;
+    }
+}
+
 } // namespace
@@ -1,4 +1,6 @@
+#include <cmath>
 #include <map>
+#include <memory>
 
 #include "cppapi.hpp"
 #include "ctypes.h"
@@ -156,6 +158,225 @@ TEST_F(SubvolumeTest, SubvolumeSize)
     delete subvolume;
 }
 
+TEST_F(SubvolumeTest, FetchInChunksMatchesSingleFetch)
+{
+    static constexpr int nrows = 4;
+    static constexpr int ncols = 6;
+    static constexpr std::size_t size = nrows * ncols;
+
+    std::array<float, size> surface_data = {
+        24, 20, 24, 24, 24, 20,
+        20, 20, 20, 24, 20, 24,
+        20, 24, 20, 20, 24, 20,
+        24, 24, 24, 24, 20, 24
+    };
+
+    std::array<float, size> top_data = surface_data;
+    std::array<float, size> bottom_data = surface_data;
+    std::transform(top_data.cbegin(), top_data.cend(), top_data.begin(),
+                   [](float value) { return value - 8; });
+    std::transform(bottom_data.cbegin(), bottom_data.cend(), bottom_data.begin(),
+                   [](float value) { return value + 8; });
+
+    RegularSurface primary_surface =
+        RegularSurface(surface_data.data(), nrows, ncols, other_grid, fill);
+    RegularSurface top_surface =
+        RegularSurface(top_data.data(), nrows, ncols, other_grid, fill);
+    RegularSurface bottom_surface =
+        RegularSurface(bottom_data.data(), nrows, ncols, other_grid, fill);
+
+    auto const& metadata = datahandle.get_metadata();
+    std::unique_ptr< SurfaceBoundedSubVolume > whole(
+        make_subvolume(metadata, primary_surface, top_surface, bottom_surface)
+    );
+    std::unique_ptr< SurfaceBoundedSubVolume > chunked(
+        make_subvolume(metadata, primary_surface, top_surface, bottom_surface)
+    );
+
+    cppapi::fetch_subvolume(datahandle, *whole, NEAREST, 0, size);
+    for (std::size_t from = 0; from < size; from += 5) {
+        std::size_t to = std::min(from + 5, size);
+        cppapi::fetch_subvolume(datahandle, *chunked, NEAREST, from, to);
+    }
+
+    for (int i = 0; i < size; ++i) {
+        auto expected = whole->vertical_segment(i);
+        auto actual = chunked->vertical_segment(i);
+        ASSERT_EQ(expected.size(), actual.size());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), actual.begin()))
+            << "Chunked fetch differs from single fetch at position " << i;
+    }
+}
+
+TEST_F(SubvolumeTest, FetchMethodsAgree)
+{
+    static constexpr int nrows = 4;
+    static constexpr int ncols = 6;
+    static constexpr std::size_t size = nrows * ncols;
+
+    std::array<float, size> surface_data = {
+        24, 20, 24, 24, 24, 20,
+        20, 20, 20, 24, 20, 24,
+        20, 24, 20, 20, 24, 20,
+        24, 24, 24, 24, 20, 24
+    };
+
+    std::array<float, size> top_data = surface_data;
+    std::array<float, size> bottom_data = surface_data;
+    std::transform(top_data.cbegin(), top_data.cend(), top_data.begin(),
+                   [](float value) { return value - 8; });
+    std::transform(bottom_data.cbegin(), bottom_data.cend(), bottom_data.begin(),
+                   [](float value) { return value + 8; });
+
+    RegularSurface primary_surface =
+        RegularSurface(surface_data.data(), nrows, ncols, other_grid, fill);
+    RegularSurface top_surface =
+        RegularSurface(top_data.data(), nrows, ncols, other_grid, fill);
+    RegularSurface bottom_surface =
+        RegularSurface(bottom_data.data(), nrows, ncols, other_grid, fill);
+
+    auto const& metadata = datahandle.get_metadata();
+
+    /* Fetch with the method, checking that it is the one that reads */
+    auto fetch = [&](cppapi::FetchMethod method, enum interpolation_method interpolation) {
+        std::unique_ptr< SurfaceBoundedSubVolume > subvolume(
+            make_subvolume(metadata, primary_surface, top_surface, bottom_surface)
+        );
+        io_stats const before = thread_io_stats();
+        cppapi::fetch_subvolume(datahandle, *subvolume, interpolation, 0, size, method);
+        io_stats const after = thread_io_stats();
+
+        std::uint64_t const subcubes = after.subcube_requests - before.subcube_requests;
+        std::uint64_t const traces   = after.trace_requests   - before.trace_requests;
+        std::uint64_t const samples  = after.sample_requests  - before.sample_requests;
+        EXPECT_EQ(subcubes > 0, method == cppapi::FetchMethod::SLAB);
+        EXPECT_EQ(traces   > 0, method == cppapi::FetchMethod::TRACES);
+        EXPECT_EQ(samples  > 0, method == cppapi::FetchMethod::SAMPLES);
+        return subvolume;
+    };
+
+    /* Slabs are interpolated in the core, so check both methods they support */
+    for (auto interpolation : { NEAREST, LINEAR }) {
+        auto const slab    = fetch(cppapi::FetchMethod::SLAB,    interpolation);
+        auto const traces  = fetch(cppapi::FetchMethod::TRACES,  interpolation);
+        auto const samples = fetch(cppapi::FetchMethod::SAMPLES, interpolation);
+
+        for (int i = 0; i < size; ++i) {
+            auto expected = samples->vertical_segment(i);
+            for (auto const* other : { slab.get(), traces.get() }) {
+                auto actual = other->vertical_segment(i);
+                ASSERT_EQ(expected.size(), actual.size());
+                for (auto e = expected.begin(), a = actual.begin(); e != expected.end(); ++e, ++a) {
+                    EXPECT_NEAR(*e, *a, 1e-4)
+                        << "Fetch methods differ at position " << i
+                        << " with interpolation " << interpolation;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(SubvolumeTest, LinearFetchMatchesFence)
+{
+    static constexpr int nrows = 4;
+    static constexpr int ncols = 6;
+    static constexpr std::size_t size = nrows * ncols;
+
+    std::array<float, size> surface_data;
+    surface_data.fill(20);
+    std::array<float, size> top_data;
+    top_data.fill(12);
+    std::array<float, size> bottom_data;
+    bottom_data.fill(28);
+
+    RegularSurface primary_surface =
+        RegularSurface(surface_data.data(), nrows, ncols, other_grid, fill);
+    RegularSurface top_surface =
+        RegularSurface(top_data.data(), nrows, ncols, other_grid, fill);
+    RegularSurface bottom_surface =
+        RegularSurface(bottom_data.data(), nrows, ncols, other_grid, fill);
+
+    auto const& metadata = datahandle.get_metadata();
+    std::unique_ptr< SurfaceBoundedSubVolume > subvolume(
+        make_subvolume(metadata, primary_surface, top_surface, bottom_surface)
+    );
+    io_stats const before = thread_io_stats();
+    cppapi::fetch_subvolume(datahandle, *subvolume, LINEAR, 0, size);
+    io_stats const after = thread_io_stats();
+
+    /* The planner must read these segments from a slab, or the bilinear
+     * slab interpolation is not what is tested here */
+    ASSERT_GT(after.subcube_requests, before.subcube_requests);
+    ASSERT_EQ(after.trace_requests,  before.trace_requests);
+    ASSERT_EQ(after.sample_requests, before.sample_requests);
+
+    auto const& grid = primary_surface.grid();
+    auto const& sample = metadata.sample();
+    for (int i = 0; i < size; ++i) {
+        if (subvolume->is_empty(i)) continue;
+
+        auto const cdp = grid.to_cdp(i);
+        std::vector< float > coordinates{ float(cdp.x), float(cdp.y) };
+
+        struct response response_data;
+        cppapi::fence(
+            datahandle,
+            coordinate_system::CDP,
+            coordinates.data(),
+            1,
+            LINEAR,
+            nullptr,
+            &response_data
+        );
+        float const* trace = (float*)response_data.data;
+
+        auto segment = subvolume->vertical_segment(i);
+        int first = std::lround(
+            (segment.top_sample_position() - sample.min()) / sample.stepsize()
+        );
+        int k = 0;
+        for (auto it = segment.begin(); it != segment.end(); ++it, ++k) {
+            EXPECT_NEAR(trace[first + k], *it, 1e-4)
+                << "Unexpected value at position " << i << ", sample " << k;
+        }
+        delete[] response_data.data;
+    }
+}
+
+TEST_F(SubvolumeTest, HorizontalPositions)
+{
+    static constexpr int nrows = 4;
+    static constexpr int ncols = 6;
+    static constexpr std::size_t size = nrows * ncols;
+
+    std::array<float, size> surface_data;
+    surface_data.fill(20);
+
+    RegularSurface surface =
+        RegularSurface(surface_data.data(), nrows, ncols, other_grid, fill);
+
+    auto const& metadata = datahandle.get_metadata();
+    std::unique_ptr< SurfaceBoundedSubVolume > subvolume(
+        make_subvolume(metadata, surface, surface, surface)
+    );
+
+    auto iline = metadata.iline();
+    auto xline = metadata.xline();
+    auto const& transform = metadata.coordinate_transformer();
+    for (int i = 0; i < size; ++i) {
+        if (subvolume->is_empty(i)) continue;
+
+        auto const cdp = surface.grid().to_cdp(i);
+        auto const ij = transform.WorldToAnnotation({cdp.x, cdp.y, 0});
+
+        auto const& position = subvolume->horizontal_position(i);
+        EXPECT_NEAR(iline.to_sample_position(ij[0]), position[0], 1e-4)
+            << "Unexpected inline position at " << i;
+        EXPECT_NEAR(xline.to_sample_position(ij[1]), position[1], 1e-4)
+            << "Unexpected crossline position at " << i;
+    }
+}
+
 TEST_F(SubvolumeTest, DataForUnalignedSurface)
 {
     const float above = 2;
@@ -366,6 +587,64 @@ TEST_F(SubvolumeTest, LargestPossibleMarginRetrievedNearTraceBottomBoundary)
     delete subvolume;
 }
 
+TEST_F(SubvolumeTest, ConstantWindowMatchesShiftedSurfaces)
+{
+    static constexpr int nrows = 3;
+    static constexpr int ncols = 2;
+    static constexpr std::size_t size = nrows * ncols;
+    static constexpr float above = 8;
+    static constexpr float below = 6;
+
+    std::array<float, size> reference_surface_data = {
+        20, 21,
+        fill, 22.5,
+        24, 23,
+    };
+
+    std::array<float, size> top_surface_data;
+    std::array<float, size> bottom_surface_data;
+    for (std::size_t i = 0; i < size; ++i) {
+        float const value = reference_surface_data[i];
+        top_surface_data[i] = value == fill ? fill : value - above;
+        bottom_surface_data[i] = value == fill ? fill : value + below;
+    }
+
+    RegularSurface reference_surface =
+        RegularSurface(reference_surface_data.data(), nrows, ncols, samples_10_grid, fill);
+
+    RegularSurface top_surface =
+        RegularSurface(top_surface_data.data(), nrows, ncols, samples_10_grid, fill);
+
+    RegularSurface bottom_surface =
+        RegularSurface(bottom_surface_data.data(), nrows, ncols, samples_10_grid, fill);
+
+    std::unique_ptr<SurfaceBoundedSubVolume> expected(make_subvolume(
+        datahandle.get_metadata(), reference_surface, top_surface, bottom_surface
+    ));
+    std::unique_ptr<SurfaceBoundedSubVolume> actual(make_subvolume(
+        datahandle.get_metadata(), reference_surface, above, below
+    ));
+
+    cppapi::fetch_subvolume(datahandle, *expected, NEAREST, 0, size);
+    cppapi::fetch_subvolume(datahandle, *actual, NEAREST, 0, size);
+    for (int i = 0; i < size; ++i) {
+        EXPECT_EQ(expected->is_empty(i), actual->is_empty(i))
+            << "Segment emptiness differs at position " << i;
+        if (expected->is_empty(i)) continue;
+
+        auto expected_segment = expected->vertical_segment(i);
+        auto actual_segment = actual->vertical_segment(i);
+        ASSERT_THAT(
+            actual_segment.sample_positions(),
+            ::testing::ElementsAreArray(expected_segment.sample_positions())
+        );
+        ASSERT_THAT(
+            std::vector<float>(actual_segment.begin(), actual_segment.end()),
+            ::testing::ElementsAreArray(expected_segment.begin(), expected_segment.end())
+        );
+    }
+}
+
 class SurfaceAlignmentTest : public ::testing::Test {
 protected:
     SurfaceAlignmentTest() : datahandle(make_single_datahandle(SAMPLES_10.c_str(), CREDENTIALS.c_str())) {}
@@ -663,7 +942,7 @@ TEST_F(SurfaceAlignmentTest, UnalignedSurfacesPrimaryUnaligned)
     };
 
     RegularSurface primary = RegularSurface(
-        primary_surface_data.data(), pnrows, pncols, other_grid, fill);
+        primary_surface_data.data(), pnrows, pncols, samples_10_grid, fill);
     RegularSurface secondary = RegularSurface(
         secondary_surface_data.data(), snrows, sncols, samples_10_grid, fill);
 
@@ -774,6 +1053,66 @@ TEST_F(SurfaceAlignmentTest, IntersectingSurfaces)
             testing::HasSubstr("Surfaces intersect at primary surface point (2, 0)")));
 }
 
+TEST_F(SurfaceAlignmentTest, SpareThreadsDoNotChangeTheResult)
+{
+    /* Large enough to be split between several tasks */
+    static constexpr std::size_t pnrows = 512;
+    static constexpr std::size_t pncols = 256;
+    static constexpr std::size_t snrows = 400;
+    static constexpr std::size_t sncols = 300;
+
+    std::vector< float > primary_surface_data(pnrows * pncols);
+    for (std::size_t i = 0; i < primary_surface_data.size(); ++i) {
+        primary_surface_data[i] = i % 7 == 0 ? fill : 100 + i % 13;
+    }
+    std::vector< float > secondary_surface_data(snrows * sncols);
+    for (std::size_t i = 0; i < secondary_surface_data.size(); ++i) {
+        secondary_surface_data[i] = i % 11 == 0 ? fill : 20 + i % 17;
+    }
+
+    RegularSurface primary = RegularSurface(
+        primary_surface_data.data(), pnrows, pncols, samples_10_grid, fill);
+    RegularSurface secondary = RegularSurface(
+        secondary_surface_data.data(), snrows, sncols, samples_10_grid, fill);
+
+    auto align = [&](std::size_t nthreads) {
+        cppapi::set_alignment_threads(nthreads);
+        std::vector< float > data(primary.size());
+        RegularSurface aligned = RegularSurface(
+            data.data(), pnrows, pncols, samples_10_grid, fill);
+        bool primary_is_top;
+        cppapi::align_surfaces(primary, secondary, aligned, &primary_is_top);
+        cppapi::set_alignment_threads(0);
+        EXPECT_FALSE(primary_is_top);
+        return data;
+    };
+
+    std::vector< float > const serial = align(0);
+    EXPECT_EQ(align(3), serial);
+
+    /* The first crossing is reported no matter how the rows are split */
+    primary_surface_data[300 * pncols + 10] = 0;
+    primary_surface_data[100 * pncols + 5] = 0;
+    auto message = [&](std::size_t nthreads) {
+        cppapi::set_alignment_threads(nthreads);
+        std::vector< float > data(primary.size());
+        RegularSurface aligned = RegularSurface(
+            data.data(), pnrows, pncols, samples_10_grid, fill);
+        bool primary_is_top;
+        std::string what;
+        try {
+            cppapi::align_surfaces(primary, secondary, aligned, &primary_is_top);
+        } catch (std::runtime_error const& e) {
+            what = e.what();
+        }
+        cppapi::set_alignment_threads(0);
+        return what;
+    };
+    std::string const expected = message(0);
+    EXPECT_THAT(expected, testing::HasSubstr("Surfaces intersect"));
+    EXPECT_EQ(message(3), expected);
+}
+
 void inplace_subtraction(float* buffer_A, const float* buffer_B, std::size_t nsamples) noexcept(true) {
     for (std::size_t i = 0; i < nsamples; i++) {
         buffer_A[i] -= buffer_B[i];
@@ -911,4 +1250,26 @@ TEST_F(SliceFunctionTest, RequestingSliceDataSubtraction) {
     EXPECT_EQ(nr_of_values, expected.size());
 }
 
+TEST_F(SliceFunctionTest, PrefetchReadsRegionSlabBySlab) {
+    slice_bounds.push_back(Bound{0, 2, axis_name::I});
+
+    std::int64_t slab_size = 0;
+    std::size_t const nslabs =
+        cppapi::prefetch_slabs(datahandle, slice_bounds, &slab_size);
+    EXPECT_GE(nslabs, 1);
+    EXPECT_GT(slab_size, 0);
+
+    io_stats const before = thread_io_stats();
+    for (std::size_t i = 0; i < nslabs; ++i) {
+        cppapi::prefetch_slab(datahandle, slice_bounds, i);
+    }
+    io_stats const after = thread_io_stats();
+    EXPECT_EQ(after.subcube_requests - before.subcube_requests, nslabs);
+
+    EXPECT_THROW(
+        cppapi::prefetch_slab(datahandle, slice_bounds, nslabs),
+        std::invalid_argument
+    );
+}
+
 } // namespace
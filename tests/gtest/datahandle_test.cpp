@@ -1,5 +1,6 @@
 #include "cppapi.hpp"
 #include "ctypes.h"
+#include "bufferusage.hpp"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -219,4 +220,96 @@ TEST_F(DataHandleTest, SubtractionReverse) {
     delete subvolume;
 }
 
+TEST_F(DataHandleTest, ReadsAreCountedPerThread) {
+    io_stats const before = thread_io_stats();
+    cppapi::fetch_subvolume(datahandle_reference, *subvolume_reference, NEAREST, 0, size);
+    io_stats const single = thread_io_stats();
+
+    EXPECT_GT(single.requests, before.requests);
+    EXPECT_GT(single.chunks, before.chunks);
+    EXPECT_GT(single.chunk_bytes, before.chunk_bytes);
+
+    /* Every request is counted by how it fetches data */
+    EXPECT_EQ(
+        single.requests - before.requests,
+        (single.subcube_requests - before.subcube_requests) +
+        (single.trace_requests   - before.trace_requests) +
+        (single.sample_requests  - before.sample_requests)
+    );
+
+    DoubleDataHandle datahandle = make_double_datahandle(
+        DEFAULT_DATA.c_str(),
+        CREDENTIALS.c_str(),
+        DEFAULT_DATA.c_str(),
+        CREDENTIALS.c_str(),
+        binary_operator::ADDITION
+    );
+    cppapi::fetch_subvolume(datahandle, *subvolume_reference, NEAREST, 0, size);
+    io_stats const twice = thread_io_stats();
+
+    /* Both cubes of a double handle are read */
+    EXPECT_EQ(twice.requests - single.requests, 2 * (single.requests - before.requests));
+    EXPECT_EQ(twice.chunks - single.chunks, 2 * (single.chunks - before.chunks));
+}
+
+TEST_F(DataHandleTest, DoubleHandleTemporariesAreCounted) {
+    DoubleDataHandle datahandle = make_double_datahandle(
+        DEFAULT_DATA.c_str(),
+        CREDENTIALS.c_str(),
+        DEFAULT_DATA.c_str(),
+        CREDENTIALS.c_str(),
+        binary_operator::ADDITION
+    );
+
+    buffer_usage& usage = thread_buffer_usage();
+    std::int64_t const live = usage.live;
+    usage.peak = live;
+
+    cppapi::fetch_subvolume(datahandle, *subvolume_reference, NEAREST, 0, size);
+
+    /* Scratch buffers are gone once the fetch is done */
+    EXPECT_EQ(usage.live, live);
+    EXPECT_GT(usage.peak, live);
+}
+
+TEST_F(DataHandleTest, SubvolumeBuffersAreCounted) {
+    buffer_usage& usage = thread_buffer_usage();
+    std::int64_t const live = usage.live;
+
+    SurfaceBoundedSubVolume* subvolume = make_subvolume(
+        datahandle_reference.get_metadata(), primary_surface, top_surface, bottom_surface
+    );
+
+    /* Both the samples and the horizontal positions of the segments */
+    std::int64_t const samples   = subvolume->nsamples(0, size) * sizeof(float);
+    std::int64_t const positions = size * sizeof(std::array< float, 2 >);
+    EXPECT_GE(usage.live - live, samples + positions);
+
+    delete subvolume;
+    EXPECT_EQ(usage.live, live);
+}
+
+TEST_F(DataHandleTest, WholeChunkReadsAreSummarized) {
+    SingleDataHandle datahandle = make_single_datahandle(
+        DEFAULT_DATA.c_str(),
+        CREDENTIALS.c_str()
+    );
+    SubCube const subcube(datahandle.get_metadata());
+
+    /* Only handles that ask for it are indexed */
+    EXPECT_EQ(datahandle.brick_index(), nullptr);
+    datahandle.index_bricks();
+    BrickIndex const* bricks = datahandle.brick_index();
+    ASSERT_NE(bricks, nullptr);
+
+    std::int64_t const nbytes = datahandle.subcube_buffer_size(subcube);
+    std::vector< float > data(nbytes / sizeof(float));
+    datahandle.read_subcube(data.data(), nbytes, subcube);
+
+    int const first[] = { 0, 0, 0 };
+    EXPECT_TRUE(bricks->summary(first).known);
+    EXPECT_FALSE(bricks->all_fill(subcube.bounds.lower, subcube.bounds.upper));
+    EXPECT_GT(datahandle.brick_index_size(), 0);
+}
+
 } // namespace
@@ -1,5 +1,6 @@
 #include <limits>
 #include <random>
+#include <vector>
 
 #include "regularsurface.hpp"
 
@@ -50,6 +51,46 @@ TEST(AffineTransformationTest, InverseProperty) {
     EXPECT_NEAR(point.y, finv_f.y, 0.00001) << "f_inv(f(point)).y != point.y";
 }
 
+TEST(AffineTransformationTest, Composition) {
+    auto f = AffineTransformation::from_rotation(2, 0, 7.2111, 3.6056, 33.69);
+    auto g = AffineTransformation::from_rotation(-8, 11, 4.472, 2.236, 333.43);
+
+    Point point{3.5, -12.25};
+    Point expected = f * (g * point);
+    Point actual = (f * g) * point;
+
+    EXPECT_NEAR(expected.x, actual.x, 0.00001);
+    EXPECT_NEAR(expected.y, actual.y, 0.00001);
+}
+
+TEST(AffineTransformationTest, FromImages) {
+    auto f = AffineTransformation::from_rotation(2, 0, 7.2111, 3.6056, 33.69);
+    auto g = AffineTransformation::from_images(
+        f * Point{0, 0}, f * Point{1, 0}, f * Point{0, 1}
+    );
+
+    Point point{17, 4.5};
+    Point expected = f * point;
+    Point actual = g * point;
+
+    EXPECT_NEAR(expected.x, actual.x, 0.00001);
+    EXPECT_NEAR(expected.y, actual.y, 0.00001);
+}
+
+TEST(AffineTransformationTest, BatchTransform) {
+    auto f = AffineTransformation::from_rotation(2, 0, 7.2111, 3.6056, 33.69);
+
+    std::vector< Point > points = {{0, 0}, {1, 0}, {0, 1}, {2.5, -3}, {17, 4.5}};
+    std::vector< Point > transformed(points.size());
+    f.transform(points.data(), points.size(), transformed.data());
+
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        Point expected = f * points[i];
+        EXPECT_EQ(expected.x, transformed[i].x) << "at point " << i;
+        EXPECT_EQ(expected.y, transformed[i].y) << "at point " << i;
+    }
+}
+
 TEST(RegularSurfaceSubscriptTest, SingleIndexOutOfRange) {
     RegularSurface surface =
         RegularSurface(ref_surface_data.data(), nrows, ncols, samples_10_grid, fill);